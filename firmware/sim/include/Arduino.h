@@ -0,0 +1,144 @@
+// ============================================
+// Arduino.h - 主机仿真用的 Arduino 核心接口
+// ============================================
+// 只实现 sketch_sep23a 及其模块用到的部分：时间、GPIO、String、Serial、ESP。
+// millis / delay 走虚拟时钟（src/VirtualClock.h），堆统计走仿真堆（src/SimHeap.h）。
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define DEC 10
+#define HEX 16
+
+// ==================== 时间 ====================
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// ==================== GPIO ====================
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void neopixelWrite(uint8_t pin, uint8_t red, uint8_t green, uint8_t blue);
+
+// ==================== String ====================
+// 与 Arduino 一样缓冲区从堆上分配（仿真堆），临时对象会真实地产生堆抖动
+class String {
+private:
+    char* buffer = nullptr;
+    unsigned int capacity = 0;
+    unsigned int len = 0;
+
+    bool reserveExact(unsigned int size);
+    String& copy(const char* cstr, unsigned int length);
+
+public:
+    String(const char* cstr = "");
+    String(const String& other);
+    String(String&& other) noexcept;
+    explicit String(char c);
+    explicit String(int value, unsigned char base = DEC);
+    explicit String(unsigned int value, unsigned char base = DEC);
+    explicit String(long value, unsigned char base = DEC);
+    explicit String(unsigned long value, unsigned char base = DEC);
+    ~String();
+
+    String& operator=(const String& other);
+    String& operator=(String&& other) noexcept;
+    String& operator=(const char* cstr);
+
+    bool reserve(unsigned int size);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(const char* cstr) { return concat(cstr, cstr ? strlen(cstr) : 0); }
+    bool concat(const String& other) { return concat(other.c_str(), other.len); }
+    String& operator+=(const char* cstr) { concat(cstr); return *this; }
+    String& operator+=(const String& other) { concat(other); return *this; }
+
+    const char* c_str() const { return buffer ? buffer : ""; }
+    unsigned int length() const { return len; }
+    bool isEmpty() const { return len == 0; }
+    char charAt(unsigned int index) const { return index < len ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+
+    bool equals(const char* cstr) const { return strcmp(c_str(), cstr ? cstr : "") == 0; }
+    bool equals(const String& other) const { return len == other.len && equals(other.c_str()); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const char* needle, unsigned int from = 0) const;
+    int indexOf(const String& needle, unsigned int from = 0) const { return indexOf(needle.c_str(), from); }
+    bool startsWith(const char* prefix) const { return strncmp(c_str(), prefix, strlen(prefix)) == 0; }
+    String substring(unsigned int from, unsigned int to = 0xFFFFFFFF) const;
+
+    void replace(const char* find, const char* with);
+    void replace(const String& find, const String& with) { replace(find.c_str(), with.c_str()); }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+    long toInt() const { return strtol(c_str(), nullptr, 10); }
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+
+// ==================== Serial ====================
+// 输出按行交给仿真（带虚拟时间戳），不直接写 stdout
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    size_t write(const char* data, size_t length);
+
+    size_t print(const char* s) { return write(s, strlen(s)); }
+    size_t print(const String& s) { return write(s.c_str(), s.length()); }
+    size_t print(char c) { return write(&c, 1); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    template <typename T>
+    size_t println(const T& value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    size_t println() { return write("\n", 1); }
+
+    size_t printf(const char* format, ...);
+};
+
+extern HardwareSerial Serial;
+
+// ==================== ESP ====================
+class EspClass {
+public:
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+};
+
+extern EspClass ESP;
+
+#endif  // ARDUINO_H
@@ -0,0 +1,106 @@
+// ============================================
+// WebSocketsClient.h - 主机仿真用的 WebSocket 客户端替身
+// ============================================
+// 接口与 links2004/arduinoWebSockets 一致；连接、重连间隔、心跳（ping / pong 超时计数）
+// 按该库的语义在虚拟时钟上建模，对端是进程内的服务器替身（src/SimServer.h），不走真实网络。
+#ifndef WEBSOCKETS_CLIENT_H
+#define WEBSOCKETS_CLIENT_H
+
+#include <Arduino.h>
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient {
+public:
+    typedef std::function<void(WStype_t type, uint8_t* payload, size_t length)> WebSocketClientEvent;
+
+    // 服务器替身投递给客户端的消息，到 atUs 才在 loop() 里处理
+    struct Inbound {
+        uint64_t atUs;
+        WStype_t type;  // TEXT / PING / PONG / DISCONNECTED（对端关闭）
+        std::string payload;
+    };
+
+private:
+    // 已写入 TCP 发送缓冲、尚未被对端确认的数据（占用仿真堆，确认后释放）
+    struct Pending {
+        uint64_t ackAtUs;  // UINT64_MAX 表示链路不通，永远等不到确认
+        void* memory;
+        size_t bytes;
+        size_t heapBytes;
+    };
+
+    String host;
+    uint16_t port = 0;
+    String url;
+    WebSocketClientEvent onEventCallback;
+    bool connected = false;
+    bool started = false;
+    uint32_t connection = 0;  // 服务器替身分配的连接编号
+    void* clientMemory = nullptr;  // 连接期间库分配的收发缓冲
+    unsigned long lastConnectionFail = 0;
+    unsigned long reconnectInterval = 500;
+    unsigned long pingInterval = 0;
+    unsigned long pongTimeout = 0;
+    uint8_t disconnectTimeoutCount = 0;
+    unsigned long lastPing = 0;
+    bool pongReceived = false;
+    uint8_t pongTimeoutCount = 0;
+    std::deque<Inbound> inbox;
+    std::deque<Pending> pending;
+    size_t pendingBytes = 0;
+    size_t pendingHeapBytes = 0;
+    uint32_t failedSends = 0;  // 自上次成功发送二进制帧以来的失败次数
+
+    void tryConnect();
+    void handleHeartbeat();
+    void releaseAcked(uint64_t nowUs);
+    bool write(const uint8_t* payload, size_t length, bool binary);
+    void runEvent(WStype_t type, uint8_t* payload, size_t length);
+    void clientDisconnect(bool notify);
+
+public:
+    void begin(const char* host, uint16_t port, const char* url = "/", const char* protocol = "arduino");
+    void onEvent(WebSocketClientEvent callback) { onEventCallback = callback; }
+    void setReconnectInterval(unsigned long time) { reconnectInterval = time; }
+    void enableHeartbeat(uint32_t pingIntervalMs, uint32_t pongTimeoutMs, uint8_t disconnectCount);
+    void loop();
+    void disconnect();
+    bool isConnected() { return connected; }
+    bool sendBIN(uint8_t* payload, size_t length) { return write(payload, length, true); }
+    bool sendTXT(const char* payload) { return write(reinterpret_cast<const uint8_t*>(payload), strlen(payload), false); }
+    bool sendTXT(String& payload) { return sendTXT(payload.c_str()); }
+    bool sendPing();
+
+    // ---- 仿真用 ----
+    void deliver(Inbound message) { inbox.push_back(std::move(message)); }
+    // 链路恢复：之前等不到确认的数据在 ackAtUs 得到确认
+    void linkRestored(uint64_t ackAtUs);
+    uint32_t connectionId() const { return connection; }
+    uint32_t sendFailures() const { return failedSends; }
+    unsigned long getReconnectInterval() const { return reconnectInterval; }
+    unsigned long getPingInterval() const { return pingInterval; }
+    unsigned long getPongTimeout() const { return pongTimeout; }
+    uint8_t getDisconnectTimeoutCount() const { return disconnectTimeoutCount; }
+    size_t unackedBytes() const { return pendingBytes; }
+    size_t unackedHeapBytes() const { return pendingHeapBytes; }
+};
+
+#endif  // WEBSOCKETS_CLIENT_H
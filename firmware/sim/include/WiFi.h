@@ -0,0 +1,42 @@
+// ============================================
+// WiFi.h - 主机仿真用的 WiFi 接口
+// ============================================
+// begin 后经过固定的虚拟时长变为已连接；协议栈占用的堆从仿真堆里扣掉
+#ifndef WIFI_H
+#define WIFI_H
+
+#include <Arduino.h>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+class IPAddress {
+private:
+    uint8_t octets[4];
+
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : octets{a, b, c, d} {}
+    String toString() const;
+};
+
+class WiFiClass {
+private:
+    unsigned long connectedAt = 0;
+    bool started = false;
+    void* stackMemory = nullptr;
+
+public:
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr);
+    wl_status_t status();
+    IPAddress localIP();
+    String macAddress();
+};
+
+extern WiFiClass WiFi;
+
+#endif  // WIFI_H
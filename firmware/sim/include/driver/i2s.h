@@ -0,0 +1,103 @@
+// ============================================
+// driver/i2s.h - 主机仿真用的 ESP-IDF 旧版 I2S 驱动接口
+// ============================================
+// 结构体字段顺序与 ESP-IDF 4.4 一致（sketch 用指定初始化器）。
+// RX 数据来自仿真音源（src/I2SSource.cpp），按 DMA 缓冲粒度、以采样率在虚拟时钟上产生。
+// 按 ESP32-C3 提供 TDM 字段（SOC_I2S_SUPPORTS_TDM）：I2S_CHANNEL_FMT_MULTIPLE 时音源按 total_chan 交错输出。
+#ifndef DRIVER_I2S_H
+#define DRIVER_I2S_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#define SOC_I2S_SUPPORTS_TDM 1
+
+typedef enum { I2S_NUM_0 = 0, I2S_NUM_MAX } i2s_port_t;
+
+typedef enum {
+    I2S_MODE_MASTER = 1 << 0,
+    I2S_MODE_SLAVE = 1 << 1,
+    I2S_MODE_TX = 1 << 2,
+    I2S_MODE_RX = 1 << 3,
+} i2s_mode_t;
+
+typedef enum {
+    I2S_BITS_PER_SAMPLE_8BIT = 8,
+    I2S_BITS_PER_SAMPLE_16BIT = 16,
+    I2S_BITS_PER_SAMPLE_24BIT = 24,
+    I2S_BITS_PER_SAMPLE_32BIT = 32,
+} i2s_bits_per_sample_t;
+
+typedef enum {
+    I2S_CHANNEL_FMT_RIGHT_LEFT,
+    I2S_CHANNEL_FMT_ALL_RIGHT,
+    I2S_CHANNEL_FMT_ALL_LEFT,
+    I2S_CHANNEL_FMT_ONLY_RIGHT,
+    I2S_CHANNEL_FMT_ONLY_LEFT,
+    I2S_CHANNEL_FMT_MULTIPLE,
+} i2s_channel_fmt_t;
+
+typedef enum {
+    I2S_TDM_ACTIVE_CH0 = 1 << 16,
+    I2S_TDM_ACTIVE_CH1 = 1 << 17,
+    I2S_TDM_ACTIVE_CH2 = 1 << 18,
+    I2S_TDM_ACTIVE_CH3 = 1 << 19,
+    I2S_TDM_ACTIVE_CH4 = 1 << 20,
+    I2S_TDM_ACTIVE_CH5 = 1 << 21,
+    I2S_TDM_ACTIVE_CH6 = 1 << 22,
+    I2S_TDM_ACTIVE_CH7 = 1 << 23,
+} i2s_channel_t;
+
+typedef enum { I2S_MCLK_MULTIPLE_DEFAULT = 0 } i2s_mclk_multiple_t;
+typedef enum { I2S_BITS_PER_CHAN_DEFAULT = 0 } i2s_bits_per_chan_t;
+
+typedef enum {
+    I2S_COMM_FORMAT_STAND_I2S = 0x01,
+    I2S_COMM_FORMAT_STAND_MSB = 0x02,
+    I2S_COMM_FORMAT_I2S = 0x01,
+} i2s_comm_format_t;
+
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct {
+    i2s_mode_t mode;
+    int sample_rate;
+    i2s_bits_per_sample_t bits_per_sample;
+    i2s_channel_fmt_t channel_format;
+    i2s_comm_format_t communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;  // 每个 DMA 缓冲的帧数
+    bool use_apll;
+    bool tx_desc_auto_clear;
+    int fixed_mclk;
+    i2s_mclk_multiple_t mclk_multiple;
+    i2s_bits_per_chan_t bits_per_chan;
+    i2s_channel_t chan_mask;  // TDM 启用的时隙
+    uint32_t total_chan;      // TDM 每帧的时隙数
+    bool left_align;
+    bool big_edin;
+    bool bit_order_msb;
+    bool skip_msk;
+} i2s_config_t;
+
+typedef struct {
+    int mck_io_num;
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int queue_size, void* queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t port);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins);
+esp_err_t i2s_read(i2s_port_t port, void* dest, size_t size, size_t* bytes_read, TickType_t ticks_to_wait);
+esp_err_t i2s_write(i2s_port_t port, const void* src, size_t size, size_t* bytes_written, TickType_t ticks_to_wait);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port);
+
+#endif  // DRIVER_I2S_H
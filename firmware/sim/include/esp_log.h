@@ -0,0 +1,6 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include "esp_err.h"
+
+#endif  // ESP_LOG_H
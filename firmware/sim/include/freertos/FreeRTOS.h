@@ -0,0 +1,23 @@
+// ============================================
+// freertos/FreeRTOS.h - 主机仿真用的 FreeRTOS 节拍
+// ============================================
+// configTICK_RATE_HZ 取 1000（ESP32 Arduino 默认），1 tick = 1 ms，走虚拟时钟
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define configTICK_RATE_HZ 1000
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+#define pdTRUE 1
+#define pdFALSE 0
+
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+
+#endif  // FREERTOS_H
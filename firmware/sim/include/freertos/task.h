@@ -0,0 +1,6 @@
+#ifndef FREERTOS_TASK_H
+#define FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#endif  // FREERTOS_TASK_H
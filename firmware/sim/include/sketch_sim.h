@@ -0,0 +1,17 @@
+// ============================================
+// sketch_sim.h - 编译 .ino 时强制包含的前置声明
+// ============================================
+// Arduino 构建器会为 .ino 自动补函数原型并包含 Arduino.h；主机上用 -include 本文件代替。
+// sketch 新增在定义前就被调用的函数时，要在这里补上声明。
+#ifndef SKETCH_SIM_H
+#define SKETCH_SIM_H
+
+#include <Arduino.h>
+#include <WebSocketsClient.h>
+
+void convert32to16(uint8_t* input32, uint8_t* output16, int samples);
+void handleRelayCommand(const char* text);
+void webSocketEvent(WStype_t type, uint8_t* payload, size_t length);
+void cleanup();
+
+#endif  // SKETCH_SIM_H
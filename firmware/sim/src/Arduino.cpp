@@ -0,0 +1,317 @@
+// ============================================
+// Arduino.cpp - Arduino / ESP32 核心接口的主机实现
+// ============================================
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_err.h>
+
+#include <cctype>
+#include <string>
+
+#include "Hooks.h"
+#include "SimHeap.h"
+#include "VirtualClock.h"
+
+namespace sim {
+
+Hooks& hooks() {
+    static Hooks instance;
+    return instance;
+}
+
+}  // namespace sim
+
+// ==================== 时间 ====================
+// ESP32 上 millis() 是 32 位，约 49.7 天回绕一次；这里保持同样的宽度
+unsigned long millis() { return static_cast<uint32_t>(sim::clock().millis()); }
+unsigned long micros() { return static_cast<uint32_t>(sim::clock().micros()); }
+void delay(uint32_t ms) { sim::clock().advance(uint64_t(ms) * 1000); }
+void delayMicroseconds(uint32_t us) { sim::clock().advance(us); }
+void yield() {}
+
+TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(sim::clock().millis() * configTICK_RATE_HZ / 1000); }
+void vTaskDelay(TickType_t ticks) { sim::clock().advance(uint64_t(ticks) * 1000000 / configTICK_RATE_HZ); }
+
+// ==================== GPIO ====================
+namespace {
+uint8_t pinLevels[64];
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= sizeof(pinLevels)) return;
+    uint8_t level = val ? HIGH : LOW;
+    if (pinLevels[pin] == level) return;
+    pinLevels[pin] = level;
+    if (sim::hooks().gpio) sim::hooks().gpio(pin, level);
+}
+
+int digitalRead(uint8_t pin) { return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW; }
+
+void neopixelWrite(uint8_t pin, uint8_t red, uint8_t green, uint8_t blue) {
+    if (sim::hooks().neopixel) sim::hooks().neopixel(pin, red, green, blue);
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+// ==================== String ====================
+bool String::reserveExact(unsigned int size) {
+    char* grown = static_cast<char*>(sim::heap().realloc(buffer, size + 1));
+    if (!grown) return false;
+    if (!buffer) grown[0] = '\0';
+    buffer = grown;
+    capacity = size;
+    return true;
+}
+
+bool String::reserve(unsigned int size) {
+    if (buffer && capacity >= size) return true;
+    return reserveExact(size);
+}
+
+String& String::copy(const char* cstr, unsigned int length) {
+    if (!reserve(length)) {
+        // 与 Arduino 一样，分配失败时变成无效（空）字符串
+        sim::heap().free(buffer);
+        buffer = nullptr;
+        capacity = len = 0;
+        return *this;
+    }
+    memmove(buffer, cstr, length);
+    buffer[length] = '\0';
+    len = length;
+    return *this;
+}
+
+String::String(const char* cstr) {
+    if (cstr) copy(cstr, strlen(cstr));
+}
+
+String::String(const String& other) { copy(other.c_str(), other.len); }
+
+String::String(String&& other) noexcept : buffer(other.buffer), capacity(other.capacity), len(other.len) {
+    other.buffer = nullptr;
+    other.capacity = other.len = 0;
+}
+
+String::String(char c) { copy(&c, 1); }
+
+String::String(int value, unsigned char base) : String(long(value), base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) {
+    char text[34];
+    if (base == DEC) snprintf(text, sizeof(text), "%ld", value);
+    else snprintf(text, sizeof(text), "%lx", value);
+    copy(text, strlen(text));
+}
+
+String::String(unsigned long value, unsigned char base) {
+    char text[34];
+    snprintf(text, sizeof(text), base == DEC ? "%lu" : "%lx", value);
+    copy(text, strlen(text));
+}
+
+String::~String() { sim::heap().free(buffer); }
+
+String& String::operator=(const String& other) {
+    if (this != &other) copy(other.c_str(), other.len);
+    return *this;
+}
+
+String& String::operator=(String&& other) noexcept {
+    if (this != &other) {
+        sim::heap().free(buffer);
+        buffer = other.buffer;
+        capacity = other.capacity;
+        len = other.len;
+        other.buffer = nullptr;
+        other.capacity = other.len = 0;
+    }
+    return *this;
+}
+
+String& String::operator=(const char* cstr) { return copy(cstr ? cstr : "", cstr ? strlen(cstr) : 0); }
+
+bool String::concat(const char* cstr, unsigned int length) {
+    if (!cstr) return false;
+    if (length == 0) return true;
+    if (!reserve(len + length)) return false;
+    memmove(buffer + len, cstr, length);
+    len += length;
+    buffer[len] = '\0';
+    return true;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    if (from >= len) return -1;
+    const char* found = strchr(buffer + from, c);
+    return found ? int(found - buffer) : -1;
+}
+
+int String::indexOf(const char* needle, unsigned int from) const {
+    if (from >= len) return -1;
+    const char* found = strstr(buffer + from, needle);
+    return found ? int(found - buffer) : -1;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (to > len) to = len;
+    if (from >= to) return String();
+    String out;
+    out.copy(buffer + from, to - from);
+    return out;
+}
+
+void String::replace(const char* find, const char* with) {
+    size_t findLength = strlen(find);
+    if (len == 0 || findLength == 0) return;
+    std::string result;
+    const char* cursor = buffer;
+    while (const char* found = strstr(cursor, find)) {
+        result.append(cursor, found - cursor).append(with);
+        cursor = found + findLength;
+    }
+    if (cursor == buffer) return;
+    result.append(cursor);
+    copy(result.c_str(), static_cast<unsigned int>(result.size()));
+}
+
+void String::toLowerCase() {
+    for (unsigned int i = 0; i < len; i++) buffer[i] = static_cast<char>(tolower(static_cast<unsigned char>(buffer[i])));
+}
+
+void String::toUpperCase() {
+    for (unsigned int i = 0; i < len; i++) buffer[i] = static_cast<char>(toupper(static_cast<unsigned char>(buffer[i])));
+}
+
+void String::trim() {
+    unsigned int begin = 0;
+    unsigned int end = len;
+    while (begin < end && isspace(static_cast<unsigned char>(buffer[begin]))) begin++;
+    while (end > begin && isspace(static_cast<unsigned char>(buffer[end - 1]))) end--;
+    if (begin == 0 && end == len) return;
+    copy(buffer + begin, end - begin);
+}
+
+String operator+(const String& lhs, const String& rhs) {
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+    String out(lhs);
+    out += rhs;
+    return out;
+}
+
+// ==================== Serial ====================
+HardwareSerial Serial;
+
+namespace {
+std::string& serialLine() {
+    static std::string line;
+    return line;
+}
+}  // namespace
+
+void HardwareSerial::begin(unsigned long) {}
+
+size_t HardwareSerial::write(const char* data, size_t length) {
+    std::string& line = serialLine();
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == '\n') {
+            if (sim::hooks().serialLine) sim::hooks().serialLine(line);
+            line.clear();
+        } else if (data[i] != '\r') {
+            line.push_back(data[i]);
+        }
+    }
+    return length;
+}
+
+size_t HardwareSerial::print(long value, int base) {
+    char text[34];
+    snprintf(text, sizeof(text), base == DEC ? "%ld" : "%lx", value);
+    return print(text);
+}
+
+size_t HardwareSerial::print(unsigned long value, int base) {
+    char text[34];
+    snprintf(text, sizeof(text), base == DEC ? "%lu" : "%lx", value);
+    return print(text);
+}
+
+size_t HardwareSerial::print(double value, int digits) {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return print(text);
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write(text, size_t(length) < sizeof(text) ? size_t(length) : sizeof(text) - 1);
+}
+
+// ==================== ESP ====================
+EspClass ESP;
+
+uint32_t EspClass::getHeapSize() { return static_cast<uint32_t>(sim::heap().size()); }
+uint32_t EspClass::getFreeHeap() { return static_cast<uint32_t>(sim::heap().freeSize()); }
+uint32_t EspClass::getMinFreeHeap() { return static_cast<uint32_t>(sim::heap().minFreeSize()); }
+uint32_t EspClass::getMaxAllocHeap() { return static_cast<uint32_t>(sim::heap().largestFreeBlock()); }
+
+// ==================== WiFi ====================
+WiFiClass WiFi;
+
+namespace {
+constexpr unsigned long kWiFiJoinMs = 2300;             // 关联 + DHCP
+constexpr size_t kWiFiStackBytes = 56 * 1024;           // 协议栈与驱动常驻内存
+}  // namespace
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) {
+    if (!started) {
+        stackMemory = sim::heap().malloc(kWiFiStackBytes);
+        started = true;
+    }
+    connectedAt = millis() + kWiFiJoinMs;
+    return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+    if (!started) return WL_IDLE_STATUS;
+    return millis() >= connectedAt ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() { return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 57) : IPAddress(); }
+
+String WiFiClass::macAddress() { return String("24:6F:28:A1:B2:C3"); }
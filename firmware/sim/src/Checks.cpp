@@ -0,0 +1,71 @@
+#include "Checks.h"
+
+#include <cstdarg>
+
+#include "VirtualClock.h"
+
+namespace sim {
+
+Checks& checks() {
+    static Checks instance;
+    return instance;
+}
+
+Checks::Item& Checks::item(const char* name) {
+    for (Item& existing : items) {
+        if (existing.key == name || existing.name == name) return existing;
+    }
+    items.push_back(Item{});
+    items.back().key = name;
+    items.back().name = name;
+    return items.back();
+}
+
+bool Checks::expect(const char* name, bool ok, const char* format, ...) {
+    Item& entry = item(name);
+    if (ok) {
+        entry.passed++;
+        return true;
+    }
+    entry.failed++;
+    if (entry.failures.size() < kKeepFailures) {
+        char message[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+        entry.failures.push_back(formatTime(clock().micros()) + "  " + message);
+    }
+    return false;
+}
+
+void Checks::detail(const char* name, const char* format, ...) {
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    item(name).detail = message;
+}
+
+bool Checks::failed() const {
+    for (const Item& entry : items) {
+        if (entry.failed > 0) return true;
+    }
+    return false;
+}
+
+void Checks::report(FILE* out) const {
+    for (const Item& entry : items) {
+        const char* mark = entry.failed > 0 ? "❌" : entry.passed > 0 ? "✅" : "➖";
+        fprintf(out, "%s %-28s %llu/%llu  %s\n", mark, entry.name.c_str(), (unsigned long long)entry.passed,
+                (unsigned long long)(entry.passed + entry.failed),
+                entry.passed + entry.failed > 0 ? entry.detail.c_str() : "未触发");
+        for (const std::string& failure : entry.failures) fprintf(out, "      %s\n", failure.c_str());
+        if (entry.failed > entry.failures.size()) {
+            fprintf(out, "      ……另有 %llu 次\n", (unsigned long long)(entry.failed - entry.failures.size()));
+        }
+    }
+}
+
+}  // namespace sim
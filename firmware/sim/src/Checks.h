@@ -0,0 +1,45 @@
+// ============================================
+// Checks.h - 仿真过程中的断言汇总
+// ============================================
+// 每条断言按名字累计通过 / 失败次数，失败时记下虚拟时间与原因（每项只留前几条），
+// 结束时统一输出；从未触发的断言单独标出，不算失败。
+#ifndef SIM_CHECKS_H
+#define SIM_CHECKS_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+class Checks {
+private:
+    struct Item {
+        const char* key;  // 调用方传入的字面量，先按指针比较
+        std::string name;
+        uint64_t passed = 0;
+        uint64_t failed = 0;
+        std::vector<std::string> failures;
+        std::string detail;
+    };
+
+    static constexpr size_t kKeepFailures = 5;
+    std::vector<Item> items;
+
+    Item& item(const char* name);
+
+public:
+    // 返回 ok，便于调用方在失败时附加处理
+    bool expect(const char* name, bool ok, const char* format, ...) __attribute__((format(printf, 4, 5)));
+    // 结束时显示在该项后面的统计信息（覆盖之前的值）
+    void detail(const char* name, const char* format, ...) __attribute__((format(printf, 3, 4)));
+    bool failed() const;
+    void report(FILE* out) const;
+};
+
+Checks& checks();
+
+}  // namespace sim
+
+#endif  // SIM_CHECKS_H
@@ -0,0 +1,24 @@
+// ============================================
+// Hooks.h - 固件可观测输出的回调
+// ============================================
+// Arduino 桩（串口、GPIO、灯珠）把输出交给这里，由 main.cpp 的断言订阅
+#ifndef SIM_HOOKS_H
+#define SIM_HOOKS_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace sim {
+
+struct Hooks {
+    std::function<void(const std::string& line)> serialLine;  // 不含换行
+    std::function<void(uint8_t pin, int level)> gpio;          // 电平变化时
+    std::function<void(uint8_t pin, uint8_t r, uint8_t g, uint8_t b)> neopixel;
+};
+
+Hooks& hooks();
+
+}  // namespace sim
+
+#endif  // SIM_HOOKS_H
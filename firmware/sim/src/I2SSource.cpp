@@ -0,0 +1,151 @@
+#include "I2SSource.h"
+
+#include <driver/i2s.h>
+
+#include <cstring>
+
+#include "SimHeap.h"
+#include "VirtualClock.h"
+
+namespace sim {
+
+I2SSource& i2s() {
+    static I2SSource instance;
+    return instance;
+}
+
+int32_t I2SSource::sample32(uint64_t index) {
+    uint32_t noise = static_cast<uint32_t>((index * 2654435761u) >> 7) & 0xFFFF;
+    return static_cast<int32_t>((static_cast<uint32_t>(index & 0xFFFF) << 16) | noise);
+}
+
+uint64_t I2SSource::producedAt(uint64_t us) const {
+    return us <= installedAtUs ? 0 : (us - installedAtUs) * sampleRate / 1000000;
+}
+
+bool I2SSource::install(uint32_t rate, uint32_t bitsPerSample, int bufferCount, int bufferLength, uint32_t channels) {
+    if (installed || bufferCount <= 0 || bufferCount > 64 || bufferLength <= 0 || channels == 0) return false;
+    sampleRate = rate;
+    bytesPerSample = bitsPerSample / 8;
+    channelCount = channels;
+    bytesPerFrame = bytesPerSample * channels;
+    bufferFrames = bufferLength;
+    ringFrames = uint64_t(bufferCount) * bufferLength;
+    // 与驱动一样每个 DMA 缓冲单独分配
+    size_t freeBefore = heap().freeSize();
+    for (int i = 0; i < bufferCount; i++) {
+        dmaMemory[i] = heap().malloc(size_t(bufferLength) * bytesPerFrame);
+        if (!dmaMemory[i]) {
+            for (int j = 0; j < i; j++) heap().free(dmaMemory[j]);
+            return false;
+        }
+    }
+    dmaBuffers = bufferCount;
+    heapBytes = freeBefore - heap().freeSize();
+    installedAtUs = clock().micros();
+    consumed = 0;
+    installed = true;
+    return true;
+}
+
+void I2SSource::uninstall() {
+    for (int i = 0; i < dmaBuffers; i++) {
+        heap().free(dmaMemory[i]);
+        dmaMemory[i] = nullptr;
+    }
+    dmaBuffers = 0;
+    installed = false;
+}
+
+void I2SSource::dropOverflow() {
+    uint64_t completed = completedAt(clock().micros());
+    if (completed - consumed <= ringFrames) return;
+    uint64_t keepFrom = completed - ringFrames;
+    overflows += (keepFrom - consumed + bufferFrames - 1) / bufferFrames;
+    droppedFrames += keepFrom - consumed;
+    consumed = keepFrom;
+}
+
+size_t I2SSource::read(uint8_t* dest, size_t size, uint64_t waitUs) {
+    dropOverflow();
+    uint64_t want = size / bytesPerFrame;
+    if (want == 0) return 0;
+    lastReadBacklog = completedAt(clock().micros()) - consumed;
+
+    // 等到覆盖所需帧的那个 DMA 缓冲写满
+    uint64_t neededCompleted = (consumed + want + bufferFrames - 1) / bufferFrames * bufferFrames;
+    uint64_t readyUs = installedAtUs + (neededCompleted * 1000000 + sampleRate - 1) / sampleRate;
+    uint64_t nowUs = clock().micros();
+    if (readyUs > nowUs) {
+        uint64_t waitFor = readyUs - nowUs;
+        clock().advance(waitFor <= waitUs ? waitFor : waitUs);
+    }
+
+    uint64_t available = completedAt(clock().micros()) - consumed;
+    uint64_t frames = available < want ? available : want;
+    lastReadFirst = consumed;
+    for (uint64_t i = 0; i < frames; i++) {
+        uint64_t index = consumed + i;
+        uint8_t* frame = dest + i * bytesPerFrame;
+        for (uint32_t c = 0; c < channelCount; c++) {
+            if (bytesPerSample == 4) {
+                int32_t value = sample32(index, c);
+                memcpy(frame + c * 4, &value, 4);
+            } else {
+                int16_t value = static_cast<int16_t>(sample32(index, c) >> 16);
+                memcpy(frame + c * 2, &value, 2);
+            }
+        }
+    }
+    consumed += frames;
+    return frames * bytesPerFrame;
+}
+
+}  // namespace sim
+
+// ==================== ESP-IDF 接口 ====================
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int, void*) {
+    if (port != I2S_NUM_0 || !config) return ESP_ERR_INVALID_ARG;
+    if (!(config->mode & I2S_MODE_RX)) return ESP_OK;  // 仿真只提供输入
+    uint32_t channels = 1;
+    if (config->channel_format == I2S_CHANNEL_FMT_RIGHT_LEFT) channels = 2;
+    if (config->channel_format == I2S_CHANNEL_FMT_MULTIPLE) {
+        // 与驱动一样检查：时隙数要盖住掩码里最高的声道，一个 DMA 缓冲不超过 4092 字节
+        uint32_t mask = static_cast<uint32_t>(config->chan_mask) / I2S_TDM_ACTIVE_CH0;
+        uint32_t highest = 0;
+        while (mask >> highest) highest++;
+        channels = config->total_chan;
+        if (mask == 0 || channels < highest) return ESP_ERR_INVALID_ARG;
+        if (uint32_t(config->dma_buf_len) * channels * (config->bits_per_sample / 8) > 4092) return ESP_ERR_INVALID_ARG;
+    }
+    if (!sim::i2s().install(config->sample_rate, config->bits_per_sample, config->dma_buf_count, config->dma_buf_len,
+                            channels)) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+    if (port != I2S_NUM_0) return ESP_ERR_INVALID_ARG;
+    sim::i2s().uninstall();
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins) {
+    return port == I2S_NUM_0 && pins ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2s_read(i2s_port_t port, void* dest, size_t size, size_t* bytes_read, TickType_t ticks_to_wait) {
+    *bytes_read = 0;
+    if (port != I2S_NUM_0 || !sim::i2s().isInstalled()) return ESP_ERR_INVALID_STATE;
+    uint64_t waitUs = ticks_to_wait == portMAX_DELAY ? UINT64_MAX : uint64_t(ticks_to_wait) * 1000000 / configTICK_RATE_HZ;
+    *bytes_read = sim::i2s().read(static_cast<uint8_t*>(dest), size, waitUs);
+    return ESP_OK;
+}
+
+esp_err_t i2s_write(i2s_port_t port, const void*, size_t size, size_t* bytes_written, TickType_t) {
+    *bytes_written = port == I2S_NUM_0 ? size : 0;
+    return port == I2S_NUM_0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port) { return port == I2S_NUM_0 ? ESP_OK : ESP_ERR_INVALID_ARG; }
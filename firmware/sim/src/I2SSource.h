@@ -0,0 +1,69 @@
+// ============================================
+// I2SSource.h - 仿真 I2S 麦克风与 DMA 环
+// ============================================
+// 采样按采样率在虚拟时钟上连续产生，DMA 每填满一个缓冲（dma_buf_len 帧）才对 i2s_read 可见；
+// 环里最多 dma_buf_count 个缓冲，读得不够快时与真实驱动一样丢最旧的整块（溢出计数）。
+// 样本内容是确定的“序号锯齿”：32 位样本高 16 位 = 样本序号的低 16 位，低 16 位是噪声，
+// 服务器替身据此校验 32→16 位转换、帧内连续性，并换算出每个样本的真实采集时刻。
+// 多声道（TDM / 立体声）时每帧按声道交错，第 c 个声道的高 16 位再异或 c << 8，声道选错或步长错都能看出来。
+#ifndef I2S_SOURCE_H
+#define I2S_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sim {
+
+class I2SSource {
+private:
+    bool installed = false;
+    uint64_t installedAtUs = 0;
+    uint32_t sampleRate = 16000;
+    uint32_t bytesPerSample = 4;
+    uint32_t channelCount = 1;
+    uint32_t bytesPerFrame = 4;
+    uint64_t bufferFrames = 1024;
+    uint64_t ringFrames = 8 * 1024;
+    uint64_t consumed = 0;  // 已被读走（或因溢出丢弃）的帧数
+    uint64_t overflows = 0;
+    uint64_t droppedFrames = 0;
+    uint64_t lastReadFirst = 0;
+    uint64_t lastReadBacklog = 0;  // 上次读开始时 DMA 环里已就绪的帧数
+    void* dmaMemory[64] = {};
+    int dmaBuffers = 0;
+    size_t heapBytes = 0;  // DMA 缓冲占用的堆（含块头）
+
+    uint64_t producedAt(uint64_t us) const;
+    uint64_t completedAt(uint64_t us) const { return producedAt(us) / bufferFrames * bufferFrames; }
+    void dropOverflow();
+
+public:
+    bool install(uint32_t rate, uint32_t bitsPerSample, int bufferCount, int bufferLength, uint32_t channels = 1);
+    void uninstall();
+    // 最多等待 waitUs（UINT64_MAX 为无限），返回读到的字节数
+    size_t read(uint8_t* dest, size_t size, uint64_t waitUs);
+
+    static int32_t sample32(uint64_t index);
+    // 第 channel 个声道的样本；声道 0 即 sample32
+    static int32_t sample32(uint64_t index, uint32_t channel) {
+        return static_cast<int32_t>(static_cast<uint32_t>(sample32(index)) ^ (channel << 24));
+    }
+    bool isInstalled() const { return installed; }
+    uint32_t rate() const { return sampleRate; }
+    uint32_t channels() const { return channelCount; }
+    uint64_t bufferDurationUs() const { return bufferFrames * 1000000 / sampleRate; }
+    uint64_t ringDurationUs() const { return ringFrames * 1000000 / sampleRate; }
+    // 第 index 个样本的采集时刻
+    uint64_t frameTimeUs(uint64_t index) const { return installedAtUs + index * 1000000 / sampleRate; }
+    uint64_t lastReadFirstFrame() const { return lastReadFirst; }
+    uint64_t lastReadBacklogUs() const { return lastReadBacklog * 1000000 / sampleRate; }
+    uint64_t overflowCount() const { return overflows; }
+    uint64_t droppedFrameCount() const { return droppedFrames; }
+    size_t dmaHeapBytes() const { return heapBytes; }
+};
+
+I2SSource& i2s();
+
+}  // namespace sim
+
+#endif  // I2S_SOURCE_H
@@ -0,0 +1,114 @@
+#include "SimHeap.h"
+
+#include <cstring>
+
+namespace sim {
+
+SimHeap& heap() {
+    static SimHeap instance(320 * 1024);
+    return instance;
+}
+
+SimHeap::SimHeap(size_t bytes)
+    : storage(new uint64_t[bytes / sizeof(uint64_t)]),
+      arena(reinterpret_cast<uint8_t*>(storage.get())),
+      capacity(bytes / kAlign * kAlign),
+      freeBytes(capacity),
+      minFreeBytes(capacity) {
+    Header* first = at(0);
+    first->size = static_cast<uint32_t>(capacity);
+    first->used = 0;
+}
+
+void SimHeap::coalesce(size_t offset) {
+    Header* block = at(offset);
+    size_t next = offset + block->size;
+    while (next < capacity && !at(next)->used) {
+        block->size += at(next)->size;
+        next = offset + block->size;
+    }
+}
+
+void* SimHeap::malloc(size_t size) {
+    allocations++;
+    size_t need = sizeof(Header) + (size + kAlign - 1) / kAlign * kAlign;
+    if (need < kMinBlock) need = kMinBlock;
+    for (size_t offset = 0; offset < capacity; offset += at(offset)->size) {
+        Header* block = at(offset);
+        if (block->used) continue;
+        coalesce(offset);
+        if (block->size < need) continue;
+        // 剩余部分足够大才切开，否则整块给出去
+        if (block->size - need >= kMinBlock) {
+            Header* rest = at(offset + need);
+            rest->size = static_cast<uint32_t>(block->size - need);
+            rest->used = 0;
+            block->size = static_cast<uint32_t>(need);
+        }
+        block->used = 1;
+        freeBytes -= block->size;
+        if (freeBytes < minFreeBytes) minFreeBytes = freeBytes;
+        liveBlocks++;
+        return reinterpret_cast<uint8_t*>(block) + sizeof(Header);
+    }
+    failures++;
+    return nullptr;
+}
+
+void SimHeap::free(void* ptr) {
+    if (!ptr) return;
+    Header* block = reinterpret_cast<Header*>(static_cast<uint8_t*>(ptr) - sizeof(Header));
+    block->used = 0;
+    freeBytes += block->size;
+    liveBlocks--;
+}
+
+void* SimHeap::realloc(void* ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    Header* block = reinterpret_cast<Header*>(static_cast<uint8_t*>(ptr) - sizeof(Header));
+    size_t payload = block->size - sizeof(Header);
+    if (size <= payload) return ptr;
+    // 先尝试就地吞并后面的空闲块
+    size_t offset = reinterpret_cast<uint8_t*>(block) - arena;
+    size_t next = offset + block->size;
+    if (next < capacity && !at(next)->used) {
+        coalesce(next);
+        size_t need = sizeof(Header) + (size + kAlign - 1) / kAlign * kAlign;
+        if (block->size + at(next)->size >= need) {
+            uint32_t merged = block->size + at(next)->size;
+            freeBytes -= at(next)->size;
+            block->size = merged;
+            if (merged - need >= kMinBlock) {
+                Header* rest = at(offset + need);
+                rest->size = static_cast<uint32_t>(merged - need);
+                rest->used = 0;
+                block->size = static_cast<uint32_t>(need);
+                freeBytes += rest->size;
+            }
+            if (freeBytes < minFreeBytes) minFreeBytes = freeBytes;
+            return ptr;
+        }
+    }
+    void* moved = malloc(size);
+    if (!moved) return nullptr;
+    memcpy(moved, ptr, payload);
+    free(ptr);
+    return moved;
+}
+
+size_t SimHeap::largestFreeBlock() {
+    size_t largest = 0;
+    for (size_t offset = 0; offset < capacity; offset += at(offset)->size) {
+        if (at(offset)->used) continue;
+        coalesce(offset);
+        if (at(offset)->size > largest) largest = at(offset)->size;
+    }
+    return largest > sizeof(Header) ? largest - sizeof(Header) : 0;
+}
+
+double SimHeap::fragmentation() {
+    if (freeBytes == 0) return 0;
+    return 1.0 - double(largestFreeBlock()) / double(freeBytes);
+}
+
+}  // namespace sim
@@ -0,0 +1,70 @@
+// ============================================
+// SimHeap.h - 仿真堆（模拟 ESP32 的 DRAM 堆）
+// ============================================
+// 固定大小的一块内存，首次适配 + 相邻空闲块合并，每块 8 字节头部。
+// 固件侧的 String、WebSocket 收发缓冲、I2S DMA 缓冲、WiFi 协议栈都从这里分配，
+// 所以 ESP.getFreeHeap / getMaxAllocHeap 能反映真实的泄漏与碎片化趋势。
+// 分配策略与 ESP-IDF 的 multi_heap 不完全相同，看的是趋势而不是精确字节数。
+#ifndef SIM_HEAP_H
+#define SIM_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace sim {
+
+class SimHeap {
+private:
+    struct Header {
+        uint32_t size;  // 含头部
+        uint32_t used;
+    };
+
+    static constexpr size_t kAlign = 8;
+    static constexpr size_t kMinBlock = sizeof(Header) + kAlign;
+
+    std::unique_ptr<uint64_t[]> storage;
+    uint8_t* arena;
+    size_t capacity;
+    size_t freeBytes;
+    size_t minFreeBytes;
+    size_t liveBlocks = 0;
+    uint64_t allocations = 0;
+    uint64_t failures = 0;
+
+    Header* at(size_t offset) { return reinterpret_cast<Header*>(arena + offset); }
+    // 把 offset 处空闲块与其后的连续空闲块合并
+    void coalesce(size_t offset);
+
+public:
+    explicit SimHeap(size_t bytes);
+
+    SimHeap(const SimHeap&) = delete;
+    SimHeap& operator=(const SimHeap&) = delete;
+
+    void* malloc(size_t size);
+    void* realloc(void* ptr, size_t size);
+    void free(void* ptr);
+
+    // ptr 所在块占用的堆（含头部）
+    size_t blockSize(const void* ptr) const {
+        return reinterpret_cast<const Header*>(static_cast<const uint8_t*>(ptr) - sizeof(Header))->size;
+    }
+    size_t size() const { return capacity; }
+    size_t freeSize() const { return freeBytes; }
+    size_t minFreeSize() const { return minFreeBytes; }
+    size_t largestFreeBlock();
+    size_t blocks() const { return liveBlocks; }
+    uint64_t totalAllocations() const { return allocations; }
+    uint64_t allocFailures() const { return failures; }
+    // 碎片率：1 - 最大可分配块 / 空闲总量
+    double fragmentation();
+};
+
+// ESP32-C3 启动后可用堆约 320 KB（WiFi 协议栈另行在 WiFi.begin 时扣除）
+SimHeap& heap();
+
+}  // namespace sim
+
+#endif  // SIM_HEAP_H
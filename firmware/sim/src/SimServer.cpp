@@ -0,0 +1,374 @@
+#include "SimServer.h"
+
+#include <Arduino.h>
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "Checks.h"
+#include "Decimator.h"
+#include "I2SSource.h"
+#include "VirtualClock.h"
+
+namespace sim {
+
+namespace {
+
+// 窄带构建（make NARROWBAND=1）时固件上行的是 Decimator.h 抽取到 8 kHz 后的样本
+#ifndef NARROWBAND
+#define NARROWBAND 0
+#endif
+constexpr size_t kDecimation = NARROWBAND ? 2 : 1;
+
+// TDM 构建（make TDM_CHANNELS=8 UPLINK_CHANNEL_MASK=0x85）时上行的是选中声道高 16 位的平均
+#ifndef TDM_CHANNELS
+#define TDM_CHANNELS 0
+#endif
+#ifndef UPLINK_CHANNEL_MASK
+#define UPLINK_CHANNEL_MASK 0x1
+#endif
+
+// 音源第 index 帧转成上行 16 位（抽取前）应有的值
+int16_t expectedSample(uint64_t index) {
+    if (TDM_CHANNELS == 0) return static_cast<int16_t>(I2SSource::sample32(index) >> 16);
+    int32_t sum = 0;
+    int32_t count = 0;
+    for (int c = 0; c < TDM_CHANNELS; c++) {
+        if (!(UPLINK_CHANNEL_MASK & (1u << c))) continue;
+        sum += static_cast<int16_t>(I2SSource::sample32(index, c) >> 16);
+        count++;
+    }
+    return static_cast<int16_t>(sum / count);
+}
+
+// 窗口最新一个输入样本为音源第 newest 个时，抽取输出应有的值
+int16_t expectedDecimated(uint64_t newest) {
+    int16_t window[HALFBAND_TAPS];
+    for (int i = 0; i < HALFBAND_TAPS; i++) window[i] = expectedSample(newest + 1 - HALFBAND_TAPS + i);
+    return halfbandFilter(window);
+}
+
+std::unique_ptr<SimServer>& instance() {
+    static std::unique_ptr<SimServer> server;
+    return server;
+}
+
+struct Phrase {
+    const char* text;
+    int intent;  // 与 server/lib/relayCommand.ts 的 relayIntent 一致：关 / off → 0，开 / on → 1
+};
+
+const Phrase kPhrases[] = {
+    {"打开客厅的灯", 1}, {"关灯", 0}, {"帮我开一下灯", 1}, {"把灯关掉", 0},
+    {"turn on the light", 1}, {"turn off the light", 0},
+};
+
+}  // namespace
+
+SimServer& server() { return *instance(); }
+
+void startServer(const ServerConfig& config) {
+    instance().reset(new SimServer(config));
+    instance()->start();
+}
+
+SimServer::SimServer(const ServerConfig& cfg) : config(cfg), rngState(cfg.seed * 0x9E3779B97F4A7C15ull + 1) {}
+
+// ==================== 随机 ====================
+// splitmix64：跨平台结果一致（std 分布的实现因库而异）
+double SimServer::random() {
+    uint64_t z = (rngState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (double(z >> 11) + 1.0) / 9007199254740993.0;  // (0, 1]
+}
+
+uint64_t SimServer::exponentialUs(double meanMin) {
+    return static_cast<uint64_t>(-std::log(random()) * meanMin * 60e6);
+}
+
+void SimServer::scheduleEvery(double meanMin, void (SimServer::*action)()) {
+    if (meanMin <= 0) return;
+    clock().after(exponentialUs(meanMin), [this, meanMin, action]() {
+        (this->*action)();
+        scheduleEvery(meanMin, action);
+    });
+}
+
+void SimServer::start() {
+    scheduleEvery(config.commandEveryMin, &SimServer::sendCommand);
+    scheduleEvery(config.closeEveryMin, &SimServer::closeConnection);
+    scheduleEvery(config.outageEveryMin, &SimServer::startOutage);
+    scheduleEvery(config.blackholeEveryMin, &SimServer::startBlackhole);
+}
+
+void SimServer::deliver(WStype_t type, std::string payload, uint64_t delayUs) {
+    if (peer) peer->deliver(WebSocketsClient::Inbound{clock().micros() + delayUs, type, std::move(payload)});
+}
+
+// ==================== 故障注入 ====================
+void SimServer::closeConnection() {
+    if (!open || closing || link != Link::Up || clock().micros() < readyAtUs) return;
+    closes++;
+    closing = true;
+    deliver(WStype_DISCONNECTED, "", uint64_t(config.latencyMs) * 1000);
+}
+
+void SimServer::startOutage() {
+    if (link != Link::Up) return;
+    outages++;
+    link = Link::Refusing;
+    // 服务重启：已有连接被对端复位
+    if (open && !closing) {
+        closing = true;
+        deliver(WStype_DISCONNECTED, "", uint64_t(config.latencyMs) * 1000);
+    }
+    double seconds = config.outageMinS + random() * (config.outageMaxS - config.outageMinS);
+    clock().after(static_cast<uint64_t>(seconds * 1e6), [this]() { endFault(); });
+}
+
+void SimServer::startBlackhole() {
+    if (link != Link::Up) return;
+    blackholes++;
+    link = Link::Blackhole;
+    blackholeStartUs = clock().micros();
+    lastPingUs = 0;
+    resync = true;
+    double seconds = config.blackholeMinS + random() * (config.blackholeMaxS - config.blackholeMinS);
+    clock().after(static_cast<uint64_t>(seconds * 1e6), [this]() { endFault(); });
+}
+
+void SimServer::endFault() {
+    bool wasBlackhole = link == Link::Blackhole;
+    link = Link::Up;
+    faultEndUs = clock().micros();
+    resync = true;
+    if (!wasBlackhole || !peer) return;
+    // 链路恢复后 TCP 重传成功，积压的发送缓冲得到确认
+    peer->linkRestored(clock().micros() + 2 * uint64_t(config.latencyMs) * 1000);
+    // 短黑洞可能没被心跳发现；过了检测上限就不再把之后的心跳断开归到这次黑洞
+    uint64_t startedAt = blackholeStartUs;
+    uint64_t bound = (uint64_t(peer->getPingInterval()) +
+                      uint64_t(peer->getDisconnectTimeoutCount()) * peer->getPongTimeout() + 2 * config.slackMs) *
+                     1000;
+    clock().at(startedAt + bound, [this, startedAt]() {
+        if (blackholeStartUs == startedAt) blackholeStartUs = 0;
+    });
+}
+
+// ==================== 指令 ====================
+void SimServer::sendCommand() {
+    if (!open || closing || link != Link::Up || clock().micros() < readyAtUs || outstandingId) return;
+    const Phrase& phrase = kPhrases[static_cast<size_t>(random() * (sizeof(kPhrases) / sizeof(kPhrases[0]))) %
+                                    (sizeof(kPhrases) / sizeof(kPhrases[0]))];
+    uint32_t id = nextCommandId++;
+    outstandingId = id;
+    outstandingIntent = phrase.intent;
+    outstandingSentUs = clock().micros();
+    commandsSent++;
+    deliver(WStype_TEXT, "#" + std::to_string(id) + " " + phrase.text, uint64_t(config.latencyMs) * 1000);
+
+    uint32_t conn = connection;
+    clock().after(uint64_t(config.ackTimeoutMs) * 1000, [this, id, conn]() {
+        if (outstandingId != id) return;
+        outstandingId = 0;
+        if (open && !closing && connection == conn && link == Link::Up) {
+            checks().expect("command_ack", false, "指令 #%u 超过 %u ms 未回执", id, config.ackTimeoutMs);
+        } else {
+            commandsLost++;  // 连接已断，服务器侧会重发，不算固件问题
+        }
+    });
+}
+
+// ==================== 连接 ====================
+SimServer::ConnectResult SimServer::connect(WebSocketsClient* client, const char*, uint32_t& blockMs) {
+    uint64_t now = clock().micros();
+    uint64_t interval = uint64_t(client->getReconnectInterval()) * 1000;
+    peer = client;
+    attempts++;
+
+    // 库用 millis() 比较，允许 1 ms 截断误差
+    uint64_t since = lastFailedAttemptEndUs > disconnectedAtUs ? lastFailedAttemptEndUs : disconnectedAtUs;
+    if (since > 0) {
+        checks().expect("reconnect_spacing", now + 1000 >= since + interval, "距上次失败 / 断开仅 %llu ms",
+                        (unsigned long long)((now - since) / 1000));
+    }
+
+    if (link != Link::Up) {
+        bool blackhole = link == Link::Blackhole;
+        (blackhole ? timedOut : refused)++;
+        blockMs = blackhole ? config.connectTimeoutMs : config.refusedMs;
+        lastFailedAttemptEndUs = now + uint64_t(blockMs) * 1000;
+        return blackhole ? ConnectResult::TimedOut : ConnectResult::Refused;
+    }
+
+    uint64_t slack = uint64_t(config.slackMs) * 1000;
+    if (everConnected && faultEndUs > disconnectedAtUs) {
+        uint64_t bound = interval + uint64_t(config.connectTimeoutMs) * 1000 + slack;
+        checks().expect("reconnect_after_fault", now - faultEndUs <= bound, "故障结束 %llu ms 后才重连",
+                        (unsigned long long)((now - faultEndUs) / 1000));
+    } else if (everConnected) {
+        checks().expect("reconnect_after_close", now - disconnectedAtUs <= interval + slack, "断开 %llu ms 后才重连",
+                        (unsigned long long)((now - disconnectedAtUs) / 1000));
+    }
+
+    blockMs = config.handshakeMs;
+    readyAtUs = now + uint64_t(blockMs) * 1000;
+    open = true;
+    closing = false;
+    resync = true;
+    lastPingUs = 0;
+    connection++;
+    connections++;
+    everConnected = true;
+    lastFailedAttemptEndUs = 0;
+    return ConnectResult::Accepted;
+}
+
+void SimServer::onClosed(CloseReason reason) {
+    uint64_t now = clock().micros();
+    if (reason == CloseReason::Heartbeat) {
+        heartbeatDrops++;
+        if (blackholeStartUs) {
+            // 最坏情况：黑洞刚好在一次 pong 之后开始，等满一个 ping 间隔，再连续 N 次 pong 超时
+            uint64_t bound = (uint64_t(peer->getPingInterval()) +
+                              uint64_t(peer->getDisconnectTimeoutCount()) * peer->getPongTimeout() +
+                              2 * config.slackMs) *
+                             1000;
+            checks().expect("halfopen_detect", now - blackholeStartUs <= bound, "半开连接 %llu ms 后才发现（上限 %llu）",
+                            (unsigned long long)((now - blackholeStartUs) / 1000), (unsigned long long)(bound / 1000));
+            blackholeStartUs = 0;
+        } else {
+            checks().expect("halfopen_detect", false, "链路正常时心跳超时断开");
+        }
+    }
+    open = false;
+    closing = false;
+    disconnectedAtUs = now;
+}
+
+// ==================== 数据 ====================
+bool SimServer::onPing() {
+    if (!open || link != Link::Up) return false;
+    uint64_t now = clock().micros();
+    if (lastPingUs) {
+        uint64_t interval = uint64_t(peer->getPingInterval()) * 1000;
+        uint64_t elapsed = now - lastPingUs;
+        checks().expect("heartbeat_interval",
+                        elapsed + 1000 >= interval && elapsed <= interval + uint64_t(config.slackMs) * 1000,
+                        "ping 间隔 %llu ms", (unsigned long long)(elapsed / 1000));
+    }
+    lastPingUs = now;
+    deliver(WStype_PONG, "", 2 * uint64_t(config.latencyMs) * 1000);
+    return true;
+}
+
+void SimServer::onText(const char* payload, size_t length) {
+    if (!open || link != Link::Up) return;
+    std::string text(payload, length);
+    unsigned long id = 0;
+    int relay = -1;
+    if (sscanf(text.c_str(), "{\"type\":\"ack\",\"id\":%lu,\"relay\":%d}", &id, &relay) != 2) return;
+    if (!checks().expect("command_ack", outstandingId != 0 && id == outstandingId,
+                         "回执 #%lu 与待确认指令 #%u 不符", id, outstandingId)) {
+        return;
+    }
+    uint64_t latency = clock().micros() - outstandingSentUs;
+    if (latency > maxAckUs) maxAckUs = latency;
+    checks().expect("command_ack", relay == outstandingIntent, "指令 #%lu 期望继电器 %d，回执为 %d", id,
+                    outstandingIntent, relay);
+    checks().expect("relay_gpio", digitalRead(config.relayPin) == outstandingIntent, "回执后 GPIO%u 电平 %d，期望 %d",
+                    config.relayPin, digitalRead(config.relayPin), outstandingIntent);
+    outstandingId = 0;
+}
+
+void SimServer::onBinary(const uint8_t* payload, size_t length) {
+    if (!open || closing || link != Link::Up) return;
+    frames++;
+    if (!checks().expect("frame_format", length >= 8 && (length - 8) % 2 == 0, "帧长 %zu 字节", length)) return;
+
+    uint32_t seq;
+    uint32_t captureMs;
+    memcpy(&seq, payload, 4);
+    memcpy(&captureMs, payload + 4, 4);
+    size_t samples = (length - 8) / 2;
+    const I2SSource& source = i2s();
+    if (samples * kDecimation < source.rate() / 20) shortFrames++;
+
+    // 32→16 位转换：每个样本应等于音源的高 16 位（TDM 时为选中声道的平均）
+    uint64_t first = source.lastReadFirstFrame();
+    size_t bad = samples;
+    int16_t value = 0;
+    int16_t expected = 0;
+    if (kDecimation == 1) {
+        for (size_t i = 0; i < samples && bad == samples; i++) {
+            memcpy(&value, payload + 8 + i * 2, 2);
+            expected = expectedSample(first + i);
+            if (value != expected) bad = i;
+        }
+    } else {
+        // 抽取：只比对滤波窗口完全落在本次读取内的输出（更早的历史可能跨过断线或 DMA 溢出）。
+        // 上一次读到奇数个样本时，剩下的一个与本次第一个配对，两种对齐都试
+        for (size_t carry = 0; carry < 2; carry++) {
+            bad = samples;
+            for (size_t j = 0; j < samples && bad == samples; j++) {
+                uint64_t offset = 2 * j + 1 - carry;
+                if (offset < HALFBAND_TAPS - 1) continue;
+                memcpy(&value, payload + 8 + j * 2, 2);
+                expected = expectedDecimated(first + offset);
+                if (value != expected) bad = j;
+            }
+            if (bad == samples) break;
+        }
+    }
+    checks().expect("pcm_conversion", bad == samples, "第 %zu 个样本为 %d，应为 %d", bad, value, expected);
+
+    if (!resync) {
+        uint32_t failures = peer->sendFailures();
+        checks().expect("frame_seq", seq == lastSeq + 1 + failures, "序号 %u，上一帧 %u，其间发送失败 %u 次", seq,
+                        lastSeq, failures);
+        uint64_t dropped = source.droppedFrameCount() - lastDropped;
+        checks().expect("dma_no_overflow", dropped == 0, "两帧之间 DMA 溢出丢弃 %llu ms 音频",
+                        (unsigned long long)(dropped * 1000 / source.rate()));
+    }
+
+    // 帧头采集时间与音源真实时刻的偏差（都是 32 位毫秒，按回绕差值计算）。
+    // 固件以“读完的时刻 - 本块时长”作为采集时间：读到的若是 DMA 环里积压的旧数据，
+    // 帧头就晚于真实时刻，晚多少由读开始时的积压量决定，但不应早于真实时刻
+    uint32_t trueMs = static_cast<uint32_t>(source.frameTimeUs(first) / 1000);
+    int64_t errMs = static_cast<int32_t>(captureMs - trueMs);
+    int64_t backlogMs = static_cast<int64_t>(source.lastReadBacklogUs() / 1000);
+    int64_t bufferMs = static_cast<int64_t>(source.bufferDurationUs() / 1000);
+    checks().expect("capture_ts", errMs >= -2 && errMs <= backlogMs + bufferMs + 2,
+                    "帧头采集时间偏差 %lld ms（读开始时积压 %lld ms）", (long long)errMs, (long long)backlogMs);
+    if (backlogMs <= bufferMs) {
+        if (errMs < minCaptureErrMs) minCaptureErrMs = errMs;
+        if (errMs > maxCaptureErrMs) maxCaptureErrMs = errMs;
+    } else if (errMs > maxStaleMs) {
+        maxStaleMs = errMs;
+    }
+
+    lastSeq = seq;
+    lastDropped = source.droppedFrameCount();
+    resync = false;
+}
+
+// ==================== 汇总 ====================
+void SimServer::report(FILE* out) const {
+    fprintf(out, "服务器替身: %llu 帧（短帧 %llu），连接 %llu 次 / 尝试 %llu 次（拒绝 %llu，超时 %llu）\n",
+            (unsigned long long)frames, (unsigned long long)shortFrames, (unsigned long long)connections,
+            (unsigned long long)attempts, (unsigned long long)refused, (unsigned long long)timedOut);
+    fprintf(out, "故障注入: 主动断开 %llu，服务不可用 %llu，链路黑洞 %llu（心跳断开 %llu）\n",
+            (unsigned long long)closes, (unsigned long long)outages, (unsigned long long)blackholes,
+            (unsigned long long)heartbeatDrops);
+    fprintf(out, "指令: 下发 %llu，因断线丢失 %llu，最大回执延迟 %.1f ms\n", (unsigned long long)commandsSent,
+            (unsigned long long)commandsLost, maxAckUs / 1000.0);
+    if (maxCaptureErrMs != INT64_MIN) {
+        fprintf(out, "帧头采集时间偏差: 无积压时 %lld ~ %lld ms，读到积压数据时最大 %lld ms\n", (long long)minCaptureErrMs,
+                (long long)maxCaptureErrMs, (long long)maxStaleMs);
+    }
+}
+
+}  // namespace sim
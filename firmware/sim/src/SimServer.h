@@ -0,0 +1,127 @@
+// ============================================
+// SimServer.h - 进程内的服务器替身与故障注入
+// ============================================
+// 扮演 server/ 的 /api/audio：接收 v2 音频帧、按 "#<id> <text>" 下发指令并等回执、回应 ping。
+// 同时在虚拟时钟上按指数分布注入故障：服务器主动断开、服务不可用（连接被拒）、
+// 链路黑洞（半开连接：数据与 pong 都石沉大海，重连超时）。
+// 断言都以固件自己配置的参数为准（setReconnectInterval / enableHeartbeat 的值），改 sketch 不用改这里。
+#ifndef SIM_SERVER_H
+#define SIM_SERVER_H
+
+#include <WebSocketsClient.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace sim {
+
+struct ServerConfig {
+    uint64_t seed = 1;
+    uint32_t latencyMs = 8;             // 单程时延
+    uint32_t handshakeMs = 40;          // TCP + HTTP Upgrade
+    uint32_t refusedMs = 3;             // 服务未监听时很快收到 RST
+    uint32_t connectTimeoutMs = 5000;   // 链路黑洞时 connect 阻塞到超时
+    size_t sendBufferBytes = 5744;      // lwIP TCP_SND_BUF 默认值
+    size_t connectionBytes = 1536;      // 连接期间库分配的收发缓冲
+    uint8_t relayPin = 20;
+    double commandEveryMin = 10;        // 各类事件的平均间隔（分钟），0 关闭
+    double closeEveryMin = 180;
+    double outageEveryMin = 480;
+    double blackholeEveryMin = 480;
+    uint32_t outageMinS = 20, outageMaxS = 600;
+    uint32_t blackholeMinS = 10, blackholeMaxS = 180;
+    uint32_t ackTimeoutMs = 500;
+    uint32_t slackMs = 250;             // 固件主循环一轮的最大耗时（读超时 100 ms + 未连接时 delay(100) 等）
+};
+
+class SimServer {
+public:
+    enum class ConnectResult { Accepted, Refused, TimedOut };
+    enum class CloseReason { Remote, Heartbeat, Local };
+
+private:
+    enum class Link { Up, Refusing, Blackhole };
+
+    ServerConfig config;
+    uint64_t rngState = 0;
+    WebSocketsClient* peer = nullptr;
+    Link link = Link::Up;
+
+    // 当前连接
+    bool open = false;
+    uint32_t connection = 0;
+    uint64_t readyAtUs = 0;           // 握手完成时刻，之后才下发指令
+    bool resync = true;               // 下一帧只建立基准（新连接 / 链路恢复后）
+    uint32_t lastSeq = 0;
+    uint64_t lastDropped = 0;         // 上一帧时 DMA 累计丢弃的帧数
+    uint64_t lastPingUs = 0;
+    bool closing = false;             // 已下发关闭，等客户端处理
+
+    // 重连
+    uint64_t disconnectedAtUs = 0;
+    uint64_t lastFailedAttemptEndUs = 0;
+    uint64_t faultEndUs = 0;          // 最近一次故障结束时刻
+    uint64_t blackholeStartUs = 0;
+    bool everConnected = false;
+
+    // 指令
+    uint32_t nextCommandId = 1;
+    uint32_t outstandingId = 0;
+    int outstandingIntent = 0;
+    uint64_t outstandingSentUs = 0;
+
+    // 统计
+    uint64_t frames = 0;
+    uint64_t shortFrames = 0;
+    uint64_t attempts = 0;
+    uint64_t refused = 0;
+    uint64_t timedOut = 0;
+    uint64_t connections = 0;
+    uint64_t commandsSent = 0;
+    uint64_t commandsLost = 0;
+    uint64_t closes = 0;
+    uint64_t outages = 0;
+    uint64_t blackholes = 0;
+    uint64_t heartbeatDrops = 0;
+    uint64_t maxAckUs = 0;
+    int64_t minCaptureErrMs = INT64_MAX;
+    int64_t maxCaptureErrMs = INT64_MIN;
+    int64_t maxStaleMs = 0;
+
+    double random();
+    uint64_t exponentialUs(double meanMin);
+    void scheduleEvery(double meanMin, void (SimServer::*action)());
+    void deliver(WStype_t type, std::string payload, uint64_t delayUs);
+    void sendCommand();
+    void closeConnection();
+    void startOutage();
+    void startBlackhole();
+    void endFault();
+
+public:
+    explicit SimServer(const ServerConfig& cfg);
+
+    void start();
+    const ServerConfig& settings() const { return config; }
+    bool linkUp() const { return link == Link::Up; }
+
+    // ---- 由 WebSocketsClient 替身调用 ----
+    ConnectResult connect(WebSocketsClient* client, const char* url, uint32_t& blockMs);
+    void onBinary(const uint8_t* payload, size_t length);
+    void onText(const char* payload, size_t length);
+    // 返回 true 表示会回 pong
+    bool onPing();
+    void onClosed(CloseReason reason);
+
+    void report(FILE* out) const;
+};
+
+SimServer& server();
+// main.cpp 在固件 setup() 之前调用一次
+void startServer(const ServerConfig& config);
+
+}  // namespace sim
+
+#endif  // SIM_SERVER_H
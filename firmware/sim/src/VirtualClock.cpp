@@ -0,0 +1,38 @@
+#include "VirtualClock.h"
+
+#include <cstdio>
+
+namespace sim {
+
+VirtualClock& clock() {
+    static VirtualClock instance;
+    return instance;
+}
+
+void VirtualClock::at(uint64_t atUs, std::function<void()> fn) {
+    events.push(Event{atUs < nowUs ? nowUs : atUs, nextSeq++, std::move(fn)});
+}
+
+void VirtualClock::advance(uint64_t us) {
+    uint64_t target = nowUs + us;
+    while (!events.empty() && events.top().atUs <= target) {
+        Event event = events.top();
+        events.pop();
+        if (event.atUs > nowUs) nowUs = event.atUs;
+        event.fn();
+    }
+    // 事件里嵌套推进过时钟时不回拨
+    if (target > nowUs) nowUs = target;
+}
+
+std::string formatTime(uint64_t us) {
+    uint64_t ms = us / 1000;
+    char text[48];
+    snprintf(text, sizeof(text), "d%llu %02llu:%02llu:%02llu.%03llu",
+             (unsigned long long)(ms / 86400000), (unsigned long long)(ms / 3600000 % 24),
+             (unsigned long long)(ms / 60000 % 60), (unsigned long long)(ms / 1000 % 60),
+             (unsigned long long)(ms % 1000));
+    return text;
+}
+
+}  // namespace sim
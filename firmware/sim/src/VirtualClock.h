@@ -0,0 +1,51 @@
+// ============================================
+// VirtualClock.h - 虚拟时钟与定时事件
+// ============================================
+// 固件里所有“等待”（delay、vTaskDelay、i2s_read 阻塞、连接超时）都只是把虚拟时间往前拨，
+// 途中到期的事件（故障注入、服务器下发指令等）按时间顺序执行。单线程，结果只取决于种子。
+#ifndef VIRTUAL_CLOCK_H
+#define VIRTUAL_CLOCK_H
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+class VirtualClock {
+private:
+    struct Event {
+        uint64_t atUs;
+        uint64_t seq;  // 同一时刻按安排顺序执行
+        std::function<void()> fn;
+
+        bool operator>(const Event& other) const {
+            return atUs != other.atUs ? atUs > other.atUs : seq > other.seq;
+        }
+    };
+
+    uint64_t nowUs = 0;
+    uint64_t nextSeq = 0;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+
+public:
+    uint64_t micros() const { return nowUs; }
+    uint64_t millis() const { return nowUs / 1000; }
+
+    void at(uint64_t atUs, std::function<void()> fn);
+    void after(uint64_t delayUs, std::function<void()> fn) { at(nowUs + delayUs, std::move(fn)); }
+
+    // 推进 us 微秒；事件里可以再安排事件，也可以再推进时钟
+    void advance(uint64_t us);
+};
+
+VirtualClock& clock();
+
+// "d1 03:12:45.123"：日志与断言失败信息里的虚拟时间
+std::string formatTime(uint64_t us);
+
+}  // namespace sim
+
+#endif  // VIRTUAL_CLOCK_H
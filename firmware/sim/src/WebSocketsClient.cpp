@@ -0,0 +1,182 @@
+// ============================================
+// WebSocketsClient.cpp - WebSocket 客户端替身
+// ============================================
+// 行为按 links2004/arduinoWebSockets（ESP32）建模：
+//   - 未连接时 loop() 每隔 reconnectInterval 尝试一次，connect 期间阻塞调用方（虚拟时间照走）
+//   - 心跳：距上次 ping 超过 pingInterval 发 ping；pong 超过 pongTimeout 未到则计数并立刻补发，
+//     计数达到 disconnectTimeoutCount 断开
+//   - 发送写入 TCP 发送缓冲（占堆），对端确认后释放；缓冲满时发送失败
+#include <WebSocketsClient.h>
+
+#include "SimHeap.h"
+#include "SimServer.h"
+#include "VirtualClock.h"
+
+namespace {
+
+// 客户端帧头：2 字节基本头 + 扩展长度 + 4 字节掩码
+size_t frameOverhead(size_t length) { return 2 + (length > 125 ? (length > 65535 ? 8 : 2) : 0) + 4; }
+
+}  // namespace
+
+void WebSocketsClient::begin(const char* hostName, uint16_t portNumber, const char* path, const char*) {
+    host = hostName;
+    port = portNumber;
+    url = path;
+    started = true;
+    lastConnectionFail = 0;
+}
+
+void WebSocketsClient::enableHeartbeat(uint32_t pingIntervalMs, uint32_t pongTimeoutMs, uint8_t disconnectCount) {
+    pingInterval = pingIntervalMs;
+    pongTimeout = pongTimeoutMs;
+    disconnectTimeoutCount = disconnectCount;
+}
+
+void WebSocketsClient::runEvent(WStype_t type, uint8_t* payload, size_t length) {
+    if (onEventCallback) onEventCallback(type, payload, length);
+}
+
+void WebSocketsClient::tryConnect() {
+    uint32_t blockMs = 0;
+    sim::SimServer::ConnectResult result = sim::server().connect(this, url.c_str(), blockMs);
+    delay(blockMs);
+    if (result != sim::SimServer::ConnectResult::Accepted) {
+        lastConnectionFail = millis();
+        return;
+    }
+    clientMemory = sim::heap().malloc(sim::server().settings().connectionBytes);
+    connected = true;
+    connection++;
+    lastPing = millis();
+    pongReceived = true;
+    pongTimeoutCount = 0;
+    failedSends = 0;
+    runEvent(WStype_CONNECTED, reinterpret_cast<uint8_t*>(const_cast<char*>(url.c_str())), url.length());
+}
+
+void WebSocketsClient::clientDisconnect(bool notify) {
+    for (const Pending& item : pending) sim::heap().free(item.memory);
+    pending.clear();
+    pendingBytes = 0;
+    pendingHeapBytes = 0;
+    inbox.clear();
+    sim::heap().free(clientMemory);
+    clientMemory = nullptr;
+    connected = false;
+    pongTimeoutCount = 0;
+    lastConnectionFail = millis();
+    if (notify) runEvent(WStype_DISCONNECTED, nullptr, 0);
+}
+
+void WebSocketsClient::disconnect() {
+    if (!connected) return;
+    sim::server().onClosed(sim::SimServer::CloseReason::Local);
+    clientDisconnect(true);
+}
+
+void WebSocketsClient::releaseAcked(uint64_t nowUs) {
+    while (!pending.empty() && pending.front().ackAtUs <= nowUs) {
+        sim::heap().free(pending.front().memory);
+        pendingBytes -= pending.front().bytes;
+        pendingHeapBytes -= pending.front().heapBytes;
+        pending.pop_front();
+    }
+}
+
+void WebSocketsClient::linkRestored(uint64_t ackAtUs) {
+    for (Pending& item : pending) {
+        if (item.ackAtUs > ackAtUs) item.ackAtUs = ackAtUs;
+    }
+}
+
+bool WebSocketsClient::write(const uint8_t* payload, size_t length, bool binary) {
+    if (!connected) return false;
+    uint64_t nowUs = sim::clock().micros();
+    releaseAcked(nowUs);
+    const sim::ServerConfig& settings = sim::server().settings();
+    size_t bytes = length + frameOverhead(length);
+    void* memory = pendingBytes + bytes <= settings.sendBufferBytes ? sim::heap().malloc(bytes) : nullptr;
+    if (!memory) {
+        if (binary) failedSends++;
+        return false;
+    }
+    bool up = sim::server().linkUp();
+    uint64_t ackAtUs = up ? nowUs + 2 * uint64_t(settings.latencyMs) * 1000 : UINT64_MAX;
+    size_t heapBytes = sim::heap().blockSize(memory);
+    pending.push_back(Pending{ackAtUs, memory, bytes, heapBytes});
+    pendingBytes += bytes;
+    pendingHeapBytes += heapBytes;
+    if (up) {
+        if (binary) sim::server().onBinary(payload, length);
+        else sim::server().onText(reinterpret_cast<const char*>(payload), length);
+    }
+    if (binary) failedSends = 0;
+    return true;
+}
+
+bool WebSocketsClient::sendPing() {
+    if (!connected) return false;
+    sim::server().onPing();
+    return true;
+}
+
+void WebSocketsClient::handleHeartbeat() {
+    if (pingInterval == 0) return;
+    unsigned long elapsed = millis() - lastPing;
+    if (elapsed > pingInterval) {
+        if (sendPing()) {
+            lastPing = millis();
+            pongReceived = false;
+        }
+        return;
+    }
+    if (pongReceived) {
+        pongTimeoutCount = 0;
+    } else if (elapsed > pongTimeout) {
+        pongTimeoutCount++;
+        lastPing = millis() - pingInterval - 500;  // 下一轮立刻补发 ping
+        if (disconnectTimeoutCount && pongTimeoutCount >= disconnectTimeoutCount) {
+            sim::server().onClosed(sim::SimServer::CloseReason::Heartbeat);
+            clientDisconnect(true);
+        }
+    }
+}
+
+void WebSocketsClient::loop() {
+    if (!started) return;
+    if (!connected) {
+        if (lastConnectionFail == 0 || millis() - lastConnectionFail >= reconnectInterval) tryConnect();
+        return;
+    }
+
+    uint64_t nowUs = sim::clock().micros();
+    releaseAcked(nowUs);
+    while (connected && !inbox.empty() && inbox.front().atUs <= nowUs) {
+        Inbound message = std::move(inbox.front());
+        inbox.pop_front();
+        switch (message.type) {
+            case WStype_TEXT: {
+                // 库为每条消息单独分配负载缓冲，回调返回后释放
+                uint8_t* payload = static_cast<uint8_t*>(sim::heap().malloc(message.payload.size() + 1));
+                if (!payload) break;
+                memcpy(payload, message.payload.data(), message.payload.size());
+                payload[message.payload.size()] = '\0';
+                runEvent(WStype_TEXT, payload, message.payload.size());
+                sim::heap().free(payload);
+                break;
+            }
+            case WStype_PONG:
+                pongReceived = true;
+                runEvent(WStype_PONG, nullptr, 0);
+                break;
+            case WStype_DISCONNECTED:
+                sim::server().onClosed(sim::SimServer::CloseReason::Remote);
+                clientDisconnect(true);
+                break;
+            default:
+                break;
+        }
+    }
+    if (connected) handleHeartbeat();
+}
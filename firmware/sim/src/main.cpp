@@ -0,0 +1,326 @@
+// ============================================
+// main.cpp - 固件主机仿真
+// ============================================
+// 在 Linux 上原样编译 sketch_sep23a.ino，millis / delay / FreeRTOS 节拍走虚拟时钟，
+// 麦克风换成仿真 I2S 音源，WebSocket 对端换成进程内的服务器替身（含故障注入）。
+// 一天的设备行为几秒跑完，过程中检查：
+//   - 音频帧：序号、32→16 位转换、帧头采集时间、DMA 是否溢出
+//   - 连接：重连间隔、断开后多久恢复、半开连接多久被心跳发现、ping 间隔
+//   - 指令：回执内容与时延、继电器 GPIO 电平；Relay::pulse 的高电平宽度
+//   - 内存：MEM_CHECK_INTERVAL 打印间隔、空闲堆漂移、碎片率、分配失败、清理后是否归还
+//   - RGB_Lamp_Loop：颜色序列与换色节奏
+//
+// 用法: firmware-sim [--days 1] [--seed 1] [--verbose] [--log FILE]
+//                    [--command-every-min 10] [--close-every-min 180]
+//                    [--outage-every-min 480] [--blackhole-every-min 480]
+//                    [--pulse-every-min 60] [--pulse-ms 200] [--lamp-waiting 20]
+//                    [--max-fragmentation 0.3] [--max-leak-bytes 1024]
+// 事件间隔填 0 关闭对应的注入。
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "Checks.h"
+#include "Hooks.h"
+#include "I2SSource.h"
+#include "Relay.h"
+#include "RGB_lamp.h"
+#include "SimHeap.h"
+#include "SimServer.h"
+#include "VirtualClock.h"
+#include "WebSocketsClient.h"
+
+// ---- sketch 与模块里的全局对象 ----
+void setup();
+void loop();
+void cleanup();
+extern Relay relay;
+extern WebSocketsClient webSocket;
+extern uint8_t RGB_Data[192][3];
+
+namespace {
+
+// 与 sketch_sep23a.ino 的 MEM_CHECK_INTERVAL 一致（那里是 const，外部链接不到）
+constexpr uint64_t kMemCheckIntervalMs = 5000;
+constexpr uint64_t kHourUs = 3600ull * 1000000;
+
+struct Options {
+    double days = 1;
+    bool verbose = false;
+    std::string logPath;
+    double pulseEveryMin = 60;
+    uint32_t pulseMs = 200;
+    uint16_t lampWaiting = 20;
+    double maxFragmentation = 0.3;
+    size_t maxLeakBytes = 1024;
+    sim::ServerConfig server;
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "用法: %s [--days N] [--seed N] [--verbose] [--log FILE]\n"
+            "          [--command-every-min M] [--close-every-min M] [--outage-every-min M]\n"
+            "          [--blackhole-every-min M] [--pulse-every-min M] [--pulse-ms MS]\n"
+            "          [--lamp-waiting N] [--max-fragmentation R] [--max-leak-bytes N]\n",
+            argv0);
+}
+
+// ==================== 内存与 MEM_CHECK ====================
+struct HeapSample {
+    uint64_t atUs;
+    size_t free;
+};
+
+struct MemoryWatch {
+    uint64_t lastCheckUs = 0;
+    uint64_t loopStartUs = 0;
+    uint64_t maxLoopGapUs = 0;  // 两次 MEM_CHECK 之间，相邻两轮 loop() 开始的最大间隔
+    bool previousWasEvent = false;
+    std::vector<HeapSample> samples;
+    double maxFragmentation = 0;
+    size_t minLargestBlock = SIZE_MAX;
+
+    void onLine(const std::string& line, const Options& options) {
+        bool isMemory = line.rfind("[Memory] 空闲堆:", 0) == 0;
+        // 连接 / 断开事件后面紧跟的那行是事件日志，不是定时检查
+        bool periodic = isMemory && !previousWasEvent;
+        previousWasEvent = line.rfind("[WebSocket] ✅", 0) == 0 || line.rfind("[WebSocket] 🔌", 0) == 0;
+        if (!periodic) return;
+
+        uint64_t now = sim::clock().micros();
+        if (lastCheckUs) {
+            uint64_t elapsedMs = now / 1000 - lastCheckUs / 1000;
+            // 到期后最迟在下一轮 loop() 检查：迟到不超过一轮的间隔，再加本轮 webSocket.loop() 的耗时
+            uint64_t lateUs = maxLoopGapUs + (now - loopStartUs);
+            uint64_t boundMs = kMemCheckIntervalMs + 1 + lateUs / 1000 + 2;
+            sim::checks().expect("mem_check_interval", elapsedMs > kMemCheckIntervalMs && elapsedMs <= boundMs,
+                                 "两次内存检查相隔 %llu ms（允许 %llu ~ %llu）", (unsigned long long)elapsedMs,
+                                 (unsigned long long)kMemCheckIntervalMs + 1, (unsigned long long)boundMs);
+        }
+        lastCheckUs = now;
+        maxLoopGapUs = 0;
+
+        sim::SimHeap& heap = sim::heap();
+        double fragmentation = heap.fragmentation();
+        size_t largest = heap.largestFreeBlock();
+        if (fragmentation > maxFragmentation) maxFragmentation = fragmentation;
+        if (largest < minLargestBlock) minLargestBlock = largest;
+        sim::checks().expect("heap_fragmentation", fragmentation <= options.maxFragmentation,
+                             "碎片率 %.2f（空闲 %zu，最大块 %zu）", fragmentation, heap.freeSize(), largest);
+        // 只在连接中采样，并把尚未确认的发送缓冲加回去，各样本的内存状态才可比
+        if (webSocket.isConnected()) samples.push_back(HeapSample{now, heap.freeSize() + webSocket.unackedHeapBytes()});
+    }
+
+    void onLoopStart() {
+        uint64_t now = sim::clock().micros();
+        if (loopStartUs && now - loopStartUs > maxLoopGapUs) maxLoopGapUs = now - loopStartUs;
+        loopStartUs = now;
+    }
+
+    // 比较第 2 小时与最后一小时的空闲堆（各取最大值，排除偶发的临时分配）
+    void checkDrift(const Options& options) const {
+        if (samples.empty()) return;
+        uint64_t endUs = samples.back().atUs;
+        if (endUs < 3 * kHourUs) return;
+        size_t firstHour = 0;
+        size_t lastHour = 0;
+        for (const HeapSample& sample : samples) {
+            if (sample.atUs >= kHourUs && sample.atUs < 2 * kHourUs && sample.free > firstHour) firstHour = sample.free;
+            if (sample.atUs >= endUs - kHourUs && sample.free > lastHour) lastHour = sample.free;
+        }
+        long drift = long(firstHour) - long(lastHour);
+        sim::checks().expect("heap_drift", drift <= long(options.maxLeakBytes), "空闲堆峰值从 %zu 降到 %zu（%ld 字节）",
+                             firstHour, lastHour, drift);
+        sim::checks().detail("heap_drift", "第 2 小时峰值 %zu，最后 1 小时峰值 %zu", firstHour, lastHour);
+    }
+};
+
+// ==================== Relay::pulse ====================
+struct PulseWatch {
+    uint8_t pin;
+    bool active = false;
+    uint64_t risingUs = 0;
+    uint64_t widthUs = 0;
+    uint64_t pulses = 0;
+
+    void onGpio(uint8_t changed, int level) {
+        if (!active || changed != pin) return;
+        if (level == HIGH) risingUs = sim::clock().micros();
+        else widthUs = sim::clock().micros() - risingUs;
+    }
+
+    // 在 loop() 之间调用：与在 sketch 里调用 pulse 一样阻塞主循环
+    void run(uint32_t ms) {
+        bool previous = relay.getState();
+        if (previous) relay.off();
+        active = true;
+        widthUs = 0;
+        relay.pulse(ms);
+        active = false;
+        pulses++;
+        sim::checks().expect("relay_pulse", widthUs == uint64_t(ms) * 1000 && !relay.getState(),
+                             "脉冲 %u ms 实际高电平 %llu us", ms, (unsigned long long)widthUs);
+        if (previous) relay.on();
+    }
+};
+
+// ==================== RGB_Lamp_Loop ====================
+struct LampWatch {
+    uint16_t waiting = 0;
+    uint64_t calls = 0;
+    uint64_t lastCall = 0;
+    uint64_t lastWriteUs = 0;
+    uint64_t minStepUs = UINT64_MAX;
+    uint64_t maxStepUs = 0;
+    size_t expected = 1;  // RGB_Lamp_Loop 先 Number++ 再写，首次写的是第 1 项
+    uint64_t writes = 0;
+
+    void onNeopixel(uint8_t pin, uint8_t r, uint8_t g, uint8_t b) {
+        uint64_t now = sim::clock().micros();
+        const uint8_t* color = RGB_Data[expected];
+        bool ok = pin == PIN_NEOPIXEL && r == uint8_t(color[0] * 3) && g == uint8_t(color[1] * 3) &&
+                  b == uint8_t(color[2] * 3) && calls - lastCall == waiting;
+        sim::checks().expect("lamp_sequence", ok, "第 %zu 色应为 (%u,%u,%u)，写入 (%u,%u,%u)，距上次 %llu 次调用",
+                             expected, color[0] * 3, color[1] * 3, color[2] * 3, r, g, b,
+                             (unsigned long long)(calls - lastCall));
+        if (writes > 0) {
+            uint64_t step = now - lastWriteUs;
+            if (step < minStepUs) minStepUs = step;
+            if (step > maxStepUs) maxStepUs = step;
+        }
+        writes++;
+        lastWriteUs = now;
+        lastCall = calls;
+        expected = (expected + 1) % 192;
+    }
+
+    void tick() {
+        calls++;
+        RGB_Lamp_Loop(waiting);
+    }
+};
+
+FILE* logFile = nullptr;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage(argv[0]);
+            return 0;
+        }
+        if (arg == "--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "--days") options.days = atof(value);
+        else if (arg == "--seed") options.server.seed = strtoull(value, nullptr, 10);
+        else if (arg == "--log") options.logPath = value;
+        else if (arg == "--command-every-min") options.server.commandEveryMin = atof(value);
+        else if (arg == "--close-every-min") options.server.closeEveryMin = atof(value);
+        else if (arg == "--outage-every-min") options.server.outageEveryMin = atof(value);
+        else if (arg == "--blackhole-every-min") options.server.blackholeEveryMin = atof(value);
+        else if (arg == "--pulse-every-min") options.pulseEveryMin = atof(value);
+        else if (arg == "--pulse-ms") options.pulseMs = static_cast<uint32_t>(atoi(value));
+        else if (arg == "--lamp-waiting") options.lampWaiting = static_cast<uint16_t>(atoi(value));
+        else if (arg == "--max-fragmentation") options.maxFragmentation = atof(value);
+        else if (arg == "--max-leak-bytes") options.maxLeakBytes = strtoul(value, nullptr, 10);
+        else {
+            fprintf(stderr, "未知参数: %s\n", arg.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!options.logPath.empty()) {
+        logFile = fopen(options.logPath.c_str(), "w");
+        if (!logFile) {
+            perror(options.logPath.c_str());
+            return 2;
+        }
+    }
+
+    MemoryWatch memory;
+    PulseWatch pulse{relay.getPin()};
+    LampWatch lamp;
+    lamp.waiting = options.lampWaiting;
+    options.server.relayPin = relay.getPin();
+
+    sim::Hooks& hooks = sim::hooks();
+    hooks.serialLine = [&](const std::string& line) {
+        if (options.verbose || logFile) {
+            std::string stamped = "[" + sim::formatTime(sim::clock().micros()) + "] " + line + "\n";
+            if (options.verbose) fputs(stamped.c_str(), stdout);
+            if (logFile) fputs(stamped.c_str(), logFile);
+        }
+        memory.onLine(line, options);
+    };
+    hooks.gpio = [&](uint8_t pin, int level) { pulse.onGpio(pin, level); };
+    hooks.neopixel = [&](uint8_t pin, uint8_t r, uint8_t g, uint8_t b) { lamp.onNeopixel(pin, r, g, b); };
+
+    sim::startServer(options.server);
+    auto wallStart = std::chrono::steady_clock::now();
+
+    setup();
+    size_t freeAfterSetup = sim::heap().freeSize();
+
+    uint64_t endUs = static_cast<uint64_t>(options.days * 24 * kHourUs);
+    uint64_t pulseEveryUs = static_cast<uint64_t>(options.pulseEveryMin * 60e6);
+    uint64_t nextPulseUs = pulseEveryUs;
+    uint64_t nextDayUs = 24 * kHourUs;
+    while (sim::clock().micros() < endUs) {
+        memory.onLoopStart();
+        loop();
+        if (lamp.waiting) lamp.tick();
+        if (pulseEveryUs && sim::clock().micros() >= nextPulseUs) {
+            pulse.run(options.pulseMs);
+            nextPulseUs += pulseEveryUs;
+        }
+        if (sim::clock().micros() >= nextDayUs) {
+            fprintf(stderr, "…已仿真 %llu 天，空闲堆 %zu 字节\n", (unsigned long long)(nextDayUs / (24 * kHourUs)),
+                    sim::heap().freeSize());
+            nextDayUs += 24 * kHourUs;
+        }
+    }
+
+    // ---- 结束：清理后堆应回到 setup() 之后的水平（加上释放的 DMA 缓冲）----
+    memory.checkDrift(options);
+    cleanup();
+    size_t expectedFree = freeAfterSetup + sim::i2s().dmaHeapBytes();
+    sim::checks().expect("heap_after_cleanup", sim::heap().freeSize() == expectedFree,
+                         "清理后空闲堆 %zu，期望 %zu（差 %ld）", sim::heap().freeSize(), expectedFree,
+                         long(expectedFree) - long(sim::heap().freeSize()));
+    sim::checks().expect("heap_alloc", sim::heap().allocFailures() == 0, "分配失败 %llu 次",
+                         (unsigned long long)sim::heap().allocFailures());
+    sim::checks().detail("heap_fragmentation", "最大碎片率 %.3f，最小可分配块 %zu 字节", memory.maxFragmentation,
+                         memory.minLargestBlock);
+    sim::checks().detail("heap_alloc", "共 %llu 次分配，最低空闲 %zu 字节",
+                         (unsigned long long)sim::heap().totalAllocations(), sim::heap().minFreeSize());
+    sim::checks().detail("relay_pulse", "%llu 次 × %u ms", (unsigned long long)pulse.pulses, options.pulseMs);
+    if (lamp.writes > 1) {
+        sim::checks().detail("lamp_sequence", "换色 %llu 次，间隔 %.0f ~ %.0f ms（一圈 192 色约 %.1f s）",
+                             (unsigned long long)lamp.writes, lamp.minStepUs / 1000.0, lamp.maxStepUs / 1000.0,
+                             double(lamp.lastWriteUs) / double(lamp.writes) * 192 / 1e6);
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    printf("虚拟时间 %s，实际耗时 %.1f s（%.0f×）\n", sim::formatTime(sim::clock().micros()).c_str(), wallSeconds,
+           sim::clock().micros() / 1e6 / wallSeconds);
+    sim::server().report(stdout);
+    printf("I2S: DMA 溢出 %llu 次，丢弃 %.1f s 音频（未连接期间不读麦克风）\n",
+           (unsigned long long)sim::i2s().overflowCount(), sim::i2s().droppedFrameCount() / double(sim::i2s().rate()));
+    sim::checks().report(stdout);
+    if (logFile) fclose(logFile);
+    return sim::checks().failed() ? 1 : 0;
+}
@@ -0,0 +1,68 @@
+// ============================================
+// Decimator.h - 16 kHz → 8 kHz 抽取（窄带上行，sketch_sep23a.ino 与主机仿真 firmware/sim 共用）
+// ============================================
+// 先低通再隔一个样本取一个：47 阶半带 FIR（窗函数法，Kaiser β=5.65），
+// 3.4 kHz 以内平坦（-0.03 dB），4 kHz -6 dB，4.6 kHz -49.9 dB，5 kHz 以上 65 dB 以上。
+// 半带滤波器偶数位置的系数除中心外都是 0，每个输出只需 12 次乘法（对称的两个样本先相加）。
+// 服务器 server/lib/resample.ts 用同一组系数做 8 kHz → 16 kHz 插值，改系数时两边一起改。
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define HALFBAND_TAPS 47
+#define HALFBAND_CENTER 16384  // 0.5，Q15
+#define HALFBAND_SIDE_COUNT 12
+
+// h[±1], h[±3], ..., h[±23]，Q15；与中心系数合计为 32768（直流增益 1）
+static const int16_t HALFBAND_SIDE[HALFBAND_SIDE_COUNT] = {
+  10381, -3328, 1846, -1169, 772, -511, 331, -206, 120, -64, 29, -9,
+};
+
+// 对 x[0..HALFBAND_TAPS) 做一次滤波（x[0] 最旧），四舍五入并饱和到 int16
+inline int16_t halfbandFilter(const int16_t* x) {
+  const int c = HALFBAND_TAPS / 2;
+  int32_t acc = (int32_t)HALFBAND_CENTER * x[c];
+  for (int k = 0; k < HALFBAND_SIDE_COUNT; k++) {
+    acc += (int32_t)HALFBAND_SIDE[k] * ((int32_t)x[c - 1 - 2 * k] + x[c + 1 + 2 * k]);
+  }
+  acc = (acc + (1 << 14)) >> 15;
+  return acc > 32767 ? 32767 : acc < -32768 ? -32768 : (int16_t)acc;
+}
+
+class Decimator {
+private:
+  // 延迟线存两份：写入位置之后连续 HALFBAND_TAPS 个就是完整窗口，不用取模
+  int16_t line[2 * HALFBAND_TAPS];
+  int pos;
+  bool pending;  // 已收一个样本、还差一个凑成一对
+
+public:
+  Decimator() {
+    reset();
+  }
+
+  // 重新连接后调用：断线期间没读麦克风，旧的历史样本与新数据不连续
+  void reset() {
+    memset(line, 0, sizeof(line));
+    pos = 0;
+    pending = false;
+  }
+
+  // 每两个输入产生一个输出，返回输出样本数；out 可以与 in 相同（原地抽取）。
+  // 块长为奇数时剩下的一个样本留到下一块配对
+  int process(const int16_t* in, int n, int16_t* out) {
+    int produced = 0;
+    for (int i = 0; i < n; i++) {
+      line[pos] = in[i];
+      line[pos + HALFBAND_TAPS] = in[i];
+      pos = (pos + 1 == HALFBAND_TAPS) ? 0 : pos + 1;
+      pending = !pending;
+      if (!pending) out[produced++] = halfbandFilter(&line[pos]);
+    }
+    return produced;
+  }
+};
+
+#endif  // DECIMATOR_H
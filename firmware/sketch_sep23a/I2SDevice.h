@@ -6,16 +6,23 @@
 
 #include <driver/i2s.h>  // ESP32 I2S 驱动
 #include <esp_log.h>     // 日志（Arduino 中可用 ESP_LOGI）
+#include "TdmFrame.h"    // TDM 交错缓冲的按声道视图
 
 // 设备类型枚举
 typedef enum {
   DEVICE_MIC,    // 麦克风 (RX, 单声道)
-  DEVICE_SENSOR  // 传感器 (TX/RX 可配置，多声道示例)
+  DEVICE_SENSOR  // 传感器 (TX/RX 可配置，3~8 声道走 TDM，如麦克风阵列)
 } i2s_device_type_t;
 
 // 默认端口
 #define DEFAULT_I2S_PORT I2S_NUM_0
 
+// 旧版驱动每个 DMA 描述符最多 4092 字节；TDM 一帧 N 个声道，帧数要按帧长缩小
+#define I2S_DMA_BUF_MAX_BYTES 4092
+// TDM 时 DMA 缓冲变短，按时长补足个数：环至少容纳 256 ms，主循环阻塞（如 Relay::pulse(200)）时不丢数据。
+// 8 声道 32 位 16kHz：33 × 127 帧，约 130 KB
+#define I2S_TDM_DMA_RING_MS 256
+
 class I2SDevice {
 private:
   i2s_device_type_t type;                 // 设备类型
@@ -73,7 +80,25 @@ public:
       .fixed_mclk = 0
     };
 
-    
+    // 3 声道以上走 TDM：ch0 起连续 channels 个时隙，DMA 缓冲里按帧交错（见 TdmFrame.h）
+    if (isTdm()) {
+#if SOC_I2S_SUPPORTS_TDM
+      if (channels > TDM_MAX_CHANNELS) {
+        Serial.printf("[I2SDevice] TDM 最多 %d 声道，配置为 %d\n", TDM_MAX_CHANNELS, channels);
+        return false;
+      }
+      i2s_config.channel_format = I2S_CHANNEL_FMT_MULTIPLE;
+      i2s_config.chan_mask = (i2s_channel_t)(((1u << channels) - 1) * I2S_TDM_ACTIVE_CH0);
+      i2s_config.total_chan = channels;
+      int buf_frames = I2S_DMA_BUF_MAX_BYTES / getFrameBytes();
+      int ring_frames = sample_rate * I2S_TDM_DMA_RING_MS / 1000;
+      i2s_config.dma_buf_len = buf_frames;
+      i2s_config.dma_buf_count = (ring_frames + buf_frames - 1) / buf_frames;
+#else
+      Serial.println("[I2SDevice] 本芯片的 I2S 不支持 TDM（需 ESP32-S3/C3）");
+      return false;
+#endif
+    }
 
     // 安装驱动
     esp_err_t ret = i2s_driver_install(port, &i2s_config, 0, NULL);
@@ -103,7 +128,7 @@ public:
     Serial.print(rx_mode ? "是" : "否");
     Serial.print(", 声道: ");
     Serial.print(channels);
-    Serial.println(")");
+    Serial.println(isTdm() ? ", TDM)" : ")");
 
     return true;
   }
@@ -188,6 +213,21 @@ public:
     return channels;
   }
 
+  bool isTdm() {
+    return channels > 2;
+  }
+
+  // 一帧（每个声道各一个样本）的字节数；read() 读到的字节数是它的整数倍
+  int getFrameBytes() {
+    return channels * (bits_per_sample / 8);
+  }
+
+  // read() 读回的交错缓冲里第 ch 个声道的零拷贝视图；T 与位深对应（32 位用 int32_t）
+  template <typename T>
+  TdmChannel<T> channel(const uint8_t* buffer, size_t bytes, int ch) {
+    return tdmChannel((const T*)buffer, bytes / getFrameBytes(), channels, ch);
+  }
+
   uint8_t getPin(int pin_type) {  // 0=WS, 1=SD, 2=SCK
     switch (pin_type) {
       case 0: return ws_pin;
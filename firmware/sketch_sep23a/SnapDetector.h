@@ -0,0 +1,56 @@
+// ============================================
+// SnapDetector.h - 响指检测（sound.h 与主机基准 firmware/snapbench 共用）
+// ============================================
+// 每次处理一个 I2S DMA 块（512 点，16 kHz）：Hamming 窗 → FFT → 取 1..255 号 bin 的峰值，
+// 主频落在 2~5 kHz 且峰值超过阈值即判为响指。阈值是凭耳朵调出来的，
+// 改这里（包括"结果应该一样"的优化）之前先在 firmware/snapbench 跑 make check。
+#ifndef SNAP_DETECTOR_H
+#define SNAP_DETECTOR_H
+
+#include <arduinoFFT.h>
+#include <stdint.h>
+
+#define SNAP_SAMPLE_RATE 16000
+#define SNAP_SAMPLES 512
+#define SNAP_MIN_FREQ 2000.0f   // 主频下限（不含）
+#define SNAP_MAX_FREQ 5000.0f   // 主频上限（不含）
+#define SNAP_MIN_PEAK 6000.0f   // 峰值幅度下限（不含）
+
+struct SnapResult {
+  bool isSnap;
+  int peakIndex;
+  float peak;
+  float dominantFreq;
+};
+
+// INMP441 的 24 位数据左对齐在 32 位里，>>14 后截成 int16（很响时会回绕，保持原样）
+inline int16_t snapSample16(int32_t raw) {
+  return (int16_t)(raw >> 14);
+}
+
+// fft 必须以 vReal / vImag、SNAP_SAMPLES、SNAP_SAMPLE_RATE 构造；buffer 为一块原始 I2S 数据
+inline SnapResult detectSnap(ArduinoFFT<float>& fft, float* vReal, float* vImag, const int32_t* buffer) {
+  for (int i = 0; i < SNAP_SAMPLES; i++) {
+    vReal[i] = (float)snapSample16(buffer[i]);
+    vImag[i] = 0.0;
+  }
+
+  fft.windowing(FFTWindow::Hamming, FFTDirection::Forward);
+  fft.compute(FFTDirection::Forward);
+  fft.complexToMagnitude();
+
+  SnapResult result = {false, 0, 0.0f, 0.0f};
+  for (int i = 1; i < SNAP_SAMPLES / 2; i++) {
+    if (vReal[i] > result.peak) {
+      result.peak = vReal[i];
+      result.peakIndex = i;
+    }
+  }
+
+  result.dominantFreq = result.peakIndex * ((float)SNAP_SAMPLE_RATE / SNAP_SAMPLES);
+  result.isSnap = result.dominantFreq > SNAP_MIN_FREQ && result.dominantFreq < SNAP_MAX_FREQ &&
+                  result.peak > SNAP_MIN_PEAK;
+  return result;
+}
+
+#endif // SNAP_DETECTOR_H
@@ -0,0 +1,103 @@
+// ============================================
+// TdmFrame.h - TDM 多声道交错缓冲（sketch_sep23a.ino、I2SDevice.h 与主机基准 firmware/tdmbench 共用）
+// ============================================
+// TDM 模式下 i2s_read 读到的样本按帧交错：帧 0 的 ch0..chN-1，帧 1 的 ch0..chN-1 ……
+// TdmChannel 只记本声道的起点与步长，直接在 DMA 读出的缓冲上按下标取样，不复制；
+// 上行要连续的 16 位 PCM 时，再用下面的拆分 / 混合函数一次走完缓冲（32 位取高 16 位，与 convert32to16 一致）。
+//
+// 声道选择用位掩码：bit c 对应第 c 个时隙（I2S_TDM_ACTIVE_CH0 起）。
+// 几种写法的主机对比（逐声道 / 按帧、运行期 / 编译期步长）见 firmware/tdmbench，改这里前后都跑一遍 make check。
+#ifndef TDM_FRAME_H
+#define TDM_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TDM_MAX_CHANNELS 8
+
+// 交错缓冲里一个声道的零拷贝视图
+template <typename T>
+struct TdmChannel {
+  const T* base;  // 本声道第 0 帧的样本
+  int stride;     // 每帧样本数（总声道数）
+  size_t frames;
+
+  T operator[](size_t i) const {
+    return base[i * stride];
+  }
+
+  size_t size() const {
+    return frames;
+  }
+};
+
+template <typename T>
+inline TdmChannel<T> tdmChannel(const T* interleaved, size_t frames, int totalChannels, int channel) {
+  return TdmChannel<T>{ interleaved + channel, totalChannels, frames };
+}
+
+// 掩码里落在 [0, totalChannels) 的声道号，升序写入 selected，返回个数
+inline int tdmSelect(uint32_t mask, int totalChannels, uint8_t* selected) {
+  int count = 0;
+  for (int c = 0; c < totalChannels && c < TDM_MAX_CHANNELS; c++) {
+    if (mask & (1u << c)) selected[count++] = (uint8_t)c;
+  }
+  return count;
+}
+
+// ---- 拆分：选中声道各自连续（第 j 个选中声道写到 out + j * frames） ----
+// 逐声道用视图跨步读、连续写。主机上比按帧走一遍（每帧往 N 个输出各写一个）快，
+// ESP32-C3 内部 SRAM 没有缓存，跨步读不吃亏，循环体也最短
+inline int tdmDeinterleave16(const int32_t* in, size_t frames, int totalChannels, uint32_t mask, int16_t* out) {
+  uint8_t selected[TDM_MAX_CHANNELS];
+  int count = tdmSelect(mask, totalChannels, selected);
+  for (int j = 0; j < count; j++) {
+    TdmChannel<int32_t> channel = tdmChannel(in, frames, totalChannels, selected[j]);
+    int16_t* dst = out + j * frames;
+    for (size_t i = 0; i < frames; i++) dst[i] = (int16_t)(channel[i] >> 16);
+  }
+  return count;
+}
+
+// ---- 混合：选中声道的高 16 位求平均，成一路单声道（上行用） ----
+// 除法向零取整；各声道相同时输出与单声道逐位一致
+inline void tdmDownmix16Generic(const int32_t* in, size_t frames, int totalChannels,
+                                const uint8_t* selected, int count, int16_t* out) {
+  for (size_t i = 0; i < frames; i++) {
+    const int32_t* frame = in + i * totalChannels;
+    int32_t sum = 0;
+    for (int j = 0; j < count; j++) sum += frame[selected[j]] >> 16;
+    out[i] = (int16_t)(sum / count);
+  }
+}
+
+// 全部 N 个声道（阵列最常见的用法）：步长与声道数都是编译期常量，内层循环展开
+template <int N>
+inline void tdmDownmix16All(const int32_t* in, size_t frames, int16_t* out) {
+  for (size_t i = 0; i < frames; i++) {
+    const int32_t* frame = in + i * N;
+    int32_t sum = 0;
+    for (int c = 0; c < N; c++) sum += frame[c] >> 16;
+    out[i] = (int16_t)(sum / N);
+  }
+}
+
+// 返回选中的声道数（0 表示掩码没有选中任何存在的声道，什么都不写）
+inline int tdmDownmix16(const int32_t* in, size_t frames, int totalChannels, uint32_t mask, int16_t* out) {
+  uint8_t selected[TDM_MAX_CHANNELS];
+  int count = tdmSelect(mask, totalChannels, selected);
+  if (count == 1) {
+    // 只选一个声道：直接取样，省掉除法
+    TdmChannel<int32_t> channel = tdmChannel(in, frames, totalChannels, selected[0]);
+    for (size_t i = 0; i < frames; i++) out[i] = (int16_t)(channel[i] >> 16);
+  } else if (count == 4 && totalChannels == 4) {
+    tdmDownmix16All<4>(in, frames, out);
+  } else if (count == 8 && totalChannels == 8) {
+    tdmDownmix16All<8>(in, frames, out);
+  } else if (count > 0) {
+    tdmDownmix16Generic(in, frames, totalChannels, selected, count, out);
+  }
+  return count;
+}
+
+#endif  // TDM_FRAME_H
@@ -3,6 +3,8 @@
 #include <WiFi.h>
 #include <WebSocketsClient.h>
 #include "I2SDevice.h"
+#include "Decimator.h"
+#include "TdmFrame.h"
 #include "RGB_lamp.h"
 
 Relay relay(20);
@@ -17,10 +19,32 @@ const int CHUNK_DURATION_MS = 50;
 const int SAMPLE_RATE = 16000;
 const int SAMPLES_PER_CHUNK = (SAMPLE_RATE * CHUNK_DURATION_MS) / 1000; // 800 samples
 
+// ✅ 窄带模式：弱网设备编译时设为 1，16kHz 采集后抗混叠滤波抽取到 8kHz 上行，码率减半
+// （服务器按 ?sr=8000 插值回 16kHz 再识别）
+#ifndef NARROWBAND
+#define NARROWBAND 0
+#endif
+const int UPLINK_SAMPLE_RATE = NARROWBAND ? SAMPLE_RATE / 2 : SAMPLE_RATE;
+
+// ✅ TDM 多声道：麦克风阵列等 I2S 传感器接在同一端口时设为 4~8（0 = 单声道麦克风）。
+// 上行仍是一路 16kHz 单声道：UPLINK_CHANNEL_MASK 选哪些时隙（bit0 = 第 1 路），多选时取平均
+#ifndef TDM_CHANNELS
+#define TDM_CHANNELS 0
+#endif
+#ifndef UPLINK_CHANNEL_MASK
+#define UPLINK_CHANNEL_MASK 0x1
+#endif
+const int CAPTURE_CHANNELS = TDM_CHANNELS ? TDM_CHANNELS : 1;
+static_assert(TDM_CHANNELS <= TDM_MAX_CHANNELS, "TDM 最多 8 声道");
+static_assert(!TDM_CHANNELS || (UPLINK_CHANNEL_MASK & ((1 << TDM_CHANNELS) - 1)), "UPLINK_CHANNEL_MASK 没有选中任何声道");
+
 // ✅ 32bit输入 -> 16bit输出
-const int INPUT_BUFFER_SIZE = SAMPLES_PER_CHUNK * 4;  // 3200 bytes (32bit)
+const int INPUT_BUFFER_SIZE = SAMPLES_PER_CHUNK * 4 * CAPTURE_CHANNELS;  // 3200 bytes (32bit 单声道)
 const int OUTPUT_BUFFER_SIZE = SAMPLES_PER_CHUNK * 2; // 1600 bytes (16bit)
 
+// ✅ v2 帧头: uint32 帧序号 + uint32 采集时间(millis)，小端
+const int FRAME_HEADER_SIZE = 8;
+
 // WiFi & WebSocket配置
 const char* SSID = "bob";
 const char* PASSWORD = "www.bobjoy.com";
@@ -28,12 +52,15 @@ const char* SERVER_HOST = "pi";
 const uint16_t SERVER_PORT = 3000;
 const char* WS_PATH = "/api/audio";
 
-// ✅ 使用32bit配置创建麦克风
-I2SDevice mic(DEVICE_MIC, SAMPLE_RATE, 1, I2S_BITS_PER_SAMPLE_32BIT, I2S_WS, I2S_SD, I2S_SCK);
+// ✅ 使用32bit配置创建麦克风（TDM 时为多声道传感器）
+I2SDevice mic(TDM_CHANNELS ? DEVICE_SENSOR : DEVICE_MIC, SAMPLE_RATE, CAPTURE_CHANNELS, I2S_BITS_PER_SAMPLE_32BIT,
+              I2S_WS, I2S_SD, I2S_SCK);
 
 // 缓冲区
 uint8_t inputBuffer[INPUT_BUFFER_SIZE];   // 32bit原始数据
-uint8_t outputBuffer[OUTPUT_BUFFER_SIZE]; // 16bit转换后数据
+uint8_t outputBuffer[FRAME_HEADER_SIZE + OUTPUT_BUFFER_SIZE]; // 帧头 + 16bit转换后数据
+uint32_t frameSeq = 0;
+Decimator decimator;
 
 WebSocketsClient webSocket;
 
@@ -60,15 +87,21 @@ void setup() {
   }
   Serial.println("\n[WiFi] 已连接! IP: " + WiFi.localIP().toString());
   
-  // I2S初始化
+  // I2S初始化（传感器默认是 TX，采集要先切到 RX）
+  if (TDM_CHANNELS) mic.toggleMode(true);
   if (!mic.begin()) {
     Serial.println("[I2S] 初始化失败!");
     while (1) delay(1000);
   }
   Serial.println("[I2S] 麦克风就绪 (32bit模式)");
+  if (TDM_CHANNELS) Serial.printf("[I2S] TDM %d 声道，上行声道掩码 0x%X\n", TDM_CHANNELS, UPLINK_CHANNEL_MASK);
   
-  // WebSocket配置
-  webSocket.begin(SERVER_HOST, SERVER_PORT, WS_PATH);
+  // WebSocket配置（上报设备 ID 与帧协议版本）
+  String mac = WiFi.macAddress();
+  mac.replace(":", "");
+  String wsUrl = String(WS_PATH) + "?id=" + mac + "&v=2";
+  if (NARROWBAND) wsUrl += "&sr=" + String(UPLINK_SAMPLE_RATE);
+  webSocket.begin(SERVER_HOST, SERVER_PORT, wsUrl.c_str());
   webSocket.onEvent(webSocketEvent);
   webSocket.setReconnectInterval(5000);
   webSocket.enableHeartbeat(15000, 3000, 2);
@@ -96,18 +129,35 @@ void loop() {
   size_t bytesRead = mic.read(inputBuffer, INPUT_BUFFER_SIZE, pdMS_TO_TICKS(100));
   
   if (bytesRead > 0) {
-    // ✅ 验证读取的数据是4的倍数（32bit对齐）
-    if (bytesRead % 4 != 0) {
+    // ✅ 验证读取的数据是整帧（32bit × 声道数对齐）
+    if (bytesRead % mic.getFrameBytes() != 0) {
       Serial.printf("[Warning] 非对齐数据: %d 字节\n", bytesRead);
       return;
     }
     
-    // ✅ 32bit -> 16bit 转换
-    int samples = bytesRead / 4; // 32bit样本数
-    convert32to16(inputBuffer, outputBuffer, samples);
+    // ✅ 32bit -> 16bit 转换（TDM：选中声道平均成单声道）
+    int samples = bytesRead / mic.getFrameBytes(); // 每声道样本数
+    if (TDM_CHANNELS) {
+      tdmDownmix16((const int32_t*)inputBuffer, samples, TDM_CHANNELS, UPLINK_CHANNEL_MASK,
+                   (int16_t*)(outputBuffer + FRAME_HEADER_SIZE));
+    } else {
+      convert32to16(inputBuffer, outputBuffer + FRAME_HEADER_SIZE, samples);
+    }
+    
+    // ✅ 帧头：采集时间取本块第一个样本的时刻
+    uint32_t captureMs = millis() - (uint32_t)samples * 1000 / SAMPLE_RATE;
+    
+    // ✅ 窄带：原地抽取到 8kHz，样本数减半
+    if (NARROWBAND) {
+      int16_t* pcm = (int16_t*)(outputBuffer + FRAME_HEADER_SIZE);
+      samples = decimator.process(pcm, samples, pcm);
+    }
+    memcpy(outputBuffer, &frameSeq, 4);
+    memcpy(outputBuffer + 4, &captureMs, 4);
+    frameSeq++;
     
-    // 发送16bit数据
-    size_t outputSize = samples * 2;
+    // 发送帧头 + 16bit数据
+    size_t outputSize = FRAME_HEADER_SIZE + samples * 2;
     bool sent = webSocket.sendBIN(outputBuffer, outputSize);
     
     if (!sent) {
@@ -175,13 +225,29 @@ void webSocketEvent(WStype_t type, uint8_t* payload, size_t length) {
       
     case WStype_CONNECTED:
       Serial.printf("[WebSocket] ✅ 已连接到: %s\n", payload);
+      decimator.reset();  // 断线期间没读麦克风，旧样本与新数据不连续
       Serial.printf("[Memory] 空闲堆: %d 字节\n", ESP.getFreeHeap());
       break;
       
-    case WStype_TEXT:
+    case WStype_TEXT: {
       Serial.printf("[WebSocket] 📩 收到文本 (%d bytes): %s\n", length, (char*)payload);
-      handleRelayCommand((char*)payload);
+      // ✅ 服务器指令格式 "#<id> <text>"，带 id 的指令执行后回执
+      char* text = (char*)payload;
+      unsigned long commandId = 0;
+      if (text[0] == '#') {
+        char* end = nullptr;
+        commandId = strtoul(text + 1, &end, 10);
+        text = (end && *end == ' ') ? end + 1 : end;
+      }
+      handleRelayCommand(text);
+      if (commandId > 0) {
+        char ack[64];
+        snprintf(ack, sizeof(ack), "{\"type\":\"ack\",\"id\":%lu,\"relay\":%d}",
+                 commandId, relay.getState() ? 1 : 0);
+        webSocket.sendTXT(ack);
+      }
       break;
+    }
       
     case WStype_BIN:
       Serial.printf("[WebSocket] 📦 收到二进制数据: %d 字节\n", length);
@@ -1,6 +1,7 @@
 #include "Relay.h"
 #include <driver/i2s.h>
 #include <arduinoFFT.h>
+#include "SnapDetector.h"
 
 Relay relay(20);
 
@@ -8,8 +9,8 @@ Relay relay(20);
 #define I2S_SD 5
 #define I2S_SCK 19
 
-#define SAMPLE_RATE 16000
-#define SAMPLES 512
+#define SAMPLE_RATE SNAP_SAMPLE_RATE
+#define SAMPLES SNAP_SAMPLES
 #define I2S_PORT I2S_NUM_0
 
 float vReal[SAMPLES];
@@ -59,31 +60,10 @@ void loop() {
 
   i2s_read(I2S_PORT, buffer, sizeof(buffer), &bytesRead, portMAX_DELAY);
 
-  for (int i = 0; i < SAMPLES; i++) {
-    int16_t sample16 = buffer[i] >> 14;
-    vReal[i] = (float)sample16;
-    vImag[i] = 0.0;
-  }
-
-  FFT.windowing(FFTWindow::Hamming, FFTDirection::Forward);
-  FFT.compute(FFTDirection::Forward);
-  FFT.complexToMagnitude();
-
-  float peak = 0.0;
-  int peakIndex = 0;
-  for (int i = 1; i < SAMPLES / 2; i++) {
-    if (vReal[i] > peak) {
-      peak = vReal[i];
-      peakIndex = i;
-    }
-  }
-
-  float dominantFreq = peakIndex * ((float)SAMPLE_RATE / SAMPLES);
-
   // 检测单个响指
-  bool isSnap = (dominantFreq > 2000 && dominantFreq < 5000 && peak > 6000);
+  SnapResult result = detectSnap(FFT, vReal, vImag, buffer);
 
-  if (isSnap) {
+  if (result.isSnap) {
     unsigned long now = millis();
 
    
@@ -0,0 +1,116 @@
+// ============================================
+// arduinoFFT.h - 主机上的 arduinoFFT 2.x 替身
+// ============================================
+// 只实现 SnapDetector.h 用到的部分：Hamming 窗、正向 FFT、求模。
+// 运算顺序与库里一致（位反转 → 逐级蝶形，旋转因子用半角公式递推；窗系数用 double 算再截成 T），
+// 这样主机上的逐块判定才能代表固件。ESP32-C3 的 libm 与主机的 cos 可能差最后一位，
+// 个别卡在阈值边上的块可能不同，基线按主机结果记录。
+#ifndef ARDUINO_FFT_H
+#define ARDUINO_FFT_H
+
+#include <cmath>
+#include <cstdint>
+
+enum class FFTDirection { Forward, Reverse };
+enum class FFTWindow { Rectangle, Hamming };
+
+template <typename T>
+class ArduinoFFT {
+private:
+    T* vReal;
+    T* vImag;
+    uint_fast16_t samples;
+    T samplingFrequency;
+    uint_fast8_t power = 0;
+
+    static constexpr double kTwoPi = 6.28318531;  // 库里就是这个精度
+
+public:
+    ArduinoFFT(T* real, T* imag, uint_fast16_t count, T frequency)
+        : vReal(real), vImag(imag), samples(count), samplingFrequency(frequency) {
+        while ((uint_fast16_t(1) << power) < samples) power++;
+    }
+
+    void windowing(FFTWindow windowType, FFTDirection dir) {
+        T samplesMinusOne = T(samples) - T(1.0);
+        for (uint_fast16_t i = 0; i < (samples >> 1); i++) {
+            T ratio = T(i) / samplesMinusOne;
+            T weighingFactor = 1.0;
+            if (windowType == FFTWindow::Hamming) weighingFactor = 0.54 - (0.46 * std::cos(kTwoPi * ratio));
+            if (dir == FFTDirection::Forward) {
+                vReal[i] *= weighingFactor;
+                vReal[samples - (i + 1)] *= weighingFactor;
+            } else {
+                vReal[i] /= weighingFactor;
+                vReal[samples - (i + 1)] /= weighingFactor;
+            }
+        }
+    }
+
+    void compute(FFTDirection dir) {
+        // 位反转（正向时假定虚部全 0，库里同样只交换实部）
+        uint_fast16_t j = 0;
+        for (uint_fast16_t i = 0; i < (samples - 1); i++) {
+            if (i < j) {
+                T t = vReal[i];
+                vReal[i] = vReal[j];
+                vReal[j] = t;
+                if (dir == FFTDirection::Reverse) {
+                    t = vImag[i];
+                    vImag[i] = vImag[j];
+                    vImag[j] = t;
+                }
+            }
+            uint_fast16_t k = samples >> 1;
+            while (k <= j) {
+                j -= k;
+                k >>= 1;
+            }
+            j += k;
+        }
+
+        T c1 = -1.0;
+        T c2 = 0.0;
+        uint_fast16_t l2 = 1;
+        for (uint_fast8_t l = 0; l < power; l++) {
+            uint_fast16_t l1 = l2;
+            l2 <<= 1;
+            T u1 = 1.0;
+            T u2 = 0.0;
+            for (j = 0; j < l1; j++) {
+                for (uint_fast16_t i = j; i < samples; i += l2) {
+                    uint_fast16_t i1 = i + l1;
+                    T t1 = u1 * vReal[i1] - u2 * vImag[i1];
+                    T t2 = u1 * vImag[i1] + u2 * vReal[i1];
+                    vReal[i1] = vReal[i] - t1;
+                    vImag[i1] = vImag[i] - t2;
+                    vReal[i] += t1;
+                    vImag[i] += t2;
+                }
+                T z = (u1 * c1) - (u2 * c2);
+                u2 = (u1 * c2) + (u2 * c1);
+                u1 = z;
+            }
+            T cTemp = 0.5 * c1;
+            c2 = std::sqrt(T(0.5 - cTemp));
+            c1 = std::sqrt(T(0.5 + cTemp));
+            if (dir == FFTDirection::Forward) c2 = -c2;
+        }
+
+        if (dir != FFTDirection::Forward) {
+            T reciprocal = T(1.0) / T(samples);
+            for (uint_fast16_t i = 0; i < samples; i++) {
+                vReal[i] *= reciprocal;
+                vImag[i] *= reciprocal;
+            }
+        }
+    }
+
+    void complexToMagnitude() {
+        for (uint_fast16_t i = 0; i < samples; i++) vReal[i] = std::sqrt(vReal[i] * vReal[i] + vImag[i] * vImag[i]);
+    }
+
+    T frequency() const { return samplingFrequency; }
+};
+
+#endif  // ARDUINO_FFT_H
@@ -0,0 +1,67 @@
+// ============================================
+// Baseline.cpp - 基线读写
+// ============================================
+#include "Baseline.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace bench {
+
+bool loadBaseline(const std::string& path, Baseline& baseline, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = path + " 打不开";
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        if (line.empty() || line[0] == '#') continue;
+        std::stringstream row(line);
+        std::string name, blocks, checksum, positives;
+        if (!std::getline(row, name, '\t') || !std::getline(row, blocks, '\t') || !std::getline(row, checksum, '\t') ||
+            !std::getline(row, positives, '\t')) {
+            error = path + " 第 " + std::to_string(lineNo) + " 行应有 4 列";
+            return false;
+        }
+        BaselineClip& clip = baseline[name];
+        clip.blocks = strtoul(blocks.c_str(), nullptr, 10);
+        clip.checksum = strtoull(checksum.c_str(), nullptr, 16);
+        if (positives != "-") {
+            std::stringstream list(positives);
+            std::string item;
+            while (std::getline(list, item, ',')) clip.positives.push_back(uint32_t(strtoul(item.c_str(), nullptr, 10)));
+        }
+    }
+    return true;
+}
+
+bool saveBaseline(const std::string& path, const std::vector<std::string>& order, const Baseline& baseline,
+                  std::string& error) {
+    FILE* out = fopen(path.c_str(), "w");
+    if (!out) {
+        error = path + " 写入失败";
+        return false;
+    }
+    fprintf(out, "# snapbench 基线：reference 后端逐块判为响指的块号（make baseline 重新生成）\n");
+    fprintf(out, "# 段名\t块数\t校验和\t触发块\n");
+    for (const std::string& name : order) {
+        const BaselineClip& clip = baseline.at(name);
+        fprintf(out, "%s\t%zu\t%016" PRIx64 "\t", name.c_str(), clip.blocks, clip.checksum);
+        if (clip.positives.empty()) fputc('-', out);
+        for (size_t i = 0; i < clip.positives.size(); i++) fprintf(out, i ? ",%u" : "%u", clip.positives[i]);
+        fputc('\n', out);
+    }
+    if (fclose(out) != 0) {
+        error = path + " 写入失败";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace bench
@@ -0,0 +1,32 @@
+// ============================================
+// Baseline.h - 逐块判定基线
+// ============================================
+// 记录 reference 后端在每段语料上判为响指的块号，外加块数与语料校验和：
+//   # 段名<TAB>块数<TAB>校验和<TAB>触发块（逗号分隔，无则 -）
+// 比较的是固件调度之前的逐块判定，调度（300 ms 防抖、DMA 溢出）遮住的差异也能发现。
+#ifndef SNAPBENCH_BASELINE_H
+#define SNAPBENCH_BASELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+struct BaselineClip {
+    size_t blocks = 0;
+    uint64_t checksum = 0;
+    std::vector<uint32_t> positives;
+};
+
+using Baseline = std::map<std::string, BaselineClip>;
+
+bool loadBaseline(const std::string& path, Baseline& baseline, std::string& error);
+bool saveBaseline(const std::string& path, const std::vector<std::string>& order, const Baseline& baseline,
+                  std::string& error);
+
+}  // namespace bench
+
+#endif  // SNAPBENCH_BASELINE_H
@@ -0,0 +1,402 @@
+// ============================================
+// Corpus.cpp - 合成语料表与 WAV 读写
+// ============================================
+#include "Corpus.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#include "SnapDetector.h"
+#include "Synth.h"
+
+namespace bench {
+
+namespace {
+
+uint64_t fnv1a(const void* data, size_t length, uint64_t hash = 0xcbf29ce484222325ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+size_t seconds(double s) { return static_cast<size_t>(s * kSampleRate); }
+
+// ==================== 合成语料 ====================
+// 种子取自段名，增删、调换其它段不影响这一段的内容
+class Builder {
+private:
+    Clip clip;
+    Track track;
+    Rng rng;
+
+    // 事件起点：首个不早于 0.5 s，末个离结尾至少 0.6 s（留出检测与 300 ms 防抖）
+    std::vector<size_t> onsets(double minGap, double maxGap) {
+        std::vector<size_t> out;
+        size_t last = track.size() - seconds(0.6);
+        for (size_t at = seconds(0.5 + rng.uniform(0, 0.5)); at < last; at += seconds(rng.uniform(minGap, maxGap))) {
+            out.push_back(at);
+        }
+        return out;
+    }
+
+    void mark(size_t onset, EventKind kind) { clip.events.push_back(Event{static_cast<uint32_t>(onset), kind}); }
+
+public:
+    Builder(const std::string& name, const std::string& category, double length)
+        : rng(fnv1a(name.data(), name.size())) {
+        clip.name = name;
+        clip.category = category;
+        size_t samples = seconds(length);
+        track.assign((samples + SNAP_SAMPLES - 1) / SNAP_SAMPLES * SNAP_SAMPLES, 0.0);
+        // 每段都带麦克风底噪
+        synth::noise(track, rng, NoiseColor::White, 1.5);
+    }
+
+    Builder& noise(NoiseColor color, double rms) {
+        synth::noise(track, rng, color, rms);
+        return *this;
+    }
+
+    Builder& hum(double hz, double rms) {
+        synth::hum(track, hz, rms);
+        return *this;
+    }
+
+    Builder& speech(double rms, double f0) {
+        synth::speech(track, 0, track.size(), rng, rms, f0);
+        return *this;
+    }
+
+    Builder& music(double rms, bool drums) {
+        synth::music(track, 0, track.size(), rng, rms, drums);
+        return *this;
+    }
+
+    Builder& snaps(double minGap, double maxGap, double peakLo, double peakHi, double hzLo = 1600, double hzHi = 4200) {
+        for (size_t at : onsets(minGap, maxGap)) {
+            synth::snap(track, at, rng, rng.logUniform(peakLo, peakHi), rng.uniform(hzLo, hzHi));
+            mark(at, EventKind::Snap);
+        }
+        return *this;
+    }
+
+    // 连续两次响指，间隔 0.2~0.8 s（sound.h 原本想做的"双击"）
+    Builder& doubleSnaps(double peakLo, double peakHi) {
+        for (size_t at : onsets(1.8, 2.8)) {
+            size_t second = at + seconds(rng.uniform(0.2, 0.8));
+            double hz = rng.uniform(1600, 4200);
+            synth::snap(track, at, rng, rng.logUniform(peakLo, peakHi), hz);
+            mark(at, EventKind::Snap);
+            if (second + seconds(0.6) >= track.size()) break;
+            synth::snap(track, second, rng, rng.logUniform(peakLo, peakHi), hz * rng.uniform(0.9, 1.1));
+            mark(second, EventKind::Snap);
+        }
+        return *this;
+    }
+
+    Builder& claps(double minGap, double maxGap, double peakLo, double peakHi) {
+        for (size_t at : onsets(minGap, maxGap)) {
+            synth::clap(track, at, rng, rng.logUniform(peakLo, peakHi));
+            mark(at, EventKind::Clap);
+        }
+        return *this;
+    }
+
+    Clip finish() {
+        clip.raw = toRaw(track);
+        std::sort(clip.events.begin(), clip.events.end(),
+                  [](const Event& a, const Event& b) { return a.onset < b.onset; });
+        return std::move(clip);
+    }
+};
+
+// ==================== WAV ====================
+void put16(std::string& out, uint16_t v) {
+    out.push_back(char(v & 0xFF));
+    out.push_back(char(v >> 8));
+}
+
+void put32(std::string& out, uint32_t v) {
+    put16(out, uint16_t(v & 0xFFFF));
+    put16(out, uint16_t(v >> 16));
+}
+
+uint16_t get16(const uint8_t* p) { return uint16_t(p[0] | (p[1] << 8)); }
+uint32_t get32(const uint8_t* p) { return uint32_t(get16(p)) | (uint32_t(get16(p + 2)) << 16); }
+
+bool readFile(const std::string& path, std::string& data) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) data.append(chunk, n);
+    fclose(file);
+    return true;
+}
+
+bool writeFile(const std::string& path, const std::string& data) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return fclose(file) == 0 && ok;
+}
+
+bool parseWav(const std::string& data, std::vector<int32_t>& raw, std::string& error) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    if (data.size() < 12 || memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WAVE", 4) != 0) {
+        error = "不是 RIFF/WAVE";
+        return false;
+    }
+    uint16_t format = 0, channels = 0, bits = 0;
+    uint32_t rate = 0;
+    for (size_t at = 12; at + 8 <= data.size();) {
+        uint32_t size = get32(bytes + at + 4);
+        const uint8_t* body = bytes + at + 8;
+        if (at + 8 + size > data.size()) size = uint32_t(data.size() - at - 8);
+        if (memcmp(bytes + at, "fmt ", 4) == 0 && size >= 16) {
+            format = get16(body);
+            channels = get16(body + 2);
+            rate = get32(body + 4);
+            bits = get16(body + 14);
+            if (format == 0xFFFE && size >= 26) format = get16(body + 24);  // WAVE_FORMAT_EXTENSIBLE
+        } else if (memcmp(bytes + at, "data", 4) == 0) {
+            if (format != 1 || channels != 1 || rate != kSampleRate || (bits != 16 && bits != 32)) {
+                error = "需要 16 kHz 单声道 16/32 位 PCM";
+                return false;
+            }
+            size_t count = size / (bits / 8);
+            raw.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                raw[i] = bits == 16 ? int32_t(uint32_t(get16(body + i * 2)) << 16) : int32_t(get32(body + i * 4));
+            }
+            return true;
+        }
+        at += 8 + size + (size & 1);
+    }
+    error = "缺少 data 块";
+    return false;
+}
+
+std::string onsetList(const Clip& clip, EventKind kind) {
+    std::string out;
+    for (const Event& event : clip.events) {
+        if (event.kind != kind) continue;
+        if (!out.empty()) out += ',';
+        out += std::to_string(event.onset);
+    }
+    return out.empty() ? "-" : out;
+}
+
+bool parseOnsets(const std::string& field, EventKind kind, std::vector<Event>& events) {
+    if (field == "-" || field.empty()) return true;
+    std::stringstream stream(field);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        char* end = nullptr;
+        unsigned long onset = strtoul(item.c_str(), &end, 10);
+        if (end == item.c_str() || *end) return false;
+        events.push_back(Event{static_cast<uint32_t>(onset), kind});
+    }
+    return true;
+}
+
+}  // namespace
+
+size_t Clip::blocks() const { return raw.size() / SNAP_SAMPLES; }
+
+double Clip::seconds() const { return double(raw.size()) / kSampleRate; }
+
+uint64_t Clip::checksum() const { return fnv1a(raw.data(), raw.size() * sizeof(int32_t)); }
+
+std::vector<Clip> synthCorpus() {
+    std::vector<Clip> clips;
+    auto add = [&](Builder& builder) { clips.push_back(builder.finish()); };
+
+    // ---- 正样本 ----
+    for (int i = 1; i <= 4; i++) {
+        Builder b("snap_near_" + std::to_string(i), "snap", 12);
+        add(b.noise(NoiseColor::Pink, 1).snaps(1.2, 2.4, 3000, 12000));
+    }
+    for (int i = 1; i <= 3; i++) {
+        Builder b("snap_far_" + std::to_string(i), "snap", 12);
+        add(b.noise(NoiseColor::Pink, 3).snaps(1.2, 2.4, 200, 1500));
+    }
+    for (int i = 1; i <= 3; i++) {
+        Builder b("snap_double_" + std::to_string(i), "snap", 12);
+        add(b.noise(NoiseColor::Pink, 1).doubleSnaps(2000, 10000));
+    }
+    for (int i = 1; i <= 2; i++) {
+        Builder b("snap_fan_" + std::to_string(i), "snap+noise", 15);
+        add(b.noise(NoiseColor::Pink, 7).hum(50, 4).snaps(1.5, 3, 1000, 8000));
+    }
+    {
+        Builder b("snap_noisy_1", "snap+noise", 15);
+        add(b.noise(NoiseColor::Pink, 40).snaps(1.5, 3, 1500, 10000));
+    }
+    {
+        Builder b("snap_speech_1", "snap+speech", 15);
+        add(b.speech(60, 120).snaps(1.5, 3, 1500, 10000));
+    }
+    {
+        Builder b("snap_speech_2", "snap+speech", 15);
+        add(b.speech(120, 210).snaps(1.5, 3, 1500, 10000));
+    }
+    {
+        Builder b("snap_music_1", "snap+music", 15);
+        add(b.music(120, false).snaps(1.5, 3, 1500, 10000));
+    }
+    {
+        Builder b("snap_music_2", "snap+music", 15);
+        add(b.music(200, true).snaps(1.5, 3, 1500, 10000));
+    }
+
+    // ---- 拍手 ----
+    for (int i = 1; i <= 3; i++) {
+        Builder b("clap_single_" + std::to_string(i), "clap", 12);
+        add(b.noise(NoiseColor::Pink, 1).claps(1.5, 3, 4000, 20000));
+    }
+    {
+        Builder b("clap_applause_1", "clap", 8);
+        add(b.noise(NoiseColor::Pink, 2).claps(0.08, 0.25, 1500, 15000));
+    }
+
+    // ---- 语音 ----
+    struct Voice {
+        const char* name;
+        double rms;
+        double f0;
+    };
+    for (const Voice& v : {Voice{"speech_male_quiet", 30, 115}, Voice{"speech_male_loud", 100, 125},
+                           Voice{"speech_female_quiet", 30, 205}, Voice{"speech_female_loud", 100, 220},
+                           Voice{"speech_near", 300, 170}}) {
+        Builder b(v.name, "speech", 20);
+        add(b.speech(v.rms, v.f0));
+    }
+
+    // ---- 音乐 ----
+    struct Tune {
+        const char* name;
+        double rms;
+        bool drums;
+    };
+    for (const Tune& t : {Tune{"music_piano_quiet", 60, false}, Tune{"music_piano_loud", 250, false},
+                          Tune{"music_drums", 150, true}, Tune{"music_drums_loud", 300, true}}) {
+        Builder b(t.name, "music", 20);
+        add(b.music(t.rms, t.drums));
+    }
+
+    // ---- 噪声 ----
+    {
+        Builder b("noise_floor", "noise", 15);
+        add(b);
+    }
+    {
+        Builder b("noise_fan", "noise", 15);
+        add(b.noise(NoiseColor::Pink, 8).hum(50, 3));
+    }
+    {
+        Builder b("noise_hum", "noise", 15);
+        add(b.hum(50, 10));
+    }
+    {
+        Builder b("noise_pink_loud", "noise", 15);
+        add(b.noise(NoiseColor::Pink, 60));
+    }
+    {
+        Builder b("noise_white_loud", "noise", 15);
+        add(b.noise(NoiseColor::White, 60));
+    }
+    {
+        Builder b("noise_brown", "noise", 15);
+        add(b.noise(NoiseColor::Brown, 100));
+    }
+    return clips;
+}
+
+bool loadCorpusDir(const std::string& dir, std::vector<Clip>& clips, std::string& error) {
+    std::string labels;
+    if (!readFile(dir + "/labels.tsv", labels)) {
+        error = dir + "/labels.tsv 打不开";
+        return false;
+    }
+    std::stringstream lines(labels);
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(lines, line)) {
+        lineNo++;
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string> fields;
+        std::stringstream row(line);
+        std::string field;
+        while (std::getline(row, field, '\t')) fields.push_back(field);
+        if (fields.size() < 4) {
+            error = "labels.tsv 第 " + std::to_string(lineNo) + " 行应有 4 列";
+            return false;
+        }
+
+        Clip clip;
+        clip.name = fields[0].substr(0, fields[0].rfind('.'));
+        clip.category = fields[1];
+        if (!parseOnsets(fields[2], EventKind::Snap, clip.events) ||
+            !parseOnsets(fields[3], EventKind::Clap, clip.events)) {
+            error = "labels.tsv 第 " + std::to_string(lineNo) + " 行起点格式不对";
+            return false;
+        }
+        std::sort(clip.events.begin(), clip.events.end(),
+                  [](const Event& a, const Event& b) { return a.onset < b.onset; });
+
+        std::string data;
+        if (!readFile(dir + "/" + fields[0], data)) {
+            error = fields[0] + " 打不开";
+            return false;
+        }
+        if (!parseWav(data, clip.raw, error)) {
+            error = fields[0] + ": " + error;
+            return false;
+        }
+        // 末尾不足一块的部分 i2s_read 读不到，直接舍去
+        clip.raw.resize(clip.raw.size() / SNAP_SAMPLES * SNAP_SAMPLES);
+        clips.push_back(std::move(clip));
+    }
+    return true;
+}
+
+bool dumpCorpusDir(const std::string& dir, const std::vector<Clip>& clips, std::string& error) {
+    std::string labels = "# 文件\t类别\t响指起点（样本）\t拍手起点\n";
+    for (const Clip& clip : clips) {
+        std::string wav = "RIFF";
+        uint32_t dataBytes = uint32_t(clip.raw.size() * 4);
+        put32(wav, 36 + dataBytes);
+        wav += "WAVEfmt ";
+        put32(wav, 16);
+        put16(wav, 1);
+        put16(wav, 1);
+        put32(wav, kSampleRate);
+        put32(wav, kSampleRate * 4);
+        put16(wav, 4);
+        put16(wav, 32);
+        wav += "data";
+        put32(wav, dataBytes);
+        for (int32_t word : clip.raw) put32(wav, uint32_t(word));
+
+        std::string file = clip.name + ".wav";
+        if (!writeFile(dir + "/" + file, wav)) {
+            error = dir + "/" + file + " 写入失败";
+            return false;
+        }
+        labels += file + "\t" + clip.category + "\t" + onsetList(clip, EventKind::Snap) + "\t" +
+                  onsetList(clip, EventKind::Clap) + "\n";
+    }
+    if (!writeFile(dir + "/labels.tsv", labels)) {
+        error = dir + "/labels.tsv 写入失败";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace bench
@@ -0,0 +1,47 @@
+// ============================================
+// Corpus.h - 带标注的检测语料
+// ============================================
+// 每段语料是一串原始 I2S 字（与 sound.h 里 i2s_read 读到的一样），长度补齐到 DMA 块的整数倍，
+// 另有标注的瞬态事件：响指是正样本，拍手是最容易混淆的负样本。语音 / 音乐 / 噪声段
+// 不标事件，上面的任何触发都算误触发。
+//
+// 默认语料由 Synth 按固定种子合成；真实录音可放进目录，配 labels.tsv：
+//   文件名<TAB>类别<TAB>响指起点（样本，逗号分隔，无则 -）<TAB>拍手起点
+// WAV 须为 16 kHz 单声道：16 位（服务器归档格式，按高 16 位还原）或 32 位（原始 I2S 字）。
+#ifndef SNAPBENCH_CORPUS_H
+#define SNAPBENCH_CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+enum class EventKind { Snap, Clap };
+
+struct Event {
+    uint32_t onset;  // 样本
+    EventKind kind;
+};
+
+struct Clip {
+    std::string name;
+    std::string category;     // snap / clap / speech / music / noise，混合的写成 snap+speech
+    std::vector<int32_t> raw;
+    std::vector<Event> events;
+
+    size_t blocks() const;
+    double seconds() const;
+    // FNV-1a，判断语料本身有没有变
+    uint64_t checksum() const;
+};
+
+std::vector<Clip> synthCorpus();
+bool loadCorpusDir(const std::string& dir, std::vector<Clip>& clips, std::string& error);
+// 写成 32 位 WAV + labels.tsv，可再用 loadCorpusDir 读回（逐位一致）
+bool dumpCorpusDir(const std::string& dir, const std::vector<Clip>& clips, std::string& error);
+
+}  // namespace bench
+
+#endif  // SNAPBENCH_CORPUS_H
@@ -0,0 +1,175 @@
+// ============================================
+// Detectors.cpp - 检测后端
+// ============================================
+#include "Detectors.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace bench {
+
+namespace {
+
+// ==================== reference：固件原样 ====================
+class ReferenceDetector : public Detector {
+private:
+    float vReal[SNAP_SAMPLES];
+    float vImag[SNAP_SAMPLES];
+    ArduinoFFT<float> fft{vReal, vImag, SNAP_SAMPLES, SNAP_SAMPLE_RATE};
+
+public:
+    SnapResult process(const int32_t* block) override { return detectSnap(fft, vReal, vImag, block); }
+};
+
+// ==================== nosqrt：峰值比较改用模的平方 ====================
+// FFT 不变，只省掉 255 次 sqrt；sqrt 单调，但舍入后两个不同的平方可能开出同一个值，
+// 阈值边上与并列峰值处可能与 reference 不同——正是基线要拦的那类"等价"改动
+class NoSqrtDetector : public Detector {
+private:
+    float vReal[SNAP_SAMPLES];
+    float vImag[SNAP_SAMPLES];
+    ArduinoFFT<float> fft{vReal, vImag, SNAP_SAMPLES, SNAP_SAMPLE_RATE};
+
+public:
+    SnapResult process(const int32_t* block) override {
+        for (int i = 0; i < SNAP_SAMPLES; i++) {
+            vReal[i] = (float)snapSample16(block[i]);
+            vImag[i] = 0.0f;
+        }
+        fft.windowing(FFTWindow::Hamming, FFTDirection::Forward);
+        fft.compute(FFTDirection::Forward);
+
+        float best = 0.0f;
+        SnapResult result = {false, 0, 0.0f, 0.0f};
+        for (int i = 1; i < SNAP_SAMPLES / 2; i++) {
+            float power = vReal[i] * vReal[i] + vImag[i] * vImag[i];
+            if (power > best) {
+                best = power;
+                result.peakIndex = i;
+            }
+        }
+        result.peak = std::sqrt(best);
+        result.dominantFreq = result.peakIndex * ((float)SNAP_SAMPLE_RATE / SNAP_SAMPLES);
+        result.isSnap = result.dominantFreq > SNAP_MIN_FREQ && result.dominantFreq < SNAP_MAX_FREQ &&
+                        best > SNAP_MIN_PEAK * SNAP_MIN_PEAK;
+        return result;
+    }
+};
+
+// ==================== realfft：实数 FFT + 预计算表 ====================
+// 512 点实序列拼成 256 点复序列做 FFT 再拆分，窗系数、旋转因子、位反转都预先算好，
+// 运算量约为 reference 的一半；舍入路径不同，结果不保证逐位一致
+class RealFftDetector : public Detector {
+private:
+    static constexpr int kHalf = SNAP_SAMPLES / 2;
+
+    float window[SNAP_SAMPLES];
+    float cosTable[kHalf / 2];   // 256 点 FFT 的旋转因子
+    float sinTable[kHalf / 2];
+    float splitCos[kHalf];       // 拆分用的 e^{-2πik/512}
+    float splitSin[kHalf];
+    uint16_t reversed[kHalf];
+    float re[kHalf];
+    float im[kHalf];
+
+public:
+    RealFftDetector() {
+        // 与 arduinoFFT 一样用 double 算再截成 float
+        for (int i = 0; i < SNAP_SAMPLES / 2; i++) {
+            float ratio = float(i) / (float(SNAP_SAMPLES) - 1.0f);
+            float weight = 0.54 - (0.46 * std::cos(6.28318531 * ratio));
+            window[i] = weight;
+            window[SNAP_SAMPLES - 1 - i] = weight;
+        }
+        for (int k = 0; k < kHalf / 2; k++) {
+            cosTable[k] = float(std::cos(2 * M_PI * k / kHalf));
+            sinTable[k] = float(-std::sin(2 * M_PI * k / kHalf));
+        }
+        for (int k = 0; k < kHalf; k++) {
+            splitCos[k] = float(std::cos(2 * M_PI * k / SNAP_SAMPLES));
+            splitSin[k] = float(-std::sin(2 * M_PI * k / SNAP_SAMPLES));
+        }
+        int bits = 0;
+        while ((1 << bits) < kHalf) bits++;
+        for (int i = 0; i < kHalf; i++) {
+            int r = 0;
+            for (int b = 0; b < bits; b++) r |= ((i >> b) & 1) << (bits - 1 - b);
+            reversed[i] = uint16_t(r);
+        }
+    }
+
+    SnapResult process(const int32_t* block) override {
+        for (int n = 0; n < kHalf; n++) {
+            int r = reversed[n];
+            re[r] = (float)snapSample16(block[2 * n]) * window[2 * n];
+            im[r] = (float)snapSample16(block[2 * n + 1]) * window[2 * n + 1];
+        }
+        for (int size = 2; size <= kHalf; size <<= 1) {
+            int half = size >> 1;
+            int step = kHalf / size;
+            for (int start = 0; start < kHalf; start += size) {
+                for (int j = 0; j < half; j++) {
+                    float wr = cosTable[j * step];
+                    float wi = sinTable[j * step];
+                    int a = start + j;
+                    int b = a + half;
+                    float tr = wr * re[b] - wi * im[b];
+                    float ti = wr * im[b] + wi * re[b];
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+
+        // X[k] = (Z[k] + conj(Z[N/2-k]))/2 - i·W^k·(Z[k] - conj(Z[N/2-k]))/2
+        SnapResult result = {false, 0, 0.0f, 0.0f};
+        for (int k = 1; k < kHalf; k++) {
+            float ar = re[k], ai = im[k];
+            float br = re[kHalf - k], bi = -im[kHalf - k];
+            float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+            float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+            // -i·W·d
+            float wr = splitCos[k], wi = splitSin[k];
+            float pr = wr * dr - wi * di;
+            float pi = wr * di + wi * dr;
+            float xr = er + pi;
+            float xi = ei - pr;
+            float magnitude = std::sqrt(xr * xr + xi * xi);
+            if (magnitude > result.peak) {
+                result.peak = magnitude;
+                result.peakIndex = k;
+            }
+        }
+        result.dominantFreq = result.peakIndex * ((float)SNAP_SAMPLE_RATE / SNAP_SAMPLES);
+        result.isSnap = result.dominantFreq > SNAP_MIN_FREQ && result.dominantFreq < SNAP_MAX_FREQ &&
+                        result.peak > SNAP_MIN_PEAK;
+        return result;
+    }
+};
+
+template <typename T>
+std::unique_ptr<Detector> make() {
+    return std::unique_ptr<Detector>(new T());
+}
+
+}  // namespace
+
+const std::vector<Backend>& backends() {
+    static const std::vector<Backend> table = {
+        {"reference", "固件 SnapDetector.h + arduinoFFT", make<ReferenceDetector>},
+        {"nosqrt", "峰值比较用模的平方", make<NoSqrtDetector>},
+        {"realfft", "256 点复 FFT 拆分实数谱 + 预计算表", make<RealFftDetector>},
+    };
+    return table;
+}
+
+const Backend* findBackend(const char* name) {
+    for (const Backend& backend : backends()) {
+        if (strcmp(backend.name, name) == 0) return &backend;
+    }
+    return nullptr;
+}
+
+}  // namespace bench
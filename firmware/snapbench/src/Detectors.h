@@ -0,0 +1,36 @@
+// ============================================
+// Detectors.h - 可替换的响指检测后端
+// ============================================
+// reference 直接编译固件的 SnapDetector.h（配主机上的 arduinoFFT 替身），是基线的来源；
+// 其它后端是候选优化，输出同样的 SnapResult，逐块判定必须与基线一致才能换上固件。
+// 新后端：实现 Detector，在 Detectors.cpp 的 backends() 表里登记。
+#ifndef SNAPBENCH_DETECTORS_H
+#define SNAPBENCH_DETECTORS_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SnapDetector.h"
+
+namespace bench {
+
+class Detector {
+public:
+    virtual ~Detector() = default;
+    // block 为一块 SNAP_SAMPLES 个原始 I2S 字
+    virtual SnapResult process(const int32_t* block) = 0;
+};
+
+struct Backend {
+    const char* name;
+    const char* description;
+    std::unique_ptr<Detector> (*create)();
+};
+
+const std::vector<Backend>& backends();
+const Backend* findBackend(const char* name);
+
+}  // namespace bench
+
+#endif  // SNAPBENCH_DETECTORS_H
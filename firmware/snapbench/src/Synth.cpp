@@ -0,0 +1,340 @@
+// ============================================
+// Synth.cpp - 语料合成
+// ============================================
+#include "Synth.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace bench {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+size_t ms(double milliseconds) { return static_cast<size_t>(milliseconds * kSampleRate / 1000); }
+
+// RBJ 双二阶滤波器
+class Biquad {
+private:
+    double b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+    void set(double nb0, double nb1, double nb2, double a0, double na1, double na2) {
+        b0 = nb0 / a0;
+        b1 = nb1 / a0;
+        b2 = nb2 / a0;
+        a1 = na1 / a0;
+        a2 = na2 / a0;
+    }
+
+public:
+    // 带通（峰值增益 0 dB）
+    static Biquad bandpass(double hz, double q) {
+        Biquad f;
+        double w = 2 * kPi * hz / kSampleRate;
+        double alpha = std::sin(w) / (2 * q);
+        f.set(alpha, 0, -alpha, 1 + alpha, -2 * std::cos(w), 1 - alpha);
+        return f;
+    }
+
+    static Biquad lowpass(double hz, double q = 0.7071) {
+        Biquad f;
+        double w = 2 * kPi * hz / kSampleRate;
+        double alpha = std::sin(w) / (2 * q);
+        double c = std::cos(w);
+        f.set((1 - c) / 2, 1 - c, (1 - c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+        return f;
+    }
+
+    static Biquad highpass(double hz, double q = 0.7071) {
+        Biquad f;
+        double w = 2 * kPi * hz / kSampleRate;
+        double alpha = std::sin(w) / (2 * q);
+        double c = std::cos(w);
+        f.set((1 + c) / 2, -(1 + c), (1 + c) / 2, 1 + alpha, -2 * c, 1 - alpha);
+        return f;
+    }
+
+    double operator()(double x) {
+        double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+    }
+};
+
+// 把 sound 缩放到峰值 peak 后叠加到 track 的 offset 处（超出末尾的部分丢弃）
+void mixPeak(Track& track, size_t offset, const Track& sound, double peak) {
+    double max = 0;
+    for (double v : sound) max = std::max(max, std::fabs(v));
+    if (max == 0) return;
+    double gain = peak / max;
+    for (size_t i = 0; i < sound.size() && offset + i < track.size(); i++) track[offset + i] += sound[i] * gain;
+}
+
+void mixRms(Track& track, size_t offset, const Track& sound, double rms) {
+    double sum = 0;
+    for (double v : sound) sum += v * v;
+    if (sum == 0) return;
+    double gain = rms / std::sqrt(sum / sound.size());
+    for (size_t i = 0; i < sound.size() && offset + i < track.size(); i++) track[offset + i] += sound[i] * gain;
+}
+
+// 衰减包络：attack 内线性上升，之后按 tau 指数衰减
+double envelope(size_t n, size_t attack, double tauSamples) {
+    if (n < attack) return double(n + 1) / double(attack + 1);
+    return std::exp(-double(n - attack) / tauSamples);
+}
+
+struct Vowel {
+    double f1, f2, f3;
+};
+
+// 成年男性元音共振峰（Peterson & Barney 均值附近），女声整体乘 1.17
+constexpr Vowel kVowels[] = {
+    {730, 1090, 2440},  // a
+    {270, 2290, 3010},  // i
+    {300, 870, 2240},   // u
+    {530, 1840, 2480},  // e
+    {570, 840, 2410},   // o
+};
+
+}  // namespace
+
+// ==================== Rng ====================
+uint64_t Rng::next() {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+double Rng::uniform() { return double(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+double Rng::uniform(double lo, double hi) { return lo + (hi - lo) * uniform(); }
+
+double Rng::logUniform(double lo, double hi) { return std::exp(uniform(std::log(lo), std::log(hi))); }
+
+double Rng::gaussian() {
+    // Box-Muller，只用一半结果，保持调用次数固定
+    double u1 = uniform();
+    double u2 = uniform();
+    if (u1 < 1e-300) u1 = 1e-300;
+    return std::sqrt(-2 * std::log(u1)) * std::cos(2 * kPi * u2);
+}
+
+namespace synth {
+
+// ==================== 瞬态 ====================
+void snap(Track& track, size_t onset, Rng& rng, double peak, double centerHz) {
+    size_t attack = ms(0.3);
+    double tau = rng.uniform(2, 5) * kSampleRate / 1000;
+    Biquad main = Biquad::bandpass(centerHz, rng.uniform(3, 6));
+    Biquad upper = Biquad::bandpass(std::min(centerHz * rng.uniform(1.5, 1.9), 7000.0), 4);
+    Biquad thump = Biquad::lowpass(300);  // 指腹撞到掌心的低频
+    double upperGain = rng.uniform(0.3, 0.6);
+
+    Track sound(ms(40));
+    for (size_t n = 0; n < sound.size(); n++) {
+        double excitation = rng.gaussian() * envelope(n, attack, tau);
+        sound[n] = main(excitation) + upperGain * upper(excitation) + 0.15 * thump(excitation);
+    }
+    mixPeak(track, onset, sound, peak);
+}
+
+void clap(Track& track, size_t onset, Rng& rng, double peak) {
+    Biquad body = Biquad::bandpass(rng.uniform(800, 2500), rng.uniform(1.2, 2.0));
+    Biquad tail = Biquad::lowpass(3000);
+    int bursts = 2 + int(rng.next() % 3);
+    size_t burstAt[4];
+    for (int b = 0; b < bursts; b++) burstAt[b] = b == 0 ? 0 : burstAt[b - 1] + ms(rng.uniform(1, 4));
+    double tau = rng.uniform(6, 12) * kSampleRate / 1000;
+    double reverbTau = rng.uniform(40, 90) * kSampleRate / 1000;
+
+    Track sound(ms(250));
+    for (size_t n = 0; n < sound.size(); n++) {
+        double excitation = 0;
+        for (int b = 0; b < bursts; b++) {
+            if (n >= burstAt[b]) excitation += envelope(n - burstAt[b], ms(0.5), tau) / (1 + 0.4 * b);
+        }
+        double reverb = 0.06 * std::exp(-double(n) / reverbTau);
+        double white = rng.gaussian();
+        sound[n] = body(white * excitation) + tail(white * reverb);
+    }
+    mixPeak(track, onset, sound, peak);
+}
+
+// ==================== 语音 ====================
+void speech(Track& track, size_t begin, size_t end, Rng& rng, double rms, double f0) {
+    end = std::min(end, track.size());
+    if (begin >= end) return;
+    Track voice(end - begin, 0.0);
+    double formantScale = f0 > 160 ? 1.17 : 1.0;
+    double phase = 0;
+
+    size_t pos = 0;
+    while (pos < voice.size()) {
+        // ---- 辅音：擦音 s / sh / f、爆破音，或者没有 ----
+        double kind = rng.uniform();
+        size_t consonantLength = 0;
+        if (kind < 0.45) {
+            Biquad shape = kind < 0.15   ? Biquad::bandpass(rng.uniform(5000, 7000), 2.0)   // s
+                           : kind < 0.3 ? Biquad::bandpass(rng.uniform(2500, 3800), 2.0)  // sh
+                                         : Biquad::highpass(1500);                          // f / h
+            double level = kind < 0.3 ? rng.uniform(0.15, 0.35) : rng.uniform(0.05, 0.15);
+            consonantLength = ms(rng.uniform(60, 140));
+            for (size_t n = 0; n < consonantLength && pos + n < voice.size(); n++) {
+                double shapeEnv = std::sin(kPi * double(n) / double(consonantLength));
+                voice[pos + n] += level * shapeEnv * shape(rng.gaussian());
+            }
+        } else if (kind < 0.65) {
+            Biquad shape = Biquad::bandpass(rng.uniform(800, 4000), 1.0);
+            consonantLength = ms(rng.uniform(8, 20));
+            for (size_t n = 0; n < consonantLength && pos + n < voice.size(); n++) {
+                voice[pos + n] += 0.5 * envelope(n, ms(1), ms(5)) * shape(rng.gaussian());
+            }
+        }
+        pos += consonantLength;
+
+        // ---- 元音：谐波按 -12 dB/倍频程 衰减，再过三个共振峰 ----
+        const Vowel& vowel = kVowels[rng.next() % (sizeof(kVowels) / sizeof(kVowels[0]))];
+        Biquad formant1 = Biquad::bandpass(vowel.f1 * formantScale, 6);
+        Biquad formant2 = Biquad::bandpass(vowel.f2 * formantScale, 8);
+        Biquad formant3 = Biquad::bandpass(vowel.f3 * formantScale, 10);
+        size_t vowelLength = ms(rng.uniform(120, 300));
+        double pitch = f0 * rng.uniform(0.85, 1.2);
+        double glide = rng.uniform(-0.25, 0.2);  // 音节内的升降调
+        double level = rng.uniform(0.6, 1.0);
+        for (size_t n = 0; n < vowelLength && pos + n < voice.size(); n++) {
+            double progress = double(n) / double(vowelLength);
+            double hz = pitch * (1 + glide * progress);
+            phase += 2 * kPi * hz / kSampleRate;
+            if (phase > 2 * kPi) phase -= 2 * kPi;
+            double source = 0;
+            for (int k = 1; k * hz < 4000; k++) source += std::sin(k * phase) / double(k * k);
+            double shapeEnv = std::sin(kPi * progress);
+            voice[pos + n] += level * shapeEnv * (formant1(source) + 0.6 * formant2(source) + 0.3 * formant3(source));
+        }
+        pos += vowelLength;
+
+        // ---- 停顿：词间短、句间长 ----
+        pos += rng.uniform() < 0.15 ? ms(rng.uniform(300, 600)) : ms(rng.uniform(30, 200));
+    }
+    mixRms(track, begin, voice, rms);
+}
+
+// ==================== 音乐 ====================
+void music(Track& track, size_t begin, size_t end, Rng& rng, double rms, bool drums) {
+    end = std::min(end, track.size());
+    if (begin >= end) return;
+    Track tune(end - begin, 0.0);
+    static constexpr int kPentatonic[] = {0, 2, 4, 7, 9};
+    double beat = 60.0 / rng.uniform(80, 130);  // 秒
+
+    // ---- 旋律与和弦：类钢琴，谐波越高衰减越快 ----
+    size_t pos = 0;
+    while (pos < tune.size()) {
+        int voices = rng.uniform() < 0.3 ? 3 : 1;
+        size_t length = static_cast<size_t>(beat * kSampleRate * (rng.uniform() < 0.5 ? 0.5 : 1.0));
+        for (int v = 0; v < voices; v++) {
+            int degree = kPentatonic[rng.next() % 5] + 12 * int(rng.next() % 3);
+            double hz = 261.63 * std::pow(2.0, degree / 12.0);  // C4 起三个八度
+            double decay = rng.uniform(0.15, 0.5) * kSampleRate;
+            for (size_t n = 0; n < length * 2 && pos + n < tune.size(); n++) {
+                double t = double(n) / kSampleRate;
+                double sample = 0;
+                for (int k = 1; k <= 8 && k * hz < 7500; k++) {
+                    sample += std::sin(2 * kPi * k * hz * t) * std::exp(-double(n) * k / decay) / k;
+                }
+                tune[pos + n] += sample * envelope(n, ms(5), 1e12) / voices;
+            }
+        }
+        pos += length;
+    }
+
+    // ---- 鼓：1、3 拍底鼓，2、4 拍军鼓，八分音符踩镲 ----
+    if (drums) {
+        Track kit(tune.size(), 0.0);
+        size_t eighth = static_cast<size_t>(beat * kSampleRate / 2);
+        Biquad hatFilter = Biquad::highpass(7000);
+        Biquad snareFilter = Biquad::bandpass(rng.uniform(1500, 2500), 0.8);
+        for (size_t step = 0; step * eighth < kit.size(); step++) {
+            size_t at = step * eighth;
+            int inBar = int(step % 8);
+            for (size_t n = 0; n < ms(60) && at + n < kit.size(); n++) {
+                kit[at + n] += 0.15 * envelope(n, 2, ms(15)) * hatFilter(rng.gaussian());
+            }
+            if (inBar == 0 || inBar == 4) {
+                for (size_t n = 0; n < ms(200) && at + n < kit.size(); n++) {
+                    double t = double(n) / kSampleRate;
+                    kit[at + n] += 1.2 * std::sin(2 * kPi * (50 + 60 * std::exp(-t * 30)) * t) * std::exp(-t * 12);
+                }
+            }
+            if (inBar == 2 || inBar == 6) {
+                for (size_t n = 0; n < ms(150) && at + n < kit.size(); n++) {
+                    double t = double(n) / kSampleRate;
+                    double tone = 0.3 * std::sin(2 * kPi * 190 * t);
+                    kit[at + n] += envelope(n, 3, ms(35)) * (snareFilter(rng.gaussian()) * 1.5 + tone);
+                }
+            }
+        }
+        for (size_t n = 0; n < tune.size(); n++) tune[n] += kit[n];
+    }
+    mixRms(track, begin, tune, rms);
+}
+
+// ==================== 噪声 ====================
+void noise(Track& track, Rng& rng, NoiseColor color, double rms) {
+    Track sound(track.size());
+    double b0 = 0, b1 = 0, b2 = 0, b3 = 0, b4 = 0, b5 = 0, b6 = 0;
+    double brown = 0;
+    for (size_t n = 0; n < sound.size(); n++) {
+        double white = rng.gaussian();
+        switch (color) {
+            case NoiseColor::White:
+                sound[n] = white;
+                break;
+            case NoiseColor::Pink:  // Paul Kellet 的粉红噪声滤波器
+                b0 = 0.99886 * b0 + white * 0.0555179;
+                b1 = 0.99332 * b1 + white * 0.0750759;
+                b2 = 0.96900 * b2 + white * 0.1538520;
+                b3 = 0.86650 * b3 + white * 0.3104856;
+                b4 = 0.55000 * b4 + white * 0.5329522;
+                b5 = -0.7616 * b5 - white * 0.0168980;
+                sound[n] = b0 + b1 + b2 + b3 + b4 + b5 + b6 + white * 0.5362;
+                b6 = white * 0.115926;
+                break;
+            case NoiseColor::Brown:  // 带泄漏的积分，避免直流漂走
+                brown = 0.995 * brown + white * 0.1;
+                sound[n] = brown;
+                break;
+        }
+    }
+    mixRms(track, 0, sound, rms);
+}
+
+void hum(Track& track, double hz, double rms) {
+    Track sound(track.size());
+    for (size_t n = 0; n < sound.size(); n++) {
+        double t = double(n) / kSampleRate;
+        sound[n] = std::sin(2 * kPi * hz * t) + 0.5 * std::sin(4 * kPi * hz * t) + 0.25 * std::sin(6 * kPi * hz * t);
+    }
+    mixRms(track, 0, sound, rms);
+}
+
+}  // namespace synth
+
+std::vector<int32_t> toRaw(const Track& track) {
+    std::vector<int32_t> raw(track.size());
+    for (size_t n = 0; n < track.size(); n++) {
+        double value = std::nearbyint(track[n] * 256);
+        value = std::max(-8388608.0, std::min(8388607.0, value));
+        raw[n] = static_cast<int32_t>(static_cast<uint32_t>(static_cast<int32_t>(value)) << 8);
+    }
+    return raw;
+}
+
+}  // namespace bench
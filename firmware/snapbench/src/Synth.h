@@ -0,0 +1,61 @@
+// ============================================
+// Synth.h - 语料合成：响指、拍手、语音、音乐、噪声
+// ============================================
+// 全部以 16 kHz、"16 位 PCM 单位"（与服务器归档一致，满幅 ±32767）的 double 轨道生成，
+// 最后换算成 INMP441 的原始 I2S 字。同一种子在同一平台上逐位可复现；
+// 换平台后 libm 可能差最后一位，所以基线里记了每段的校验和。
+//
+// 电平参考（INMP441：94 dB SPL ≈ 1640 RMS）：
+//   安静房间 / 麦克风底噪 ≈ 1.5，风扇 ≈ 8，1 m 外正常说话 ≈ 30~100，
+//   外放音乐 ≈ 100~300，1 m 内响指 / 拍手峰值 ≈ 3000~20000，3~5 m 外响指 ≈ 200~1500
+#ifndef SNAPBENCH_SYNTH_H
+#define SNAPBENCH_SYNTH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bench {
+
+constexpr int kSampleRate = 16000;
+
+using Track = std::vector<double>;
+
+// splitmix64，与固件仿真的服务器替身同一套
+class Rng {
+private:
+    uint64_t state;
+
+public:
+    explicit Rng(uint64_t seed) : state(seed) {}
+    uint64_t next();
+    double uniform();                        // [0, 1)
+    double uniform(double lo, double hi);
+    double logUniform(double lo, double hi);  // 电平这类量按对数均匀取
+    double gaussian();
+};
+
+enum class NoiseColor { White, Pink, Brown };
+
+namespace synth {
+
+// 单个响指：约 0.3 ms 起音、2~5 ms 衰减的噪声激励，经 centerHz 附近两个共振峰塑形；peak 为峰值
+void snap(Track& track, size_t onset, Rng& rng, double peak, double centerHz);
+// 单次拍手：2~4 个相隔几毫秒的短脉冲 + 房间混响尾巴，能量集中在 0.8~2.5 kHz
+void clap(Track& track, size_t onset, Rng& rng, double peak);
+// [begin, end) 内一段连续语音：浊音（基频 f0 的谐波经元音共振峰）+ 擦音 / 爆破音 + 停顿
+void speech(Track& track, size_t begin, size_t end, Rng& rng, double rms, double f0);
+// [begin, end) 内一段音乐：五声音阶的音符 / 和弦，drums 为真时加底鼓、军鼓、踩镲
+void music(Track& track, size_t begin, size_t end, Rng& rng, double rms, bool drums);
+void noise(Track& track, Rng& rng, NoiseColor color, double rms);
+// 工频嗡声（基波 + 2、3 次谐波）
+void hum(Track& track, double hz, double rms);
+
+}  // namespace synth
+
+// 换算成原始 I2S 字：24 位有符号数左对齐到 32 位（1 个 PCM16 单位 = 256 个 24 位单位）
+std::vector<int32_t> toRaw(const Track& track);
+
+}  // namespace bench
+
+#endif  // SNAPBENCH_SYNTH_H
@@ -0,0 +1,471 @@
+// ============================================
+// main.cpp - 响指检测基准与回归门禁
+// ============================================
+// 把带标注的语料逐块喂给检测后端，按 sound.h 的 loop() 节奏（每轮 delay(20)，触发后再 delay(300)，
+// DMA 队列满了丢最旧的块）还原设备上真正会触发的时刻，输出：
+//   - 精确率 / 召回率，按类别统计的误触发（次/分钟）
+//   - 检测延迟（样本）：从响指起点到 loop() 处理完触发块
+//   - 吞吐：每秒处理的块数（帧/秒）与实时倍数。这是主机上的数字，只用来比较后端之间的相对快慢：
+//     ESP32-C3 没有 FPU，sqrt、乘加各自的代价比例与主机（还会自动向量化）不同
+// 并把每个后端的逐块判定与 baseline.tsv 比较；--check 时有任何不同即返回 1。
+// 调阈值这类有意改变行为的改动，先看报告再 make baseline 重新生成基线，与代码一起提交。
+//
+// 用法: snapbench [--backend NAME]... [--check] [--update-baseline] [--baseline FILE]
+//                 [--corpus DIR] [--dump DIR] [--repeat 3] [--verbose]
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Baseline.h"
+#include "Corpus.h"
+#include "Detectors.h"
+#include "Synth.h"
+
+namespace {
+
+using namespace bench;
+
+// ---- sound.h 的调度参数 ----
+constexpr uint64_t kLoopDelaySamples = 20 * kSampleRate / 1000;   // loop() 末尾 delay(20)
+constexpr uint64_t kDebounceSamples = 300 * kSampleRate / 1000;   // 触发后 delay(300)
+constexpr size_t kDmaQueue = 8 - 1;  // dma_buf_count = 8；旧版驱动的就绪队列长度为 dma_buf_count - 1
+
+// 一次触发所在的块要和事件的这段时间有重叠，才算"由这次事件引起"
+constexpr uint32_t kSnapSpanSamples = 50 * kSampleRate / 1000;
+constexpr uint32_t kClapSpanSamples = 250 * kSampleRate / 1000;
+constexpr size_t kShowDiffs = 5;
+
+struct Options {
+    std::vector<const Backend*> backends;
+    bool check = false;
+    bool updateBaseline = false;
+    bool verbose = false;
+    std::string baselinePath;
+    std::string corpusDir;
+    std::string dumpDir;
+    int repeat = 3;
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "用法: %s [--backend NAME]... [--check] [--update-baseline] [--baseline FILE]\n"
+            "          [--corpus DIR] [--dump DIR] [--repeat N] [--verbose]\n"
+            "后端:",
+            argv0);
+    for (const Backend& backend : backends()) fprintf(stderr, " %s", backend.name);
+    fputc('\n', stderr);
+}
+
+// ==================== 设备上的 loop() 节奏 ====================
+struct Detection {
+    uint32_t block;
+    uint64_t atSample;  // loop() 处理完这块的时刻
+};
+
+std::vector<Detection> schedule(const std::vector<SnapResult>& results, std::vector<bool>* read = nullptr) {
+    std::vector<Detection> detections;
+    if (read) read->assign(results.size(), false);
+    uint64_t now = 0;
+    size_t next = 0;
+    while (true) {
+        size_t completed = now / SNAP_SAMPLES;
+        if (completed > next + kDmaQueue) next = completed - kDmaQueue;  // 队列满时丢最旧的块
+        if (next >= results.size()) break;
+        if (completed <= next) now = uint64_t(next + 1) * SNAP_SAMPLES;  // i2s_read 等这块填满
+        bool hit = results[next].isSnap;
+        if (read) (*read)[next] = true;
+        if (hit) detections.push_back(Detection{uint32_t(next), now});
+        next++;
+        now += kLoopDelaySamples + (hit ? kDebounceSamples : 0);
+    }
+    return detections;
+}
+
+std::vector<bool> readBlocks(const std::vector<SnapResult>& results) {
+    std::vector<bool> read;
+    schedule(results, &read);
+    return read;
+}
+
+// ==================== 打分 ====================
+struct Score {
+    size_t clips = 0;
+    double seconds = 0;
+    size_t snaps = 0;
+    size_t hits = 0;
+    size_t falseAlarms = 0;
+    size_t duplicates = 0;   // 同一个响指触发两次（继电器会来回翻）
+    size_t onClaps = 0;      // 误触发落在拍手上
+
+    void add(const Score& other) {
+        clips += other.clips;
+        seconds += other.seconds;
+        snaps += other.snaps;
+        hits += other.hits;
+        falseAlarms += other.falseAlarms;
+        duplicates += other.duplicates;
+        onClaps += other.onClaps;
+    }
+};
+
+bool overlaps(uint32_t block, uint32_t onset, uint32_t span) {
+    uint64_t begin = uint64_t(block) * SNAP_SAMPLES;
+    return onset < begin + SNAP_SAMPLES && uint64_t(onset) + span > begin;
+}
+
+Score score(const Clip& clip, const std::vector<Detection>& detections, std::vector<uint64_t>& latencies) {
+    Score s;
+    s.clips = 1;
+    s.seconds = clip.seconds();
+    std::vector<bool> matched(clip.events.size(), false);
+    for (size_t e = 0; e < clip.events.size(); e++) {
+        if (clip.events[e].kind == EventKind::Snap) s.snaps++;
+    }
+    for (const Detection& detection : detections) {
+        bool found = false;
+        bool duplicate = false;
+        bool onClap = false;
+        for (size_t e = 0; e < clip.events.size(); e++) {
+            const Event& event = clip.events[e];
+            if (event.kind == EventKind::Clap) {
+                if (overlaps(detection.block, event.onset, kClapSpanSamples)) onClap = true;
+                continue;
+            }
+            if (!overlaps(detection.block, event.onset, kSnapSpanSamples)) continue;
+            if (matched[e]) {
+                duplicate = true;
+                continue;
+            }
+            matched[e] = true;
+            found = true;
+            latencies.push_back(detection.atSample - event.onset);
+            break;
+        }
+        if (found) {
+            s.hits++;
+        } else {
+            s.falseAlarms++;
+            if (duplicate) s.duplicates++;
+            else if (onClap) s.onClaps++;
+        }
+    }
+    return s;
+}
+
+double ratio(size_t a, size_t b) { return b ? double(a) / double(b) : 0.0; }
+
+uint64_t percentile(std::vector<uint64_t> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, size_t(p * double(values.size() - 1) + 0.5));
+    return values[index];
+}
+
+// ==================== 每个后端跑一遍 ====================
+struct Run {
+    const Backend* backend;
+    std::vector<std::vector<SnapResult>> results;  // [段][块]
+    double framesPerSecond = 0;
+    Score total;
+    std::map<std::string, Score> byCategory;
+    std::vector<Score> byClip;
+    std::vector<uint64_t> latencies;
+    bool baselineChecked = false;
+    bool baselineMatch = true;
+};
+
+Run runBackend(const Backend& backend, const std::vector<Clip>& clips, int repeat) {
+    Run run;
+    run.backend = &backend;
+    run.results.resize(clips.size());
+    size_t frames = 0;
+    for (const Clip& clip : clips) frames += clip.blocks();
+
+    double best = 1e300;
+    for (int r = 0; r < std::max(repeat, 1); r++) {
+        std::unique_ptr<Detector> detector = backend.create();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t c = 0; c < clips.size(); c++) {
+            std::vector<SnapResult>& out = run.results[c];
+            out.resize(clips[c].blocks());
+            const int32_t* raw = clips[c].raw.data();
+            for (size_t b = 0; b < out.size(); b++) out[b] = detector->process(raw + b * SNAP_SAMPLES);
+        }
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    run.framesPerSecond = frames / best;
+
+    for (size_t c = 0; c < clips.size(); c++) {
+        Score s = score(clips[c], schedule(run.results[c]), run.latencies);
+        run.byClip.push_back(s);
+        run.byCategory[clips[c].category].add(s);
+        run.total.add(s);
+    }
+    return run;
+}
+
+std::vector<uint32_t> positives(const std::vector<SnapResult>& results) {
+    std::vector<uint32_t> out;
+    for (size_t b = 0; b < results.size(); b++) {
+        if (results[b].isSnap) out.push_back(uint32_t(b));
+    }
+    return out;
+}
+
+// ==================== 基线比较 ====================
+void compareBaseline(Run& run, const std::vector<Clip>& clips, const Baseline& baseline) {
+    run.baselineChecked = true;
+    size_t shown = 0;
+    auto show = [&](const char* format, auto... args) {
+        if (shown++ < kShowDiffs) {
+            printf("    ");
+            printf(format, args...);
+            printf("\n");
+        }
+    };
+
+    for (size_t c = 0; c < clips.size(); c++) {
+        const Clip& clip = clips[c];
+        auto it = baseline.find(clip.name);
+        if (it == baseline.end()) {
+            run.baselineMatch = false;
+            show("%s：基线里没有这一段", clip.name.c_str());
+            continue;
+        }
+        const BaselineClip& expected = it->second;
+        if (expected.blocks != clip.blocks() || expected.checksum != clip.checksum()) {
+            run.baselineMatch = false;
+            show("%s：语料本身变了（块数 %zu / %zu，校验和 %016" PRIx64 " / %016" PRIx64 "），逐块比较没有意义",
+                 clip.name.c_str(), expected.blocks, clip.blocks(), expected.checksum, clip.checksum());
+            continue;
+        }
+        std::vector<uint32_t> actual = positives(run.results[c]);
+        if (actual == expected.positives) continue;
+        run.baselineMatch = false;
+        std::vector<uint32_t> gained, lost;
+        std::set_difference(actual.begin(), actual.end(), expected.positives.begin(), expected.positives.end(),
+                            std::back_inserter(gained));
+        std::set_difference(expected.positives.begin(), expected.positives.end(), actual.begin(), actual.end(),
+                            std::back_inserter(lost));
+        for (uint32_t b : gained) {
+            const SnapResult& r = run.results[c][b];
+            show("%s 块 %u：新增触发（峰值 %.1f @ %.0f Hz）", clip.name.c_str(), b, r.peak, r.dominantFreq);
+        }
+        for (uint32_t b : lost) {
+            const SnapResult& r = run.results[c][b];
+            show("%s 块 %u：不再触发（峰值 %.1f @ %.0f Hz）", clip.name.c_str(), b, r.peak, r.dominantFreq);
+        }
+    }
+    if (shown > kShowDiffs) printf("    …另有 %zu 处不同\n", shown - kShowDiffs);
+    for (const auto& entry : baseline) {
+        bool present = std::any_of(clips.begin(), clips.end(), [&](const Clip& c) { return c.name == entry.first; });
+        if (!present) {
+            run.baselineMatch = false;
+            printf("    %s：语料里没有这一段（基线过期？）\n", entry.first.c_str());
+        }
+    }
+}
+
+// ==================== 报告 ====================
+void printCategories(const Run& run) {
+    printf("\n[%s] 按类别\n", run.backend->name);
+    printf("  %-12s %4s %7s %5s %5s %5s %6s %9s\n", "类别", "段", "时长s", "响指", "命中", "漏检", "误触发", "误触发/分");
+    for (const auto& entry : run.byCategory) {
+        const Score& s = entry.second;
+        printf("  %-12s %4zu %7.1f %5zu %5zu %5zu %6zu %9.2f\n", entry.first.c_str(), s.clips, s.seconds, s.snaps,
+               s.hits, s.snaps - s.hits, s.falseAlarms, s.falseAlarms / (s.seconds / 60));
+    }
+}
+
+// 每个漏检的响指：覆盖它的块里峰值最高的那块长什么样，以及那几块有没有被 loop() 读到
+void printMisses(const Run& run, const std::vector<Clip>& clips) {
+    printf("\n[%s] 漏检明细\n", run.backend->name);
+    for (size_t c = 0; c < clips.size(); c++) {
+        const Clip& clip = clips[c];
+        std::vector<Detection> detections = schedule(run.results[c]);
+        std::vector<bool> read = readBlocks(run.results[c]);
+        for (const Event& event : clip.events) {
+            if (event.kind != EventKind::Snap) continue;
+            bool hit = std::any_of(detections.begin(), detections.end(), [&](const Detection& d) {
+                return overlaps(d.block, event.onset, kSnapSpanSamples);
+            });
+            if (hit) continue;
+            uint32_t first = event.onset / SNAP_SAMPLES;
+            uint32_t last = std::min<uint32_t>((event.onset + kSnapSpanSamples - 1) / SNAP_SAMPLES,
+                                               uint32_t(run.results[c].size() - 1));
+            uint32_t best = first;
+            bool anyPositive = false, anyRead = false;
+            for (uint32_t b = first; b <= last; b++) {
+                if (run.results[c][b].peak > run.results[c][best].peak) best = b;
+                anyPositive |= run.results[c][b].isSnap;
+                anyRead |= read[b];
+            }
+            const SnapResult& r = run.results[c][best];
+            printf("  %-22s 起点 %7u：峰值 %8.1f @ %5.0f Hz%s\n", clip.name.c_str(), event.onset, r.peak,
+                   r.dominantFreq, !anyRead ? "（防抖 / DMA 溢出，块没被读到）" : anyPositive ? "（判定为真的块没被读到）" : "");
+        }
+    }
+}
+
+void printClips(const Run& run, const std::vector<Clip>& clips) {
+    printf("\n[%s] 逐段\n", run.backend->name);
+    printf("  %-22s %-12s %5s %5s %6s %6s\n", "段", "类别", "响指", "命中", "误触发", "触发块");
+    for (size_t c = 0; c < clips.size(); c++) {
+        const Score& s = run.byClip[c];
+        printf("  %-22s %-12s %5zu %5zu %6zu %6zu\n", clips[c].name.c_str(), clips[c].category.c_str(), s.snaps,
+               s.hits, s.falseAlarms, positives(run.results[c]).size());
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage(argv[0]);
+            return 0;
+        }
+        if (arg == "--check") {
+            options.check = true;
+            continue;
+        }
+        if (arg == "--update-baseline") {
+            options.updateBaseline = true;
+            continue;
+        }
+        if (arg == "--verbose") {
+            options.verbose = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "--backend") {
+            const Backend* backend = findBackend(value);
+            if (!backend) {
+                fprintf(stderr, "未知后端: %s\n", value);
+                usage(argv[0]);
+                return 2;
+            }
+            options.backends.push_back(backend);
+        } else if (arg == "--baseline") options.baselinePath = value;
+        else if (arg == "--corpus") options.corpusDir = value;
+        else if (arg == "--dump") options.dumpDir = value;
+        else if (arg == "--repeat") options.repeat = atoi(value);
+        else {
+            fprintf(stderr, "未知参数: %s\n", arg.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.backends.empty()) {
+        for (const Backend& backend : backends()) options.backends.push_back(&backend);
+    }
+    if (options.baselinePath.empty()) {
+        options.baselinePath = options.corpusDir.empty() ? "baseline.tsv" : options.corpusDir + "/baseline.tsv";
+    }
+
+    // ---- 语料 ----
+    std::vector<Clip> clips;
+    std::string error;
+    if (options.corpusDir.empty()) {
+        clips = synthCorpus();
+    } else if (!loadCorpusDir(options.corpusDir, clips, error)) {
+        fprintf(stderr, "语料读取失败: %s\n", error.c_str());
+        return 2;
+    }
+    if (!options.dumpDir.empty()) {
+        if (!dumpCorpusDir(options.dumpDir, clips, error)) {
+            fprintf(stderr, "语料导出失败: %s\n", error.c_str());
+            return 2;
+        }
+        printf("已导出 %zu 段语料到 %s\n", clips.size(), options.dumpDir.c_str());
+        return 0;
+    }
+    size_t frames = 0;
+    double seconds = 0;
+    for (const Clip& clip : clips) {
+        frames += clip.blocks();
+        seconds += clip.seconds();
+    }
+    printf("snapbench：%zu 段 / %.1f s / %zu 块（%s），阈值 %.0f < f < %.0f Hz，峰值 > %.0f\n", clips.size(), seconds,
+           frames, options.corpusDir.empty() ? "合成语料" : options.corpusDir.c_str(), SNAP_MIN_FREQ, SNAP_MAX_FREQ,
+           SNAP_MIN_PEAK);
+
+    // ---- 基线 ----
+    if (options.updateBaseline) {
+        Run reference = runBackend(*findBackend("reference"), clips, 1);
+        Baseline baseline;
+        std::vector<std::string> order;
+        for (size_t c = 0; c < clips.size(); c++) {
+            BaselineClip& entry = baseline[clips[c].name];
+            entry.blocks = clips[c].blocks();
+            entry.checksum = clips[c].checksum();
+            entry.positives = positives(reference.results[c]);
+            order.push_back(clips[c].name);
+        }
+        if (!saveBaseline(options.baselinePath, order, baseline, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        printf("已按 reference 写入基线 %s\n", options.baselinePath.c_str());
+        return 0;
+    }
+    Baseline baseline;
+    bool haveBaseline = loadBaseline(options.baselinePath, baseline, error);
+    if (!haveBaseline) printf("没有基线（%s），跳过逐块比较\n", error.c_str());
+
+    // ---- 各后端 ----
+    std::vector<Run> runs;
+    for (const Backend* backend : options.backends) {
+        runs.push_back(runBackend(*backend, clips, options.repeat));
+        Run& run = runs.back();
+        if (haveBaseline) {
+            printf("\n[%s] 与基线比较\n", backend->name);
+            compareBaseline(run, clips, baseline);
+            if (run.baselineMatch) printf("    逐块判定一致\n");
+        }
+    }
+
+    printf("\n  %-10s %7s %7s %9s %22s %9s %8s  %s\n", "后端", "精确率", "召回率", "误触发/分", "延迟(样本) 中位/P90/最大",
+           "帧/秒", "实时倍数", "基线");
+    for (const Run& run : runs) {
+        const Score& t = run.total;
+        char latency[48];
+        snprintf(latency, sizeof(latency), "%" PRIu64 "/%" PRIu64 "/%" PRIu64, percentile(run.latencies, 0.5),
+                 percentile(run.latencies, 0.9), percentile(run.latencies, 1.0));
+        printf("  %-10s %7.3f %7.3f %9.2f %22s %9.0f %7.0f×  %s\n", run.backend->name, ratio(t.hits, t.hits + t.falseAlarms),
+               ratio(t.hits, t.snaps), t.falseAlarms / (t.seconds / 60), latency, run.framesPerSecond,
+               run.framesPerSecond * SNAP_SAMPLES / kSampleRate,
+               !run.baselineChecked ? "➖" : run.baselineMatch ? "✅ 一致" : "❌ 不同");
+    }
+    for (const Run& run : runs) {
+        const Score& t = run.total;
+        if (t.duplicates || t.onClaps) {
+            printf("  [%s] 误触发中：同一响指重复触发 %zu 次，拍手上触发 %zu 次\n", run.backend->name, t.duplicates,
+                   t.onClaps);
+        }
+    }
+    for (const Run& run : runs) {
+        if (options.verbose || runs.size() == 1 || run.backend == findBackend("reference")) printCategories(run);
+        if (options.verbose) {
+            printClips(run, clips);
+            printMisses(run, clips);
+        }
+    }
+
+    if (!options.check) return 0;
+    bool ok = haveBaseline && std::all_of(runs.begin(), runs.end(), [](const Run& r) { return r.baselineMatch; });
+    printf("\n%s\n", ok ? "✅ 检测结果与基线一致" : "❌ 检测结果与基线不同：确认是有意改动后 make baseline 并随代码提交");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,245 @@
+// ============================================
+// main.cpp - TDM 拆分基准
+// ============================================
+// 在合成的交错缓冲（一块 = sketch 的一次读取，800 帧）上比较 TdmFrame.h 与几种候选写法：
+//   拆分 deinterleave（选中声道各自连续）
+//     channel   逐声道用 TdmChannel 跨步读、连续写（TdmFrame.h 采用）
+//     frame     按帧走一遍，每帧往各声道的输出各写一个
+//   混合 downmix（选中声道平均成单声道，上行用）
+//     channel   逐声道累加到 int32 暂存，最后再除
+//     generic   按帧走一遍，选中声道表在运行期（TdmFrame.h 的通用路径）
+//     all       按帧走一遍，声道数为模板参数、内层展开（只有 4、8 声道全选）
+//     dispatch  tdmDownmix16 实际选到的路径（只选一个声道时直接取样）
+// 输出每帧耗时（5 轮取最快）与相对 16 kHz 实时的倍数，并校验每个实现与逐样本的朴素计算一致。
+// 这是主机上的数字，只用来比较写法之间的相对快慢：ESP32-C3 是顺序执行的 RV32，没有 SIMD、内部 SRAM 没有缓存，
+// 主机编译器还会把部分循环自动向量化，差距与设备上不同。
+//
+// 用法: tdmbench [--channels N]... [--mask HEX]... [--frames 800] [--ms 200] [--check]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "TdmFrame.h"
+
+namespace {
+
+constexpr int kSampleRate = 16000;
+
+struct Options {
+    std::vector<int> channels;
+    std::vector<uint32_t> masks;
+    size_t frames = 800;  // sketch 每次读 50 ms
+    int ms = 200;         // 每个实现计时这么久（分 5 轮）
+    bool check = false;
+};
+
+void usage(const char* argv0) {
+    fprintf(stderr, "用法: %s [--channels N]... [--mask HEX]... [--frames 800] [--ms 200] [--check]\n", argv0);
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--channels" && hasValue) {
+            int n = atoi(argv[++i]);
+            if (n < 1 || n > TDM_MAX_CHANNELS) {
+                fprintf(stderr, "声道数须在 1..%d\n", TDM_MAX_CHANNELS);
+                return false;
+            }
+            options.channels.push_back(n);
+        } else if (arg == "--mask" && hasValue) {
+            options.masks.push_back(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 16)));
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--ms" && hasValue) {
+            options.ms = atoi(argv[++i]);
+        } else if (arg == "--check") {
+            options.check = true;
+        } else {
+            return false;
+        }
+    }
+    if (options.channels.empty()) options.channels = {4, 6, 8};
+    return options.frames > 0;
+}
+
+// ==================== 合成输入 ====================
+// 每个声道不同的 32 位样本（高 16 位带符号、有正有负，低 16 位是噪声），声道错位或步长错都会被校验发现
+std::vector<int32_t> synth(size_t frames, int channels) {
+    std::vector<int32_t> buffer(frames * channels);
+    uint32_t state = 0x12345678u + channels;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        state = state * 1664525u + 1013904223u;
+        buffer[i] = static_cast<int32_t>(state);
+    }
+    return buffer;
+}
+
+// ==================== 朴素计算（校验用） ====================
+int16_t high16(int32_t sample) { return static_cast<int16_t>(sample >> 16); }
+
+void naiveDeinterleave(const int32_t* in, size_t frames, int channels, uint32_t mask, int16_t* out) {
+    size_t j = 0;
+    for (int c = 0; c < channels; c++) {
+        if (!(mask & (1u << c))) continue;
+        for (size_t i = 0; i < frames; i++) out[j * frames + i] = high16(in[i * channels + c]);
+        j++;
+    }
+}
+
+void naiveDownmix(const int32_t* in, size_t frames, int channels, uint32_t mask, int16_t* out) {
+    for (size_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        int32_t count = 0;
+        for (int c = 0; c < channels; c++) {
+            if (!(mask & (1u << c))) continue;
+            sum += high16(in[i * channels + c]);
+            count++;
+        }
+        out[i] = static_cast<int16_t>(sum / count);
+    }
+}
+
+// ==================== 候选写法 ====================
+void frameDeinterleave(const int32_t* in, size_t frames, int channels, const uint8_t* selected, int count,
+                       int16_t* out) {
+    for (size_t i = 0; i < frames; i++) {
+        const int32_t* frame = in + i * channels;
+        for (int j = 0; j < count; j++) out[j * frames + i] = high16(frame[selected[j]]);
+    }
+}
+
+void channelDownmix(const int32_t* in, size_t frames, int channels, const uint8_t* selected, int count,
+                    int16_t* out, int32_t* scratch) {
+    memset(scratch, 0, frames * sizeof(int32_t));
+    for (int j = 0; j < count; j++) {
+        TdmChannel<int32_t> channel = tdmChannel(in, frames, channels, selected[j]);
+        for (size_t i = 0; i < channel.size(); i++) scratch[i] += channel[i] >> 16;
+    }
+    for (size_t i = 0; i < frames; i++) out[i] = static_cast<int16_t>(scratch[i] / count);
+}
+
+// ==================== 计时 ====================
+// 5 轮各跑 ms / 5，取最快一轮
+template <typename Fn>
+double nsPerFrame(Fn&& run, size_t frames, int ms) {
+    using Clock = std::chrono::steady_clock;
+    double best = 0;
+    for (int round = 0; round < 5; round++) {
+        auto start = Clock::now();
+        auto deadline = start + std::chrono::microseconds(ms * 200);
+        uint64_t blocks = 0;
+        do {
+            for (int k = 0; k < 16; k++) run();
+            blocks += 16;
+        } while (Clock::now() < deadline);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / double(blocks * frames);
+        if (round == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+// 编译器看得到输出没人用时会把整个循环删掉
+volatile int16_t gSink;
+
+struct Case {
+    int channels;
+    uint32_t mask;
+};
+
+// 0 个选中声道的组合直接跳过；默认掩码：第 1 路、前一半、全部
+std::vector<Case> cases(const Options& options) {
+    std::vector<Case> result;
+    for (int n : options.channels) {
+        uint32_t all = (1u << n) - 1;
+        std::vector<uint32_t> masks = options.masks;
+        if (masks.empty()) masks = {0x1, (1u << ((n + 1) / 2)) - 1, all};
+        for (uint32_t mask : masks) {
+            if (mask & all) result.push_back({n, mask & all});
+        }
+    }
+    return result;
+}
+
+struct Variant {
+    const char* kernel;
+    const char* name;
+    bool available;
+    std::function<void(int16_t*)> run;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t mismatches = 0;
+    if (!options.check) {
+        printf("%-8s %-6s %-12s %-9s %10s %12s\n", "channels", "mask", "kernel", "variant", "ns/frame", "实时倍数");
+    }
+    for (const Case& c : cases(options)) {
+        size_t frames = options.frames;
+        std::vector<int32_t> input = synth(frames, c.channels);
+        const int32_t* in = input.data();
+        uint8_t selected[TDM_MAX_CHANNELS];
+        int count = tdmSelect(c.mask, c.channels, selected);
+        bool all = count == c.channels && (c.channels == 4 || c.channels == 8);
+        std::vector<int32_t> scratch(frames);
+
+        std::vector<int16_t> split(frames * count), mixed(frames);
+        naiveDeinterleave(in, frames, c.channels, c.mask, split.data());
+        naiveDownmix(in, frames, c.channels, c.mask, mixed.data());
+
+        const Variant variants[] = {
+            {"deinterleave", "channel", true,
+             [&](int16_t* out) { tdmDeinterleave16(in, frames, c.channels, c.mask, out); }},
+            {"deinterleave", "frame", true,
+             [&](int16_t* out) { frameDeinterleave(in, frames, c.channels, selected, count, out); }},
+            {"downmix", "channel", true,
+             [&](int16_t* out) { channelDownmix(in, frames, c.channels, selected, count, out, scratch.data()); }},
+            {"downmix", "generic", true,
+             [&](int16_t* out) { tdmDownmix16Generic(in, frames, c.channels, selected, count, out); }},
+            {"downmix", "all", all,
+             [&](int16_t* out) {
+                 if (c.channels == 4) tdmDownmix16All<4>(in, frames, out);
+                 else tdmDownmix16All<8>(in, frames, out);
+             }},
+            {"downmix", "dispatch", true, [&](int16_t* out) { tdmDownmix16(in, frames, c.channels, c.mask, out); }},
+        };
+        std::vector<int16_t> out(frames * count);
+        for (const Variant& variant : variants) {
+            if (!variant.available) continue;
+            bool isSplit = strcmp(variant.kernel, "deinterleave") == 0;
+            const std::vector<int16_t>& expected = isSplit ? split : mixed;
+            std::fill(out.begin(), out.end(), int16_t(0x5A5A));
+            variant.run(out.data());
+            for (size_t i = 0; i < expected.size(); i++) {
+                if (out[i] == expected[i]) continue;
+                fprintf(stderr, "❌ %d 声道 掩码 0x%X %s/%s：第 %zu 个样本为 %d，应为 %d\n", c.channels, c.mask,
+                        variant.kernel, variant.name, i, out[i], expected[i]);
+                mismatches++;
+                break;
+            }
+            if (options.check) continue;
+
+            int16_t* dst = out.data();
+            double ns = nsPerFrame([&] { variant.run(dst); gSink = dst[0]; }, frames, options.ms);
+            // 16 kHz 每帧 62.5 us
+            printf("%-8d 0x%-4X %-12s %-9s %10.2f %11.0f×\n", c.channels, c.mask, variant.kernel, variant.name, ns,
+                   1e9 / kSampleRate / ns);
+        }
+    }
+
+    if (options.check) printf(mismatches ? "❌ %zu 处不一致\n" : "✅ 全部一致\n", mismatches);
+    else if (mismatches) printf("❌ %zu 处不一致（详见 stderr）\n", mismatches);
+    return mismatches ? 1 : 0;
+}
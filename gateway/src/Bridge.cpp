@@ -0,0 +1,226 @@
+#include "Bridge.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace gateway {
+
+namespace {
+const size_t BLOCK_BYTES = 64 * 1024;
+
+uint32_t readU32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+}  // namespace
+
+Bridge::Bridge(const std::string& path, size_t maxQueuedBytes)
+    : socketPath(path), pool(BLOCK_BYTES, 16), maxQueuedBlocks(maxQueuedBytes / BLOCK_BYTES + 1) {}
+
+Bridge::~Bridge() {
+    disconnect();
+}
+
+int Bridge::connect() {
+    if (fd >= 0) return fd;
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    int rc = ::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    if (rc < 0 && errno != EINPROGRESS) {
+        close(sock);
+        return -1;
+    }
+    fd = sock;
+    connecting = rc < 0;
+    printf("[Bridge] 已连接 Node: %s\n", socketPath.c_str());
+    // 断开期间的积压全部作废：Node 侧会话已随连接关闭
+    while (head) {
+        Block* next = head->next;
+        pool.release(head);
+        head = next;
+    }
+    tail = nullptr;
+    queuedBlocks = 0;
+    if (onConnected) onConnected();
+    return fd;
+}
+
+void Bridge::disconnect() {
+    if (fd < 0) return;
+    close(fd);
+    fd = -1;
+    connecting = false;
+    input.clear();
+}
+
+bool Bridge::reserve(size_t bytes, bool droppable) {
+    if (fd < 0) {
+        if (droppable) droppedMessages++;
+        return false;
+    }
+    if (tail && tail->capacity - tail->size >= bytes) return true;
+    // 音频在积压时丢弃；控制消息总是入队，保证 Node 侧会话状态一致
+    if (droppable && queuedBlocks >= maxQueuedBlocks) {
+        droppedMessages++;
+        return false;
+    }
+    Block* block = pool.acquire();
+    if (tail) tail->next = block;
+    else head = block;
+    tail = block;
+    queuedBlocks++;
+    return true;
+}
+
+void Bridge::put(const void* data, size_t len) {
+    memcpy(tail->data + tail->size, data, len);
+    tail->size += len;
+}
+
+void Bridge::putU32(uint32_t v) {
+    uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)};
+    put(b, 4);
+}
+
+void Bridge::putHeader(uint8_t type, size_t payloadLen) {
+    putU32(static_cast<uint32_t>(payloadLen + 1));
+    put(&type, 1);
+}
+
+void Bridge::deviceUp(uint32_t session, const std::string& target) {
+    size_t payload = 4 + target.size();
+    if (!reserve(5 + payload, false)) return;
+    putHeader(MSG_DEVICE_UP, payload);
+    putU32(session);
+    put(target.data(), target.size());
+}
+
+void Bridge::deviceDown(uint32_t session) {
+    if (!reserve(9, false)) return;
+    putHeader(MSG_DEVICE_DOWN, 4);
+    putU32(session);
+}
+
+void Bridge::segmentStart(uint32_t session, uint32_t segment) {
+    if (!reserve(13, false)) return;
+    putHeader(MSG_SEGMENT_START, 8);
+    putU32(session);
+    putU32(segment);
+}
+
+void Bridge::audio(uint32_t session, uint32_t seq, uint32_t deviceMs, const uint8_t* pcm,
+                   size_t bytes) {
+    size_t payload = 12 + bytes;
+    if (5 + payload > BLOCK_BYTES || !reserve(5 + payload, true)) return;
+    putHeader(MSG_AUDIO, payload);
+    putU32(session);
+    putU32(seq);
+    putU32(deviceMs);
+    put(pcm, bytes);
+}
+
+void Bridge::segmentEnd(uint32_t session, uint32_t segment, uint32_t durationMs, uint8_t reason) {
+    if (!reserve(18, false)) return;
+    putHeader(MSG_SEGMENT_END, 13);
+    putU32(session);
+    putU32(segment);
+    putU32(durationMs);
+    put(&reason, 1);
+}
+
+void Bridge::deviceText(uint32_t session, const uint8_t* text, size_t len) {
+    size_t payload = 4 + len;
+    if (5 + payload > BLOCK_BYTES || !reserve(5 + payload, false)) return;
+    putHeader(MSG_DEVICE_TEXT, payload);
+    putU32(session);
+    put(text, len);
+}
+
+void Bridge::stats(const std::string& json) {
+    if (5 + json.size() > BLOCK_BYTES || !reserve(5 + json.size(), true)) return;
+    putHeader(MSG_STATS, json.size());
+    put(json.data(), json.size());
+}
+
+bool Bridge::handleWritable() {
+    if (fd < 0) return false;
+    if (connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        if (err != 0) {
+            disconnect();
+            return false;
+        }
+        connecting = false;
+    }
+    while (head) {
+        // 部分发送时把剩余数据前移到块首，下次可写时继续
+        ssize_t n = send(fd, head->data, head->size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            fprintf(stderr, "[Bridge] 发送失败: %s\n", strerror(errno));
+            disconnect();
+            return false;
+        }
+        bytesSent += static_cast<uint64_t>(n);
+        if (static_cast<size_t>(n) < head->size) {
+            memmove(head->data, head->data + n, head->size - n);
+            head->size -= n;
+            return true;
+        }
+        Block* next = head->next;
+        pool.release(head);
+        head = next;
+        queuedBlocks--;
+        if (!head) tail = nullptr;
+    }
+    return true;
+}
+
+bool Bridge::handleReadable() {
+    if (fd < 0) return false;
+    char buf[4096];
+    for (;;) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            input.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        printf("[Bridge] Node 断开连接\n");
+        disconnect();
+        return false;
+    }
+    parseInput();
+    return true;
+}
+
+void Bridge::parseInput() {
+    size_t pos = 0;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+    while (input.size() - pos >= 5) {
+        uint32_t len = readU32(data + pos);
+        if (len == 0 || input.size() - pos - 4 < len) break;
+        uint8_t type = data[pos + 4];
+        const uint8_t* payload = data + pos + 5;
+        size_t payloadLen = len - 1;
+        if (type == MSG_SEND_TEXT && payloadLen >= 4 && onSendText) {
+            onSendText(readU32(payload), reinterpret_cast<const char*>(payload + 4), payloadLen - 4);
+        } else if (type == MSG_CLOSE && payloadLen >= 6 && onClose) {
+            onClose(readU32(payload), static_cast<uint16_t>(payload[4] | (payload[5] << 8)));
+        }
+        pos += 4 + len;
+    }
+    input.erase(0, pos);
+}
+
+}  // namespace gateway
@@ -0,0 +1,105 @@
+// ============================================
+// Bridge.h - 网关 -> Node 的 Unix socket 通道
+// ============================================
+// 消息格式（小端）：[u32 长度（含类型字节）][u8 类型][负载]
+//
+// 网关 -> Node
+//   DEVICE_UP      u32 session, utf8 请求路径（/api/audio?id=...）
+//   DEVICE_DOWN    u32 session
+//   SEGMENT_START  u32 session, u32 segment
+//   AUDIO          u32 session, u32 seq, u32 deviceMs, PCM16
+//                  （session 之后正好是 v2 音频帧格式，Node 侧零拷贝转交）
+//   SEGMENT_END    u32 session, u32 segment, u32 durationMs, u8 reason
+//   DEVICE_TEXT    u32 session, utf8（设备回执等文本帧）
+//   STATS          utf8 JSON，每秒一次
+// Node -> 网关
+//   SEND_TEXT      u32 session, utf8（继电器指令）
+//   CLOSE          u32 session, u16 关闭码
+//
+// 与 server/lib/gatewayBridge.ts 保持一致。
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "BufferPool.h"
+
+namespace gateway {
+
+enum BridgeMessage : uint8_t {
+    MSG_DEVICE_UP = 1,
+    MSG_DEVICE_DOWN = 2,
+    MSG_SEGMENT_START = 3,
+    MSG_AUDIO = 4,
+    MSG_SEGMENT_END = 5,
+    MSG_DEVICE_TEXT = 6,
+    MSG_STATS = 7,
+    MSG_SEND_TEXT = 16,
+    MSG_CLOSE = 17,
+};
+
+class Bridge {
+public:
+    // Node 下发的消息
+    std::function<void(uint32_t session, const char* text, size_t len)> onSendText;
+    std::function<void(uint32_t session, uint16_t code)> onClose;
+    // 连上（或重连上）Node 时调用，用于补发在线设备的 DEVICE_UP
+    std::function<void()> onConnected;
+
+private:
+    std::string socketPath;
+    int fd = -1;
+    bool connecting = false;
+    BufferPool pool;
+    Block* head = nullptr;  // 输出队列
+    Block* tail = nullptr;
+    size_t queuedBlocks = 0;
+    size_t maxQueuedBlocks;
+    std::string input;  // Node 下发的未解析数据
+    uint64_t droppedMessages = 0;
+    uint64_t bytesSent = 0;
+
+    bool reserve(size_t bytes, bool droppable);
+    void put(const void* data, size_t len);
+    void putHeader(uint8_t type, size_t payloadLen);
+    void putU32(uint32_t v);
+    void parseInput();
+    void disconnect();
+
+public:
+    /**
+     * @param path Unix socket 路径
+     * @param maxQueuedBytes 输出队列上限；Node 处理不过来或断开时丢弃音频，保留控制消息
+     */
+    Bridge(const std::string& path, size_t maxQueuedBytes);
+    ~Bridge();
+
+    // 非阻塞连接；返回新的 fd（需要加入 epoll），失败返回 -1
+    int connect();
+    int getFd() const { return fd; }
+    bool isConnected() const { return fd >= 0 && !connecting; }
+    bool wantsWrite() const { return head != nullptr || connecting; }
+
+    // epoll 事件：可读 / 可写；返回 false 表示连接已断开
+    bool handleReadable();
+    bool handleWritable();
+
+    void deviceUp(uint32_t session, const std::string& target);
+    void deviceDown(uint32_t session);
+    void segmentStart(uint32_t session, uint32_t segment);
+    void audio(uint32_t session, uint32_t seq, uint32_t deviceMs, const uint8_t* pcm, size_t bytes);
+    void segmentEnd(uint32_t session, uint32_t segment, uint32_t durationMs, uint8_t reason);
+    void deviceText(uint32_t session, const uint8_t* text, size_t len);
+    void stats(const std::string& json);
+
+    uint64_t getDropped() const { return droppedMessages; }
+    uint64_t getBytesSent() const { return bytesSent; }
+    size_t getQueuedBlocks() const { return queuedBlocks; }
+};
+
+}  // namespace gateway
+
+#endif  // BRIDGE_H
@@ -0,0 +1,80 @@
+// ============================================
+// BufferPool.h - 固定大小内存块池
+// ============================================
+// 连接读缓冲与发往 Node 的输出块都从这里取，稳态下不再调用 malloc。
+// 单线程使用（epoll 主循环），不加锁。
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gateway {
+
+struct Block {
+    uint8_t* data;
+    size_t size;      // 已使用字节数
+    size_t capacity;  // 块大小
+    Block* next;      // 空闲链表 / 输出队列
+};
+
+class BufferPool {
+private:
+    size_t blockSize;
+    size_t blocksPerSlab;
+    std::vector<std::unique_ptr<uint8_t[]>> slabs;
+    std::vector<std::unique_ptr<Block[]>> headers;
+    Block* freeList = nullptr;
+    size_t totalBlocks = 0;
+    size_t inUse = 0;
+
+    // 一次分配一整片（slab），切成等长块挂到空闲链表
+    void grow() {
+        std::unique_ptr<uint8_t[]> slab(new uint8_t[blockSize * blocksPerSlab]);
+        std::unique_ptr<Block[]> blocks(new Block[blocksPerSlab]);
+        for (size_t i = 0; i < blocksPerSlab; i++) {
+            blocks[i].data = slab.get() + i * blockSize;
+            blocks[i].size = 0;
+            blocks[i].capacity = blockSize;
+            blocks[i].next = freeList;
+            freeList = &blocks[i];
+        }
+        totalBlocks += blocksPerSlab;
+        slabs.push_back(std::move(slab));
+        headers.push_back(std::move(blocks));
+    }
+
+public:
+    BufferPool(size_t blockBytes, size_t slabBlocks = 64)
+        : blockSize(blockBytes), blocksPerSlab(slabBlocks) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Block* acquire() {
+        if (!freeList) grow();
+        Block* block = freeList;
+        freeList = block->next;
+        block->next = nullptr;
+        block->size = 0;
+        inUse++;
+        return block;
+    }
+
+    void release(Block* block) {
+        if (!block) return;
+        block->next = freeList;
+        freeList = block;
+        inUse--;
+    }
+
+    size_t getBlockSize() const { return blockSize; }
+    size_t getInUse() const { return inUse; }
+    size_t getTotal() const { return totalBlocks; }
+};
+
+}  // namespace gateway
+
+#endif  // BUFFER_POOL_H
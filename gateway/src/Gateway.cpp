@@ -0,0 +1,526 @@
+#include "Gateway.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "WebSocket.h"
+
+namespace gateway {
+
+namespace {
+const uint64_t LISTEN_TAG = 0;
+const uint64_t BRIDGE_TAG = 1;
+const int MAX_EVENTS = 256;
+const int TICK_MS = 1000;
+
+int64_t nowMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+// 升级路径必须是 /api/audio（可带查询串）
+bool isAudioPath(const std::string& target) {
+    const char* path = "/api/audio";
+    size_t len = strlen(path);
+    return target.compare(0, len, path) == 0 && (target.size() == len || target[len] == '?');
+}
+
+// 查询串中是否有完全等于 pair（如 "v=2"）的一项
+bool hasQueryPair(const std::string& target, const char* pair) {
+    size_t len = strlen(pair);
+    size_t q = target.find('?');
+    while (q != std::string::npos) {
+        if (target.compare(q + 1, len, pair) == 0 &&
+            (q + 1 + len == target.size() || target[q + 1 + len] == '&')) {
+            return true;
+        }
+        q = target.find('&', q + 1);
+    }
+    return false;
+}
+
+int queryVersion(const std::string& target) {
+    return hasQueryPair(target, "v=2") ? 2 : 1;
+}
+
+// 窄带固件（?sr=8000）上行 8 kHz，VAD 的时长换算按实际采样率；Node 侧据同一参数插值回 16 kHz
+int querySampleRate(const std::string& target, int fallback) {
+    return hasQueryPair(target, "sr=8000") ? 8000 : fallback;
+}
+}  // namespace
+
+Gateway::Gateway(const GatewayConfig& cfg)
+    : config(cfg), readPool(cfg.readBufferBytes, 256), bridge(cfg.bridgeSocket, cfg.bridgeQueueBytes) {
+    bridge.onSendText = [this](uint32_t session, const char* text, size_t len) {
+        auto it = connections.find(session);
+        if (it == connections.end() || it->second->state != ConnState::Open) return;
+        appendFrame(it->second->out, WS_TEXT, reinterpret_cast<const uint8_t*>(text), len);
+        flushOutput(*it->second);
+        if (it->second->dead) closeConnection(session);
+    };
+    bridge.onClose = [this](uint32_t session, uint16_t code) {
+        auto it = connections.find(session);
+        if (it == connections.end()) return;
+        sendClose(*it->second, code);
+        if (it->second->dead) closeConnection(session);
+    };
+    // 重连 Node 后补发在线设备，Node 侧重新建立会话
+    bridge.onConnected = [this]() {
+        for (auto& entry : connections) {
+            Connection& conn = *entry.second;
+            if (conn.state == ConnState::Open) {
+                conn.announced = false;
+                announce(conn);
+            }
+        }
+    };
+}
+
+Gateway::~Gateway() {
+    for (auto& entry : connections) {
+        close(entry.second->fd);
+        readPool.release(entry.second->in);
+    }
+    if (listenFd >= 0) close(listenFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+int Gateway::run() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (epollFd < 0 || listenFd < 0) {
+        perror("[Gateway] 创建 socket 失败");
+        return 1;
+    }
+    int one = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(config.port));
+    if (inet_pton(AF_INET, config.host.c_str(), &addr.sin_addr) != 1) {
+        fprintf(stderr, "[Gateway] 无效地址: %s\n", config.host.c_str());
+        return 1;
+    }
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listenFd, 4096) < 0) {
+        perror("[Gateway] 监听失败");
+        return 1;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = LISTEN_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    printf("[Gateway] 监听 ws://%s:%d/api/audio -> %s\n", config.host.c_str(), config.port,
+           config.bridgeSocket.c_str());
+    fflush(stdout);
+
+    int64_t lastTick = 0;
+    epoll_event events[MAX_EVENTS];
+    while (running) {
+        int64_t now = nowMs();
+        if (now - lastTick >= TICK_MS) {
+            tick(now);
+            lastTick = now;
+        }
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, TICK_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("[Gateway] epoll_wait");
+            return 1;
+        }
+        loopNow = nowMs();
+        for (int i = 0; i < n; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == LISTEN_TAG) {
+                acceptAll();
+            } else if (tag == BRIDGE_TAG) {
+                int fd = bridge.getFd();
+                bool ok = true;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) ok = bridge.handleReadable();
+                if (ok && (events[i].events & EPOLLOUT)) ok = bridge.handleWritable();
+                if (!ok) {
+                    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                } else {
+                    updateBridgeInterest();
+                }
+            } else {
+                auto it = connections.find(static_cast<uint32_t>(tag));
+                if (it != connections.end()) handleConnection(*it->second, events[i].events);
+            }
+        }
+        // 本轮产生的音频统一写一次，减少系统调用
+        if (bridge.isConnected() && bridge.wantsWrite()) {
+            int fd = bridge.getFd();
+            if (!bridge.handleWritable()) {
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            } else {
+                updateBridgeInterest();
+            }
+        }
+    }
+
+    // 退出：结束所有语音段并通知 Node
+    printf("[Gateway] 正在关闭 %zu 个连接\n", connections.size());
+    std::vector<uint32_t> sessions;
+    for (auto& entry : connections) sessions.push_back(entry.first);
+    for (uint32_t session : sessions) {
+        auto it = connections.find(session);
+        if (it != connections.end()) {
+            appendClose(it->second->out, WS_CLOSE_GOING_AWAY);
+            flushOutput(*it->second);
+        }
+        closeConnection(session);
+    }
+    if (bridge.isConnected()) bridge.handleWritable();
+    return 0;
+}
+
+void Gateway::updateBridgeInterest() {
+    int fd = bridge.getFd();
+    if (fd < 0) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    if (bridge.wantsWrite()) ev.events |= EPOLLOUT;
+    ev.data.u64 = BRIDGE_TAG;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void Gateway::tick(int64_t now) {
+    // Node 通道断开时每秒重连
+    if (bridge.getFd() < 0) {
+        int fd = bridge.connect();
+        if (fd >= 0) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT;
+            ev.data.u64 = BRIDGE_TAG;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+
+    // 握手超时与心跳：空闲满 pingIntervalMs 发 ping，超过 deadAfterMs 视为半开连接回收。
+    // 每秒扫描一遍，1 万连接也只是一次顺序遍历
+    static const uint8_t emptyPayload[1] = {0};
+    std::vector<uint32_t> expired;
+    for (auto& entry : connections) {
+        Connection& conn = *entry.second;
+        if (conn.state == ConnState::Handshake && now - conn.acceptedAt > config.handshakeTimeoutMs) {
+            expired.push_back(entry.first);
+            continue;
+        }
+        if (conn.state != ConnState::Open || config.pingIntervalMs <= 0) continue;
+        int64_t idle = now - conn.lastSeen;
+        if (idle >= config.deadAfterMs) {
+            reaped++;
+            expired.push_back(entry.first);
+        } else if (idle >= config.pingIntervalMs && now - conn.lastPing >= config.pingIntervalMs) {
+            pings++;
+            conn.lastPing = now;
+            appendFrame(conn.out, WS_PING, emptyPayload, 0);
+            flushOutput(conn);
+            if (conn.dead) expired.push_back(entry.first);
+        }
+    }
+    for (uint32_t session : expired) closeConnection(session);
+
+    char json[512];
+    snprintf(json, sizeof(json),
+             "{\"connections\":%zu,\"framesIn\":%llu,\"bytesIn\":%llu,\"speechFrames\":%llu,"
+             "\"speechBytes\":%llu,\"segments\":%llu,\"rejected\":%llu,\"bridgeDropped\":%llu,"
+             "\"bridgeBytes\":%llu,\"bridgeQueuedBlocks\":%zu,\"poolBlocks\":%zu,\"poolInUse\":%zu,"
+             "\"pings\":%llu,\"reaped\":%llu}",
+             connections.size(), (unsigned long long)framesIn, (unsigned long long)bytesIn,
+             (unsigned long long)speechFrames, (unsigned long long)speechBytes,
+             (unsigned long long)segments, (unsigned long long)rejected,
+             (unsigned long long)bridge.getDropped(), (unsigned long long)bridge.getBytesSent(),
+             bridge.getQueuedBlocks(), readPool.getTotal(), readPool.getInUse(),
+             (unsigned long long)pings, (unsigned long long)reaped);
+    bridge.stats(json);
+    updateBridgeInterest();
+}
+
+void Gateway::acceptAll() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                perror("[Gateway] accept");
+            }
+            return;
+        }
+        if (connections.size() >= config.maxConnections) {
+            rejected++;
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->session = nextSession++;
+        if (nextSession < 2) nextSession = 2;  // 回绕时跳过保留值
+        conn->in = readPool.acquire();
+        conn->acceptedAt = nowMs();
+        conn->lastSeen = conn->acceptedAt;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u64 = conn->session;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        connections.emplace(conn->session, std::move(conn));
+    }
+}
+
+void Gateway::handleConnection(Connection& conn, uint32_t events) {
+    if (events & EPOLLOUT) flushOutput(conn);
+    if (!conn.dead && (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+        if (!readInput(conn)) conn.dead = true;
+    }
+    if (conn.dead) closeConnection(conn.session);
+}
+
+// 读到 EAGAIN 为止，每次读入后立即解析，读缓冲只需容纳一帧
+bool Gateway::readInput(Connection& conn) {
+    for (;;) {
+        Block* in = conn.in;
+        size_t space = in->capacity - in->size;
+        if (space == 0) {
+            // 缓冲区已满仍解析不出一帧
+            if (conn.state == ConnState::Open) sendClose(conn, WS_CLOSE_TOO_BIG);
+            return false;
+        }
+        ssize_t n = recv(conn.fd, in->data + in->size, space, 0);
+        if (n > 0) {
+            conn.lastSeen = loopNow;
+            in->size += static_cast<size_t>(n);
+            bytesIn += static_cast<uint64_t>(n);
+            processInput(conn);
+            if (conn.dead) return false;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (n < 0 && errno == EINTR) continue;
+        return false;  // 对端关闭或出错
+    }
+}
+
+void Gateway::processInput(Connection& conn) {
+    if (conn.state == ConnState::Handshake && !processHandshake(conn)) return;
+    if (conn.state == ConnState::Open) processFrames(conn);
+    if (conn.state == ConnState::Closing) conn.in->size = 0;  // 关闭中丢弃后续数据
+}
+
+bool Gateway::processHandshake(Connection& conn) {
+    HandshakeRequest request;
+    size_t consumed = 0;
+    HandshakeResult result = parseHandshake(reinterpret_cast<const char*>(conn.in->data),
+                                            conn.in->size, request, consumed);
+    if (result == HandshakeResult::Incomplete) return false;
+    if (result == HandshakeResult::BadRequest || !isAudioPath(request.target)) {
+        conn.out += httpError(result == HandshakeResult::BadRequest ? 400 : 404,
+                              result == HandshakeResult::BadRequest ? "Bad Request" : "Not Found");
+        conn.state = ConnState::Closing;
+        flushOutput(conn);
+        return false;
+    }
+
+    conn.out += handshakeResponse(request.key);
+    conn.target = request.target;
+    conn.version = queryVersion(request.target);
+    conn.sampleRate = querySampleRate(request.target, config.vad.sampleRate);
+    conn.state = ConnState::Open;
+
+    // 握手后紧跟的帧数据前移到缓冲区开头
+    memmove(conn.in->data, conn.in->data + consumed, conn.in->size - consumed);
+    conn.in->size -= consumed;
+
+    uint32_t session = conn.session;
+    VadConfig vad = config.vad;
+    vad.sampleRate = conn.sampleRate;
+    conn.segmenter = std::make_unique<Segmenter>(vad);
+    conn.segmenter->onStart = [this, session](uint32_t segment) {
+        segments++;
+        bridge.segmentStart(session, segment);
+    };
+    conn.segmenter->onAudio = [this, session](uint32_t seq, uint32_t deviceMs, const uint8_t* pcm,
+                                              size_t bytes) {
+        speechFrames++;
+        speechBytes += bytes;
+        bridge.audio(session, seq, deviceMs, pcm, bytes);
+    };
+    conn.segmenter->onEnd = [this, session](uint32_t segment, uint32_t durationMs, SegmentEnd reason) {
+        bridge.segmentEnd(session, segment, durationMs, static_cast<uint8_t>(reason));
+    };
+
+    announce(conn);
+    flushOutput(conn);
+    return !conn.dead;
+}
+
+void Gateway::announce(Connection& conn) {
+    if (conn.announced || !bridge.isConnected()) return;
+    conn.announced = true;
+    bridge.deviceUp(conn.session, conn.target);
+}
+
+void Gateway::processFrames(Connection& conn) {
+    size_t pos = 0;
+    while (conn.state == ConnState::Open && !conn.dead) {
+        WsFrame frame;
+        size_t consumed = 0;
+        FrameResult result = parseFrame(conn.in->data + pos, conn.in->size - pos,
+                                        conn.in->capacity - 14, frame, consumed);
+        if (result == FrameResult::Incomplete) break;
+        if (result != FrameResult::Ok) {
+            sendClose(conn, result == FrameResult::TooBig ? WS_CLOSE_TOO_BIG : WS_CLOSE_PROTOCOL_ERROR);
+            break;
+        }
+        pos += consumed;
+
+        if (frame.opcode & 0x08) {
+            handleMessage(conn, frame.opcode, frame.payload, frame.length);
+            continue;
+        }
+        // 分片：首帧 opcode 非 0 且 FIN=0，后续为 continuation
+        if (frame.opcode == WS_CONTINUATION) {
+            if (conn.fragmentOpcode == 0) {
+                sendClose(conn, WS_CLOSE_PROTOCOL_ERROR);
+                break;
+            }
+            conn.fragment.append(reinterpret_cast<char*>(frame.payload), frame.length);
+            if (conn.fragment.size() > conn.in->capacity) {
+                sendClose(conn, WS_CLOSE_TOO_BIG);
+                break;
+            }
+            if (frame.fin) {
+                uint8_t opcode = conn.fragmentOpcode;
+                conn.fragmentOpcode = 0;
+                handleMessage(conn, opcode, reinterpret_cast<uint8_t*>(&conn.fragment[0]),
+                              conn.fragment.size());
+                conn.fragment.clear();
+            }
+        } else if (!frame.fin) {
+            conn.fragmentOpcode = frame.opcode;
+            conn.fragment.assign(reinterpret_cast<char*>(frame.payload), frame.length);
+        } else {
+            handleMessage(conn, frame.opcode, frame.payload, frame.length);
+        }
+    }
+    if (pos > 0) {
+        memmove(conn.in->data, conn.in->data + pos, conn.in->size - pos);
+        conn.in->size -= pos;
+    }
+}
+
+void Gateway::handleMessage(Connection& conn, uint8_t opcode, uint8_t* payload, size_t length) {
+    switch (opcode) {
+        case WS_BINARY:
+            handleAudio(conn, payload, length);
+            break;
+        case WS_TEXT:
+            bridge.deviceText(conn.session, payload, length);
+            break;
+        case WS_PING:
+            appendFrame(conn.out, WS_PONG, payload, length);
+            flushOutput(conn);
+            break;
+        case WS_PONG:
+            break;
+        case WS_CLOSE: {
+            uint16_t code = WS_CLOSE_NORMAL;
+            if (length >= 2) code = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+            sendClose(conn, code);
+            break;
+        }
+        default:
+            sendClose(conn, WS_CLOSE_PROTOCOL_ERROR);
+            break;
+    }
+}
+
+void Gateway::handleAudio(Connection& conn, const uint8_t* payload, size_t length) {
+    framesIn++;
+    uint32_t seq;
+    uint32_t deviceMs;
+    const uint8_t* pcm = payload;
+    size_t bytes = length;
+    if (conn.version == 2) {
+        if (length < 8) return;
+        seq = readU32(payload);
+        deviceMs = readU32(payload + 4);
+        pcm += 8;
+        bytes -= 8;
+    } else {
+        // 旧固件没有帧头：序号自增，时间按已收样本数推算
+        seq = conn.nextSeq++;
+        deviceMs = static_cast<uint32_t>(conn.samples * 1000 / conn.sampleRate);
+    }
+    bytes &= ~size_t(1);
+    conn.samples += bytes / 2;
+    conn.segmenter->push(seq, deviceMs, pcm, bytes);
+}
+
+void Gateway::sendClose(Connection& conn, uint16_t code) {
+    if (conn.state == ConnState::Closing) return;
+    if (conn.state == ConnState::Open) appendClose(conn.out, code);
+    conn.state = ConnState::Closing;
+    flushOutput(conn);
+}
+
+void Gateway::flushOutput(Connection& conn) {
+    while (!conn.out.empty()) {
+        ssize_t n = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out.erase(0, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        conn.dead = true;
+        return;
+    }
+    if (conn.out.empty() && conn.state == ConnState::Closing) {
+        conn.dead = true;
+        return;
+    }
+    updateInterest(conn);
+}
+
+void Gateway::updateInterest(Connection& conn) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    if (!conn.out.empty()) ev.events |= EPOLLOUT;
+    ev.data.u64 = conn.session;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+void Gateway::closeConnection(uint32_t session) {
+    auto it = connections.find(session);
+    if (it == connections.end()) return;
+    Connection& conn = *it->second;
+    if (conn.segmenter) conn.segmenter->finish(SegmentEnd::Disconnect);
+    if (conn.announced) bridge.deviceDown(session);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+    close(conn.fd);
+    readPool.release(conn.in);
+    connections.erase(it);
+}
+
+}  // namespace gateway
@@ -0,0 +1,109 @@
+// ============================================
+// Gateway.h - epoll 主循环与设备连接管理
+// ============================================
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Bridge.h"
+#include "BufferPool.h"
+#include "Segmenter.h"
+
+namespace gateway {
+
+struct GatewayConfig {
+    std::string host = "0.0.0.0";
+    int port = 8081;
+    std::string bridgeSocket = "/tmp/light-switch-gateway.sock";
+    size_t maxConnections = 10000;
+    size_t readBufferBytes = 16 * 1024;  // 单连接读缓冲，也是单帧上限
+    size_t bridgeQueueBytes = 16 * 1024 * 1024;
+    int handshakeTimeoutMs = 5000;
+    int pingIntervalMs = 20000;  // 空闲满该时长发 ping；0 关闭心跳
+    int deadAfterMs = 50000;     // 空闲超过该时长视为半开连接，直接关闭
+    VadConfig vad;
+};
+
+enum class ConnState {
+    Handshake,
+    Open,
+    Closing,  // 已发送关闭帧 / 错误响应，写完即关
+};
+
+struct Connection {
+    int fd;
+    uint32_t session;
+    ConnState state = ConnState::Handshake;
+    Block* in = nullptr;        // 读缓冲（来自 BufferPool）
+    std::string out;            // 待写数据：握手响应、pong、指令文本帧
+    std::string fragment;       // 分片消息重组
+    uint8_t fragmentOpcode = 0;
+    std::string target;         // 升级请求路径
+    int version = 1;            // 1 旧固件（纯 PCM），2 带 8 字节帧头
+    int sampleRate = 16000;     // ?sr=8000 为窄带固件
+    uint32_t nextSeq = 0;       // v1 设备由网关补序号与时间
+    uint64_t samples = 0;
+    int64_t acceptedAt = 0;
+    int64_t lastSeen = 0;       // 最后一次收到数据（含 ping / pong）
+    int64_t lastPing = 0;
+    bool announced = false;     // 是否已向 Node 发送 DEVICE_UP
+    bool dead = false;          // 待关闭：由事件处理结束后统一释放，避免处理中途析构
+    std::unique_ptr<Segmenter> segmenter;
+};
+
+class Gateway {
+private:
+    GatewayConfig config;
+    int epollFd = -1;
+    int listenFd = -1;
+    BufferPool readPool;
+    Bridge bridge;
+    std::unordered_map<uint32_t, std::unique_ptr<Connection>> connections;
+    uint32_t nextSession = 2;  // 0 / 1 保留给监听 socket 与 Node 通道
+    volatile std::sig_atomic_t running = 1;  // 由 SIGINT/SIGTERM 处理函数经 stop() 清零
+    int64_t loopNow = 0;  // 本轮 epoll_wait 返回的时间，读数据时用作 lastSeen
+
+    // 统计（累计值，STATS 消息中上报）
+    uint64_t framesIn = 0;
+    uint64_t bytesIn = 0;
+    uint64_t speechFrames = 0;
+    uint64_t speechBytes = 0;
+    uint64_t segments = 0;
+    uint64_t rejected = 0;
+    uint64_t pings = 0;
+    uint64_t reaped = 0;
+
+    void acceptAll();
+    void handleConnection(Connection& conn, uint32_t events);
+    bool readInput(Connection& conn);
+    void processInput(Connection& conn);
+    bool processHandshake(Connection& conn);
+    void processFrames(Connection& conn);
+    void handleMessage(Connection& conn, uint8_t opcode, uint8_t* payload, size_t length);
+    void handleAudio(Connection& conn, const uint8_t* payload, size_t length);
+    void announce(Connection& conn);
+    void sendClose(Connection& conn, uint16_t code);
+    void flushOutput(Connection& conn);
+    void updateInterest(Connection& conn);
+    void closeConnection(uint32_t session);
+    void updateBridgeInterest();
+    void tick(int64_t nowMs);
+
+public:
+    explicit Gateway(const GatewayConfig& cfg);
+    ~Gateway();
+
+    // 运行主循环，直到 stop() 被调用；返回进程退出码
+    int run();
+    void stop() { running = 0; }
+};
+
+}  // namespace gateway
+
+#endif  // GATEWAY_H
@@ -0,0 +1,185 @@
+// ============================================
+// Segmenter.h - 能量 VAD 与语音分段
+// ============================================
+// 每台设备一个实例。只有语音段（含前置缓冲）会转发给 Node，
+// 静音帧在网关内丢弃，Node 侧 ASR 与归档只处理有声部分。
+#ifndef SEGMENTER_H
+#define SEGMENTER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace gateway {
+
+struct VadConfig {
+    int sampleRate = 16000;
+    float thresholdDb = 9.0f;    // 高于噪声基底多少 dB 判为语音
+    float minLevelDb = -50.0f;   // 绝对下限（dBFS），极安静环境下避免把底噪当语音
+    int attackMs = 100;          // 连续超过阈值多久才开始一段
+    int hangoverMs = 500;        // 连续静音多久结束一段
+    int prerollMs = 300;         // 段首补发的前置音频，避免吞掉首字
+    int maxSegmentMs = 15000;    // 单段上限，超长时强制切段
+};
+
+enum class SegmentEnd : uint8_t {
+    Silence = 0,
+    MaxLength = 1,
+    Disconnect = 2,
+};
+
+// 计算 PCM16 小端数据的电平（dBFS）；按字节读取，不要求对齐
+inline float pcmLevelDb(const uint8_t* pcm, size_t bytes) {
+    size_t samples = bytes / 2;
+    if (samples == 0) return -120.0f;
+    double sum = 0;
+    for (size_t i = 0; i < samples; i++) {
+        int16_t s = static_cast<int16_t>(pcm[i * 2] | (pcm[i * 2 + 1] << 8));
+        sum += double(s) * s;
+    }
+    double rms = std::sqrt(sum / samples);
+    return rms < 1.0 ? -120.0f : static_cast<float>(20.0 * std::log10(rms / 32768.0));
+}
+
+class Segmenter {
+public:
+    // 回调：段开始、段内音频帧（含前置缓冲）、段结束
+    std::function<void(uint32_t segment)> onStart;
+    std::function<void(uint32_t seq, uint32_t deviceMs, const uint8_t* pcm, size_t bytes)> onAudio;
+    std::function<void(uint32_t segment, uint32_t durationMs, SegmentEnd reason)> onEnd;
+
+private:
+    struct Frame {
+        uint32_t seq;
+        uint32_t deviceMs;
+        std::vector<uint8_t> pcm;  // 循环复用，稳态下不再分配
+    };
+
+    VadConfig config;
+    float noiseFloorDb = 0;
+    bool floorReady = false;
+    bool inSpeech = false;
+    uint32_t segmentId = 0;
+    size_t loudSamples = 0;
+    size_t silenceSamples = 0;
+    size_t segmentSamples = 0;
+
+    std::vector<Frame> preroll;  // 环形缓冲
+    size_t prerollHead = 0;
+    size_t prerollCount = 0;
+    size_t prerollSamples = 0;
+
+    uint64_t totalSamples = 0;
+    uint64_t speechSamples = 0;
+
+    size_t msToSamples(int ms) const {
+        return static_cast<size_t>(ms) * config.sampleRate / 1000;
+    }
+
+    // 噪声基底：静音时快速下降、缓慢上升，跟随环境噪声变化
+    void updateFloor(float levelDb, bool loud) {
+        if (!floorReady) {
+            noiseFloorDb = levelDb;
+            floorReady = true;
+            return;
+        }
+        float rate = levelDb < noiseFloorDb ? 0.3f : (loud ? 0.005f : 0.05f);
+        noiseFloorDb += (levelDb - noiseFloorDb) * rate;
+    }
+
+    void pushPreroll(uint32_t seq, uint32_t deviceMs, const uint8_t* pcm, size_t bytes) {
+        size_t capacity = preroll.size();
+        size_t slot = (prerollHead + prerollCount) % capacity;
+        if (prerollCount == capacity) {
+            // 满了：覆盖最旧的一帧
+            prerollSamples -= preroll[prerollHead].pcm.size() / 2;
+            prerollHead = (prerollHead + 1) % capacity;
+            prerollCount--;
+        }
+        Frame& frame = preroll[slot];
+        frame.seq = seq;
+        frame.deviceMs = deviceMs;
+        frame.pcm.assign(pcm, pcm + bytes);
+        prerollCount++;
+        prerollSamples += bytes / 2;
+
+        // 只保留 prerollMs 之内的音频（再加上正在判断起音的部分）
+        size_t keep = msToSamples(config.prerollMs) + loudSamples;
+        while (prerollCount > 1 && prerollSamples - preroll[prerollHead].pcm.size() / 2 >= keep) {
+            prerollSamples -= preroll[prerollHead].pcm.size() / 2;
+            prerollHead = (prerollHead + 1) % capacity;
+            prerollCount--;
+        }
+    }
+
+    void startSegment() {
+        inSpeech = true;
+        segmentId++;
+        silenceSamples = 0;
+        segmentSamples = 0;
+        if (onStart) onStart(segmentId);
+        for (size_t i = 0; i < prerollCount; i++) {
+            const Frame& frame = preroll[(prerollHead + i) % preroll.size()];
+            emit(frame.seq, frame.deviceMs, frame.pcm.data(), frame.pcm.size());
+        }
+        prerollCount = 0;
+        prerollSamples = 0;
+        loudSamples = 0;
+    }
+
+    void emit(uint32_t seq, uint32_t deviceMs, const uint8_t* pcm, size_t bytes) {
+        segmentSamples += bytes / 2;
+        speechSamples += bytes / 2;
+        if (onAudio) onAudio(seq, deviceMs, pcm, bytes);
+    }
+
+public:
+    explicit Segmenter(const VadConfig& cfg) : config(cfg), preroll(64) {}
+
+    // 送入一帧音频
+    void push(uint32_t seq, uint32_t deviceMs, const uint8_t* pcm, size_t bytes) {
+        size_t samples = bytes / 2;
+        totalSamples += samples;
+        float level = pcmLevelDb(pcm, bytes);
+        float threshold = noiseFloorDb + config.thresholdDb;
+        if (threshold < config.minLevelDb) threshold = config.minLevelDb;
+        bool loud = floorReady && level > threshold;
+
+        if (!inSpeech) {
+            updateFloor(level, loud);
+            loudSamples = loud ? loudSamples + samples : 0;
+            pushPreroll(seq, deviceMs, pcm, bytes);
+            if (loudSamples >= msToSamples(config.attackMs)) startSegment();
+            return;
+        }
+
+        emit(seq, deviceMs, pcm, bytes);
+        silenceSamples = loud ? 0 : silenceSamples + samples;
+        if (silenceSamples >= msToSamples(config.hangoverMs)) {
+            finish(SegmentEnd::Silence);
+        } else if (segmentSamples >= msToSamples(config.maxSegmentMs)) {
+            finish(SegmentEnd::MaxLength);
+        }
+    }
+
+    // 结束当前段（断开连接时调用）
+    void finish(SegmentEnd reason) {
+        if (!inSpeech) return;
+        inSpeech = false;
+        uint32_t durationMs = static_cast<uint32_t>(segmentSamples * 1000 / config.sampleRate);
+        if (onEnd) onEnd(segmentId, durationMs, reason);
+        segmentSamples = 0;
+        silenceSamples = 0;
+    }
+
+    bool isSpeaking() const { return inSpeech; }
+    float getNoiseFloorDb() const { return noiseFloorDb; }
+    uint64_t getTotalSamples() const { return totalSamples; }
+    uint64_t getSpeechSamples() const { return speechSamples; }
+};
+
+}  // namespace gateway
+
+#endif  // SEGMENTER_H
@@ -0,0 +1,103 @@
+// ============================================
+// Sha1.h - WebSocket 握手用的 SHA-1 与 Base64
+// ============================================
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace gateway {
+
+// RFC 3174；只用于计算 Sec-WebSocket-Accept，不追求速度
+inline void sha1(const uint8_t* data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+
+    // 填充：0x80，补零到 56 mod 64，再附 64 位大端比特长度
+    size_t total = ((len + 8) / 64 + 1) * 64;
+    std::string msg(reinterpret_cast<const char*>(data), len);
+    msg.push_back(static_cast<char>(0x80));
+    msg.resize(total - 8, '\0');
+    uint64_t bits = static_cast<uint64_t>(len) * 8;
+    for (int i = 7; i >= 0; i--) {
+        msg.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+    }
+
+    for (size_t chunk = 0; chunk < total; chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(msg.data()) + chunk + i * 4;
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        out[i * 4] = (h[i] >> 24) & 0xFF;
+        out[i * 4 + 1] = (h[i] >> 16) & 0xFF;
+        out[i * 4 + 2] = (h[i] >> 8) & 0xFF;
+        out[i * 4 + 3] = h[i] & 0xFF;
+    }
+}
+
+inline std::string base64Encode(const uint8_t* data, size_t len) {
+    static const char table[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < len) v |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out.push_back(table[(v >> 18) & 0x3F]);
+        out.push_back(table[(v >> 12) & 0x3F]);
+        out.push_back(i + 1 < len ? table[(v >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < len ? table[v & 0x3F] : '=');
+    }
+    return out;
+}
+
+// Sec-WebSocket-Accept = base64(sha1(key + GUID))
+inline std::string websocketAccept(const std::string& key) {
+    std::string input = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    uint8_t digest[20];
+    sha1(reinterpret_cast<const uint8_t*>(input.data()), input.size(), digest);
+    return base64Encode(digest, sizeof(digest));
+}
+
+}  // namespace gateway
+
+#endif  // SHA1_H
@@ -0,0 +1,156 @@
+#include "WebSocket.h"
+
+#include <cstring>
+#include <strings.h>
+
+#include "Sha1.h"
+
+namespace gateway {
+
+namespace {
+
+// 头部值去掉首尾空白
+std::string trim(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) end--;
+    return std::string(begin, end);
+}
+
+bool containsToken(const std::string& value, const char* token) {
+    // Connection 头可能是 "keep-alive, Upgrade"
+    size_t tokenLen = strlen(token);
+    for (size_t i = 0; i + tokenLen <= value.size(); i++) {
+        if (strncasecmp(value.c_str() + i, token, tokenLen) == 0) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+HandshakeResult parseHandshake(const char* data, size_t len, HandshakeRequest& request,
+                               size_t& consumed) {
+    const char* end = nullptr;
+    for (size_t i = 3; i < len; i++) {
+        if (data[i - 3] == '\r' && data[i - 2] == '\n' && data[i - 1] == '\r' && data[i] == '\n') {
+            end = data + i + 1;
+            break;
+        }
+    }
+    if (!end) return HandshakeResult::Incomplete;
+    consumed = static_cast<size_t>(end - data);
+
+    // 请求行：GET <target> HTTP/1.1
+    const char* lineEnd = static_cast<const char*>(memchr(data, '\r', consumed));
+    if (!lineEnd || lineEnd - data < 14 || strncmp(data, "GET ", 4) != 0) {
+        return HandshakeResult::BadRequest;
+    }
+    const char* targetEnd = static_cast<const char*>(memchr(data + 4, ' ', lineEnd - data - 4));
+    if (!targetEnd) return HandshakeResult::BadRequest;
+    request.target.assign(data + 4, targetEnd);
+
+    bool upgrade = false;
+    bool connection = false;
+    bool version = false;
+    const char* line = lineEnd + 2;
+    while (line < end - 2) {
+        const char* next = static_cast<const char*>(memchr(line, '\r', end - line));
+        if (!next) break;
+        const char* colon = static_cast<const char*>(memchr(line, ':', next - line));
+        if (colon) {
+            size_t nameLen = static_cast<size_t>(colon - line);
+            std::string value = trim(colon + 1, next);
+            if (nameLen == 7 && strncasecmp(line, "upgrade", 7) == 0) {
+                upgrade = strcasecmp(value.c_str(), "websocket") == 0;
+            } else if (nameLen == 10 && strncasecmp(line, "connection", 10) == 0) {
+                connection = containsToken(value, "upgrade");
+            } else if (nameLen == 17 && strncasecmp(line, "sec-websocket-key", 17) == 0) {
+                request.key = value;
+            } else if (nameLen == 21 && strncasecmp(line, "sec-websocket-version", 21) == 0) {
+                version = value == "13";
+            }
+        }
+        line = next + 2;
+    }
+
+    if (!upgrade || !connection || !version || request.key.empty()) {
+        return HandshakeResult::BadRequest;
+    }
+    return HandshakeResult::Ok;
+}
+
+std::string handshakeResponse(const std::string& key) {
+    std::string response =
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: ";
+    response += websocketAccept(key);
+    response += "\r\n\r\n";
+    return response;
+}
+
+std::string httpError(int status, const char* reason) {
+    std::string response = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n";
+    response += "Connection: close\r\nContent-Length: 0\r\n\r\n";
+    return response;
+}
+
+FrameResult parseFrame(uint8_t* data, size_t len, size_t maxPayload, WsFrame& frame,
+                       size_t& consumed) {
+    if (len < 2) return FrameResult::Incomplete;
+    uint8_t b0 = data[0];
+    uint8_t b1 = data[1];
+    if (b0 & 0x70) return FrameResult::ProtocolError;  // 未协商扩展，RSV 必须为 0
+    if (!(b1 & 0x80)) return FrameResult::ProtocolError;  // 客户端帧必须带掩码
+
+    frame.fin = (b0 & 0x80) != 0;
+    frame.opcode = b0 & 0x0F;
+    uint64_t length = b1 & 0x7F;
+    size_t offset = 2;
+    if (length == 126) {
+        if (len < 4) return FrameResult::Incomplete;
+        length = (uint64_t(data[2]) << 8) | data[3];
+        offset = 4;
+    } else if (length == 127) {
+        if (len < 10) return FrameResult::Incomplete;
+        length = 0;
+        for (int i = 0; i < 8; i++) length = (length << 8) | data[2 + i];
+        offset = 10;
+    }
+
+    bool control = frame.opcode & 0x08;
+    if (control && (length > 125 || !frame.fin)) return FrameResult::ProtocolError;
+    if (length > maxPayload) return FrameResult::TooBig;
+    if (len < offset + 4 + length) return FrameResult::Incomplete;
+
+    const uint8_t* mask = data + offset;
+    uint8_t* payload = data + offset + 4;
+    for (size_t i = 0; i < length; i++) payload[i] ^= mask[i & 3];
+
+    frame.payload = payload;
+    frame.length = static_cast<size_t>(length);
+    consumed = offset + 4 + static_cast<size_t>(length);
+    return FrameResult::Ok;
+}
+
+void appendFrame(std::string& out, uint8_t opcode, const uint8_t* payload, size_t length) {
+    out.push_back(static_cast<char>(0x80 | opcode));
+    if (length < 126) {
+        out.push_back(static_cast<char>(length));
+    } else if (length <= 0xFFFF) {
+        out.push_back(static_cast<char>(126));
+        out.push_back(static_cast<char>(length >> 8));
+        out.push_back(static_cast<char>(length & 0xFF));
+    } else {
+        out.push_back(static_cast<char>(127));
+        for (int i = 7; i >= 0; i--) out.push_back(static_cast<char>((uint64_t(length) >> (i * 8)) & 0xFF));
+    }
+    out.append(reinterpret_cast<const char*>(payload), length);
+}
+
+void appendClose(std::string& out, uint16_t code) {
+    uint8_t payload[2] = {static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code & 0xFF)};
+    appendFrame(out, WS_CLOSE, payload, sizeof(payload));
+}
+
+}  // namespace gateway
@@ -0,0 +1,85 @@
+// ============================================
+// WebSocket.h - 最小 RFC 6455 实现（服务端）
+// ============================================
+// 只实现设备上行需要的部分：握手、掩码帧解析、分片重组、ping/pong/close。
+// 不支持扩展（permessage-deflate 等），握手时不协商。
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gateway {
+
+enum WsOpcode : uint8_t {
+    WS_CONTINUATION = 0x0,
+    WS_TEXT = 0x1,
+    WS_BINARY = 0x2,
+    WS_CLOSE = 0x8,
+    WS_PING = 0x9,
+    WS_PONG = 0xA,
+};
+
+// 关闭码
+enum WsCloseCode : uint16_t {
+    WS_CLOSE_NORMAL = 1000,
+    WS_CLOSE_GOING_AWAY = 1001,
+    WS_CLOSE_PROTOCOL_ERROR = 1002,
+    WS_CLOSE_TOO_BIG = 1009,
+    WS_CLOSE_TRY_AGAIN = 1013,
+};
+
+struct HandshakeRequest {
+    std::string target;  // 例如 /api/audio?id=AABBCCDDEEFF&v=2
+    std::string key;     // Sec-WebSocket-Key
+};
+
+enum class HandshakeResult {
+    Incomplete,  // 头部未收全
+    Ok,
+    BadRequest,
+};
+
+/**
+ * 解析 HTTP 升级请求
+ * @param consumed 成功时返回请求头占用的字节数（之后可能紧跟 WebSocket 帧）
+ */
+HandshakeResult parseHandshake(const char* data, size_t len, HandshakeRequest& request,
+                               size_t& consumed);
+
+// 101 Switching Protocols 响应
+std::string handshakeResponse(const std::string& key);
+
+// 非 101 的错误响应（随后关闭连接）
+std::string httpError(int status, const char* reason);
+
+struct WsFrame {
+    bool fin;
+    uint8_t opcode;
+    uint8_t* payload;  // 指向读缓冲内部，已就地去掩码
+    size_t length;
+};
+
+enum class FrameResult {
+    Incomplete,
+    Ok,
+    ProtocolError,
+    TooBig,
+};
+
+/**
+ * 从缓冲区解析一帧；客户端帧必须带掩码
+ * @param maxPayload 单帧负载上限，超出返回 TooBig
+ * @param consumed 成功时返回本帧总字节数
+ */
+FrameResult parseFrame(uint8_t* data, size_t len, size_t maxPayload, WsFrame& frame,
+                       size_t& consumed);
+
+// 服务端帧（不加掩码）追加到 out
+void appendFrame(std::string& out, uint8_t opcode, const uint8_t* payload, size_t length);
+void appendClose(std::string& out, uint16_t code);
+
+}  // namespace gateway
+
+#endif  // WEBSOCKET_H
@@ -0,0 +1,88 @@
+// ============================================
+// main.cpp - 原生音频接入网关
+// ============================================
+// 终结设备 WebSocket（/api/audio），在本地完成解帧、VAD 与分段，
+// 只把语音段和控制事件经 Unix socket 交给 Node（server/lib/gatewayBridge.ts）。
+//
+// 用法: light-switch-gateway [--port 8081] [--host 0.0.0.0]
+//                            [--socket /tmp/light-switch-gateway.sock]
+//                            [--max-connections 10000]
+//                            [--ping-interval-ms 20000] [--dead-after-ms 50000]
+//                            [--vad-threshold-db 9] [--vad-hangover-ms 500]
+//                            [--vad-preroll-ms 300] [--vad-max-segment-ms 15000]
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Gateway.h"
+
+namespace {
+
+gateway::Gateway* instance = nullptr;
+
+void handleSignal(int) {
+    if (instance) instance->stop();
+}
+
+void usage(const char* argv0) {
+    fprintf(stderr,
+            "用法: %s [--port N] [--host ADDR] [--socket PATH] [--max-connections N]\n"
+            "          [--ping-interval-ms MS] [--dead-after-ms MS]\n"
+            "          [--vad-threshold-db DB] [--vad-attack-ms MS] [--vad-hangover-ms MS]\n"
+            "          [--vad-preroll-ms MS] [--vad-max-segment-ms MS]\n",
+            argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gateway::GatewayConfig config;
+    if (const char* env = getenv("GATEWAY_SOCKET")) config.bridgeSocket = env;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "--port") config.port = atoi(value);
+        else if (arg == "--host") config.host = value;
+        else if (arg == "--socket") config.bridgeSocket = value;
+        else if (arg == "--max-connections") config.maxConnections = strtoul(value, nullptr, 10);
+        else if (arg == "--ping-interval-ms") config.pingIntervalMs = atoi(value);
+        else if (arg == "--dead-after-ms") config.deadAfterMs = atoi(value);
+        else if (arg == "--vad-threshold-db") config.vad.thresholdDb = static_cast<float>(atof(value));
+        else if (arg == "--vad-attack-ms") config.vad.attackMs = atoi(value);
+        else if (arg == "--vad-hangover-ms") config.vad.hangoverMs = atoi(value);
+        else if (arg == "--vad-preroll-ms") config.vad.prerollMs = atoi(value);
+        else if (arg == "--vad-max-segment-ms") config.vad.maxSegmentMs = atoi(value);
+        else {
+            fprintf(stderr, "未知参数: %s\n", arg.c_str());
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // 输出到管道时按行刷新，便于被 Node 脚本读取启动状态
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    gateway::Gateway gw(config);
+    instance = &gw;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    int code = gw.run();
+    instance = nullptr;
+    return code;
+}
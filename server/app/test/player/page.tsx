@@ -3,11 +3,27 @@
 import { useState, useRef, useEffect } from "react";
 
 interface AudioConfig {
+  codec: "pcm" | "opus";
   sampleRate: number;
   channels: number;
   bitDepth: number;
 }
 
+// 待播放的一块音频：Opus 解码输出为 48 kHz，PCM 为设备采样率
+interface AudioChunk {
+  data: Float32Array;
+  sampleRate: number;
+}
+
+// Opus 流：每台设备一路（服务器 opus_stream 消息通知），二进制消息 = u16 流编号 + Opus 包
+interface OpusStream {
+  decoder: AudioDecoder;
+  timestamp: number; // 微秒，按包时长递增
+}
+
+const OPUS_PACKET_US = 20000;
+const opusSupported = () => typeof AudioDecoder !== "undefined";
+
 interface AsrResult {
   text: string;
   isEnd: boolean;
@@ -25,10 +41,16 @@ export default function LiveAudioPlayer() {
   const [audioContextState, setAudioContextState] =
     useState<string>("未初始化");
   const [asrResults, setAsrResults] = useState<AsrResult[]>([]);
+  // 手机流量下用 Opus（约 24 kbps，PCM 为 256 kbps）；浏览器不支持 WebCodecs 时只能 PCM
+  const [useOpus, setUseOpus] = useState(false);
+  const [codec, setCodec] = useState<string>("-");
+  // 只听一路：设备 ID，或 monitor:<组 id> 听整组的混音；留空为全部设备
+  const [stream, setStream] = useState("");
 
   const wsRef = useRef<WebSocket | null>(null);
   const audioContextRef = useRef<AudioContext | null>(null);
-  const audioBufferQueueRef = useRef<Float32Array[]>([]);
+  const audioBufferQueueRef = useRef<AudioChunk[]>([]);
+  const opusStreamsRef = useRef<Map<number, OpusStream>>(new Map());
   const nextPlayTimeRef = useRef<number>(0);
   const configRef = useRef<AudioConfig | null>(null);
   const gainNodeRef = useRef<GainNode | null>(null);
@@ -44,13 +66,18 @@ export default function LiveAudioPlayer() {
   }, [asrResults]);
 
   useEffect(() => {
+    setUseOpus(opusSupported());
     return () => {
       disconnect();
     };
   }, []);
 
   const connect = async () => {
-    const ws = new WebSocket("ws://pi:3000/api/playback");
+    const params = new URLSearchParams();
+    if (useOpus && opusSupported()) params.set("codec", "opus");
+    if (stream.trim()) params.set("stream", stream.trim());
+    const query = params.toString();
+    const ws = new WebSocket(`ws://pi:3000/api/playback${query ? `?${query}` : ""}`);
     wsRef.current = ws;
 
     ws.onopen = () => {
@@ -64,12 +91,19 @@ export default function LiveAudioPlayer() {
           const data = JSON.parse(event.data);
           if (data.type === "config") {
             configRef.current = {
+              codec: data.codec === "opus" ? "opus" : "pcm",
               sampleRate: data.sampleRate,
               channels: data.channels,
               bitDepth: data.bitDepth,
             };
             console.log("📡 收到音频配置:", configRef.current);
+            setCodec(configRef.current.codec);
             initAudioContext();
+          } else if (data.type === "opus_stream") {
+            openOpusStream(data.stream, data.sampleRate, data.channels);
+            console.log("🎧 Opus 流:", data.stream, data.device);
+          } else if (data.type === "opus_stream_end") {
+            closeOpusStream(data.stream);
           } else if (data.type === "asr_result") {
             const result: AsrResult = {
               text: data.text,
@@ -93,7 +127,11 @@ export default function LiveAudioPlayer() {
         }
       } else if (event.data instanceof Blob) {
         event.data.arrayBuffer().then((buffer) => {
-          processAudioChunk(buffer);
+          if (configRef.current?.codec === "opus") {
+            processOpusPacket(buffer);
+          } else {
+            processAudioChunk(buffer);
+          }
         });
       }
     };
@@ -121,6 +159,7 @@ export default function LiveAudioPlayer() {
       audioContextRef.current.close();
       audioContextRef.current = null;
     }
+    for (const id of [...opusStreamsRef.current.keys()]) closeOpusStream(id);
     audioBufferQueueRef.current = [];
     nextPlayTimeRef.current = 0;
     setIsConnected(false);
@@ -161,6 +200,54 @@ export default function LiveAudioPlayer() {
     }
   };
 
+  const openOpusStream = (id: number, sampleRate: number, channels: number) => {
+    closeOpusStream(id);
+    const decoder = new AudioDecoder({
+      output: (audioData) => {
+        const samples = new Float32Array(audioData.numberOfFrames);
+        audioData.copyTo(samples, { planeIndex: 0, format: "f32-planar" });
+        enqueueAudio({ data: samples, sampleRate: audioData.sampleRate });
+        audioData.close();
+      },
+      error: (error) => console.error("❌ Opus 解码失败:", error),
+    });
+    decoder.configure({ codec: "opus", sampleRate, numberOfChannels: channels });
+    opusStreamsRef.current.set(id, { decoder, timestamp: 0 });
+  };
+
+  const closeOpusStream = (id: number) => {
+    const stream = opusStreamsRef.current.get(id);
+    if (!stream) return;
+    opusStreamsRef.current.delete(id);
+    if (stream.decoder.state !== "closed") stream.decoder.close();
+  };
+
+  const processOpusPacket = (arrayBuffer: ArrayBuffer) => {
+    setBytesReceived((prev) => prev + arrayBuffer.byteLength);
+    const id = new DataView(arrayBuffer).getUint16(0, true);
+    const stream = opusStreamsRef.current.get(id);
+    if (!stream || stream.decoder.state !== "configured") return;
+    stream.decoder.decode(
+      new EncodedAudioChunk({
+        type: "key",
+        timestamp: stream.timestamp,
+        data: new Uint8Array(arrayBuffer, 2),
+      }),
+    );
+    stream.timestamp += OPUS_PACKET_US;
+  };
+
+  const enqueueAudio = (chunk: AudioChunk) => {
+    audioBufferQueueRef.current.push(chunk);
+    setBufferSize(audioBufferQueueRef.current.length);
+
+    // ✅ 降低初始缓冲阈值到 2 块，减少启动延迟
+    if (!isPlayingRef.current && audioBufferQueueRef.current.length >= 2) {
+      console.log("▶️ 缓冲充足，开始自动播放");
+      startPlayback();
+    }
+  };
+
   const processAudioChunk = (arrayBuffer: ArrayBuffer) => {
     if (!audioContextRef.current || !configRef.current) {
       console.warn("⚠️ AudioContext 或配置未就绪");
@@ -185,14 +272,7 @@ export default function LiveAudioPlayer() {
       );
     }
 
-    audioBufferQueueRef.current.push(float32Data);
-    setBufferSize(audioBufferQueueRef.current.length);
-
-    // ✅ 降低初始缓冲阈值到 2 块，减少启动延迟
-    if (!isPlayingRef.current && audioBufferQueueRef.current.length >= 2) {
-      console.log("▶️ 缓冲充足，开始自动播放");
-      startPlayback();
-    }
+    enqueueAudio({ data: float32Data, sampleRate: configRef.current.sampleRate });
   };
 
   const startPlayback = async () => {
@@ -230,18 +310,18 @@ export default function LiveAudioPlayer() {
       }
 
       while (audioBufferQueueRef.current.length > 0) {
-        const audioData = audioBufferQueueRef.current.shift()!;
+        const chunk = audioBufferQueueRef.current.shift()!;
         const audioContext = audioContextRef.current!;
         const config = configRef.current!;
 
         try {
           const audioBuffer = audioContext.createBuffer(
             config.channels,
-            audioData.length,
-            config.sampleRate,
+            chunk.data.length,
+            chunk.sampleRate,
           );
 
-          audioBuffer.getChannelData(0).set(audioData);
+          audioBuffer.getChannelData(0).set(chunk.data);
 
           const source = audioContext.createBufferSource();
           source.buffer = audioBuffer;
@@ -351,6 +431,26 @@ export default function LiveAudioPlayer() {
             </button>
           </div>
 
+          <label className="flex items-center gap-3 text-white">
+            <input
+              type="checkbox"
+              checked={useOpus}
+              disabled={isConnected}
+              onChange={(e) => setUseOpus(e.target.checked && opusSupported())}
+              className="w-5 h-5"
+            />
+            Opus 压缩传输（省流量，需浏览器支持 WebCodecs）
+          </label>
+
+          <input
+            type="text"
+            value={stream}
+            disabled={isConnected}
+            onChange={(e) => setStream(e.target.value)}
+            placeholder="收听的流：留空为全部设备，或设备 ID、monitor:<组 id>"
+            className="w-full bg-gray-700 text-white rounded-lg px-3 py-2"
+          />
+
           <div className="grid grid-cols-2 gap-4">
             <button
               onClick={togglePlayback}
@@ -470,6 +570,7 @@ export default function LiveAudioPlayer() {
                 value={`${(bytesReceived / 1024).toFixed(2)} KB`}
               />
               <Stat label="AudioContext 状态" value={audioContextState} />
+              <Stat label="传输格式" value={codec} />
               {configRef.current && (
                 <>
                   <Stat
@@ -0,0 +1,297 @@
+/**
+ * 集群 ingest 扩展性压测
+ * 依次以不同 worker 数启动服务器（AUDIO_ONLY，无 ASR），模拟设备按固定速率推送 v2 音频帧，
+ * 从 /metrics 统计服务器实际处理的帧数与各进程事件循环延迟，输出随 worker 数的变化。
+ * 处理不过来时设备侧 bufferedAmount 积压、帧被跳过，送达率下降。
+ *
+ * 用法: npm run bench:cluster -- --workers 0,1,2,4 --devices 200 --speed 4 --seconds 10
+ *   --workers   逗号分隔的 worker 数，0 表示单进程模式
+ *   --devices   模拟设备数（按 ID 哈希分到各 worker）
+ *   --speed     每台设备的发送速率倍数（1 = 实时，每秒 20 帧）
+ *   --playback  播放订阅者数（默认 0；>0 时音频经 IPC 回到主进程广播）
+ *   --threads   发压线程数（默认 CPU 数的一半）
+ *   --out       结果 JSON 路径
+ */
+import { spawn } from "child_process";
+import { mkdtempSync, rmSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+import { fileURLToPath } from "url";
+import { Worker, isMainThread, parentPort, workerData } from "worker_threads";
+import WebSocket from "ws";
+import { parsePrometheusText } from "../lib/metrics";
+
+const __filename = fileURLToPath(import.meta.url);
+const __dirname = path.dirname(__filename);
+
+// 与固件一致：每帧 800 个样本（50ms），8 字节帧头
+const SAMPLES_PER_FRAME = 800;
+const FRAME_BYTES = 8 + SAMPLES_PER_FRAME * 2;
+const MAX_BUFFERED = 64 * 1024;
+
+interface LoadOptions {
+  port: number;
+  deviceIds: string[];
+  playback: number;
+  speed: number;
+}
+
+interface LoadReport {
+  sent: number;
+  skipped: number; // 因积压跳过的帧
+}
+
+interface RunResult {
+  workers: number;
+  devices: number;
+  seconds: number;
+  offeredPerSec: number;
+  frames: number;
+  framesPerSec: number;
+  deliveryRatio: number;
+  maxLagP99Ms: number; // 各进程事件循环延迟 p99 的最大值
+  mbPerSec: number;
+  realtimeFactor: number; // 处理的音频时长 / 墙钟时长
+  perWorker: Record<string, number>;
+}
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    workers: (args.get("workers") ?? "0,1,2,4").split(",").map(Number),
+    devices: Number(args.get("devices") ?? 200),
+    speed: Number(args.get("speed") ?? 4),
+    seconds: Number(args.get("seconds") ?? 10),
+    warmup: Number(args.get("warmup") ?? 2),
+    playback: Number(args.get("playback") ?? 0),
+    threads: Number(args.get("threads") ?? Math.max(1, Math.floor(os.cpus().length / 2))),
+    port: Number(args.get("port") ?? 3900),
+    out: args.get("out"),
+  };
+}
+
+// ==================== 发压线程 ====================
+// 每个 tick 给每台设备发一帧；连接积压超过上限时跳过，模拟固件发送失败
+function runLoad({ port, deviceIds, playback, speed }: LoadOptions) {
+  const frame = Buffer.alloc(FRAME_BYTES);
+  const pcm = new Int16Array(frame.buffer, frame.byteOffset + 8, SAMPLES_PER_FRAME);
+  for (let i = 0; i < pcm.length; i++) {
+    pcm[i] = Math.round(Math.sin((2 * Math.PI * 440 * i) / 16000) * 8000);
+  }
+  const sockets: WebSocket[] = [];
+  const devices: WebSocket[] = [];
+  const report: LoadReport = { sent: 0, skipped: 0 };
+  let seq = 0;
+
+  for (let p = 0; p < playback; p++) {
+    sockets.push(new WebSocket(`ws://127.0.0.1:${port}/api/playback`));
+  }
+
+  for (const id of deviceIds) {
+    const ws = new WebSocket(`ws://127.0.0.1:${port}/api/audio?id=${id}&v=2`);
+    ws.on("error", (err) => console.error(`[bench ${id}]`, err.message));
+    sockets.push(ws);
+    devices.push(ws);
+  }
+
+  const frameMs = (SAMPLES_PER_FRAME / 16000) * 1000;
+  const timer = setInterval(() => {
+    seq++;
+    for (const ws of devices) {
+      if (ws.readyState !== WebSocket.OPEN) continue;
+      if (ws.bufferedAmount > MAX_BUFFERED) {
+        report.skipped++;
+        continue;
+      }
+      frame.writeUInt32LE(seq >>> 0, 0);
+      frame.writeUInt32LE((seq * frameMs) >>> 0, 4);
+      ws.send(frame);
+      report.sent++;
+    }
+  }, frameMs / speed);
+
+  parentPort!.on("message", (msg) => {
+    if (msg === "reset") {
+      report.sent = 0;
+      report.skipped = 0;
+      return;
+    }
+    if (msg !== "stop") return;
+    clearInterval(timer);
+    for (const ws of sockets) ws.terminate();
+    parentPort!.postMessage(report);
+  });
+}
+
+// ==================== 主流程 ====================
+const sleep = (ms: number) => new Promise((r) => setTimeout(r, ms));
+
+async function startServer(workers: number, port: number, audioDir: string) {
+  const child = spawn(
+    process.execPath,
+    [...process.execArgv, path.join(__dirname, "..", "server.ts")],
+    {
+      cwd: path.join(__dirname, ".."),
+      env: {
+        ...process.env,
+        PORT: String(port),
+        CLUSTER_WORKERS: String(workers),
+        AUDIO_ONLY: "1",
+        AUDIO_DIR: audioDir,
+        DASHSCOPE_API_KEY: "",
+      },
+      stdio: ["ignore", "ignore", "inherit"],
+    },
+  );
+  let exited = false;
+  child.once("exit", () => (exited = true));
+
+  // 所有 worker 都能响应 /metrics 后才开始发压，避免连接落到尚未就绪的 worker
+  for (let attempt = 0; attempt < 100; attempt++) {
+    if (exited) throw new Error("服务器启动失败");
+    await sleep(200);
+    try {
+      const text = await (await fetch(`http://127.0.0.1:${port}/metrics`)).text();
+      const ready = Array.from({ length: workers }, (_, i) => `worker="worker-${i + 1}"`);
+      if (ready.every((label) => text.includes(label))) return child;
+    } catch {
+      // 尚未监听
+    }
+  }
+  child.kill("SIGKILL");
+  throw new Error("服务器启动超时");
+}
+
+async function scrape(port: number) {
+  const res = await fetch(`http://127.0.0.1:${port}/metrics`);
+  const families = parsePrometheusText(await res.text());
+  const frames: Record<string, number> = {};
+  const family = families.find((f) => f.name === "audio_ingest_frames_total");
+  for (const sample of family?.samples ?? []) {
+    const worker = sample.labels.worker ?? "primary";
+    frames[worker] = (frames[worker] ?? 0) + sample.value;
+  }
+  // 每次抓取会重置延迟统计，因此得到的是两次抓取之间的 p99
+  const lag = families.find((f) => f.name === "nodejs_eventloop_lag_seconds");
+  const lagP99 = (lag?.samples ?? [])
+    .filter((s) => s.labels.stat === "p99")
+    .reduce((max, s) => Math.max(max, s.value * 1000), 0);
+  return { frames, lagP99 };
+}
+
+const sum = (o: Record<string, number>) => Object.values(o).reduce((a, b) => a + b, 0);
+
+async function runOnce(opts: ReturnType<typeof parseArgs>, workers: number): Promise<RunResult> {
+  // 归档写到临时目录，压测结束后删除
+  const audioDir = mkdtempSync(path.join(os.tmpdir(), "bench-cluster-"));
+  const server = await startServer(workers, opts.port, audioDir);
+  const deviceIds = Array.from({ length: opts.devices }, (_, i) =>
+    `BENCH${i.toString(16).padStart(6, "0").toUpperCase()}`,
+  );
+
+  const threads: Worker[] = [];
+  for (let t = 0; t < opts.threads; t++) {
+    threads.push(
+      new Worker(new URL(import.meta.url), {
+        execArgv: process.execArgv,
+        workerData: {
+          port: opts.port,
+          deviceIds: deviceIds.filter((_, i) => i % opts.threads === t),
+          playback: t === 0 ? opts.playback : 0,
+          speed: opts.speed,
+        } satisfies LoadOptions,
+      }),
+    );
+  }
+
+  await sleep(opts.warmup * 1000);
+  const before = await scrape(opts.port);
+  threads.forEach((t) => t.postMessage("reset"));
+  const startedAt = performance.now();
+  await sleep(opts.seconds * 1000);
+  const after = await scrape(opts.port);
+  const elapsed = (performance.now() - startedAt) / 1000;
+
+  const reports = await Promise.all(
+    threads.map(
+      (t) =>
+        new Promise<LoadReport>((resolve) => {
+          t.once("message", resolve);
+          t.postMessage("stop");
+        }),
+    ),
+  );
+  await Promise.all(threads.map((t) => t.terminate()));
+  const exited = new Promise((r) => server.once("exit", r));
+  server.kill("SIGTERM");
+  await exited;
+  // 主进程退出后 worker 断开 IPC 才退出，给它们一点时间写完最后的段
+  await sleep(500);
+  rmSync(audioDir, { recursive: true, force: true });
+
+  const perWorker: Record<string, number> = {};
+  for (const key of Object.keys(after.frames)) {
+    perWorker[key] = Math.round(
+      ((after.frames[key] ?? 0) - (before.frames[key] ?? 0)) / elapsed,
+    );
+  }
+  const offered = reports.reduce((acc, r) => acc + r.sent + r.skipped, 0);
+  const frames = sum(after.frames) - sum(before.frames);
+  const framesPerSec = frames / elapsed;
+  return {
+    workers,
+    devices: opts.devices,
+    seconds: Number(elapsed.toFixed(2)),
+    offeredPerSec: Math.round(offered / elapsed),
+    frames,
+    framesPerSec: Math.round(framesPerSec),
+    deliveryRatio: Number((offered ? frames / offered : 0).toFixed(3)),
+    maxLagP99Ms: Number(after.lagP99.toFixed(1)),
+    mbPerSec: Number(((framesPerSec * FRAME_BYTES) / 1024 / 1024).toFixed(2)),
+    realtimeFactor: Number(((framesPerSec * SAMPLES_PER_FRAME) / 16000).toFixed(1)),
+    perWorker,
+  };
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  console.log(
+    `集群 ingest 压测: devices=${opts.devices} speed=${opts.speed}x seconds=${opts.seconds} threads=${opts.threads} playback=${opts.playback} cpus=${os.cpus().length}`,
+  );
+  const results: RunResult[] = [];
+  for (const workers of opts.workers) {
+    const result = await runOnce(opts, workers);
+    results.push(result);
+    const baseline = results[0].framesPerSec || 1;
+    console.log(
+      `workers=${String(workers).padStart(2)}  ${String(result.framesPerSec).padStart(8)} frames/s  ` +
+        `送达 ${(result.deliveryRatio * 100).toFixed(1).padStart(5)}%  ` +
+        `${String(result.mbPerSec).padStart(7)} MB/s  ${String(result.realtimeFactor).padStart(7)}x 实时  ` +
+        `lag p99 ${String(result.maxLagP99Ms).padStart(7)}ms  ` +
+        `加速比 ${(result.framesPerSec / baseline).toFixed(2)}  ${JSON.stringify(result.perWorker)}`,
+    );
+  }
+  const report = {
+    date: new Date().toISOString(),
+    cpus: os.cpus().length,
+    frameBytes: FRAME_BYTES,
+    options: opts,
+    results,
+  };
+  if (opts.out) {
+    writeFileSync(opts.out, JSON.stringify(report, null, 2));
+    console.log(`结果已写入 ${opts.out}`);
+  }
+}
+
+if (isMainThread) {
+  main().catch((err) => {
+    console.error(err);
+    process.exit(1);
+  });
+} else {
+  runLoad(workerData as LoadOptions);
+}
@@ -0,0 +1,335 @@
+/**
+ * 原生网关 vs 纯 Node ingest 对比压测
+ * 同一组模拟设备（v2 帧，按间歇语音节奏：短促语音 + 底噪）分别接入：
+ *   node     设备直连 server.ts 的 /api/audio（当前路径，所有帧进入 Node）
+ *   gateway  设备连接 gateway/ 的 C++ 网关，网关做 VAD 分段后只把语音经 Unix socket 交给 Node
+ * 统计两种模式下服务器 / 网关进程的 CPU 占用、送达率、进入 Node 的帧数与事件循环延迟。
+ * 网关需先构建：make -C ../gateway
+ *
+ * 网关帧数来自其每秒一次的 STATS 上报，窗口两端各有至多 1 秒误差，--seconds 不宜过短。
+ *
+ * 用法: npm run bench:gateway -- --modes node,gateway --devices 500 --seconds 20
+ *   --modes     逗号分隔：node / gateway
+ *   --devices   模拟设备数
+ *   --speed     每台设备的发送速率倍数（1 = 实时，每秒 20 帧）
+ *   --speech    语音占空比（默认 0.2：每 5 秒说 1 秒）
+ *   --threads   发压线程数（默认 CPU 数的一半）
+ *   --out       结果 JSON 路径
+ */
+import { spawn, type ChildProcess } from "child_process";
+import { existsSync, mkdtempSync, readFileSync, rmSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+import { fileURLToPath } from "url";
+import { Worker, isMainThread, parentPort, workerData } from "worker_threads";
+import WebSocket from "ws";
+import { parsePrometheusText } from "../lib/metrics";
+
+const __filename = fileURLToPath(import.meta.url);
+const __dirname = path.dirname(__filename);
+
+// 与固件一致：每帧 800 个样本（50ms），8 字节帧头
+const SAMPLES_PER_FRAME = 800;
+const FRAME_BYTES = 8 + SAMPLES_PER_FRAME * 2;
+const MAX_BUFFERED = 64 * 1024;
+const FRAMES_PER_CYCLE = 100; // 5 秒一个说话周期
+const GATEWAY_BIN = path.join(__dirname, "..", "..", "gateway", "build", "light-switch-gateway");
+// /proc/<pid>/stat 的时间单位，Linux 上几乎都是 100
+const CLOCK_TICKS = 100;
+
+type Mode = "node" | "gateway";
+
+interface LoadOptions {
+  url: string;
+  deviceIds: string[];
+  speed: number;
+  speech: number;
+}
+
+interface LoadReport {
+  sent: number;
+  skipped: number;
+}
+
+interface RunResult {
+  mode: Mode;
+  devices: number;
+  seconds: number;
+  offeredPerSec: number;
+  gatewayFramesPerSec: number; // 网关收到的帧（node 模式为 0）
+  nodeFramesPerSec: number; // 进入 Node 音频管线的帧
+  deliveryRatio: number; // 设备端帧被接入层收下的比例
+  serverCpu: number; // 1.0 = 占满一个核
+  gatewayCpu: number;
+  cpuPerKFrames: number; // 每千个设备帧消耗的 CPU 秒（两进程合计）
+  lagP99Ms: number;
+}
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    modes: (args.get("modes") ?? "node,gateway").split(",") as Mode[],
+    devices: Number(args.get("devices") ?? 500),
+    speed: Number(args.get("speed") ?? 1),
+    speech: Number(args.get("speech") ?? 0.2),
+    seconds: Number(args.get("seconds") ?? 20),
+    warmup: Number(args.get("warmup") ?? 3),
+    threads: Number(args.get("threads") ?? Math.max(1, Math.floor(os.cpus().length / 2))),
+    port: Number(args.get("port") ?? 3900),
+    gatewayPort: Number(args.get("gateway-port") ?? 3901),
+    out: args.get("out"),
+  };
+}
+
+// ==================== 发压线程 ====================
+// 每台设备按各自相位循环：speech 占比的帧为 440Hz 语音，其余为低电平噪声
+function runLoad({ url, deviceIds, speed, speech }: LoadOptions) {
+  const makeFrame = (amplitude: number, tone: boolean) => {
+    const frame = Buffer.alloc(FRAME_BYTES);
+    for (let i = 0; i < SAMPLES_PER_FRAME; i++) {
+      const value = tone
+        ? Math.sin((2 * Math.PI * 440 * i) / 16000) * amplitude
+        : (Math.random() * 2 - 1) * amplitude;
+      frame.writeInt16LE(Math.round(value), 8 + i * 2);
+    }
+    return frame;
+  };
+  const voice = makeFrame(8000, true);
+  const quiet = makeFrame(60, false);
+  const speechFrames = Math.round(FRAMES_PER_CYCLE * speech);
+
+  const devices = deviceIds.map((id, index) => {
+    const ws = new WebSocket(`${url}?id=${id}&v=2`);
+    ws.on("error", (err) => console.error(`[bench ${id}]`, err.message));
+    // 错开各设备的说话时间
+    return { ws, phase: (index * 37) % FRAMES_PER_CYCLE };
+  });
+  const report: LoadReport = { sent: 0, skipped: 0 };
+  let seq = 0;
+
+  const frameMs = (SAMPLES_PER_FRAME / 16000) * 1000;
+  const timer = setInterval(() => {
+    seq++;
+    for (const { ws, phase } of devices) {
+      if (ws.readyState !== WebSocket.OPEN) continue;
+      if (ws.bufferedAmount > MAX_BUFFERED) {
+        report.skipped++;
+        continue;
+      }
+      const frame = (seq + phase) % FRAMES_PER_CYCLE < speechFrames ? voice : quiet;
+      frame.writeUInt32LE(seq >>> 0, 0);
+      frame.writeUInt32LE((seq * frameMs) >>> 0, 4);
+      ws.send(frame);
+      report.sent++;
+    }
+  }, frameMs / speed);
+
+  parentPort!.on("message", (msg) => {
+    if (msg === "reset") {
+      report.sent = 0;
+      report.skipped = 0;
+      return;
+    }
+    if (msg !== "stop") return;
+    clearInterval(timer);
+    for (const { ws } of devices) ws.terminate();
+    parentPort!.postMessage(report);
+  });
+}
+
+// ==================== 进程管理 ====================
+const sleep = (ms: number) => new Promise((r) => setTimeout(r, ms));
+
+// 进程累计 CPU 秒（utime + stime）
+function cpuSeconds(pid: number): number {
+  const stat = readFileSync(`/proc/${pid}/stat`, "utf8");
+  // 第 2 列是带括号的进程名，可能含空格，从右括号之后开始数
+  const fields = stat.slice(stat.lastIndexOf(")") + 2).split(" ");
+  return (Number(fields[11]) + Number(fields[12])) / CLOCK_TICKS;
+}
+
+async function startServer(port: number, audioDir: string, gatewaySocket: string) {
+  const child = spawn(
+    process.execPath,
+    [...process.execArgv, path.join(__dirname, "..", "server.ts")],
+    {
+      cwd: path.join(__dirname, ".."),
+      env: {
+        ...process.env,
+        PORT: String(port),
+        CLUSTER_WORKERS: "0",
+        AUDIO_ONLY: "1",
+        AUDIO_DIR: audioDir,
+        GATEWAY_SOCKET: gatewaySocket,
+        DASHSCOPE_API_KEY: "",
+      },
+      stdio: ["ignore", "ignore", "inherit"],
+    },
+  );
+  let exited = false;
+  child.once("exit", () => (exited = true));
+  for (let attempt = 0; attempt < 100; attempt++) {
+    if (exited) throw new Error("服务器启动失败");
+    await sleep(200);
+    try {
+      await fetch(`http://127.0.0.1:${port}/metrics`);
+      return child;
+    } catch {
+      // 尚未监听
+    }
+  }
+  child.kill("SIGKILL");
+  throw new Error("服务器启动超时");
+}
+
+function startGateway(port: number, socketPath: string) {
+  if (!existsSync(GATEWAY_BIN)) {
+    throw new Error(`未找到网关可执行文件 ${GATEWAY_BIN}，请先运行 make -C gateway`);
+  }
+  return spawn(
+    GATEWAY_BIN,
+    ["--port", String(port), "--host", "127.0.0.1", "--socket", socketPath],
+    { stdio: ["ignore", "ignore", "inherit"] },
+  );
+}
+
+async function stopProcess(child: ChildProcess) {
+  if (child.exitCode !== null) return;
+  const exited = new Promise((r) => child.once("exit", r));
+  child.kill("SIGTERM");
+  await exited;
+}
+
+async function scrape(port: number) {
+  const res = await fetch(`http://127.0.0.1:${port}/metrics`);
+  const families = parsePrometheusText(await res.text());
+  const total = (name: string) =>
+    (families.find((f) => f.name === name)?.samples ?? []).reduce((acc, s) => acc + s.value, 0);
+  const lag = families.find((f) => f.name === "nodejs_eventloop_lag_seconds");
+  const lagP99 = (lag?.samples ?? []).find((s) => s.labels.stat === "p99")?.value ?? 0;
+  return {
+    nodeFrames: total("audio_ingest_frames_total"),
+    gatewayFrames: total("gateway_frames_total"),
+    lagP99: lagP99 * 1000,
+  };
+}
+
+async function runOnce(opts: ReturnType<typeof parseArgs>, mode: Mode): Promise<RunResult> {
+  const workDir = mkdtempSync(path.join(os.tmpdir(), "bench-gateway-"));
+  const socketPath = mode === "gateway" ? path.join(workDir, "gateway.sock") : "";
+  const server = await startServer(opts.port, path.join(workDir, "audio"), socketPath);
+  const gateway = mode === "gateway" ? startGateway(opts.gatewayPort, socketPath) : null;
+  const url =
+    mode === "gateway"
+      ? `ws://127.0.0.1:${opts.gatewayPort}/api/audio`
+      : `ws://127.0.0.1:${opts.port}/api/audio`;
+  if (gateway) await sleep(500);
+
+  const deviceIds = Array.from({ length: opts.devices }, (_, i) =>
+    `BENCH${i.toString(16).padStart(6, "0").toUpperCase()}`,
+  );
+  const threads: Worker[] = [];
+  for (let t = 0; t < opts.threads; t++) {
+    threads.push(
+      new Worker(new URL(import.meta.url), {
+        execArgv: process.execArgv,
+        workerData: {
+          url,
+          deviceIds: deviceIds.filter((_, i) => i % opts.threads === t),
+          speed: opts.speed,
+          speech: opts.speech,
+        } satisfies LoadOptions,
+      }),
+    );
+  }
+
+  await sleep(opts.warmup * 1000);
+  const before = await scrape(opts.port);
+  const serverCpuBefore = cpuSeconds(server.pid!);
+  const gatewayCpuBefore = gateway ? cpuSeconds(gateway.pid!) : 0;
+  threads.forEach((t) => t.postMessage("reset"));
+  const startedAt = performance.now();
+  await sleep(opts.seconds * 1000);
+  const elapsed = (performance.now() - startedAt) / 1000;
+  const serverCpu = (cpuSeconds(server.pid!) - serverCpuBefore) / elapsed;
+  const gatewayCpu = gateway ? (cpuSeconds(gateway.pid!) - gatewayCpuBefore) / elapsed : 0;
+  // 网关统计每秒上报一次，多等一个周期再抓
+  if (gateway) await sleep(1100);
+  const after = await scrape(opts.port);
+
+  const reports = await Promise.all(
+    threads.map(
+      (t) =>
+        new Promise<LoadReport>((resolve) => {
+          t.once("message", resolve);
+          t.postMessage("stop");
+        }),
+    ),
+  );
+  await Promise.all(threads.map((t) => t.terminate()));
+  if (gateway) await stopProcess(gateway);
+  await stopProcess(server);
+  rmSync(workDir, { recursive: true, force: true });
+
+  const offered = reports.reduce((acc, r) => acc + r.sent + r.skipped, 0);
+  const nodeFrames = after.nodeFrames - before.nodeFrames;
+  const gatewayFrames = after.gatewayFrames - before.gatewayFrames;
+  const accepted = mode === "gateway" ? gatewayFrames : nodeFrames;
+  return {
+    mode,
+    devices: opts.devices,
+    seconds: Number(elapsed.toFixed(2)),
+    offeredPerSec: Math.round(offered / elapsed),
+    gatewayFramesPerSec: Math.round(gatewayFrames / elapsed),
+    nodeFramesPerSec: Math.round(nodeFrames / elapsed),
+    deliveryRatio: Number((offered ? Math.min(1, accepted / offered) : 0).toFixed(3)),
+    serverCpu: Number(serverCpu.toFixed(3)),
+    gatewayCpu: Number(gatewayCpu.toFixed(3)),
+    cpuPerKFrames: Number(
+      (accepted ? ((serverCpu + gatewayCpu) * elapsed * 1000) / accepted : 0).toFixed(4),
+    ),
+    lagP99Ms: Number(after.lagP99.toFixed(1)),
+  };
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  console.log(
+    `网关 ingest 对比: devices=${opts.devices} speed=${opts.speed}x speech=${opts.speech} seconds=${opts.seconds} threads=${opts.threads} cpus=${os.cpus().length}`,
+  );
+  const results: RunResult[] = [];
+  for (const mode of opts.modes) {
+    const result = await runOnce(opts, mode);
+    results.push(result);
+    console.log(
+      `${mode.padEnd(8)} 送达 ${(result.deliveryRatio * 100).toFixed(1).padStart(5)}%  ` +
+        `网关 ${String(result.gatewayFramesPerSec).padStart(7)} frames/s  ` +
+        `Node ${String(result.nodeFramesPerSec).padStart(7)} frames/s  ` +
+        `CPU server ${(result.serverCpu * 100).toFixed(1).padStart(5)}% gateway ${(result.gatewayCpu * 100).toFixed(1).padStart(5)}%  ` +
+        `${result.cpuPerKFrames} CPU·s/千帧  lag p99 ${result.lagP99Ms}ms`,
+    );
+  }
+  const report = {
+    date: new Date().toISOString(),
+    cpus: os.cpus().length,
+    frameBytes: FRAME_BYTES,
+    options: opts,
+    results,
+  };
+  if (opts.out) {
+    writeFileSync(opts.out, JSON.stringify(report, null, 2));
+    console.log(`结果已写入 ${opts.out}`);
+  }
+}
+
+if (isMainThread) {
+  main().catch((err) => {
+    console.error(err);
+    process.exit(1);
+  });
+} else {
+  runLoad(workerData as LoadOptions);
+}
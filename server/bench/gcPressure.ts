@@ -0,0 +1,201 @@
+/**
+ * 音频管线 GC 压力压测
+ * 在本进程内创建音频管线，用内存里的假连接模拟 N 台设备按实时节奏（每 50ms 一帧 v2）推流，
+ * 统计稳态窗口内的 GC 停顿与分配速率，以及帧池占用。
+ * 假连接不经过网络：每帧由压测分配一个新 Buffer 交给管线，与 ws 收到消息时一致；
+ * 播放端模拟一个订阅者，每帧持有到下一个 tick（相当于 socket 写完）。
+ * 未配置 DASHSCOPE_API_KEY，ASR 不连接，不发送音频。
+ *
+ * 分配速率由 v8.GCProfiler 的每次 GC 前后堆统计估算：
+ * 两次 GC 之间 used / external 的增长即为这段时间的分配量（external 包含 Buffer 的数据区）。
+ *
+ * 用法: npm run bench:gc -- --devices 100 --seconds 60
+ *   --devices  模拟设备数
+ *   --seconds  统计窗口（默认 60，覆盖一个完整的归档段）
+ *   --warmup   预热秒数
+ *   --out      结果 JSON 路径
+ */
+import { EventEmitter } from "events";
+import { mkdtempSync, rmSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+import v8 from "v8";
+
+// 在加载管线之前设置：ASR 不连接，归档写到临时目录
+process.env.DASHSCOPE_API_KEY = "";
+const audioDir = mkdtempSync(path.join(os.tmpdir(), "bench-gc-"));
+
+const SAMPLES_PER_FRAME = 800;
+const FRAME_MS = 50;
+const HEADER_BYTES = 8;
+
+interface HeapPoint {
+  used: number;
+  external: number;
+}
+
+interface GcStats {
+  gcCount: number;
+  pauseMs: number;
+  pauseMsPerSec: number;
+  maxPauseMs: number;
+  heapAllocMBps: number;
+  externalAllocMBps: number;
+}
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    devices: Number(args.get("devices") ?? 100),
+    seconds: Number(args.get("seconds") ?? 60),
+    warmup: Number(args.get("warmup") ?? 3),
+    out: args.get("out"),
+  };
+}
+
+const sleep = (ms: number) => new Promise((r) => setTimeout(r, ms));
+
+class FakeDeviceSocket extends EventEmitter {
+  readyState = 1;
+  send(_data: string) {}
+  close() {
+    this.readyState = 3;
+    this.emit("close");
+  }
+}
+
+// 一帧底噪 + 正弦，所有设备共用模板
+function makeTemplate(): Buffer {
+  const pcm = Buffer.alloc(SAMPLES_PER_FRAME * 2);
+  for (let i = 0; i < SAMPLES_PER_FRAME; i++) {
+    const sample = Math.sin((2 * Math.PI * 440 * i) / 16000) * 3000 + (Math.random() - 0.5) * 400;
+    pcm.writeInt16LE(Math.round(sample), i * 2);
+  }
+  return pcm;
+}
+
+function heapPoint(stats: { usedHeapSize: number; externalMemory: number }): HeapPoint {
+  return { used: stats.usedHeapSize, external: stats.externalMemory };
+}
+
+function currentHeap(): HeapPoint {
+  const stats = v8.getHeapStatistics();
+  return { used: stats.used_heap_size, external: stats.external_memory };
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const { createAudioPipeline } = await import("../lib/audioPipeline");
+  const { framePool } = await import("../lib/framePool");
+
+  const pipeline = createAudioPipeline({
+    audioDir,
+    output: {
+      audio: (_clientId, frame) => {
+        frame.retain();
+        setImmediate(() => frame.release());
+      },
+      data: () => {},
+    },
+  });
+
+  const sockets: FakeDeviceSocket[] = [];
+  for (let i = 0; i < opts.devices; i++) {
+    const ws = new FakeDeviceSocket();
+    const id = `GC${i.toString(16).padStart(6, "0")}`;
+    pipeline.handleAudioInput(ws, new URL(`http://localhost/api/audio?id=${id}&v=2`));
+    sockets.push(ws);
+  }
+
+  const template = makeTemplate();
+  let seq = 0;
+  let frames = 0;
+  const startedAt = Date.now();
+  const driver = setInterval(() => {
+    const deviceMs = Date.now() - startedAt;
+    for (const ws of sockets) {
+      const data = Buffer.allocUnsafe(HEADER_BYTES + template.length);
+      data.writeUInt32LE(seq, 0);
+      data.writeUInt32LE(deviceMs, 4);
+      template.copy(data, HEADER_BYTES);
+      ws.emit("message", data, true);
+      frames++;
+    }
+    seq++;
+  }, FRAME_MS);
+
+  console.log(`GC 压测: devices=${opts.devices} seconds=${opts.seconds} warmup=${opts.warmup}`);
+  await sleep(opts.warmup * 1000);
+
+  const profiler = new v8.GCProfiler();
+  const framesBefore = frames;
+  const start = currentHeap();
+  const t0 = performance.now();
+  profiler.start();
+  await sleep(opts.seconds * 1000);
+  const profile = profiler.stop();
+  const elapsed = (performance.now() - t0) / 1000;
+  const end = currentHeap();
+  const windowFrames = frames - framesBefore;
+
+  // 两次 GC 之间的增长累加即为分配量
+  let prev = start;
+  let heapAlloc = 0;
+  let externalAlloc = 0;
+  let pauseMs = 0;
+  let maxPauseMs = 0;
+  for (const entry of profile.statistics) {
+    const before = heapPoint(entry.beforeGC.heapStatistics);
+    heapAlloc += Math.max(0, before.used - prev.used);
+    externalAlloc += Math.max(0, before.external - prev.external);
+    prev = heapPoint(entry.afterGC.heapStatistics);
+    const ms = entry.cost / 1000;
+    pauseMs += ms;
+    maxPauseMs = Math.max(maxPauseMs, ms);
+  }
+  heapAlloc += Math.max(0, end.used - prev.used);
+  externalAlloc += Math.max(0, end.external - prev.external);
+
+  const gc: GcStats = {
+    gcCount: profile.statistics.length,
+    pauseMs: Number(pauseMs.toFixed(1)),
+    pauseMsPerSec: Number((pauseMs / elapsed).toFixed(2)),
+    maxPauseMs: Number(maxPauseMs.toFixed(2)),
+    heapAllocMBps: Number((heapAlloc / 1024 / 1024 / elapsed).toFixed(1)),
+    externalAllocMBps: Number((externalAlloc / 1024 / 1024 / elapsed).toFixed(1)),
+  };
+  const pool = framePool.stats;
+  const rssMb = Number((process.memoryUsage().rss / 1024 / 1024).toFixed(1));
+
+  clearInterval(driver);
+  for (const ws of sockets) ws.close();
+  rmSync(audioDir, { recursive: true, force: true });
+
+  console.log(
+    `帧 ${(windowFrames / elapsed).toFixed(0)}/s  GC ${gc.gcCount} 次  停顿 ${gc.pauseMs}ms (${gc.pauseMsPerSec}ms/s, 最长 ${gc.maxPauseMs}ms)  ` +
+      `分配 堆 ${gc.heapAllocMBps} MB/s + external ${gc.externalAllocMBps} MB/s  ` +
+      `帧池 ${pool.slabs} slab / ${pool.inUse} 帧在用  RSS ${rssMb} MB`,
+  );
+  const report = {
+    date: new Date().toISOString(),
+    options: opts,
+    framesPerSec: Number((windowFrames / elapsed).toFixed(1)),
+    gc,
+    pool,
+    rssMb,
+  };
+  if (opts.out) {
+    writeFileSync(opts.out, JSON.stringify(report, null, 2));
+    console.log(`结果已写入 ${opts.out}`);
+  }
+  process.exit(0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  rmSync(audioDir, { recursive: true, force: true });
+  process.exit(1);
+});
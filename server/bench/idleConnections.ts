@@ -0,0 +1,234 @@
+/**
+ * 空闲连接心跳压测
+ * 建立大量不发音频的设备连接，其中一部分为“僵尸”（不回 pong、不发数据，模拟半开 TCP），
+ * 分别在关闭 / 开启服务器侧心跳时测量：每连接内存、空闲时 CPU、ping 数量，以及僵尸被回收的时间。
+ *
+ * 用法: npm run bench:idle -- --connections 10000 --zombies 0.05 --interval 5000 --seconds 30
+ *   --connections  连接数
+ *   --zombies      僵尸连接比例
+ *   --interval     心跳间隔（毫秒）；判死时间为 2.5 倍
+ *   --seconds      稳态观察时长（需大于判死时间才能看到回收）
+ *   --modes        off,on
+ *   --out          结果 JSON 路径
+ */
+import { spawn } from "child_process";
+import { mkdtempSync, readFileSync, rmSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+import { fileURLToPath } from "url";
+import WebSocket from "ws";
+import { parsePrometheusText } from "../lib/metrics";
+
+const __filename = fileURLToPath(import.meta.url);
+const __dirname = path.dirname(__filename);
+
+const CLOCK_TICKS = 100;
+const CONNECT_BATCH = 250;
+
+type Mode = "off" | "on";
+
+interface RunResult {
+  mode: Mode;
+  connections: number;
+  zombies: number;
+  connected: number;
+  rssMbBefore: number;
+  rssMbAfter: number;
+  kbPerConnection: number;
+  heapKbPerConnection: number;
+  idleCpu: number; // 稳态窗口内服务器 CPU（1 = 一个核）
+  pings: number;
+  reaped: number;
+  zombiesClosed: number;
+  healthyClosed: number; // 应为 0：正常连接不应被误杀
+  reapSeconds: number | null; // 最后一个僵尸被回收距观察开始的时间
+  lagP99Ms: number;
+}
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    connections: Number(args.get("connections") ?? 10000),
+    zombies: Number(args.get("zombies") ?? 0.05),
+    interval: Number(args.get("interval") ?? 5000),
+    seconds: Number(args.get("seconds") ?? 30),
+    modes: (args.get("modes") ?? "off,on").split(",") as Mode[],
+    port: Number(args.get("port") ?? 3900),
+    out: args.get("out"),
+  };
+}
+
+const sleep = (ms: number) => new Promise((r) => setTimeout(r, ms));
+
+function cpuSeconds(pid: number): number {
+  const stat = readFileSync(`/proc/${pid}/stat`, "utf8");
+  const fields = stat.slice(stat.lastIndexOf(")") + 2).split(" ");
+  return (Number(fields[11]) + Number(fields[12])) / CLOCK_TICKS;
+}
+
+async function scrape(port: number) {
+  const res = await fetch(`http://127.0.0.1:${port}/metrics`);
+  const families = parsePrometheusText(await res.text());
+  const value = (name: string) =>
+    (families.find((f) => f.name === name)?.samples ?? []).reduce((acc, s) => acc + s.value, 0);
+  const lag = families.find((f) => f.name === "nodejs_eventloop_lag_seconds");
+  return {
+    rss: value("process_resident_memory_bytes"),
+    heap: value("nodejs_heap_used_bytes"),
+    pings: value("heartbeat_pings_total"),
+    reaped: value("heartbeat_reaped_total"),
+    lagP99: ((lag?.samples ?? []).find((s) => s.labels.stat === "p99")?.value ?? 0) * 1000,
+  };
+}
+
+async function startServer(port: number, audioDir: string, intervalMs: number) {
+  const child = spawn(
+    process.execPath,
+    [...process.execArgv, path.join(__dirname, "..", "server.ts")],
+    {
+      cwd: path.join(__dirname, ".."),
+      env: {
+        ...process.env,
+        PORT: String(port),
+        CLUSTER_WORKERS: "0",
+        AUDIO_ONLY: "1",
+        AUDIO_DIR: audioDir,
+        DASHSCOPE_API_KEY: "",
+        HEARTBEAT_INTERVAL_MS: String(intervalMs),
+        // 建连风暴时不要被准入控制拒绝
+        MAX_DEVICE_SESSIONS: "1000000",
+        ADMISSION_LAG_MS: "1000000",
+        ADMISSION_CPU: "1000000",
+      },
+      stdio: "ignore",
+    },
+  );
+  let exited = false;
+  child.once("exit", () => (exited = true));
+  for (let attempt = 0; attempt < 100; attempt++) {
+    if (exited) throw new Error("服务器启动失败");
+    await sleep(200);
+    try {
+      await fetch(`http://127.0.0.1:${port}/metrics`);
+      return child;
+    } catch {
+      // 尚未监听
+    }
+  }
+  child.kill("SIGKILL");
+  throw new Error("服务器启动超时");
+}
+
+async function runOnce(opts: ReturnType<typeof parseArgs>, mode: Mode): Promise<RunResult> {
+  const audioDir = mkdtempSync(path.join(os.tmpdir(), "bench-idle-"));
+  const server = await startServer(opts.port, audioDir, mode === "on" ? opts.interval : 0);
+  await sleep(1000);
+  const before = await scrape(opts.port);
+
+  const zombieCount = Math.round(opts.connections * opts.zombies);
+  const sockets: WebSocket[] = [];
+  let zombiesClosed = 0;
+  let healthyClosed = 0;
+  let lastZombieClosedAt = 0;
+  let observing = false;
+
+  for (let start = 0; start < opts.connections; start += CONNECT_BATCH) {
+    const batch: Promise<void>[] = [];
+    for (let i = start; i < Math.min(start + CONNECT_BATCH, opts.connections); i++) {
+      const zombie = i < zombieCount;
+      // 僵尸连接关闭自动 pong，且从不发送数据
+      const ws = new WebSocket(
+        `ws://127.0.0.1:${opts.port}/api/audio?id=IDLE${i.toString(16).padStart(6, "0")}&v=2`,
+        { autoPong: !zombie },
+      );
+      ws.on("error", () => {});
+      ws.on("close", () => {
+        if (!observing) return;
+        if (zombie) {
+          zombiesClosed++;
+          lastZombieClosedAt = performance.now();
+        } else {
+          healthyClosed++;
+        }
+      });
+      sockets.push(ws);
+      batch.push(
+        new Promise((resolve) => {
+          ws.once("open", () => resolve());
+          ws.once("error", () => resolve());
+        }),
+      );
+    }
+    await Promise.all(batch);
+  }
+  const connected = sockets.filter((ws) => ws.readyState === WebSocket.OPEN).length;
+
+  // 稳态：统计空闲 CPU 与回收
+  observing = true;
+  await sleep(1000);
+  const observeStart = performance.now();
+  const cpuBefore = cpuSeconds(server.pid!);
+  await sleep(opts.seconds * 1000);
+  const elapsed = (performance.now() - observeStart) / 1000;
+  const idleCpu = (cpuSeconds(server.pid!) - cpuBefore) / elapsed;
+  const after = await scrape(opts.port);
+
+  // 之后的 close 由压测自己断开引起，不计入
+  observing = false;
+  for (const ws of sockets) ws.terminate();
+  const exited = new Promise((r) => server.once("exit", r));
+  server.kill("SIGTERM");
+  await exited;
+  rmSync(audioDir, { recursive: true, force: true });
+
+  return {
+    mode,
+    connections: opts.connections,
+    zombies: zombieCount,
+    connected,
+    rssMbBefore: Number((before.rss / 1024 / 1024).toFixed(1)),
+    rssMbAfter: Number((after.rss / 1024 / 1024).toFixed(1)),
+    kbPerConnection: Number(((after.rss - before.rss) / 1024 / Math.max(connected, 1)).toFixed(2)),
+    heapKbPerConnection: Number(((after.heap - before.heap) / 1024 / Math.max(connected, 1)).toFixed(2)),
+    idleCpu: Number(idleCpu.toFixed(4)),
+    pings: after.pings,
+    reaped: after.reaped,
+    zombiesClosed,
+    healthyClosed,
+    reapSeconds:
+      zombiesClosed > 0 ? Number(((lastZombieClosedAt - observeStart) / 1000).toFixed(1)) : null,
+    lagP99Ms: Number(after.lagP99.toFixed(1)),
+  };
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  console.log(
+    `空闲连接压测: connections=${opts.connections} zombies=${opts.zombies} interval=${opts.interval}ms seconds=${opts.seconds}`,
+  );
+  const results: RunResult[] = [];
+  for (const mode of opts.modes) {
+    const result = await runOnce(opts, mode);
+    results.push(result);
+    console.log(
+      `心跳 ${mode.padEnd(3)}  已连接 ${result.connected}  RSS ${result.rssMbBefore} -> ${result.rssMbAfter} MB ` +
+        `(${result.kbPerConnection} KB/连接, 堆 ${result.heapKbPerConnection} KB)  ` +
+        `空闲 CPU ${(result.idleCpu * 100).toFixed(2)}%  ping ${result.pings}  ` +
+        `回收 ${result.reaped}/${result.zombies} 僵尸${result.reapSeconds === null ? "" : ` (${result.reapSeconds}s)`}  ` +
+        `误杀 ${result.healthyClosed}  lag p99 ${result.lagP99Ms}ms`,
+    );
+  }
+  const report = { date: new Date().toISOString(), cpus: os.cpus().length, options: opts, results };
+  if (opts.out) {
+    writeFileSync(opts.out, JSON.stringify(report, null, 2));
+    console.log(`结果已写入 ${opts.out}`);
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
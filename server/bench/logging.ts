@@ -0,0 +1,152 @@
+/**
+ * 日志开销压测
+ * 按固定速率在事件循环上产生日志（模拟 ASR 中间结果、段保存、HTTP 请求），
+ * 比较 console.log、结构化日志器（lib/logger.ts）与日志器关闭时的事件循环延迟与主线程 CPU。
+ * 每种模式在子进程中运行，stdout 接到本进程的管道上（与 systemd / docker 收集日志相同）；
+ * 消费端按 --drain-kbps 限速读取，模拟日志收集端跟不上的情况。
+ *
+ * 用法: npm run bench:log -- --rate 2000 --seconds 10
+ *   --rate        每秒日志条数
+ *   --seconds     每种模式的测量时长
+ *   --modes       console,logger,disabled
+ *   --drain-kbps  管道读取速率（0 = 不限速）
+ *   --out         结果 JSON 路径
+ */
+import { spawn } from "child_process";
+import { writeFileSync } from "fs";
+import { fileURLToPath } from "url";
+import { monitorEventLoopDelay } from "perf_hooks";
+
+const __filename = fileURLToPath(import.meta.url);
+
+type Mode = "console" | "logger" | "disabled";
+
+interface RunResult {
+  mode: Mode;
+  records: number;
+  lagP50Ms: number;
+  lagP99Ms: number;
+  lagMaxMs: number;
+  cpu: number; // 主线程 CPU（1 = 一个核）
+  bytesRead: number;
+}
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    rate: Number(args.get("rate") ?? 2000),
+    seconds: Number(args.get("seconds") ?? 10),
+    modes: (args.get("modes") ?? "console,logger,disabled").split(",") as Mode[],
+    drainKbps: Number(args.get("drain-kbps") ?? 0),
+    child: args.get("child") as Mode | undefined,
+    out: args.get("out"),
+  };
+}
+
+// ==================== 子进程：产生日志 ====================
+async function runChild(mode: Mode, rate: number, seconds: number) {
+  if (mode === "disabled") process.env.LOG_LEVEL = "silent";
+  process.env.LOG_FORMAT = "json";
+  const { logger } = await import("../lib/logger");
+  const log = logger.get("bench");
+
+  const histogram = monitorEventLoopDelay({ resolution: 1 });
+  const perTick = Math.max(1, Math.round(rate / 100));
+  let records = 0;
+  const text = "把客厅的灯打开";
+
+  histogram.enable();
+  const cpuStart = process.cpuUsage();
+  const startedAt = performance.now();
+  const timer = setInterval(() => {
+    for (let i = 0; i < perTick; i++) {
+      const client = `AABBCCDD${(i % 64).toString(16).padStart(4, "0")}`;
+      if (mode === "console") {
+        console.log(`[识别 ${client}] 📝 "${text}"`);
+      } else {
+        log.info("中间结果", { client, text, seq: records });
+      }
+      records++;
+    }
+  }, 10);
+
+  await new Promise((resolve) => setTimeout(resolve, seconds * 1000));
+  clearInterval(timer);
+  histogram.disable();
+  const cpu = process.cpuUsage(cpuStart);
+  const elapsed = performance.now() - startedAt;
+  process.stderr.write(
+    JSON.stringify({
+      records,
+      lagP50Ms: histogram.percentile(50) / 1e6,
+      lagP99Ms: histogram.percentile(99) / 1e6,
+      lagMaxMs: histogram.max / 1e6,
+      cpu: (cpu.user + cpu.system) / 1000 / elapsed,
+    }) + "\n",
+  );
+  process.exit(0);
+}
+
+// ==================== 父进程：限速消费 stdout ====================
+function runMode(mode: Mode, opts: ReturnType<typeof parseArgs>): Promise<RunResult> {
+  return new Promise((resolve, reject) => {
+    const child = spawn(
+      process.execPath,
+      [...process.execArgv, __filename, "--child", mode, "--rate", String(opts.rate), "--seconds", String(opts.seconds)],
+      { stdio: ["ignore", "pipe", "pipe"] },
+    );
+    let bytesRead = 0;
+    let stderr = "";
+    child.stdout.on("data", (chunk: Buffer) => {
+      bytesRead += chunk.length;
+      if (opts.drainKbps > 0) {
+        // 暂停读取，模拟慢消费者：管道写满后 console.log 阻塞，日志器只是积压
+        child.stdout.pause();
+        setTimeout(() => child.stdout.resume(), (chunk.length / 1024 / opts.drainKbps) * 1000);
+      }
+    });
+    child.stderr.on("data", (chunk: Buffer) => (stderr += chunk.toString()));
+    child.on("error", reject);
+    child.on("exit", (code) => {
+      const line = stderr.trim().split("\n").pop() ?? "";
+      try {
+        resolve({ mode, ...JSON.parse(line), bytesRead });
+      } catch {
+        reject(new Error(`${mode} 子进程退出 code=${code}: ${stderr}`));
+      }
+    });
+  });
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  if (opts.child) {
+    await runChild(opts.child, opts.rate, opts.seconds);
+    return;
+  }
+  console.log(
+    `日志压测: rate=${opts.rate}/s seconds=${opts.seconds} drain=${opts.drainKbps || "不限"} KB/s`,
+  );
+  const results: RunResult[] = [];
+  for (const mode of opts.modes) {
+    const result = await runMode(mode, opts);
+    results.push(result);
+    console.log(
+      `${mode.padEnd(8)} ${result.records} 条  延迟 p50 ${result.lagP50Ms.toFixed(2)}ms ` +
+        `p99 ${result.lagP99Ms.toFixed(2)}ms max ${result.lagMaxMs.toFixed(1)}ms  ` +
+        `CPU ${(result.cpu * 100).toFixed(1)}%  输出 ${(result.bytesRead / 1024).toFixed(0)} KB`,
+    );
+  }
+  if (opts.out) {
+    writeFileSync(opts.out, JSON.stringify({ date: new Date().toISOString(), options: opts, results }, null, 2));
+    console.log(`结果已写入 ${opts.out}`);
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
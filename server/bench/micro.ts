@@ -0,0 +1,503 @@
+/**
+ * 热路径微基准
+ * 在本进程内逐项测量服务器每帧 / 每条消息都要走的代码，结果写成 JSON，便于在提交之间对比：
+ *   ingest      handleAudioInput 收到一帧 v2 音频的处理（限流、解帧、复制进帧池、时钟映射、抖动统计、
+ *               播放输出、ASR 输出、追加到段）；ASR 为空实现，不含网络
+ *   quality     音频质量统计（AudioQualityTracker）每帧更新，帧池对齐与奇数偏移两条路径；5 秒句子的汇总
+ *   resample    窄带设备一帧 8 kHz -> 16 kHz 插值（接入时每帧都做）；16 kHz -> 8 kHz 抽取（固件同款，对照）
+ *   segment     一段 60 秒（1200 帧）的累积与释放：复制进帧池、追加引用、写盘后逐帧归还
+ *   wav         60 秒段写盘（writeWavSync / writeWav），临时目录
+ *   playback    PlaybackHub 音频 / JSON 扇出，1 / 10 / 100 个订阅者；订阅者为内存假连接，不含 socket 写
+ *   mixer       监听混音一块（50ms）：2 / 8 / 32 路各送入一帧并混音输出，WebAssembly SIMD 与标量实现对比
+ *   asr         DashScope result-generated 消息的 JSON 解析与取字段（中间结果 / 句末）
+ *   relay       固件关键字规则（relayIntent）与设备回执解析（parseDeviceAck）
+ *
+ * 每项先预热，再按 --batch-ms 校准每批次数，取 --samples 个批次的每次耗时中位数与 p95。
+ *
+ * 用法: npm run bench:micro
+ *   --filter     只跑名称匹配该正则的项
+ *   --samples    每项的批次数
+ *   --batch-ms   每批目标时长
+ *   --compare    上一次结果 JSON，逐项输出变化
+ *   --threshold  变慢超过该比例时标记（默认 0.1）
+ *   --out        结果 JSON 路径（默认 bench-results/micro-<提交>.json）
+ */
+import { spawnSync } from "child_process";
+import { EventEmitter } from "events";
+import { mkdirSync, mkdtempSync, readFileSync, rmSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+import type { AsrBackend } from "../lib/asrService";
+import type { PooledFrame } from "../lib/framePool";
+import type { PlaybackClient } from "../lib/playback";
+import type { AsrMessage } from "../lib/types";
+
+// 在加载管线之前设置：不限流、归档不转码、日志只留警告
+process.env.DEVICE_FRAME_RATE = "1000000000";
+process.env.DEVICE_BYTE_RATE = "1000000000000";
+// 同一毫秒内会灌入上千帧，桶容量也要放开，否则测到的是限流分支
+process.env.DEVICE_FRAME_BURST = "1000000000";
+process.env.DEVICE_BYTE_BURST = "1000000000000";
+process.env.ARCHIVE_CODEC = "wav";
+process.env.LOG_LEVEL = process.env.LOG_LEVEL || "warn";
+process.env.HEARTBEAT_INTERVAL_MS = "0";
+const tmpDir = mkdtempSync(path.join(os.tmpdir(), "bench-micro-"));
+
+const { createAudioPipeline } = await import("../lib/audioPipeline");
+const { framePool } = await import("../lib/framePool");
+const { AudioQualityTracker } = await import("../lib/audioQuality");
+const { HalfbandDecimator, HalfbandUpsampler } = await import("../lib/resample");
+const { PlaybackHub } = await import("../lib/playback");
+const { MIXER_CONFIG, MonitorMixer } = await import("../lib/mixer");
+const { writeWav, writeWavSync } = await import("../lib/wav");
+const { parseDeviceAck, relayIntent } = await import("../lib/relayCommand");
+
+const FRAME_MS = 50;
+const PCM_BYTES = (16000 * FRAME_MS * 2) / 1000;
+const HEADER_BYTES = 8;
+const SEGMENT_FRAMES = 60000 / FRAME_MS;
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    filter: args.get("filter"),
+    samples: Number(args.get("samples") ?? 15),
+    batchMs: Number(args.get("batch-ms") ?? 50),
+    compare: args.get("compare"),
+    threshold: Number(args.get("threshold") ?? 0.1),
+    out: args.get("out"),
+  };
+}
+
+// ==================== 计时 ====================
+interface Case {
+  name: string;
+  unit: string; // 一次操作指什么
+  // 执行 n 次操作；返回 Promise 的异步项按批等待
+  run: (n: number) => void | Promise<void>;
+  // 每批之后、不计时：回收状态
+  afterBatch?: () => void;
+  maxOps?: number; // 每批次数上限（如写盘）
+}
+
+interface CaseResult {
+  name: string;
+  unit: string;
+  nsPerOp: number; // 中位数
+  p95NsPerOp: number;
+  opsPerSec: number;
+  opsPerBatch: number;
+  samples: number;
+}
+
+async function measure(c: Case, opts: ReturnType<typeof parseArgs>): Promise<CaseResult> {
+  const timeBatch = async (n: number) => {
+    const t0 = process.hrtime.bigint();
+    const pending = c.run(n);
+    if (pending) await pending;
+    const elapsed = Number(process.hrtime.bigint() - t0);
+    c.afterBatch?.();
+    return elapsed;
+  };
+
+  // 校准：次数翻倍直到一批超过目标时长的 1/4，再按比例放大
+  let n = 1;
+  for (;;) {
+    const elapsed = await timeBatch(n);
+    if (elapsed >= (opts.batchMs * 1e6) / 4 || n >= (c.maxOps ?? Infinity)) {
+      n = Math.max(1, Math.min(c.maxOps ?? Infinity, Math.round((n * opts.batchMs * 1e6) / Math.max(elapsed, 1))));
+      break;
+    }
+    n *= 2;
+  }
+  // 预热一批：JIT 按校准后的次数稳定下来
+  await timeBatch(n);
+
+  const perOp: number[] = [];
+  for (let i = 0; i < opts.samples; i++) {
+    perOp.push((await timeBatch(n)) / n);
+  }
+  perOp.sort((a, b) => a - b);
+  const median = perOp[Math.floor(perOp.length / 2)];
+  return {
+    name: c.name,
+    unit: c.unit,
+    nsPerOp: Number(median.toFixed(1)),
+    p95NsPerOp: Number(perOp[Math.min(perOp.length - 1, Math.floor(perOp.length * 0.95))].toFixed(1)),
+    opsPerSec: Math.round(1e9 / median),
+    opsPerBatch: n,
+    samples: perOp.length,
+  };
+}
+
+function formatNs(ns: number): string {
+  if (ns >= 1e6) return `${(ns / 1e6).toFixed(2)} ms`;
+  if (ns >= 1e3) return `${(ns / 1e3).toFixed(2)} µs`;
+  return `${ns.toFixed(0)} ns`;
+}
+
+// ==================== 测量对象 ====================
+// 与 ws 的 WebSocket 接口一致的内存连接：emit("message") 即收到一帧
+class FakeDeviceSocket extends EventEmitter {
+  readyState = 1;
+  send() {}
+  close() {
+    if (this.readyState === 3) return;
+    this.readyState = 3;
+    this.emit("close", 1000, Buffer.alloc(0));
+  }
+}
+
+// 假订阅者：send 的回调先收起来，批末统一调用，相当于 socket 写完
+class FakeSubscriber implements PlaybackClient {
+  readyState = 1;
+  bufferedAmount = 0;
+  constructor(private readonly written: Array<() => void>) {}
+  send(_data: Buffer | string, cb?: (err?: Error) => void) {
+    if (cb) this.written.push(cb);
+  }
+}
+
+function speechPcm(): Buffer {
+  const pcm = Buffer.alloc(PCM_BYTES);
+  for (let i = 0; i < PCM_BYTES / 2; i++) {
+    pcm.writeInt16LE(Math.round(6000 * Math.sin((2 * Math.PI * 220 * i) / 16000)), i * 2);
+  }
+  return pcm;
+}
+
+function buildCases(): Case[] {
+  const pcm = speechPcm();
+  const cases: Case[] = [];
+  let sink = 0;
+
+  // ---- ingest ----
+  const nullAsr: AsrBackend = {
+    appendAudioChunk() {},
+    finish: async () => "idle",
+    destroy() {},
+  };
+  const pipeline = createAudioPipeline({
+    audioDir: path.join(tmpDir, "ingest"),
+    asrBackend: () => nullAsr,
+    output: { audio: () => {}, data: () => {} },
+  });
+  // 预先生成一段的帧：设备时间戳递增，与真实推流一致
+  const frames = Array.from({ length: SEGMENT_FRAMES }, (_, i) => {
+    const data = Buffer.allocUnsafe(HEADER_BYTES + PCM_BYTES);
+    data.writeUInt32LE(i, 0);
+    data.writeUInt32LE(i * FRAME_MS, 4);
+    pcm.copy(data, HEADER_BYTES);
+    return data;
+  });
+  let socket: FakeDeviceSocket | null = null;
+  let sent = 0;
+  const connect = () => {
+    socket = new FakeDeviceSocket();
+    pipeline.handleAudioInput(socket, new URL("http://localhost/api/audio?id=BENCH000001&v=2"));
+    sent = 0;
+  };
+  cases.push({
+    name: "ingest.frame",
+    unit: "帧",
+    run: (n) => {
+      if (!socket) connect();
+      for (let i = 0; i < n; i++) {
+        socket!.emit("message", frames[sent++ % SEGMENT_FRAMES], true);
+      }
+    },
+    // 累积超过一段就断开重连：段写盘与释放不计入每帧耗时
+    afterBatch: () => {
+      if (sent >= SEGMENT_FRAMES) {
+        socket!.close();
+        socket = null;
+      }
+    },
+  });
+
+  // ---- quality ----
+  // ingest.frame 已包含一次质量更新；这里单独测，便于看它占每帧耗时的多少
+  const aligned = framePool.copyOf(pcm);
+  const oddBytes = Buffer.allocUnsafe(PCM_BYTES + 1);
+  pcm.copy(oddBytes, 1);
+  const unaligned = oddBytes.subarray(1);
+  for (const [name, frame] of [
+    ["quality.frame", aligned.pcm],
+    ["quality.frameUnaligned", unaligned],
+  ] as const) {
+    const tracker = new AudioQualityTracker();
+    let seq = 0;
+    cases.push({
+      name,
+      unit: "帧",
+      run: (n) => {
+        for (let i = 0; i < n; i++, seq++) sink += tracker.push(frame, seq, seq * FRAME_MS);
+      },
+    });
+  }
+  const summarized = new AudioQualityTracker();
+  for (let i = 0; i < SEGMENT_FRAMES / 2; i++) summarized.push(pcm, i, i * FRAME_MS);
+  const sentenceEnd = (SEGMENT_FRAMES / 2) * FRAME_MS;
+  cases.push({
+    name: "quality.summarize5s",
+    unit: "句",
+    run: (n) => {
+      for (let i = 0; i < n; i++) sink += summarized.summarize(sentenceEnd - 5000, sentenceEnd)?.frames ?? 0;
+    },
+  });
+
+  // ---- resample ----
+  const upsampler = new HalfbandUpsampler();
+  const narrowPcm = pcm.subarray(0, PCM_BYTES / 2);
+  const upsampled = Buffer.alloc(PCM_BYTES);
+  cases.push({
+    name: "resample.upsample",
+    unit: "帧",
+    run: (n) => {
+      for (let i = 0; i < n; i++) upsampler.process(narrowPcm, upsampled);
+    },
+  });
+  const decimator = new HalfbandDecimator();
+  const wideSamples = new Int16Array(pcm.buffer, pcm.byteOffset, PCM_BYTES / 2);
+  const decimated = new Int16Array(PCM_BYTES / 4);
+  cases.push({
+    name: "resample.decimate",
+    unit: "帧",
+    run: (n) => {
+      for (let i = 0; i < n; i++) sink += decimator.process(wideSamples, decimated);
+    },
+  });
+
+  // ---- segment ----
+  const segment: { frames: PooledFrame[]; bytes: number } = { frames: [], bytes: 0 };
+  cases.push({
+    name: "segment.accumulate60s",
+    unit: "段",
+    run: (n) => {
+      for (let s = 0; s < n; s++) {
+        for (let i = 0; i < SEGMENT_FRAMES; i++) {
+          const frame = framePool.copyOf(pcm);
+          segment.frames.push(frame);
+          segment.bytes += frame.length;
+        }
+        for (const frame of segment.frames) frame.release();
+        segment.frames.length = 0;
+        segment.bytes = 0;
+      }
+    },
+  });
+
+  // ---- wav ----
+  const chunks = Array.from({ length: SEGMENT_FRAMES }, () => pcm);
+  const wavDir = path.join(tmpDir, "wav");
+  mkdirSync(wavDir, { recursive: true });
+  let wavIndex = 0;
+  cases.push({
+    name: "wav.writeSync60s",
+    unit: "段",
+    maxOps: 20,
+    run: (n) => {
+      for (let i = 0; i < n; i++) writeWavSync(path.join(wavDir, `sync${wavIndex++ % 4}.wav`), chunks);
+    },
+  });
+  cases.push({
+    name: "wav.writeAsync60s",
+    unit: "段",
+    maxOps: 20,
+    run: async (n) => {
+      for (let i = 0; i < n; i++) await writeWav(path.join(wavDir, `async${wavIndex++ % 4}.wav`), chunks);
+    },
+  });
+
+  // ---- playback ----
+  for (const subscribers of [1, 10, 100]) {
+    const written: Array<() => void> = [];
+    const hub = new PlaybackHub<FakeSubscriber>();
+    for (let i = 0; i < subscribers; i++) hub.add(new FakeSubscriber(written));
+    const flush = () => {
+      for (const cb of written) cb();
+      written.length = 0;
+    };
+    cases.push({
+      name: `playback.audio.${subscribers}`,
+      unit: "帧",
+      run: (n) => {
+        for (let i = 0; i < n; i++) {
+          // 与管线相同：帧属于段（这里立即释放），每个订阅者 retain 到写完
+          const frame = framePool.copyOf(pcm);
+          hub.broadcastAudio("BENCH000001", frame.pcm, frame);
+          frame.release();
+          if (written.length >= 4096) flush();
+        }
+        flush();
+      },
+    });
+    const result = {
+      type: "asr_result",
+      text: "把客厅的灯打开",
+      isEnd: true,
+      clientId: "AABBCCDDEEFF",
+      room: "living",
+    };
+    cases.push({
+      name: `playback.data.${subscribers}`,
+      unit: "条",
+      run: (n) => {
+        for (let i = 0; i < n; i++) hub.broadcastData(result);
+      },
+    });
+  }
+
+  // ---- mixer ----
+  for (const inputs of [2, 8, 32]) {
+    for (const simd of [true, false]) {
+      const devices = Array.from({ length: inputs }, (_, i) => `BENCH${String(i).padStart(6, "0")}`);
+      const mixer = new MonitorMixer({
+        monitor: "bench",
+        devices,
+        output: (frame) => {
+          sink += frame.pcm.length;
+        },
+        simd,
+      });
+      if (mixer.simd !== simd) continue; // 运行时不支持 SIMD
+      let capturedAt = 0;
+      cases.push({
+        name: `mixer.block.${inputs}.${simd ? "simd" : "scalar"}`,
+        unit: "块",
+        run: (n) => {
+          for (let i = 0; i < n; i++) {
+            // 各路同一采集时刻的一帧，now 恰好让这一块到期
+            const now = capturedAt + MIXER_CONFIG.delayMs + FRAME_MS;
+            for (const device of devices) mixer.push(device, pcm, capturedAt, now);
+            capturedAt += FRAME_MS;
+          }
+        },
+      });
+    }
+  }
+
+  // ---- asr ----
+  const message = (text: string, end: boolean) =>
+    JSON.stringify({
+      header: { task_id: "0f8e7d6c5b4a39281706f5e4d3c2b1a0", event: "result-generated", attributes: {} },
+      payload: {
+        output: {
+          sentence: {
+            begin_time: 170,
+            end_time: end ? 1920 : null,
+            text,
+            sentence_end: end,
+            words: text.split("").map((word, i) => ({
+              begin_time: 170 + i * 250,
+              end_time: 420 + i * 250,
+              text: word,
+              punctuation: "",
+            })),
+          },
+        },
+        usage: end ? { duration: 2 } : null,
+      },
+    });
+  const partial = message("把客厅的", false);
+  const final = message("把客厅的灯打开。", true);
+  for (const [name, raw] of [
+    ["asr.parse.partial", partial],
+    ["asr.parse.final", final],
+  ] as const) {
+    cases.push({
+      name,
+      unit: "条",
+      run: (n) => {
+        for (let i = 0; i < n; i++) {
+          const parsed: AsrMessage = JSON.parse(raw);
+          const sentence = parsed.payload?.output?.sentence;
+          if (parsed.header.event === "result-generated" && sentence) sink += sentence.text.length;
+        }
+      },
+    });
+  }
+
+  // ---- relay ----
+  const texts = ["打开客厅的灯", "关灯", "turn on the light", "现在几点了，明天早上七点叫我起床", "OFF"];
+  cases.push({
+    name: "relay.intent",
+    unit: "句",
+    run: (n) => {
+      for (let i = 0; i < n; i++) sink += relayIntent(texts[i % texts.length]) ?? 2;
+    },
+  });
+  const acks = ['{"type":"ack","id":1234,"relay":1}', "turn on", "#12 开灯"];
+  cases.push({
+    name: "relay.parseAck",
+    unit: "条",
+    run: (n) => {
+      for (let i = 0; i < n; i++) sink += parseDeviceAck(acks[i % acks.length])?.id ?? 0;
+    },
+  });
+  // 防止结果被优化掉
+  process.on("exit", () => {
+    if (sink === -1) console.log(sink);
+  });
+
+  return cases;
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const rev = spawnSync("git", ["rev-parse", "--short", "HEAD"], { encoding: "utf8" }).stdout?.trim() || "unknown";
+  const previous = opts.compare ? JSON.parse(readFileSync(opts.compare, "utf8")) : null;
+  const filter = opts.filter ? new RegExp(opts.filter) : null;
+  console.log(`热路径微基准: 提交 ${rev}, node ${process.version}, ${os.cpus()[0]?.model ?? "unknown cpu"}`);
+
+  const results: CaseResult[] = [];
+  try {
+    for (const c of buildCases()) {
+      if (filter && !filter.test(c.name)) continue;
+      const result = await measure(c, opts);
+      results.push(result);
+      const before = previous?.results.find((r: CaseResult) => r.name === c.name) as CaseResult | undefined;
+      let delta = "";
+      if (before) {
+        const change = result.nsPerOp / before.nsPerOp - 1;
+        const mark = change > opts.threshold ? " ⚠️" : change < -opts.threshold ? " ✅" : "";
+        delta = `  ${change >= 0 ? "+" : ""}${(change * 100).toFixed(1)}% (之前 ${formatNs(before.nsPerOp)})${mark}`;
+      }
+      console.log(
+        `${c.name.padEnd(24)} ${formatNs(result.nsPerOp).padStart(10)}/${result.unit}  ` +
+          `p95 ${formatNs(result.p95NsPerOp).padStart(10)}  ${result.opsPerSec.toLocaleString()} 次/s${delta}`,
+      );
+    }
+  } finally {
+    rmSync(tmpDir, { recursive: true, force: true });
+  }
+
+  const out = opts.out ?? path.join("bench-results", `micro-${rev}.json`);
+  mkdirSync(path.dirname(out), { recursive: true });
+  writeFileSync(
+    out,
+    JSON.stringify(
+      {
+        date: new Date().toISOString(),
+        rev,
+        node: process.version,
+        cpu: os.cpus()[0]?.model ?? null,
+        options: opts,
+        results,
+      },
+      null,
+      2,
+    ),
+  );
+  console.log(`结果已写入 ${out}`);
+  // 管线的定时器与转码线程不再需要
+  process.exit(0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,514 @@
+/**
+ * 归档音频回放
+ * 把 saveAudioFile 写出的分段（audio_<id>_seg<N>_<time>.wav/.flac/.opus）或语料目录中的 WAV
+ * 按 1× 或 N× 速度切成 50ms 的 v2 帧，经 handleAudioInput 注入本进程内的管线，
+ * 与真实设备走同一条路径：限流 -> 解帧 -> VAD / 房间仲裁 -> ASR 后端 -> 识别结果 -> 继电器指令 -> 回执。
+ * 输出每条下发的指令（文件内位置、墙钟时间、语音结束到下发的延迟、开关意图）与吞吐（音频秒 / 墙钟秒）。
+ *
+ * ASR 后端：
+ *   scripted   离线：能量 VAD 切句，每句按顺序取同名 .txt 中的一行作为识别结果（没有 .txt 时只统计句数）；
+ *              用来回归测试切句、指令下发与延迟，不依赖网络
+ *   dashscope  真实识别（需要 DASHSCOPE_API_KEY）；服务端按实时处理，高倍速下延迟不代表线上
+ * 语料目录中 <name>.txt 每行一句期望文本，按固件的关键字规则（relayIntent）与实际下发的指令逐句比对，得出意图准确率；
+ * 另把识别出的整段文字与期望文本比对，得出字错误率（CER，去掉空白与标点后的编辑距离 / 期望字数）。
+ *
+ * 窄带（--band narrow）：按窄带固件的方式用同一组半带系数抽取到 8 kHz 上行（?sr=8000），服务器插值回 16 kHz。
+ * 同一语料分别以 wide / narrow 跑 dashscope 后端，对比上行字节 / 音频秒与 CER，即窄带省下的带宽与识别准确率的代价。
+ *
+ * 用法: npm run bench:replay -- --input public/audio --speed 10
+ *   --input     文件或目录，逗号分隔
+ *   --speed     回放倍速（0 = 不限速）
+ *   --backend   scripted | dashscope（默认有 DASHSCOPE_API_KEY 时用 dashscope）
+ *   --devices   同时回放的文件数
+ *   --room      所有回放设备加入同一房间（测试仲裁；仲裁按墙钟对齐，固定 1× 回放）
+ *   --band      wide | narrow（默认 wide）
+ *   --tail-ms   文件末尾补的静音，让 VAD 收尾
+ *   --settle-ms 注入结束后等待识别结果的墙钟时间
+ *   --out       结果 JSON 路径
+ */
+import { EventEmitter } from "events";
+import { spawnSync } from "child_process";
+import { existsSync, mkdtempSync, readdirSync, readFileSync, rmSync, statSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+import { fileURLToPath } from "url";
+
+// 在加载管线之前设置：回放速度远超设备限速；归档写到临时目录且不转码
+process.env.DEVICE_FRAME_RATE = "1000000000";
+process.env.DEVICE_BYTE_RATE = "1000000000000";
+process.env.ARCHIVE_CODEC = process.env.ARCHIVE_CODEC || "wav";
+process.env.LOG_LEVEL = process.env.LOG_LEVEL || "warn";
+const audioDir = mkdtempSync(path.join(os.tmpdir(), "replay-"));
+
+const SAMPLE_RATE = 16000;
+const FRAME_MS = 50;
+const SAMPLES_PER_FRAME = (SAMPLE_RATE * FRAME_MS) / 1000;
+const HEADER_BYTES = 8;
+const DEFAULT_INPUT = path.join(path.dirname(fileURLToPath(import.meta.url)), "..", "public", "audio");
+
+const { createAudioPipeline } = await import("../lib/audioPipeline");
+const { createDashscopeAsr } = await import("../lib/asrService");
+const { relayIntent } = await import("../lib/relayCommand");
+const { DEFAULT_VAD_CONFIG, EnergyVad } = await import("../lib/vad");
+const { parseWav } = await import("../lib/wav");
+const { decodeFlac } = await import("../lib/flac");
+const { parseArchiveName } = await import("../lib/retention");
+const { setTranscriptForwarder } = await import("../lib/transcripts");
+const { ARCHIVE_CONFIG } = await import("../lib/archiveCompressor");
+const { HalfbandDecimator } = await import("../lib/resample");
+type AsrBackend = import("../lib/asrService").AsrBackend;
+type AsrBackendFactory = import("../lib/asrService").AsrBackendFactory;
+type AsrCallbacks = import("../lib/asrService").AsrCallbacks;
+type PooledFrame = import("../lib/framePool").PooledFrame;
+type AudioTiming = import("../lib/types").AudioTiming;
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  const backend = (args.get("backend") ?? (process.env.DASHSCOPE_API_KEY ? "dashscope" : "scripted")) as
+    | "scripted"
+    | "dashscope";
+  return {
+    input: (args.get("input") ?? DEFAULT_INPUT).split(",").filter(Boolean),
+    speed: Number(args.get("speed") ?? 10),
+    backend,
+    devices: Number(args.get("devices") ?? 4),
+    room: args.get("room"),
+    band: args.get("band") === "narrow" ? ("narrow" as const) : ("wide" as const),
+    tailMs: Number(args.get("tail-ms") ?? 1000),
+    settleMs: Number(args.get("settle-ms") ?? (backend === "dashscope" ? 3000 : 100)),
+    // 真实后端建连、启动任务之前的音频会被丢弃
+    warmupMs: Number(args.get("warmup-ms") ?? (backend === "dashscope" ? 1500 : 0)),
+    out: args.get("out"),
+  };
+}
+
+const sleep = (ms: number) => new Promise((r) => setTimeout(r, ms));
+
+// ==================== 语料 ====================
+interface ReplayFile {
+  filePath: string;
+  deviceId: string;
+  samples: Int16Array;
+  expected: string[] | null; // 同名 .txt，每行一句
+}
+
+function listInputs(inputs: string[]): string[] {
+  const files: string[] = [];
+  for (const input of inputs) {
+    if (statSync(input).isDirectory()) {
+      for (const name of readdirSync(input).sort()) {
+        if (/\.(wav|flac|opus)$/i.test(name)) files.push(path.join(input, name));
+      }
+    } else {
+      files.push(input);
+    }
+  }
+  return files;
+}
+
+function decodeAudio(filePath: string): Int16Array {
+  const ext = path.extname(filePath).toLowerCase();
+  if (ext === ".flac") {
+    const flac = decodeFlac(readFileSync(filePath));
+    if (flac.sampleRate !== SAMPLE_RATE) throw new Error(`采样率 ${flac.sampleRate}，需要 ${SAMPLE_RATE}`);
+    return flac.samples;
+  }
+  if (ext === ".opus") {
+    const decoded = spawnSync(
+      ARCHIVE_CONFIG.ffmpeg,
+      ["-v", "error", "-i", filePath, "-f", "s16le", "-ac", "1", "-ar", String(SAMPLE_RATE), "-"],
+      { stdio: ["ignore", "pipe", "pipe"], maxBuffer: 1024 * 1024 * 1024 },
+    );
+    if (decoded.status !== 0) throw new Error(`ffmpeg 解码失败: ${decoded.stderr?.toString().trim()}`);
+    const pcm = Buffer.from(decoded.stdout);
+    return new Int16Array(pcm.buffer, pcm.byteOffset, pcm.length >> 1);
+  }
+  const wav = parseWav(readFileSync(filePath));
+  if (wav.sampleRate !== SAMPLE_RATE || wav.channels !== 1 || wav.bitsPerSample !== 16) {
+    throw new Error(`需要 ${SAMPLE_RATE}Hz 单声道 16 位，实际 ${wav.sampleRate}Hz ${wav.channels} 声道 ${wav.bitsPerSample} 位`);
+  }
+  return wav.samples;
+}
+
+function loadFile(filePath: string): ReplayFile {
+  const base = path.basename(filePath);
+  const stem = base.replace(/\.[^.]+$/, "");
+  // 归档分段沿用原设备 ID；其他文件以文件名作为设备 ID（与 ?id= 的校验规则一致）
+  const deviceId = parseArchiveName(base)?.device ?? (stem.replace(/[^\w.-]/g, "_").slice(0, 64) || "replay");
+  const textPath = path.join(path.dirname(filePath), `${stem}.txt`);
+  const expected = existsSync(textPath)
+    ? readFileSync(textPath, "utf8")
+        .split("\n")
+        .map((line) => line.trim())
+        .filter(Boolean)
+    : null;
+  return { filePath, deviceId, samples: decodeAudio(filePath), expected };
+}
+
+// ==================== 离线 ASR 后端 ====================
+// 能量 VAD 切句（与房间仲裁、原生网关同一套参数），句末按顺序给出脚本中的文本
+class ScriptedAsr implements AsrBackend {
+  private readonly vad = new EnergyVad(DEFAULT_VAD_CONFIG);
+  private audioMs = 0; // 已收到的音频（任务内偏移）
+  private speaking = false;
+  private beginMs = 0;
+  private beginTiming: AudioTiming | null = null;
+  // 最近的块时间点，句子起止回溯 attack / hangover 用
+  private readonly history: Array<{ offsetMs: number; timing: AudioTiming }> = [];
+  private readonly historyMs = DEFAULT_VAD_CONFIG.attackMs + DEFAULT_VAD_CONFIG.hangoverMs + FRAME_MS;
+  private destroyed = false;
+  utterances = 0;
+
+  constructor(
+    private readonly callbacks: AsrCallbacks,
+    private readonly script: string[],
+  ) {}
+
+  appendAudioChunk(frame: PooledFrame, capturedAt?: number, receivedAt?: number): void {
+    if (this.destroyed) return;
+    const now = Date.now();
+    const timing = { capturedAt: capturedAt ?? now, receivedAt: receivedAt ?? now, sentAt: now };
+    const frameMs = (frame.length / 2 / SAMPLE_RATE) * 1000;
+    this.history.push({ offsetMs: this.audioMs, timing });
+    while (this.history.length > 1 && this.audioMs - this.history[0].offsetMs > this.historyMs) {
+      this.history.shift();
+    }
+    const vad = this.vad.push(frame.pcm);
+    this.audioMs += frameMs;
+    if (vad.onset) {
+      this.speaking = true;
+      this.beginMs = Math.max(0, this.audioMs - DEFAULT_VAD_CONFIG.attackMs);
+      this.beginTiming = this.timingAt(this.beginMs);
+    } else if (this.speaking && !vad.speaking) {
+      this.emit(Math.max(this.beginMs, this.audioMs - DEFAULT_VAD_CONFIG.hangoverMs));
+    }
+  }
+
+  finish(): Promise<"finished" | "idle"> {
+    const active = this.speaking;
+    if (active) this.emit(this.audioMs);
+    this.destroy();
+    return Promise.resolve(active ? "finished" : "idle");
+  }
+
+  destroy(): void {
+    this.destroyed = true;
+  }
+
+  private emit(endMs: number) {
+    this.speaking = false;
+    this.utterances++;
+    const text = this.script.shift();
+    if (!text) return;
+    this.callbacks.onResult(text, true, {
+      beginTime: this.beginMs,
+      endTime: endMs,
+      firstPartial: true,
+      speechStart: this.beginTiming,
+      speechEnd: this.timingAt(endMs),
+    });
+  }
+
+  private timingAt(offsetMs: number): AudioTiming | null {
+    for (let i = this.history.length - 1; i >= 0; i--) {
+      const entry = this.history[i];
+      if (entry.offsetMs <= offsetMs) {
+        return { ...entry.timing, capturedAt: entry.timing.capturedAt + (offsetMs - entry.offsetMs) };
+      }
+    }
+    return this.history[0]?.timing ?? null;
+  }
+}
+
+// ==================== 字错误率 ====================
+// 去掉空白与标点，英文不分大小写；中文按字、英文按字母计
+function normalizeText(text: string): string[] {
+  return [...text.toLowerCase().replace(/[\s\p{P}\p{S}]/gu, "")];
+}
+
+function editDistance(a: string[], b: string[]): number {
+  let prev = Array.from({ length: b.length + 1 }, (_, j) => j);
+  for (let i = 1; i <= a.length; i++) {
+    const row = [i];
+    for (let j = 1; j <= b.length; j++) {
+      row[j] = Math.min(prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (a[i - 1] === b[j - 1] ? 0 : 1));
+    }
+    prev = row;
+  }
+  return prev[b.length];
+}
+
+// ==================== 回放会话 ====================
+interface FiredCommand {
+  id: number;
+  text: string;
+  intent: 0 | 1 | null;
+  audioMs: number; // 下发时已注入到文件的位置
+  wallMs: number; // 距本文件开始回放
+  latencyMs: number | null; // 句末音频送入 ASR -> 指令下发（墙钟）
+}
+
+interface ReplaySession {
+  lastSpeechEndSentAt: number | null;
+  scripted: ScriptedAsr | null;
+  script: string[]; // scripted 后端待给出的文本
+}
+
+interface FileReport {
+  file: string;
+  deviceId: string;
+  audioSeconds: number;
+  wallSeconds: number;
+  utterances: number | null; // scripted 后端 VAD 切出的句数
+  commands: FiredCommand[];
+  expected: Array<0 | 1 | null> | null;
+  intentCorrect: number | null;
+  uplinkBytes: number; // 注入的帧（含 8 字节帧头），不含 WebSocket 帧头
+  recognized: string[]; // 句末识别结果
+  charErrors: number | null; // 与期望文本的编辑距离
+  expectedChars: number | null;
+}
+
+// 模拟固件：记录下发的指令，按 relayIntent 回执
+class ReplaySocket extends EventEmitter {
+  readyState = 1;
+  constructor(private readonly onCommand: (id: number, text: string) => void) {
+    super();
+  }
+  send(data: string) {
+    const match = /^#(\d+) ([\s\S]*)$/.exec(data);
+    if (!match) return;
+    const id = Number(match[1]);
+    this.onCommand(id, match[2]);
+    const relay = relayIntent(match[2]);
+    if (relay === null) return;
+    setImmediate(() => {
+      if (this.readyState === 1) this.emit("message", Buffer.from(JSON.stringify({ type: "ack", id, relay })), false);
+    });
+  }
+  close() {
+    if (this.readyState === 3) return;
+    this.readyState = 3;
+    this.emit("close");
+  }
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  if (opts.room && opts.speed !== 1) {
+    // 房间仲裁按墙钟推进对齐队列（采集时间早于 now - delayMs 才送出），超过实时的帧会积压后被丢弃
+    console.log(`房间模式只能按 1× 回放（仲裁按墙钟对齐），忽略 --speed ${opts.speed}`);
+    opts.speed = 1;
+  }
+  const paths = listInputs(opts.input);
+  if (paths.length === 0) {
+    console.error(`没有可回放的文件: ${opts.input.join(", ")}`);
+    process.exit(1);
+  }
+  console.log(
+    `回放: ${paths.length} 个文件, speed=${opts.speed || "不限"}×, backend=${opts.backend}, 并发 ${opts.devices}, band=${opts.band}` +
+      (opts.room ? `, room=${opts.room}` : ""),
+  );
+
+  // handleAudioInput 内同步创建 ASR（房间模式下由第一个成员创建），创建时取当前正在接入的会话
+  let connecting: ReplaySession | null = null;
+  const backend: AsrBackendFactory = (callbacks, clientId) => {
+    const session = connecting!;
+    const wrapped: AsrCallbacks = {
+      ...callbacks,
+      onResult: (text, isEnd, info) => {
+        // 记录句末音频送入 ASR 的时间，指令下发时计算延迟
+        if (isEnd) session.lastSpeechEndSentAt = info.speechEnd?.sentAt ?? null;
+        callbacks.onResult(text, isEnd, info);
+      },
+    };
+    if (opts.backend === "dashscope") return createDashscopeAsr(wrapped, clientId);
+    session.scripted = new ScriptedAsr(wrapped, session.script);
+    return session.scripted;
+  };
+
+  // 句末识别结果按设备收集，算字错误率
+  const recognized = new Map<string, string[]>();
+  setTranscriptForwarder((entry) => recognized.get(entry.device)?.push(entry.text));
+  const pipeline = createAudioPipeline({
+    audioDir,
+    asrBackend: backend,
+    output: { audio: () => {}, data: () => {} },
+  });
+
+  async function replay(file: ReplayFile): Promise<FileReport> {
+    const commands: FiredCommand[] = [];
+    const tailFrames = Math.ceil(opts.tailMs / FRAME_MS);
+    const totalFrames = Math.ceil(file.samples.length / SAMPLES_PER_FRAME) + tailFrames;
+    let sent = 0;
+    const startedAt = performance.now();
+    const session: ReplaySession = {
+      lastSpeechEndSentAt: null,
+      scripted: null,
+      script: [...(file.expected ?? [])],
+    };
+
+    const ws = new ReplaySocket((id, text) => {
+      const now = Date.now();
+      commands.push({
+        id,
+        text,
+        intent: relayIntent(text),
+        audioMs: Math.min(sent * FRAME_MS, (file.samples.length / SAMPLE_RATE) * 1000),
+        wallMs: Math.round(performance.now() - startedAt),
+        latencyMs: session.lastSpeechEndSentAt !== null ? now - session.lastSpeechEndSentAt : null,
+      });
+    });
+    const query = new URLSearchParams({ id: file.deviceId, v: "2" });
+    if (opts.room) query.set("room", opts.room);
+    if (opts.band === "narrow") query.set("sr", "8000");
+    const texts: string[] = [];
+    recognized.set(file.deviceId, texts);
+    const decimator = opts.band === "narrow" ? new HalfbandDecimator() : null;
+    const narrow = new Int16Array(SAMPLES_PER_FRAME);
+    let uplinkBytes = 0;
+    connecting = session;
+    pipeline.handleAudioInput(ws, new URL(`http://localhost/api/audio?${query}`));
+    connecting = null;
+    if (opts.warmupMs > 0) await sleep(opts.warmupMs);
+
+    const pcm = Buffer.from(file.samples.buffer, file.samples.byteOffset, file.samples.byteLength);
+    const playStart = performance.now();
+    while (sent < totalFrames) {
+      // 按绝对时间补发：定时器抖动不会累积成整体变慢
+      const due = opts.speed > 0 ? Math.floor(((performance.now() - playStart) * opts.speed) / FRAME_MS) + 1 : sent + 20;
+      for (; sent < Math.min(due, totalFrames); sent++) {
+        const data = Buffer.alloc(HEADER_BYTES + SAMPLES_PER_FRAME * 2); // 末帧与补的静音为 0
+        data.writeUInt32LE(sent, 0);
+        data.writeUInt32LE(sent * FRAME_MS, 4);
+        const from = sent * SAMPLES_PER_FRAME * 2;
+        if (from < pcm.length) pcm.copy(data, HEADER_BYTES, from, Math.min(from + SAMPLES_PER_FRAME * 2, pcm.length));
+        let frame = data;
+        if (decimator) {
+          // 与窄带固件相同：每帧 800 个样本抽取成 400 个
+          const wide = new Int16Array(data.buffer, data.byteOffset + HEADER_BYTES, SAMPLES_PER_FRAME);
+          const count = decimator.process(wide, narrow);
+          frame = Buffer.alloc(HEADER_BYTES + count * 2);
+          data.copy(frame, 0, 0, HEADER_BYTES);
+          Buffer.from(narrow.buffer, 0, count * 2).copy(frame, HEADER_BYTES);
+        }
+        uplinkBytes += frame.length;
+        ws.emit("message", frame, true);
+      }
+      if (opts.speed > 0) await sleep(Math.max(1, FRAME_MS / opts.speed));
+      else await new Promise((resolve) => setImmediate(resolve));
+    }
+    await sleep(opts.settleMs);
+    const wallSeconds = (performance.now() - startedAt) / 1000;
+    ws.close();
+
+    recognized.delete(file.deviceId);
+
+    const expected = file.expected?.map(relayIntent) ?? null;
+    const expectedChars = file.expected ? normalizeText(file.expected.join("")) : null;
+    return {
+      file: file.filePath,
+      deviceId: file.deviceId,
+      audioSeconds: file.samples.length / SAMPLE_RATE,
+      wallSeconds,
+      utterances: session.scripted?.utterances ?? null,
+      commands,
+      expected,
+      // 逐句按顺序比对；多切 / 漏切的句子记为错误
+      intentCorrect: expected ? expected.filter((intent, i) => commands[i]?.intent === intent).length : null,
+      uplinkBytes,
+      recognized: texts,
+      charErrors: expectedChars ? editDistance(normalizeText(texts.join("")), expectedChars) : null,
+      expectedChars: expectedChars?.length ?? null,
+    };
+  }
+
+  const reports: FileReport[] = [];
+  const queue = [...paths];
+  const runStart = performance.now();
+  async function lane() {
+    for (;;) {
+      const filePath = queue.shift();
+      if (!filePath) return;
+      let file: ReplayFile;
+      try {
+        file = loadFile(filePath);
+      } catch (error) {
+        console.error(`跳过 ${filePath}: ${error instanceof Error ? error.message : error}`);
+        continue;
+      }
+      const report = await replay(file);
+      reports.push(report);
+      const latencies = report.commands.map((c) => c.latencyMs).filter((v): v is number => v !== null);
+      console.log(
+        `${path.basename(report.file)}  ${report.audioSeconds.toFixed(1)}s 音频 / ${report.wallSeconds.toFixed(2)}s  ` +
+          `指令 ${report.commands.length}` +
+          (report.utterances !== null ? `  切句 ${report.utterances}` : "") +
+          (report.expected ? `  意图 ${report.intentCorrect}/${report.expected.length}` : "") +
+          (report.charErrors !== null ? `  CER ${((report.charErrors / Math.max(1, report.expectedChars!)) * 100).toFixed(1)}%` : "") +
+          (latencies.length ? `  延迟 max ${Math.max(...latencies)}ms` : ""),
+      );
+      for (const command of report.commands) {
+        console.log(
+          `    #${command.id} @${(command.audioMs / 1000).toFixed(2)}s +${command.wallMs}ms ` +
+            `${command.intent === null ? "-" : command.intent ? "开" : "关"} ${command.text}` +
+            (command.latencyMs !== null ? ` (${command.latencyMs}ms)` : ""),
+        );
+      }
+    }
+  }
+  // 房间模式下同一房间共用一路 ASR，文件逐个回放
+  await Promise.all(Array.from({ length: opts.room ? 1 : Math.max(1, opts.devices) }, lane));
+  const wallSeconds = (performance.now() - runStart) / 1000;
+
+  const audioSeconds = reports.reduce((sum, r) => sum + r.audioSeconds, 0);
+  const latencies = reports
+    .flatMap((r) => r.commands.map((c) => c.latencyMs))
+    .filter((v): v is number => v !== null)
+    .sort((a, b) => a - b);
+  const labeled = reports.filter((r) => r.expected);
+  const summary = {
+    files: reports.length,
+    audioSeconds,
+    wallSeconds,
+    throughput: audioSeconds / wallSeconds, // 音频秒 / 墙钟秒
+    commands: reports.reduce((sum, r) => sum + r.commands.length, 0),
+    latencyP50Ms: latencies.length ? latencies[Math.floor(latencies.length * 0.5)] : null,
+    latencyP99Ms: latencies.length ? latencies[Math.min(latencies.length - 1, Math.floor(latencies.length * 0.99))] : null,
+    intentAccuracy: labeled.length
+      ? labeled.reduce((sum, r) => sum + r.intentCorrect!, 0) / labeled.reduce((sum, r) => sum + r.expected!.length, 0)
+      : null,
+    band: opts.band,
+    uplinkBytesPerSecond: audioSeconds > 0 ? reports.reduce((sum, r) => sum + r.uplinkBytes, 0) / audioSeconds : 0,
+    cer: labeled.length
+      ? labeled.reduce((sum, r) => sum + r.charErrors!, 0) / Math.max(1, labeled.reduce((sum, r) => sum + r.expectedChars!, 0))
+      : null,
+  };
+  console.log(
+    `\n合计 ${summary.files} 个文件, ${audioSeconds.toFixed(1)}s 音频 / ${wallSeconds.toFixed(2)}s, ` +
+      `吞吐 ${summary.throughput.toFixed(1)} 音频秒/秒, 指令 ${summary.commands}` +
+      (summary.latencyP50Ms !== null ? `, 延迟 p50 ${summary.latencyP50Ms}ms p99 ${summary.latencyP99Ms}ms` : "") +
+      (summary.intentAccuracy !== null ? `, 意图准确率 ${(summary.intentAccuracy * 100).toFixed(1)}%` : "") +
+      (summary.cer !== null ? `, CER ${(summary.cer * 100).toFixed(1)}%` : "") +
+      `, 上行 ${(summary.uplinkBytesPerSecond / 1024).toFixed(1)} KiB/音频秒（${summary.band}）`,
+  );
+
+  if (opts.out) {
+    writeFileSync(
+      opts.out,
+      JSON.stringify({ date: new Date().toISOString(), options: opts, summary, files: reports }, null, 2),
+    );
+    console.log(`结果已写入 ${opts.out}`);
+  }
+  rmSync(audioDir, { recursive: true, force: true });
+  process.exit(0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  rmSync(audioDir, { recursive: true, force: true });
+  process.exit(1);
+});
@@ -0,0 +1,697 @@
+/**
+ * 浸泡测试：长时间运行下的内存与句柄泄漏
+ * 启动一个真实的服务器子进程，ASR 指向本进程内的模拟 DashScope 服务，然后持续制造连接抖动：
+ *   设备   连接 -> 按实时发送 v2 音频帧、回执部分继电器指令 -> 以随机方式结束 -> 稍后重连
+ *          结束方式：正常关闭 / 直接断开 TCP / 僵尸（不回 pong、不发数据，等心跳回收）/
+ *          超大帧触发协议错误 / 同一设备 ID 先建新连接再关旧连接
+ *   浏览器 播放连接同样随机关闭、断开或变成僵尸（不读数据、不回 pong）
+ *   ASR    模拟服务随机断开或返回 task-failed，走 AsrService 的重连路径
+ * 心跳、自动分段、ASR 重连间隔与会话时长都缩短为 1/scale，30 分钟墙钟约等于 scale × 30 分钟的抖动量。
+ *
+ * 每个采样点抓取 /metrics：堆、RSS、external、活跃句柄（按类型）、文件描述符、
+ * 设备 / 心跳 / 播放 / ASR 会话数、帧池占用、管线各表大小。结束时：
+ *   1. 运行期间：堆与 RSS 取每个窗口的最小值（GC 后的低点），对后半段做线性回归，斜率超过 --max-growth-mb 判失败；
+ *      前半段包含分配器与线程池的一次性增长，不计入。时长太短时斜率没有意义，建议 20 分钟以上
+ *   2. 停止抖动、关闭所有连接并等待心跳判死时间后，会话相关的计数必须回到 0，句柄回到启动时的水平
+ * 结果 JSON 含全部采样点，可用 --baseline 与上一版本对比。
+ *
+ * 用法: npm run bench:soak -- --minutes 30 --devices 40 --scale 20
+ *   --minutes        墙钟时长
+ *   --devices        模拟设备数（每台循环连接 / 断开）
+ *   --playback       模拟浏览器数
+ *   --scale          时间压缩倍数
+ *   --sample-ms      采样间隔
+ *   --asr-drop       模拟 ASR 服务每个连接每秒断开的概率
+ *   --max-growth-mb  堆 / RSS 增长上限（MB / 墙钟小时）
+ *   --port           服务器端口
+ *   --baseline       上一版本的结果 JSON
+ *   --out            结果 JSON 路径
+ */
+import { spawn, spawnSync } from "child_process";
+import { createWriteStream, existsSync, mkdtempSync, readdirSync, readFileSync, readlinkSync, rmSync, writeFileSync } from "fs";
+import type { AddressInfo } from "net";
+import os from "os";
+import path from "path";
+import { fileURLToPath } from "url";
+import WebSocket, { WebSocketServer } from "ws";
+import { parsePrometheusText, type MetricFamily } from "../lib/metrics";
+
+const __filename = fileURLToPath(import.meta.url);
+const __dirname = path.dirname(__filename);
+
+const FRAME_MS = 50;
+const PCM_BYTES = (16000 * FRAME_MS * 2) / 1000;
+const HEADER_BYTES = 8;
+const COMMANDS = ["打开客厅的灯", "关灯", "现在几点了", "把空调关掉", "turn on the fan"];
+
+type DeviceEnd = "close" | "terminate" | "zombie" | "oversize" | "overlap";
+type PlaybackEnd = "close" | "terminate" | "zombie";
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    minutes: Number(args.get("minutes") ?? 30),
+    devices: Number(args.get("devices") ?? 40),
+    playback: Number(args.get("playback") ?? 4),
+    scale: Number(args.get("scale") ?? 20),
+    sampleMs: Number(args.get("sample-ms") ?? 5000),
+    asrDrop: Number(args.get("asr-drop") ?? 0.01),
+    maxGrowthMb: Number(args.get("max-growth-mb") ?? 32),
+    port: Number(args.get("port") ?? 3950),
+    baseline: args.get("baseline"),
+    out: args.get("out"),
+  };
+}
+
+const sleep = (ms: number) => new Promise((r) => setTimeout(r, ms));
+
+// 指数分布：会话时长、重连间隔
+function exponential(meanMs: number): number {
+  return -Math.log(1 - Math.random()) * meanMs;
+}
+
+function pick<T>(weights: Array<[T, number]>): T {
+  let r = Math.random() * weights.reduce((sum, [, w]) => sum + w, 0);
+  for (const [value, weight] of weights) {
+    if ((r -= weight) < 0) return value;
+  }
+  return weights[weights.length - 1][0];
+}
+
+// ==================== 模拟 DashScope ====================
+// 只实现 AsrService 用到的协议：run-task / 二进制音频 / finish-task
+function startFakeAsr(dropPerSecond: number) {
+  const wss = new WebSocketServer({ port: 0, host: "127.0.0.1" });
+  const stats = { connections: 0, open: 0, drops: 0, failures: 0, sentences: 0 };
+  let chaosEnabled = true;
+
+  wss.on("connection", (ws) => {
+    stats.connections++;
+    stats.open++;
+    let taskId = "";
+    let audioMs = 0;
+    let sentenceStartMs = 0;
+    const send = (event: string, extra: Record<string, unknown> = {}) => {
+      if (ws.readyState === WebSocket.OPEN) ws.send(JSON.stringify({ header: { event, task_id: taskId, ...extra }, payload: {} }));
+    };
+    const sendSentence = (text: string, end: boolean) => {
+      if (ws.readyState !== WebSocket.OPEN) return;
+      ws.send(
+        JSON.stringify({
+          header: { event: "result-generated", task_id: taskId },
+          payload: {
+            output: {
+              sentence: { text, sentence_end: end, begin_time: sentenceStartMs, end_time: end ? audioMs : null },
+            },
+          },
+        }),
+      );
+    };
+    // 断线检查每秒一次
+    const chaos = setInterval(() => {
+      if (!chaosEnabled) return;
+      if (Math.random() < dropPerSecond) {
+        stats.drops++;
+        ws.terminate();
+      } else if (Math.random() < dropPerSecond / 4 && taskId) {
+        stats.failures++;
+        send("task-failed", { error_code: "SoakInjected", error_message: "injected failure" });
+      }
+    }, 1000);
+    ws.on("close", () => {
+      stats.open--;
+      clearInterval(chaos);
+    });
+    ws.on("error", () => {});
+    ws.on("message", (data: Buffer, isBinary: boolean) => {
+      if (isBinary) {
+        if (!taskId) return;
+        const before = audioMs;
+        audioMs += (data.length / 2 / 16000) * 1000;
+        // 每 2 秒音频一个中间结果，每 6 秒一句
+        if (Math.floor(audioMs / 2000) !== Math.floor(before / 2000)) sendSentence("打开", false);
+        if (audioMs - sentenceStartMs >= 6000) {
+          stats.sentences++;
+          sendSentence(COMMANDS[stats.sentences % COMMANDS.length], true);
+          sentenceStartMs = audioMs;
+        }
+        return;
+      }
+      let message: { header?: { action?: string; task_id?: string } };
+      try {
+        message = JSON.parse(data.toString());
+      } catch {
+        return;
+      }
+      if (message.header?.action === "run-task") {
+        taskId = message.header.task_id ?? "";
+        audioMs = 0;
+        sentenceStartMs = 0;
+        send("task-started");
+      } else if (message.header?.action === "finish-task") {
+        send("task-finished");
+      }
+    });
+  });
+
+  return new Promise<{ port: number; stats: typeof stats; calm: () => void; close: () => void }>((resolve) => {
+    wss.on("listening", () =>
+      resolve({
+        port: (wss.address() as AddressInfo).port,
+        stats,
+        // 收尾阶段不再注入断线：服务器留下的连接（如销毁后又重连的）要能在检查时被看到
+        calm: () => {
+          chaosEnabled = false;
+        },
+        close: () => {
+          for (const client of wss.clients) client.terminate();
+          wss.close();
+        },
+      }),
+    );
+  });
+}
+
+// ==================== 服务器子进程 ====================
+async function startServer(
+  opts: ReturnType<typeof parseArgs>,
+  timers: ReturnType<typeof compressedTimers>,
+  asrPort: number,
+  dir: string,
+) {
+  const logPath = path.join(dir, "server.log");
+  const log = createWriteStream(logPath);
+  const child = spawn(process.execPath, [...process.execArgv, path.join(__dirname, "..", "server.ts")], {
+    cwd: path.join(__dirname, ".."),
+    env: {
+      ...process.env,
+      PORT: String(opts.port),
+      CLUSTER_WORKERS: "0",
+      AUDIO_ONLY: "1",
+      AUDIO_DIR: path.join(dir, "audio"),
+      TRANSCRIPT_DIR: path.join(dir, "transcripts"),
+      DASHSCOPE_API_KEY: "soak",
+      DASHSCOPE_WS_URL: `ws://127.0.0.1:${asrPort}`,
+      ASR_RECONNECT_DELAY_MS: String(timers.asrReconnectMs),
+      HEARTBEAT_INTERVAL_MS: String(timers.heartbeatMs),
+      AUTO_SAVE_INTERVAL_MS: String(timers.autoSaveMs),
+      // 分段按压缩后的间隔写盘，靠配额删除让磁盘与保留索引保持有界
+      RETENTION_MAX_MB: process.env.RETENTION_MAX_MB || "64",
+      MAX_DEVICE_SESSIONS: "1000000",
+      ADMISSION_LAG_MS: "1000000",
+      ADMISSION_CPU: "1000000",
+      LOG_LEVEL: process.env.LOG_LEVEL || "warn",
+      LOG_FORMAT: "json",
+    },
+    stdio: ["ignore", "pipe", "pipe"],
+  });
+  child.stdout!.pipe(log);
+  child.stderr!.pipe(log);
+  let exited = false;
+  child.once("exit", () => (exited = true));
+  for (let attempt = 0; attempt < 150; attempt++) {
+    if (exited) throw new Error(`服务器启动失败，日志: ${logPath}`);
+    await sleep(200);
+    try {
+      await fetch(`http://127.0.0.1:${opts.port}/metrics`);
+      return { child, logPath };
+    } catch {
+      // 尚未监听
+    }
+  }
+  child.kill("SIGKILL");
+  throw new Error(`服务器启动超时，日志: ${logPath}`);
+}
+
+function compressedTimers(scale: number) {
+  return {
+    heartbeatMs: Math.max(500, Math.round(20000 / scale)),
+    autoSaveMs: Math.max(1000, Math.round(60000 / scale)),
+    asrReconnectMs: Math.max(50, Math.round(3000 / scale)),
+    // 弱网设备平均 10 分钟掉线一次，浏览器平均 5 分钟刷新 / 关闭一次
+    deviceSessionMs: (10 * 60000) / scale,
+    playbackSessionMs: (5 * 60000) / scale,
+    reconnectMs: Math.max(100, 5000 / scale),
+  };
+}
+
+// ==================== 采样 ====================
+interface Sample {
+  t: number; // 距开始的秒数
+  phase: "warmup" | "churn" | "quiesce";
+  heapMb: number;
+  rssMb: number;
+  externalMb: number;
+  fds: number | null;
+  threads: number | null;
+  handles: Record<string, number>; // nodejs_active_resources，按类型
+  devices: number;
+  heartbeat: number;
+  playback: number;
+  asrSessions: number;
+  framesInUse: number;
+  pipeline: Record<string, number>; // audio_pipeline_entries，按表
+  transcripts: number;
+  archiveFiles: number;
+  lagP99Ms: number;
+  client: { devices: number; playback: number; asrOpen: number };
+}
+
+function familyValue(families: MetricFamily[], name: string, labels?: Record<string, string>): number {
+  const family = families.find((f) => f.name === name);
+  if (!family) return 0;
+  return family.samples
+    .filter((s) => !labels || Object.entries(labels).every(([k, v]) => s.labels[k] === v))
+    .reduce((sum, s) => sum + s.value, 0);
+}
+
+function byLabel(families: MetricFamily[], name: string, label: string): Record<string, number> {
+  const result: Record<string, number> = {};
+  for (const sample of families.find((f) => f.name === name)?.samples ?? []) {
+    result[sample.labels[label]] = sample.value;
+  }
+  return result;
+}
+
+function countFds(pid: number): number | null {
+  const dir = `/proc/${pid}/fd`;
+  return existsSync(dir) ? readdirSync(dir).length : null;
+}
+
+function countThreads(pid: number): number | null {
+  const file = `/proc/${pid}/status`;
+  if (!existsSync(file)) return null;
+  const m = /^Threads:\s+(\d+)/m.exec(readFileSync(file, "utf8"));
+  return m ? Number(m[1]) : null;
+}
+
+// 按指向归类（socket / pipe / anon_inode / 文件目录），失败时定位是哪类描述符没关
+function fdTargets(pid: number): Record<string, number> {
+  const dir = `/proc/${pid}/fd`;
+  const result: Record<string, number> = {};
+  if (!existsSync(dir)) return result;
+  for (const fd of readdirSync(dir)) {
+    let target: string;
+    try {
+      target = readlinkSync(path.join(dir, fd));
+    } catch {
+      continue;
+    }
+    const kind = target.startsWith("/") ? path.dirname(target) : target.replace(/\[\d+\]$|:\[?\d+\]?$/, "");
+    result[kind] = (result[kind] ?? 0) + 1;
+  }
+  return result;
+}
+
+// ==================== 统计 ====================
+// 最小二乘斜率（y 单位 / 秒）
+function slope(points: Array<[number, number]>): number {
+  const n = points.length;
+  if (n < 2) return 0;
+  const mx = points.reduce((s, [x]) => s + x, 0) / n;
+  const my = points.reduce((s, [, y]) => s + y, 0) / n;
+  let num = 0;
+  let den = 0;
+  for (const [x, y] of points) {
+    num += (x - mx) * (y - my);
+    den += (x - mx) ** 2;
+  }
+  return den === 0 ? 0 : num / den;
+}
+
+// 每个窗口取最小值：GC 之后的低点才反映存活对象，峰值只反映分配速度
+function windowMinima(samples: Sample[], key: "heapMb" | "rssMb", windows: number): Array<[number, number]> {
+  if (samples.length === 0) return [];
+  const size = Math.max(1, Math.floor(samples.length / windows));
+  const points: Array<[number, number]> = [];
+  for (let i = 0; i + size <= samples.length; i += size) {
+    const window = samples.slice(i, i + size);
+    const min = window.reduce((best, s) => (s[key] < best[key] ? s : best));
+    points.push([min.t, min[key]]);
+  }
+  return points;
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const timers = compressedTimers(opts.scale);
+  // 先读对比基线，路径写错时不必等跑完才发现
+  const previous = opts.baseline ? JSON.parse(readFileSync(opts.baseline, "utf8")) : null;
+  const dir = mkdtempSync(path.join(os.tmpdir(), "soak-"));
+  const rev = spawnSync("git", ["rev-parse", "--short", "HEAD"], { encoding: "utf8" }).stdout?.trim() || null;
+  console.log(
+    `浸泡测试: ${opts.minutes} 分钟 × ${opts.scale} 倍压缩, 设备 ${opts.devices}, 浏览器 ${opts.playback}, ` +
+      `心跳 ${timers.heartbeatMs}ms, 分段 ${timers.autoSaveMs}ms, ASR 重连 ${timers.asrReconnectMs}ms` +
+      (rev ? `, 版本 ${rev}` : ""),
+  );
+
+  const asr = await startFakeAsr(opts.asrDrop);
+  const { child: server, logPath } = await startServer(opts, timers, asr.port, dir);
+  const base = `ws://127.0.0.1:${opts.port}`;
+
+  // ==================== 模拟设备 ====================
+  const speech = Buffer.alloc(PCM_BYTES);
+  for (let i = 0; i < PCM_BYTES / 2; i++) {
+    speech.writeInt16LE(Math.round(8000 * Math.sin((2 * Math.PI * 220 * i) / 16000)), i * 2);
+  }
+  const silence = Buffer.alloc(PCM_BYTES);
+
+  interface Streamer {
+    ws: WebSocket;
+    seq: number;
+    startedAt: number;
+  }
+  const streamers = new Set<Streamer>(); // 正在发音频的连接
+  const counts = { deviceSessions: 0, playbackSessions: 0, acks: 0, commands: 0, ends: {} as Record<string, number> };
+  let churning = true;
+  const liveSockets = new Set<WebSocket>();
+  let connectedDevices = 0;
+  let connectedPlayback = 0;
+
+  function openDevice(deviceId: string, zombie: boolean): Promise<WebSocket | null> {
+    return new Promise((resolve) => {
+      const ws = new WebSocket(`${base}/api/audio?id=${deviceId}&v=2`, { autoPong: !zombie });
+      liveSockets.add(ws);
+      ws.on("error", () => {});
+      ws.once("open", () => {
+        connectedDevices++;
+        ws.once("close", () => connectedDevices--);
+        resolve(ws);
+      });
+      ws.once("close", () => {
+        liveSockets.delete(ws);
+        resolve(null);
+      });
+      // 固件：收到 "#id 文本" 回执，偶尔丢回执走超时路径
+      ws.on("message", (data: Buffer, isBinary: boolean) => {
+        if (isBinary || zombie) return;
+        const m = /^#(\d+) /.exec(data.toString());
+        if (!m) return;
+        counts.commands++;
+        if (Math.random() < 0.8) {
+          counts.acks++;
+          ws.send(JSON.stringify({ type: "ack", id: Number(m[1]), relay: 1 }));
+        }
+      });
+    });
+  }
+
+  const waitClose = (ws: WebSocket) =>
+    ws.readyState === WebSocket.CLOSED ? Promise.resolve() : new Promise<void>((r) => ws.once("close", () => r()));
+
+  async function deviceLoop(index: number) {
+    const deviceId = `SOAK${index.toString(16).padStart(8, "0").toUpperCase()}`;
+    await sleep(Math.random() * timers.reconnectMs * 4);
+    while (churning) {
+      const end = pick<DeviceEnd>([
+        ["close", 40],
+        ["terminate", 25],
+        ["zombie", 15],
+        ["oversize", 10],
+        ["overlap", 10],
+      ]);
+      const ws = await openDevice(deviceId, end === "zombie");
+      if (!ws) {
+        await sleep(timers.reconnectMs);
+        continue;
+      }
+      counts.deviceSessions++;
+      counts.ends[end] = (counts.ends[end] ?? 0) + 1;
+      const streamer: Streamer = { ws, seq: 0, startedAt: Date.now() };
+      streamers.add(streamer);
+      ws.once("close", () => streamers.delete(streamer));
+      await Promise.race([sleep(exponential(timers.deviceSessionMs)), waitClose(ws)]);
+
+      switch (end) {
+        case "close":
+          ws.close(1000);
+          break;
+        case "terminate":
+          ws.terminate();
+          break;
+        case "zombie":
+          // 停止发送、不回 pong，等服务器心跳判死
+          streamers.delete(streamer);
+          break;
+        case "oversize":
+          if (ws.readyState === WebSocket.OPEN) ws.send(Buffer.alloc(128 * 1024));
+          break;
+        case "overlap": {
+          // 设备重启后新连接先到，旧连接稍后才断
+          const next = await openDevice(deviceId, false);
+          await sleep(Math.min(1000, timers.reconnectMs * 5));
+          ws.terminate();
+          if (next) {
+            const overlap: Streamer = { ws: next, seq: 0, startedAt: Date.now() };
+            streamers.add(overlap);
+            next.once("close", () => streamers.delete(overlap));
+            await sleep(exponential(timers.deviceSessionMs) / 4);
+            next.close(1000);
+            await waitClose(next);
+          }
+          break;
+        }
+      }
+      await waitClose(ws);
+      await sleep(exponential(timers.reconnectMs));
+    }
+  }
+
+  async function playbackLoop() {
+    await sleep(Math.random() * timers.reconnectMs * 4);
+    while (churning) {
+      const end = pick<PlaybackEnd>([
+        ["close", 60],
+        ["terminate", 25],
+        ["zombie", 15],
+      ]);
+      const ws = new WebSocket(`${base}/api/playback`, { autoPong: end !== "zombie" });
+      liveSockets.add(ws);
+      ws.on("error", () => {});
+      ws.on("message", () => {});
+      const opened = await new Promise<boolean>((resolve) => {
+        ws.once("open", () => resolve(true));
+        ws.once("close", () => resolve(false));
+      });
+      ws.once("close", () => liveSockets.delete(ws));
+      if (!opened) {
+        await sleep(timers.reconnectMs);
+        continue;
+      }
+      connectedPlayback++;
+      ws.once("close", () => connectedPlayback--);
+      counts.playbackSessions++;
+      counts.ends[`playback_${end}`] = (counts.ends[`playback_${end}`] ?? 0) + 1;
+      await Promise.race([sleep(exponential(timers.playbackSessionMs)), waitClose(ws)]);
+      if (end === "close") ws.close(1000);
+      else if (end === "terminate") ws.terminate();
+      else {
+        // 僵尸：停止读取，服务器侧积压到上限后丢帧，随后心跳回收。
+        // 暂停读取后收不到服务器的 FIN，过了判死时间由本端放弃
+        (ws as unknown as { _socket?: { pause(): void } })._socket?.pause();
+        await Promise.race([sleep(timers.heartbeatMs * 4), waitClose(ws)]);
+        ws.terminate();
+      }
+      await waitClose(ws);
+      await sleep(exponential(timers.reconnectMs));
+    }
+  }
+
+  // 所有设备共用一个 50ms 定时器发帧：每 3 秒一段“说话”
+  const pump = setInterval(() => {
+    for (const streamer of streamers) {
+      if (streamer.ws.readyState !== WebSocket.OPEN) continue;
+      const frame = Buffer.allocUnsafe(HEADER_BYTES + PCM_BYTES);
+      frame.writeUInt32LE(streamer.seq, 0);
+      frame.writeUInt32LE((Date.now() - streamer.startedAt) >>> 0, 4);
+      (streamer.seq % 60 < 30 ? speech : silence).copy(frame, HEADER_BYTES);
+      streamer.seq++;
+      streamer.ws.send(frame);
+    }
+  }, FRAME_MS);
+
+  // ==================== 采样循环 ====================
+  const samples: Sample[] = [];
+  const startedAt = performance.now();
+  const durationMs = opts.minutes * 60000;
+  const warmupMs = Math.min(durationMs * 0.2, 5 * 60000);
+  let phase: Sample["phase"] = "warmup";
+  async function sample(): Promise<Sample> {
+    const res = await fetch(`http://127.0.0.1:${opts.port}/metrics`);
+    const families = parsePrometheusText(await res.text());
+    const value = (name: string, labels?: Record<string, string>) => familyValue(families, name, labels);
+    const s: Sample = {
+      t: Math.round((performance.now() - startedAt) / 100) / 10,
+      phase,
+      heapMb: value("nodejs_heap_used_bytes") / 1024 / 1024,
+      rssMb: value("process_resident_memory_bytes") / 1024 / 1024,
+      externalMb: value("nodejs_external_memory_bytes") / 1024 / 1024,
+      fds: countFds(server.pid!),
+      threads: countThreads(server.pid!),
+      handles: byLabel(families, "nodejs_active_resources", "type"),
+      devices: value("audio_devices_connected"),
+      heartbeat: value("heartbeat_sessions"),
+      playback: value("playback_subscribers"),
+      asrSessions: value("asr_sessions"),
+      framesInUse: value("frame_pool_frames_in_use"),
+      pipeline: byLabel(families, "audio_pipeline_entries", "table"),
+      transcripts: value("transcript_index_sentences"),
+      archiveFiles: value("archive_disk_files"),
+      lagP99Ms: value("nodejs_eventloop_lag_seconds", { stat: "p99" }) * 1000,
+      client: { devices: connectedDevices, playback: connectedPlayback, asrOpen: asr.stats.open },
+    };
+    samples.push(s);
+    return s;
+  }
+
+  await sleep(1000);
+  const baseline = await sample();
+  const baselineFds = fdTargets(server.pid!);
+  const loops = [
+    ...Array.from({ length: opts.devices }, (_, i) => deviceLoop(i)),
+    ...Array.from({ length: opts.playback }, () => playbackLoop()),
+  ];
+
+  let nextReport = 0;
+  while (performance.now() - startedAt < durationMs) {
+    await sleep(opts.sampleMs);
+    phase = performance.now() - startedAt < warmupMs ? "warmup" : "churn";
+    const s = await sample();
+    if (s.t >= nextReport) {
+      nextReport = s.t + 60;
+      console.log(
+        `${(s.t / 60).toFixed(1).padStart(5)} min  堆 ${s.heapMb.toFixed(1)} MB  RSS ${s.rssMb.toFixed(0)} MB  ` +
+          `fd ${s.fds ?? "-"}  设备 ${s.devices}/${s.client.devices}  浏览器 ${s.playback}/${s.client.playback}  ` +
+          `ASR ${s.asrSessions}/${s.client.asrOpen}  帧池 ${s.framesInUse}  lag p99 ${s.lagP99Ms.toFixed(0)}ms`,
+      );
+    }
+  }
+
+  // ==================== 收尾：停止抖动，等待会话全部释放 ====================
+  churning = false;
+  asr.calm();
+  clearInterval(pump);
+  for (const ws of liveSockets) ws.terminate();
+  await Promise.all(loops);
+  phase = "quiesce";
+  // 心跳判死 2.5 个间隔，加上 ASR 重连与关闭握手
+  const settleMs = timers.heartbeatMs * 3 + timers.asrReconnectMs * 2 + 3000;
+  await sleep(settleMs);
+  const final = await sample();
+  const finalFds = fdTargets(server.pid!);
+
+  // ==================== 判定 ====================
+  const churn = samples.filter((s) => s.phase === "churn");
+  const late = churn.slice(Math.floor(churn.length / 2));
+  const heapSlope = slope(windowMinima(late, "heapMb", 6)) * 3600;
+  const rssSlope = slope(windowMinima(late, "rssMb", 6)) * 3600;
+  const checks: Array<{ name: string; ok: boolean; detail: string }> = [];
+  const check = (name: string, ok: boolean, detail: string) => checks.push({ name, ok, detail });
+
+  check("heap_growth", heapSlope <= opts.maxGrowthMb, `${heapSlope.toFixed(1)} MB/h (上限 ${opts.maxGrowthMb})`);
+  check("rss_growth", rssSlope <= opts.maxGrowthMb, `${rssSlope.toFixed(1)} MB/h (上限 ${opts.maxGrowthMb})`);
+  check("devices_released", final.devices === 0, `audio_devices_connected=${final.devices}`);
+  check("heartbeat_released", final.heartbeat === 0, `heartbeat_sessions=${final.heartbeat}`);
+  check("playback_released", final.playback === 0, `playback_subscribers=${final.playback}`);
+  check("asr_released", final.asrSessions === 0, `asr_sessions=${final.asrSessions}`);
+  check("asr_sockets_closed", final.client.asrOpen === 0, `模拟 ASR 仍有 ${final.client.asrOpen} 个连接`);
+  check("frames_released", final.framesInUse === 0, `frame_pool_frames_in_use=${final.framesInUse}`);
+  const pipelineLeft = Object.entries(final.pipeline).filter(([, n]) => n > 0);
+  check(
+    "pipeline_tables_empty",
+    pipelineLeft.length === 0,
+    pipelineLeft.length ? pipelineLeft.map(([table, n]) => `${table}=${n}`).join(" ") : "全部为 0",
+  );
+  // 允许少量波动：日志写入、保留清理等后台任务可能恰好在进行
+  for (const type of ["TCPSocketWrap", "Timeout"]) {
+    const before = baseline.handles[type] ?? 0;
+    const after = final.handles[type] ?? 0;
+    check(`handles_${type}`, after <= before + 2, `${before} -> ${after}`);
+  }
+  // 转码等线程池按需启动，每个线程自带 epoll / eventfd / pipe；这些随线程数走，
+  // 只要求 socket 与文件回到启动时的水平，线程数在预热之后不再增长
+  if (baseline.fds !== null) {
+    const perThread = /^(anon_inode|pipe)/;
+    const grown = Object.entries(finalFds)
+      .filter(([kind, n]) => !perThread.test(kind) && n > (baselineFds[kind] ?? 0))
+      .map(([kind, n]) => `${kind} ${baselineFds[kind] ?? 0}->${n}`);
+    check("fds", grown.length === 0, grown.length ? grown.join(", ") : `${baseline.fds} -> ${final.fds}（线程相关除外）`);
+  }
+  const warmedUp = samples.find((s) => s.phase === "churn");
+  if (warmedUp?.threads != null && final.threads !== null) {
+    check("threads", final.threads <= warmedUp.threads, `预热后 ${warmedUp.threads} -> ${final.threads}`);
+  }
+
+  const summary = {
+    wallMinutes: opts.minutes,
+    simulatedHours: (opts.minutes * opts.scale) / 60,
+    deviceSessions: counts.deviceSessions,
+    playbackSessions: counts.playbackSessions,
+    ends: counts.ends,
+    commands: counts.commands,
+    acks: counts.acks,
+    asr: { ...asr.stats },
+    heapSlopeMbPerHour: Number(heapSlope.toFixed(2)),
+    rssSlopeMbPerHour: Number(rssSlope.toFixed(2)),
+    heapMb: { start: Number(baseline.heapMb.toFixed(1)), end: Number(final.heapMb.toFixed(1)) },
+    rssMb: { start: Number(baseline.rssMb.toFixed(1)), end: Number(final.rssMb.toFixed(1)) },
+    maxLagP99Ms: Number(Math.max(...samples.map((s) => s.lagP99Ms)).toFixed(1)),
+    transcripts: final.transcripts,
+  };
+
+  const exited = new Promise((r) => server.once("exit", r));
+  server.kill("SIGTERM");
+  await exited;
+  asr.close();
+
+  console.log(
+    `\n设备会话 ${summary.deviceSessions}  浏览器会话 ${summary.playbackSessions}  ` +
+      `指令 ${summary.commands} (回执 ${summary.acks})  ASR 连接 ${summary.asr.connections} ` +
+      `(断开 ${summary.asr.drops}, 失败 ${summary.asr.failures})  约合 ${summary.simulatedHours.toFixed(1)} 小时`,
+  );
+  console.log(`结束方式: ${Object.entries(summary.ends).map(([k, n]) => `${k}=${n}`).join(" ")}`);
+  for (const c of checks) {
+    console.log(`${c.ok ? "✅" : "❌"} ${c.name.padEnd(22)} ${c.detail}`);
+  }
+
+  if (previous) {
+    const rows: Array<[string, number, number]> = [
+      ["堆增长 MB/h", previous.summary.heapSlopeMbPerHour, summary.heapSlopeMbPerHour],
+      ["RSS 增长 MB/h", previous.summary.rssSlopeMbPerHour, summary.rssSlopeMbPerHour],
+      ["结束时堆 MB", previous.summary.heapMb.end, summary.heapMb.end],
+      ["结束时 RSS MB", previous.summary.rssMb.end, summary.rssMb.end],
+      ["lag p99 max ms", previous.summary.maxLagP99Ms, summary.maxLagP99Ms],
+    ];
+    console.log(`\n对比 ${opts.baseline} (${previous.rev ?? "未知版本"})`);
+    for (const [name, before, after] of rows) {
+      console.log(`  ${name.padEnd(16)} ${String(before).padStart(8)} -> ${String(after).padStart(8)}`);
+    }
+  }
+
+  const failed = checks.filter((c) => !c.ok);
+  if (opts.out) {
+    writeFileSync(
+      opts.out,
+      JSON.stringify(
+        { date: new Date().toISOString(), rev, node: process.version, options: opts, timers, summary, checks, samples },
+        null,
+        2,
+      ),
+    );
+    console.log(`结果已写入 ${opts.out}`);
+  }
+  if (failed.length) {
+    console.log(`服务器日志: ${logPath}`);
+  } else {
+    rmSync(dir, { recursive: true, force: true });
+  }
+  process.exit(failed.length ? 1 : 0);
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
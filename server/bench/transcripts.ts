@@ -0,0 +1,182 @@
+/**
+ * 转写检索压测
+ * 生成 N 句模拟的智能家居语音（多台设备、多个房间，按时间递增），写入临时目录的转写库，
+ * 统计写入吞吐、索引内存、重启加载时间与几类查询的延迟：
+ *   常见双字词（命中数十万句，只回读最新的 limit 句）、较长短语（bigram 求交后回读校验）、
+ *   单字（展开为所有包含它的 bigram 再求并）、带设备 / 房间过滤。
+ * --vocabulary 给一部分句子加上随机生成的词（人名、备忘之类），把 bigram 词表撑到几十万以上，
+ * 看单字查询是否随词表大小变慢。
+ *
+ * 用法: npm run bench:transcripts -- --sentences 1000000
+ *   --sentences  句数
+ *   --devices    设备数
+ *   --queries    每类查询的次数
+ *   --vocabulary 随机词个数（0 为只用固定句式）
+ *   --out        结果 JSON 路径
+ */
+import { mkdtempSync, rmSync, writeFileSync } from "fs";
+import os from "os";
+import path from "path";
+
+process.env.LOG_LEVEL = process.env.LOG_LEVEL || "warn";
+const { TranscriptStore } = await import("../lib/transcripts");
+
+function parseArgs(argv: string[]) {
+  const args = new Map<string, string>();
+  for (let i = 0; i < argv.length; i += 2) {
+    args.set(argv[i].replace(/^--/, ""), argv[i + 1]);
+  }
+  return {
+    sentences: Number(args.get("sentences") ?? 1_000_000),
+    devices: Number(args.get("devices") ?? 200),
+    queries: Number(args.get("queries") ?? 50),
+    vocabulary: Number(args.get("vocabulary") ?? 0),
+    out: args.get("out"),
+  };
+}
+
+// 固定种子，多次运行数据相同
+function rng(seed: number) {
+  return () => {
+    seed = (seed * 1664525 + 1013904223) >>> 0;
+    return seed / 0x100000000;
+  };
+}
+
+const ROOMS = ["客厅", "卧室", "厨房", "书房", "卫生间", "阳台", "3", "5"];
+const DEVICES = ["灯", "空调", "窗帘", "风扇", "电视", "热水器", "加湿器", "插座"];
+const VERBS = ["打开", "关掉", "开一下", "关一下", "把{d}打开", "帮我关{d}"];
+const CHAT = ["今天天气怎么样", "现在几点了", "明天早上七点叫我起床", "放一首歌", "音量调大一点", "好的谢谢"];
+
+// 随机词：从常用汉字区（U+4E00 起 3000 字）取 2~6 字
+function vocabulary(random: () => number, size: number): string[] {
+  const words: string[] = [];
+  for (let i = 0; i < size; i++) {
+    const length = 2 + Math.floor(random() * 5);
+    let word = "";
+    for (let j = 0; j < length; j++) word += String.fromCharCode(0x4e00 + Math.floor(random() * 3000));
+    words.push(word);
+  }
+  return words;
+}
+
+function sentence(random: () => number, words: string[]): string {
+  if (words.length > 0 && random() < 0.2) return "提醒我" + words[Math.floor(random() * words.length)];
+  if (random() < 0.3) return CHAT[Math.floor(random() * CHAT.length)];
+  const room = ROOMS[Math.floor(random() * ROOMS.length)];
+  const device = DEVICES[Math.floor(random() * DEVICES.length)];
+  const verb = VERBS[Math.floor(random() * VERBS.length)];
+  return verb.includes("{d}") ? room + "的" + verb.replace("{d}", device) : verb + room + device;
+}
+
+function percentile(sorted: number[], p: number): number {
+  return sorted[Math.min(sorted.length - 1, Math.floor((p / 100) * sorted.length))];
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  const dir = mkdtempSync(path.join(os.tmpdir(), "bench-transcripts-"));
+  const random = rng(42);
+  const words = vocabulary(random, opts.vocabulary);
+  console.log(
+    `转写检索压测: ${opts.sentences} 句, ${opts.devices} 台设备, ${opts.vocabulary} 个随机词, 目录 ${dir}`,
+  );
+
+  try {
+    // 倒排表与句子表是 TypedArray，计在 arrayBuffers 里
+    const memory = () => process.memoryUsage().heapUsed + process.memoryUsage().arrayBuffers;
+    globalThis.gc?.();
+    const heapBefore = memory();
+    const store = new TranscriptStore();
+    await store.start(dir);
+    const startTs = Date.now() - opts.sentences * 1000;
+    let startedAt = performance.now();
+    for (let i = 0; i < opts.sentences; i++) {
+      const device = `AABBCC${(i % opts.devices).toString(16).padStart(6, "0")}`;
+      store.add({
+        device,
+        room: i % 4 === 0 ? ROOMS[(i >> 2) % ROOMS.length] : null,
+        ts: startTs + i * 1000,
+        durationMs: 1500,
+        archive: `audio_${device}_seg${i % 30}_2026-01-01T00-00-00`,
+        offsetMs: (i * 7919) % 60000,
+        text: sentence(random, words),
+      });
+      if (i % 50000 === 49999) await store.flush();
+    }
+    await store.flush();
+    const writeSeconds = (performance.now() - startedAt) / 1000;
+    globalThis.gc?.();
+    const heapMB = (memory() - heapBefore) / 1024 / 1024;
+    console.log(
+      `写入+索引 ${writeSeconds.toFixed(1)}s (${Math.round(opts.sentences / writeSeconds)} 句/s), ` +
+        `${store.stats.terms} 个词, 内存增长 ${heapMB.toFixed(0)} MB${globalThis.gc ? "" : "（未加 --expose-gc，含垃圾）"}`,
+    );
+
+    // 重启加载
+    startedAt = performance.now();
+    const reloaded = new TranscriptStore();
+    await reloaded.start(dir);
+    const loadSeconds = (performance.now() - startedAt) / 1000;
+    console.log(`重启加载 ${loadSeconds.toFixed(1)}s, ${reloaded.stats.sentences} 句`);
+
+    const cases: Array<{ name: string; query: () => Parameters<typeof reloaded.search>[0] }> = [
+      { name: "双字词", query: () => ({ text: ["打开", "空调", "窗帘", "天气"][Math.floor(random() * 4)] }) },
+      { name: "短语", query: () => ({ text: ["客厅的把窗帘打开", "打开卧室灯", "关一下厨房热水器"][Math.floor(random() * 3)] }) },
+      { name: "单字", query: () => ({ text: ["灯", "扇", "歌"][Math.floor(random() * 3)] }) },
+      // 随机词里的字：每个字出现在上千个 bigram 里
+      ...(words.length > 0
+        ? [{ name: "生僻单字", query: () => ({ text: Array.from(words[Math.floor(random() * words.length)])[0] }) }]
+        : []),
+      {
+        name: "设备过滤",
+        query: () => ({ text: "打开", device: `AABBCC${Math.floor(random() * opts.devices).toString(16).padStart(6, "0")}` }),
+      },
+      { name: "房间+时间", query: () => ({ text: "打开", room: "3", since: startTs + (opts.sentences * 1000) / 2 }) },
+    ];
+    const results = [];
+    for (const { name, query } of cases) {
+      const latencies: number[] = [];
+      let hits = 0;
+      let candidates = 0;
+      let scanned = 0;
+      for (let i = 0; i < opts.queries; i++) {
+        const t0 = performance.now();
+        const result = await reloaded.search(query());
+        latencies.push(performance.now() - t0);
+        hits += result.hits.length;
+        candidates += result.candidates;
+        scanned += result.scanned;
+      }
+      latencies.sort((a, b) => a - b);
+      const row = {
+        name,
+        p50Ms: percentile(latencies, 50),
+        p99Ms: percentile(latencies, 99),
+        avgHits: hits / opts.queries,
+        avgCandidates: candidates / opts.queries,
+        avgScanned: scanned / opts.queries,
+      };
+      results.push(row);
+      console.log(
+        `${name.padEnd(6)} p50 ${row.p50Ms.toFixed(1)}ms p99 ${row.p99Ms.toFixed(1)}ms  ` +
+          `候选 ${Math.round(row.avgCandidates)} 回读 ${Math.round(row.avgScanned)} 命中 ${row.avgHits.toFixed(0)}`,
+      );
+    }
+
+    if (opts.out) {
+      writeFileSync(
+        opts.out,
+        JSON.stringify({ date: new Date().toISOString(), options: opts, writeSeconds, heapMB, loadSeconds, results }, null, 2),
+      );
+      console.log(`结果已写入 ${opts.out}`);
+    }
+  } finally {
+    rmSync(dir, { recursive: true, force: true });
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
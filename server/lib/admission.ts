@@ -0,0 +1,85 @@
+import { metrics } from "./metrics";
+
+// ==================== 配置 ====================
+export const ADMISSION_CONFIG = {
+  maxSessions: Number(process.env.MAX_DEVICE_SESSIONS) || 2000,
+  lagBudgetMs: Number(process.env.ADMISSION_LAG_MS) || 150, // 事件循环延迟 p99 超过则拒绝新设备
+  cpuBudget: Number(process.env.ADMISSION_CPU) || 0.9, // 主线程 CPU 占用（1 = 一个核）
+  retryAfterSec: 5,
+  cpuSampleIntervalMs: 1000,
+} as const;
+
+// draining：进程正在停机收尾，设备按 Retry-After 重连到重启后的进程
+export type AdmissionReason = "sessions" | "lag" | "cpu" | "draining";
+
+// 接收新设备的进程当前负载：单进程为本进程，集群为目标 worker 最近一次上报
+export interface ProcessLoad {
+  sessions: number;
+  lagMs: number;
+  cpu: number;
+}
+
+const rejected = metrics.counter(
+  "admission_rejected_total",
+  "Device connections rejected at upgrade time",
+  ["reason"],
+);
+const cpuGauge = metrics.gauge(
+  "process_cpu_utilization",
+  "Main thread CPU utilization over the last sample (1 = one core)",
+);
+
+// ==================== CPU 采样 ====================
+export class CpuMonitor {
+  usage = 0;
+  private last = process.cpuUsage();
+  private lastAt = performance.now();
+  private timer: NodeJS.Timeout | null = null;
+
+  start(): void {
+    if (this.timer) return;
+    this.timer = setInterval(() => this.sample(), ADMISSION_CONFIG.cpuSampleIntervalMs);
+    this.timer.unref();
+  }
+
+  stop(): void {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  private sample(): void {
+    const now = performance.now();
+    const delta = process.cpuUsage(this.last);
+    this.last = process.cpuUsage();
+    this.usage = (delta.user + delta.system) / 1000 / (now - this.lastAt);
+    this.lastAt = now;
+    cpuGauge.set(this.usage);
+  }
+}
+
+export const cpuMonitor = new CpuMonitor();
+
+// ==================== 准入判定 ====================
+/**
+ * 升级时判断是否接收新设备
+ * @param totalSessions 全局设备数（集群模式下为所有 worker 之和）
+ * @returns null 表示接收，否则为拒绝原因（已计数）
+ */
+export function admitDevice(totalSessions: number, load: ProcessLoad): AdmissionReason | null {
+  let reason: AdmissionReason | null = null;
+  if (totalSessions >= ADMISSION_CONFIG.maxSessions) reason = "sessions";
+  else if (load.lagMs >= ADMISSION_CONFIG.lagBudgetMs) reason = "lag";
+  else if (load.cpu >= ADMISSION_CONFIG.cpuBudget) reason = "cpu";
+  if (reason) rejected.labels(reason).inc();
+  return reason;
+}
+
+// 在握手前直接回 503，设备按 Retry-After 退避重连
+export function rejectUpgrade(socket: { end(data: string): unknown }, reason: AdmissionReason) {
+  socket.end(
+    "HTTP/1.1 503 Service Unavailable\r\n" +
+      `Retry-After: ${ADMISSION_CONFIG.retryAfterSec}\r\n` +
+      `X-Reject-Reason: ${reason}\r\n` +
+      "Connection: close\r\n\r\n",
+  );
+}
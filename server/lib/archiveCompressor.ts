@@ -0,0 +1,350 @@
+import { spawnSync } from "child_process";
+import { existsSync, readFileSync, statSync, unlinkSync } from "fs";
+import path from "path";
+import { fileURLToPath } from "url";
+import { Worker } from "worker_threads";
+import { loadShedder, SHED_ARCHIVE } from "./loadShedder";
+import { metrics } from "./metrics";
+import { noteArchived, noteCompressing } from "./retention";
+import { logger } from "./logger";
+
+const __filename = fileURLToPath(import.meta.url);
+const __dirname = path.dirname(__filename);
+
+// ==================== 配置 ====================
+// 连续录音的 16 位 WAV 每台设备每小时约 115 MB。分段写盘后由后台线程池转码：
+//   flac  无损（内置编码器，约为原始大小的一半）
+//   opus  有损（需要带 libopus 的 ffmpeg；不可用时退回 flac）
+//   wav   保留原始文件
+// 每台设备的策略来自 ARCHIVE_POLICY_FILE，例如
+//   { "default": { "codec": "flac" }, "devices": { "AABBCCDDEEFF": { "codec": "opus", "bitrate": 16000 } } }
+// 文件修改后下一段即按新策略处理，不需要重启。
+export const ARCHIVE_CONFIG = {
+  workers: Number(process.env.ARCHIVE_WORKERS) || 1, // 每个进程的转码线程数
+  defaultCodec: (process.env.ARCHIVE_CODEC || "flac") as ArchiveCodec,
+  opusBitrate: Number(process.env.ARCHIVE_OPUS_BITRATE) || 24000,
+  policyFile:
+    process.env.ARCHIVE_POLICY_FILE || path.join(__dirname, "..", "data", "archive-policy.json"),
+  ffmpeg: process.env.FFMPEG_PATH || "ffmpeg",
+  maxQueue: 256, // 积压超过后新段保留 WAV，不再排队
+} as const;
+
+export type ArchiveCodec = "wav" | "flac" | "opus";
+
+export interface ArchivePolicy {
+  codec: ArchiveCodec;
+  bitrate: number; // 仅 opus
+}
+
+export interface ArchiveJob {
+  jobId: number;
+  filePath: string;
+  policy: ArchivePolicy;
+  ffmpeg: string;
+}
+
+export type ArchiveResult =
+  | {
+      jobId: number;
+      codec: ArchiveCodec;
+      filePath: string;
+      status: "ok";
+      outputPath: string;
+      inputBytes: number;
+      outputBytes: number;
+      audioSeconds: number;
+      cpuSeconds: number;
+    }
+  | {
+      jobId: number;
+      codec: ArchiveCodec;
+      filePath: string;
+      status: "verify_failed" | "error";
+      error: string;
+    };
+
+// 退出前收尾：排队中的段保留 WAV；interrupted 为期限内没转完、被中止的段（同样保留 WAV）
+export interface ArchiveDrainReport {
+  completed: number;
+  queued: number;
+  interrupted: number;
+}
+
+interface PolicyFile {
+  default?: Partial<ArchivePolicy>;
+  devices?: Record<string, Partial<ArchivePolicy>>;
+}
+
+const log = logger.get("archive");
+
+// ==================== 指标 ====================
+const jobsTotal = metrics.counter(
+  "archive_jobs_total",
+  "Archive segments processed by the compressor",
+  ["codec", "status"],
+);
+const inputBytes = metrics.counter(
+  "archive_input_bytes_total",
+  "WAV bytes compressed by the archive compressor",
+  ["codec"],
+);
+const outputBytes = metrics.counter(
+  "archive_output_bytes_total",
+  "Compressed bytes written by the archive compressor",
+  ["codec"],
+);
+const audioSeconds = metrics.counter(
+  "archive_audio_seconds_total",
+  "Audio duration compressed by the archive compressor",
+  ["codec"],
+);
+const cpuSeconds = metrics.counter(
+  "archive_cpu_seconds_total",
+  "CPU time spent encoding and verifying archive segments",
+  ["codec"],
+);
+const queueGauge = metrics.gauge("archive_queue_depth", "Archive segments waiting for compression");
+
+export function parseArchivePolicy(value: unknown, fallback: ArchivePolicy): ArchivePolicy {
+  const input = (value ?? {}) as Partial<ArchivePolicy>;
+  const codec = input.codec ?? fallback.codec;
+  if (codec !== "wav" && codec !== "flac" && codec !== "opus") {
+    throw new Error(`未知的归档编码: ${codec}`);
+  }
+  const bitrate = Number(input.bitrate ?? fallback.bitrate);
+  if (!Number.isFinite(bitrate) || bitrate < 6000 || bitrate > 510000) {
+    throw new Error(`Opus 码率超出范围: ${input.bitrate}`);
+  }
+  return { codec, bitrate };
+}
+
+// ==================== 转码线程池 ====================
+interface PoolWorker {
+  worker: Worker;
+  job: ArchiveJob | null;
+}
+
+export class ArchiveCompressor {
+  private readonly workers: PoolWorker[] = [];
+  private readonly queue: ArchiveJob[] = [];
+  private nextJobId = 1;
+  private started = false;
+  private draining = false;
+  private opusAvailable: boolean | null = null;
+  private policyMtime = -1;
+  private defaultPolicy: ArchivePolicy;
+  private devicePolicies = new Map<string, ArchivePolicy>();
+
+  constructor(private readonly config: typeof ARCHIVE_CONFIG = ARCHIVE_CONFIG) {
+    this.defaultPolicy = { codec: config.defaultCodec, bitrate: config.opusBitrate };
+    // 过载时暂停派发，回落后继续
+    loadShedder.onChange(() => this.dispatch());
+  }
+
+  get queued(): number {
+    return this.queue.length;
+  }
+
+  /**
+   * 对一个已写完的段按设备策略排队转码
+   * @param deviceId 设备 ID（旧固件为连接 ID）
+   */
+  enqueue(filePath: string, deviceId: string): void {
+    if (this.draining) return;
+    let policy = this.policyFor(deviceId);
+    if (policy.codec === "wav") return;
+    if (policy.codec === "opus" && !this.checkOpus()) {
+      jobsTotal.labels("opus", "fallback").inc();
+      policy = { ...policy, codec: "flac" };
+    }
+    if (this.queue.length >= this.config.maxQueue) {
+      jobsTotal.labels(policy.codec, "skipped").inc();
+      log.sampled("warn", "queue_full", 1, "积压过多，保留 WAV", {
+        queued: this.queue.length,
+        file: path.basename(filePath),
+      });
+      return;
+    }
+    this.start();
+    noteCompressing(filePath, true);
+    this.queue.push({ jobId: this.nextJobId++, filePath, policy, ffmpeg: this.config.ffmpeg });
+    queueGauge.set(this.queue.length);
+    this.dispatch();
+  }
+
+  policyFor(deviceId: string): ArchivePolicy {
+    this.loadPolicies();
+    return this.devicePolicies.get(deviceId) ?? this.defaultPolicy;
+  }
+
+  stop(): void {
+    for (const entry of this.workers) void entry.worker.terminate();
+    this.workers.length = 0;
+    this.started = false;
+  }
+
+  /**
+   * 退出前调用：不再接收新段，清空队列，等待正在转码的段到期限为止，然后结束线程
+   * 中止的段删除临时文件，WAV 不受影响
+   */
+  async drain(deadlineAt: number): Promise<ArchiveDrainReport> {
+    this.draining = true;
+    const queued = this.queue.length;
+    for (const job of this.queue) noteCompressing(job.filePath, false);
+    this.queue.length = 0;
+    queueGauge.set(0);
+    const busy = () => this.workers.filter((entry) => entry.job).length;
+    const initial = busy();
+    while (busy() > 0 && Date.now() < deadlineAt) {
+      await new Promise((resolve) => setTimeout(resolve, 20));
+    }
+    const unfinished = this.workers.flatMap((entry) => (entry.job ? [entry.job] : []));
+    const workers = this.workers.map((entry) => entry.worker);
+    this.stop();
+    // 等线程真正结束后再删临时文件，避免与仍在写入的线程竞争；
+    // 线程卡在外部编码器里时不再等待，残留的 .tmp 需手动清理
+    const terminated = await Promise.race([
+      Promise.all(workers.map((worker) => worker.terminate())).then(() => true),
+      new Promise<boolean>((resolve) => setTimeout(() => resolve(false), 200)),
+    ]);
+    for (const job of unfinished) noteCompressing(job.filePath, false);
+    for (const job of terminated ? unfinished : []) {
+      try {
+        unlinkSync(`${job.filePath.replace(/\.wav$/i, "")}.${job.policy.codec}.tmp`);
+      } catch {
+        // 尚未创建
+      }
+    }
+    return { completed: initial - unfinished.length, queued, interrupted: unfinished.length };
+  }
+
+  // 策略文件按 mtime 变化重新加载；格式错误时保留上一版
+  private loadPolicies(): void {
+    let mtime = 0;
+    try {
+      mtime = statSync(this.config.policyFile).mtimeMs;
+    } catch {
+      // 没有策略文件：全部按默认
+    }
+    if (mtime === this.policyMtime) return;
+    this.policyMtime = mtime;
+    const fallback: ArchivePolicy = { codec: this.config.defaultCodec, bitrate: this.config.opusBitrate };
+    if (!mtime) {
+      this.defaultPolicy = fallback;
+      this.devicePolicies = new Map();
+      return;
+    }
+    try {
+      const file = JSON.parse(readFileSync(this.config.policyFile, "utf8")) as PolicyFile;
+      const defaultPolicy = parseArchivePolicy(file.default, fallback);
+      const devices = new Map<string, ArchivePolicy>();
+      for (const [id, policy] of Object.entries(file.devices ?? {})) {
+        devices.set(id, parseArchivePolicy(policy, defaultPolicy));
+      }
+      this.defaultPolicy = defaultPolicy;
+      this.devicePolicies = devices;
+      log.info("加载策略", {
+        file: this.config.policyFile,
+        codec: defaultPolicy.codec,
+        devices: devices.size,
+      });
+    } catch (error) {
+      log.error("策略文件无效，沿用上一版", { file: this.config.policyFile, error });
+    }
+  }
+
+  private checkOpus(): boolean {
+    if (this.opusAvailable === null) {
+      const probe = spawnSync(this.config.ffmpeg, ["-hide_banner", "-encoders"], { encoding: "utf8" });
+      this.opusAvailable = probe.status === 0 && /\blibopus\b/.test(probe.stdout);
+      if (!this.opusAvailable) {
+        log.warn("ffmpeg 不可用或不支持 libopus，opus 策略退回 flac", { ffmpeg: this.config.ffmpeg });
+      }
+    }
+    return this.opusAvailable;
+  }
+
+  private start(): void {
+    if (this.started) return;
+    this.started = true;
+    for (let i = 0; i < this.config.workers; i++) this.spawnWorker();
+    log.info("启动转码线程", { workers: this.config.workers });
+  }
+
+  private spawnWorker(): void {
+    // 与本模块同扩展名：tsx 下为 .ts，编译后为 .js
+    const file = path.join(__dirname, `archiveWorker${path.extname(__filename)}`);
+    const entry: PoolWorker = { worker: new Worker(file), job: null };
+    entry.worker.unref();
+    entry.worker.on("message", (result: ArchiveResult) => {
+      entry.job = null;
+      this.record(result);
+      this.dispatch();
+    });
+    entry.worker.on("error", (error) => {
+      log.error("转码线程异常", { error });
+    });
+    entry.worker.on("exit", () => {
+      const index = this.workers.indexOf(entry);
+      if (index < 0) return; // stop() 主动结束
+      this.workers.splice(index, 1);
+      if (entry.job) {
+        this.record({
+          jobId: entry.job.jobId,
+          codec: entry.job.policy.codec,
+          filePath: entry.job.filePath,
+          status: "error",
+          error: "转码线程退出",
+        });
+      }
+      this.spawnWorker();
+      this.dispatch();
+    });
+    this.workers.push(entry);
+  }
+
+  private dispatch(): void {
+    if (loadShedder.level >= SHED_ARCHIVE) return;
+    for (const entry of this.workers) {
+      if (entry.job) continue;
+      let job = this.queue.shift();
+      // 段可能已被手动删除
+      while (job && !existsSync(job.filePath)) {
+        noteCompressing(job.filePath, false);
+        job = this.queue.shift();
+      }
+      if (!job) break;
+      entry.job = job;
+      entry.worker.postMessage(job);
+    }
+    queueGauge.set(this.queue.length);
+  }
+
+  private record(result: ArchiveResult): void {
+    jobsTotal.labels(result.codec, result.status).inc();
+    noteCompressing(result.filePath, false);
+    if (result.status !== "ok") {
+      log.error("转码失败，保留 WAV", {
+        file: path.basename(result.filePath),
+        status: result.status,
+        error: result.error,
+      });
+      return;
+    }
+    inputBytes.labels(result.codec).inc(result.inputBytes);
+    outputBytes.labels(result.codec).inc(result.outputBytes);
+    audioSeconds.labels(result.codec).inc(result.audioSeconds);
+    cpuSeconds.labels(result.codec).inc(result.cpuSeconds);
+    noteArchived({ filePath: result.outputPath, bytes: result.outputBytes, replaces: result.filePath });
+    log.info("压缩完成", {
+      file: path.basename(result.outputPath),
+      inputBytes: result.inputBytes,
+      outputBytes: result.outputBytes,
+      ratio: Number((result.outputBytes / result.inputBytes).toFixed(3)),
+      cpuMs: Math.round(result.cpuSeconds * 1000),
+      audioSeconds: Number(result.audioSeconds.toFixed(1)),
+    });
+  }
+}
+
+export const archiveCompressor = new ArchiveCompressor();
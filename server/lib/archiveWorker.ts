@@ -0,0 +1,126 @@
+import { spawnSync } from "child_process";
+import { readFileSync, renameSync, statSync, unlinkSync, writeFileSync } from "fs";
+import { parentPort } from "worker_threads";
+import { decodeFlac, encodeFlac } from "./flac";
+import { parseWav, type WavData } from "./wav";
+import type { ArchiveJob, ArchiveResult } from "./archiveCompressor";
+
+// ==================== 归档压缩 worker ====================
+// 由 lib/archiveCompressor.ts 的线程池加载：一次处理一个段
+//   WAV -> <codec>.tmp -> 回读解码校验 -> 改名 -> 删除 WAV
+// 校验失败时保留 WAV、删除临时文件。
+
+// 允许的 Opus 解码时长误差（编码器预跳过与尾部填充）
+const OPUS_DURATION_TOLERANCE_SEC = 0.1;
+
+// 本线程的 CPU 时间（/proc/thread-self，Linux）；读不到时返回 null，由调用方退回墙钟
+function threadCpuSeconds(): number | null {
+  try {
+    const stat = readFileSync("/proc/thread-self/stat", "utf8");
+    const fields = stat.slice(stat.lastIndexOf(")") + 2).split(" ");
+    return (Number(fields[11]) + Number(fields[12])) / 100;
+  } catch {
+    return null;
+  }
+}
+
+function compressFlac(wav: WavData, tmpPath: string): void {
+  if (wav.channels !== 1 || wav.bitsPerSample !== 16) {
+    throw new Error(`FLAC 只支持单声道 16 位，实际 ${wav.channels} 声道 ${wav.bitsPerSample} 位`);
+  }
+  writeFileSync(tmpPath, encodeFlac(wav.samples, wav.sampleRate));
+
+  // 从磁盘回读：校验的是实际落盘的字节
+  const decoded = decodeFlac(readFileSync(tmpPath));
+  if (decoded.sampleRate !== wav.sampleRate || decoded.samples.length !== wav.samples.length) {
+    throw new VerifyError(
+      `FLAC 回读不一致：${decoded.samples.length} 样本 @${decoded.sampleRate}Hz，期望 ${wav.samples.length} @${wav.sampleRate}Hz`,
+    );
+  }
+  for (let i = 0; i < wav.samples.length; i++) {
+    if (decoded.samples[i] !== wav.samples[i]) {
+      throw new VerifyError(`FLAC 回读第 ${i} 个样本不一致`);
+    }
+  }
+}
+
+function compressOpus(job: ArchiveJob, wav: WavData, tmpPath: string): void {
+  const encode = spawnSync(
+    job.ffmpeg,
+    ["-v", "error", "-y", "-i", job.filePath, "-c:a", "libopus", "-b:a", String(job.policy.bitrate), "-f", "ogg", tmpPath],
+    { stdio: ["ignore", "ignore", "pipe"] },
+  );
+  if (encode.status !== 0) {
+    throw new Error(`ffmpeg 编码失败 (${encode.status ?? encode.signal}): ${encode.stderr?.toString().trim()}`);
+  }
+
+  // 有损编码无法逐样本比对：完整解码一遍，确认能解且时长一致
+  const decode = spawnSync(
+    job.ffmpeg,
+    ["-v", "error", "-i", tmpPath, "-f", "s16le", "-ac", "1", "-ar", String(wav.sampleRate), "-"],
+    { stdio: ["ignore", "pipe", "pipe"], maxBuffer: wav.samples.length * 4 + 1024 * 1024 },
+  );
+  if (decode.status !== 0) {
+    throw new VerifyError(`Opus 解码失败: ${decode.stderr?.toString().trim()}`);
+  }
+  const decodedSec = decode.stdout.length / 2 / wav.sampleRate;
+  const expectedSec = wav.samples.length / wav.sampleRate;
+  if (Math.abs(decodedSec - expectedSec) > OPUS_DURATION_TOLERANCE_SEC) {
+    throw new VerifyError(`Opus 时长不符：解码 ${decodedSec.toFixed(2)}s，原始 ${expectedSec.toFixed(2)}s`);
+  }
+}
+
+class VerifyError extends Error {}
+
+function runJob(job: ArchiveJob): ArchiveResult {
+  const wallStart = performance.now();
+  const cpuStart = threadCpuSeconds();
+  const outputPath = job.filePath.replace(/\.wav$/i, "") + `.${job.policy.codec}`;
+  const tmpPath = `${outputPath}.tmp`;
+  const base = { jobId: job.jobId, codec: job.policy.codec, filePath: job.filePath };
+  try {
+    const input = readFileSync(job.filePath);
+    const wav = parseWav(input);
+    if (job.policy.codec === "flac") compressFlac(wav, tmpPath);
+    else compressOpus(job, wav, tmpPath);
+
+    renameSync(tmpPath, outputPath);
+    try {
+      unlinkSync(job.filePath);
+    } catch (error) {
+      // 转码期间 WAV 已被删除（保留策略或手动）：压缩文件已就位，仍算成功，由调用方记入索引
+      if ((error as NodeJS.ErrnoException).code !== "ENOENT") throw error;
+    }
+
+    const cpuEnd = threadCpuSeconds();
+    const wallSeconds = (performance.now() - wallStart) / 1000;
+    return {
+      ...base,
+      status: "ok",
+      outputPath,
+      inputBytes: input.length,
+      outputBytes: statSync(outputPath).size,
+      audioSeconds: wav.samples.length / wav.channels / wav.sampleRate,
+      // 外部编码器的 CPU 不记在本线程上，用墙钟近似（单线程、CPU 密集）
+      cpuSeconds:
+        job.policy.codec === "flac" && cpuStart !== null && cpuEnd !== null
+          ? cpuEnd - cpuStart
+          : wallSeconds,
+    };
+  } catch (error) {
+    try {
+      unlinkSync(tmpPath);
+    } catch {
+      // 临时文件可能尚未创建
+    }
+    return {
+      ...base,
+      status: error instanceof VerifyError ? "verify_failed" : "error",
+      error: String(error instanceof Error ? error.message : error),
+    };
+  }
+}
+
+parentPort?.on("message", (job: ArchiveJob) => {
+  parentPort!.postMessage(runJob(job));
+});
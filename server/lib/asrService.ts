@@ -1,6 +1,9 @@
 import WebSocket from "ws";
 import { v4 as uuidv4 } from "uuid";
-import type { AsrMessage } from "./types";
+import type { AsrMessage, AudioTiming } from "./types";
+import type { PooledFrame } from "./framePool";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
 import dotenv from "dotenv";
 
 dotenv.config({ path: ".env.local" });
@@ -8,24 +11,64 @@ dotenv.config({ path: ".env.local" });
 // ==================== 配置 ====================
 const CONFIG = {
   apiKey: process.env.DASHSCOPE_API_KEY || "",
-  wsUrl: "wss://dashscope.aliyuncs.com/api-ws/v1/inference/",
+  // 浸泡测试（bench/soak.ts）指向本地模拟服务
+  wsUrl: process.env.DASHSCOPE_WS_URL || "wss://dashscope.aliyuncs.com/api-ws/v1/inference/",
   sampleRate: 16000,
-  reconnectDelay: 3000,
+  reconnectDelay: Number(process.env.ASR_RECONNECT_DELAY_MS) || 3000,
+  timelineSize: 1200, // 记录最近 1200 个已发送音频块（50ms/块约 60 秒）
 } as const;
 
+// 每个会话的连接、任务生命周期默认只在 debug 输出；错误与断线始终输出
+const log = logger.get("asr");
+
+const sessionsGauge = metrics.gauge("asr_sessions", "ASR sessions not yet destroyed");
+const reconnects = metrics.counter("asr_reconnects_total", "ASR connections re-established after a drop");
+
 // ==================== 类型定义 ====================
-interface AsrCallbacks {
-  onResult: (text: string, isEnd: boolean) => void;
+export interface AsrResultInfo {
+  beginTime: number; // 句子起点（相对任务音频起点，毫秒）
+  endTime: number | null;
+  firstPartial: boolean; // 是否为本句第一个结果
+  speechStart: AudioTiming | null; // 句子起点所在音频块的时间点
+  speechEnd: AudioTiming | null;
+}
+
+// finish() 的结果：finished 收到 task-finished；idle 没有进行中的任务；lost 超时或连接中断
+export type AsrFinishResult = "finished" | "idle" | "lost";
+
+export interface AsrCallbacks {
+  onResult: (text: string, isEnd: boolean, info: AsrResultInfo) => void;
   onComplete?: () => void;
   onError?: (error: string) => void;
 }
 
+// 识别后端：管线只用到这三个方法。默认是下面的 DashScope 实时识别，
+// 回放压测（bench/replay.ts）换成离线实现，走同一条 VAD -> 识别 -> 指令路径
+export interface AsrBackend {
+  appendAudioChunk(frame: PooledFrame, capturedAt?: number, receivedAt?: number): void;
+  finish(timeoutMs: number): Promise<AsrFinishResult>;
+  destroy(): void;
+}
+
+export type AsrBackendFactory = (callbacks: AsrCallbacks, clientId: string) => AsrBackend;
+
 // ==================== ASR 服务（最简化版）====================
-export class AsrService {
+export class AsrService implements AsrBackend {
   private ws: WebSocket | null = null;
   private taskId = "";
   private taskStarted = false;
   private destroyed = false; // ✅ 新增：标记是否已销毁
+  private sentenceOpen = false;
+  private finishWaiter: ((result: AsrFinishResult) => void) | null = null;
+  private reconnectTimer: NodeJS.Timeout | null = null;
+  // 已发送音频的时间线：块起点偏移（ms）-> 采集/接收/发送时间，用于计算识别延迟
+  private sentAudioMs = 0;
+  private timelineHead = 0;
+  private timelineLength = 0;
+  private readonly timelineOffset = new Float64Array(CONFIG.timelineSize);
+  private readonly timelineCapturedAt = new Float64Array(CONFIG.timelineSize);
+  private readonly timelineReceivedAt = new Float64Array(CONFIG.timelineSize);
+  private readonly timelineSentAt = new Float64Array(CONFIG.timelineSize);
   private readonly callbacks: Required<AsrCallbacks>;
   private readonly clientId: string;
 
@@ -36,15 +79,17 @@ export class AsrService {
       onComplete: callbacks.onComplete || (() => {}),
       onError:
         callbacks.onError ||
-        ((err) => console.error(`[ASR ${this.clientId}]`, err)),
+        ((error) => log.error("识别出错", { client: this.clientId, error })),
     };
 
+    sessionsGauge.inc();
     this.connect();
   }
 
   // ==================== 连接管理 ====================
   private connect(): void {
-    if (this.ws?.readyState === WebSocket.OPEN) return;
+    this.reconnectTimer = null;
+    if (this.destroyed || this.ws?.readyState === WebSocket.OPEN) return;
 
     if (!CONFIG.apiKey) {
       this.callbacks.onError("缺少 DASHSCOPE_API_KEY 环境变量");
@@ -53,6 +98,7 @@ export class AsrService {
 
     this.taskId = uuidv4().replace(/-/g, "").slice(0, 32);
     this.taskStarted = false;
+    this.resetTimeline();
 
     this.ws = new WebSocket(CONFIG.wsUrl, {
       headers: {
@@ -62,42 +108,48 @@ export class AsrService {
     });
 
     this.setupWebSocketHandlers();
-    console.log(`[ASR ${this.clientId}] 连接中... (task_id: ${this.taskId})`);
+    log.debug("连接中", { client: this.clientId, task: this.taskId });
   }
 
+  // 事件只处理当前连接：销毁或重连后旧连接迟到的事件直接忽略
   private setupWebSocketHandlers(): void {
-    if (!this.ws) return;
+    const ws = this.ws;
+    if (!ws) return;
 
-    this.ws.on("open", () => {
-      console.log(`[ASR ${this.clientId}] ✅ WebSocket 已连接`);
+    ws.on("open", () => {
+      if (this.ws !== ws) return;
+      log.debug("WebSocket 已连接", { client: this.clientId });
       this.sendRunTask();
     });
 
-    this.ws.on("message", (data: WebSocket.RawData) => {
+    ws.on("message", (data: WebSocket.RawData) => {
+      if (this.ws !== ws) return;
       try {
         const message: AsrMessage = JSON.parse(data.toString());
         this.handleMessage(message);
       } catch (error) {
-        console.error(`[ASR ${this.clientId}] 解析消息失败:`, error);
+        log.error("解析消息失败", { client: this.clientId, error });
       }
     });
 
-    this.ws.on("close", (code, reason) => {
-      console.log(
-        `[ASR ${this.clientId}] 连接关闭 (code: ${code}, reason: ${reason.toString()})`,
-      );
+    ws.on("close", (code, reason) => {
+      if (this.ws !== ws) return;
+      log.info("连接关闭", { client: this.clientId, code, reason: reason.toString() });
       this.taskStarted = false;
       this.ws = null;
+      this.finishWaiter?.("lost");
       if (this.destroyed) {
-        console.log(`[ASR ${this.clientId}] 已销毁，不再重连`);
+        log.debug("已销毁，不再重连", { client: this.clientId });
         return;
       }
-      // 3秒后自动重连
-      setTimeout(() => this.connect(), CONFIG.reconnectDelay);
+      // 3秒后自动重连；destroy 时取消
+      reconnects.inc();
+      this.reconnectTimer = setTimeout(() => this.connect(), CONFIG.reconnectDelay);
     });
 
-    this.ws.on("error", (error) => {
-      console.error(`[ASR ${this.clientId}] WebSocket 错误:`, error.message);
+    ws.on("error", (error) => {
+      if (this.ws !== ws) return;
+      log.error("WebSocket 错误", { client: this.clientId, error: error.message });
       this.callbacks.onError(`WebSocket 错误: ${error.message}`);
     });
   }
@@ -105,9 +157,7 @@ export class AsrService {
   // ==================== 任务管理 ====================
   private sendRunTask(): void {
     if (!this.isConnected()) {
-      console.error(
-        `[ASR ${this.clientId}] WebSocket 未就绪，无法发送 run-task`,
-      );
+      log.error("WebSocket 未就绪，无法发送 run-task", { client: this.clientId });
       return;
     }
 
@@ -132,7 +182,7 @@ export class AsrService {
     };
 
     this.ws!.send(JSON.stringify(message));
-    console.log(`[ASR ${this.clientId}] 已发送 run-task`);
+    log.debug("已发送 run-task", { client: this.clientId, task: this.taskId });
   }
 
   private sendFinishTask(): void {
@@ -148,7 +198,7 @@ export class AsrService {
     };
 
     this.ws!.send(JSON.stringify(message));
-    console.log(`[ASR ${this.clientId}] 已发送 finish-task`);
+    log.debug("已发送 finish-task", { client: this.clientId, task: this.taskId });
   }
 
   // ==================== 消息处理 ====================
@@ -159,50 +209,72 @@ export class AsrService {
 
     switch (event) {
       case "task-started":
-        console.log(`[ASR ${this.clientId}] ✅ 任务已启动，开始接收音频`);
+        log.info("任务已启动", { client: this.clientId, task: this.taskId });
         this.taskStarted = true;
         break;
 
       case "result-generated":
         const sentence = message.payload?.output?.sentence;
         if (sentence) {
-          this.callbacks.onResult(sentence.text, sentence.sentence_end);
+          const endTime = sentence.end_time ?? null;
+          this.callbacks.onResult(sentence.text, sentence.sentence_end, {
+            beginTime: sentence.begin_time,
+            endTime,
+            firstPartial: !this.sentenceOpen,
+            speechStart: this.timingAt(sentence.begin_time),
+            speechEnd: endTime === null ? null : this.timingAt(endTime),
+          });
+          this.sentenceOpen = !sentence.sentence_end;
 
           if (sentence.sentence_end) {
-            console.log(
-              `[ASR ${this.clientId}] 句子结束: "${sentence.text}" (${sentence.begin_time}-${sentence.end_time}ms)`,
-            );
+            log.debug("句子结束", {
+              client: this.clientId,
+              text: sentence.text,
+              beginMs: sentence.begin_time,
+              endMs: sentence.end_time,
+            });
           }
         }
         break;
 
       case "task-finished":
-        console.log(`[ASR ${this.clientId}] 任务完成`);
+        log.debug("任务完成", { client: this.clientId, task: this.taskId });
         this.callbacks.onComplete();
+        this.finishWaiter?.("finished");
         break;
 
       case "task-failed":
         const error = `${message.header.error_code}: ${message.header.error_message}`;
-        console.error(`[ASR ${this.clientId}] ❌ 任务失败:`, error);
+        log.error("任务失败", { client: this.clientId, task: this.taskId, error });
         this.callbacks.onError(error);
         this.taskStarted = false;
+        this.finishWaiter?.("lost");
         break;
 
       default:
-        console.log(`[ASR ${this.clientId}] 未知事件: ${event}`);
+        log.sampled("debug", "unknown_event", 5, "未知事件", { client: this.clientId, event });
     }
   }
 
   // ==================== 音频流管理 ====================
-  appendAudioChunk(chunk: Buffer): void {
+  /**
+   * 发送一块 PCM16 音频
+   * @param capturedAt 设备采集时间（服务器时钟），缺省为发送时间
+   * @param receivedAt 服务器接收时间，缺省为发送时间
+   */
+  appendAudioChunk(frame: PooledFrame, capturedAt?: number, receivedAt?: number): void {
     if (!this.taskStarted || !this.isConnected()) {
       return;
     }
 
+    // 压缩扩展开启时 ws 会排队异步处理，写完才归还帧
+    frame.retain();
     try {
-      this.ws!.send(chunk);
+      this.ws!.send(frame.pcm, () => frame.release());
+      this.recordSent(frame.length, capturedAt, receivedAt);
     } catch (error) {
-      console.error(`[ASR ${this.clientId}] 发送音频块失败:`, error);
+      frame.release();
+      log.sampled("error", "send_failed", 5, "发送音频块失败", { client: this.clientId, error });
       this.callbacks.onError(`发送失败: ${error}`);
     }
   }
@@ -214,17 +286,85 @@ export class AsrService {
     }
   }
 
+  /**
+   * 结束识别并销毁：发送 finish-task，等待服务端返回剩余结果与 task-finished
+   * 之后不再接收音频；剩余结果照常回调 onResult
+   * @param timeoutMs 超时后直接销毁，结果为 lost
+   */
+  finish(timeoutMs: number): Promise<AsrFinishResult> {
+    if (this.finishWaiter) return Promise.resolve("idle");
+    if (this.destroyed || !this.taskStarted || !this.isConnected()) {
+      this.destroy();
+      return Promise.resolve("idle");
+    }
+    return new Promise((resolve) => {
+      const settle = (result: AsrFinishResult) => {
+        if (this.finishWaiter !== settle) return;
+        this.finishWaiter = null;
+        clearTimeout(timer);
+        this.destroy();
+        resolve(result);
+      };
+      const timer = setTimeout(() => settle("lost"), Math.max(0, timeoutMs));
+      this.finishWaiter = settle;
+      this.sendFinishTask();
+      this.taskStarted = false;
+    });
+  }
+
   // ==================== 工具方法 ====================
   private isConnected(): boolean {
     return this.ws?.readyState === WebSocket.OPEN;
   }
 
+  private resetTimeline(): void {
+    this.sentAudioMs = 0;
+    this.timelineHead = 0;
+    this.timelineLength = 0;
+    this.sentenceOpen = false;
+  }
+
+  private recordSent(bytes: number, capturedAt?: number, receivedAt?: number): void {
+    const i = this.timelineHead;
+    const now = Date.now();
+    this.timelineOffset[i] = this.sentAudioMs;
+    this.timelineCapturedAt[i] = capturedAt ?? now;
+    this.timelineReceivedAt[i] = receivedAt ?? now;
+    this.timelineSentAt[i] = now;
+    this.timelineHead = (i + 1) % CONFIG.timelineSize;
+    if (this.timelineLength < CONFIG.timelineSize) this.timelineLength++;
+    this.sentAudioMs += (bytes / 2 / CONFIG.sampleRate) * 1000;
+  }
+
+  // 从最新块向前查找包含该偏移的块，识别结果通常落在最近几秒内
+  private timingAt(offsetMs: number): AudioTiming | null {
+    const size = CONFIG.timelineSize;
+    for (let n = 1; n <= this.timelineLength; n++) {
+      const i = (this.timelineHead - n + size) % size;
+      if (this.timelineOffset[i] <= offsetMs) {
+        // 块内偏移按实时音频折算到采集时间
+        const within = offsetMs - this.timelineOffset[i];
+        return {
+          capturedAt: this.timelineCapturedAt[i] + within,
+          receivedAt: this.timelineReceivedAt[i],
+          sentAt: this.timelineSentAt[i],
+        };
+      }
+    }
+    return null;
+  }
+
   // ==================== 销毁 ====================
 
   destroy(): void {
     if (this.destroyed) return; // 防止重复调用
-    console.log(`[ASR ${this.clientId}] 销毁实例`);
+    log.debug("销毁实例", { client: this.clientId });
     this.destroyed = true; // ✅ 标记为销毁
+    sessionsGauge.dec();
+    if (this.reconnectTimer) {
+      clearTimeout(this.reconnectTimer);
+      this.reconnectTimer = null;
+    }
     try {
       if (this.taskStarted) {
         this.sendFinishTask();
@@ -234,11 +374,17 @@ export class AsrService {
       if (this.ws) {
         if (this.ws.readyState === WebSocket.OPEN) {
           this.ws.close(1000, "Client destroyed");
+        } else if (this.ws.readyState === WebSocket.CONNECTING) {
+          // 握手未完成时 close 不会中止连接，建连成功后 socket 就没人关闭了
+          this.ws.terminate();
         }
         this.ws = null;
       }
     } catch (err) {
-      console.error(`[ASR ${this.clientId}] destroy() 出错:`, err);
+      log.error("destroy() 出错", { client: this.clientId, error: err });
     }
   }
 }
+
+export const createDashscopeAsr: AsrBackendFactory = (callbacks, clientId) =>
+  new AsrService(callbacks, clientId);
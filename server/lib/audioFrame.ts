@@ -0,0 +1,84 @@
+// ==================== 音频帧协议 ====================
+// v1（旧固件）：整帧都是 PCM16
+// v2：8 字节头 + PCM16
+//   [0..3] uint32 LE 帧序号
+//   [4..7] uint32 LE 设备采集时间（millis()，本帧第一个样本）
+export const FRAME_HEADER_BYTES = 8;
+
+export interface DeviceStreamInfo {
+  deviceId: string | null; // 固件通过 ?id= 上报（MAC），旧固件为 null
+  version: 1 | 2;
+  priority: number; // ?prio=，过载时优先保留高优先级设备的 ASR
+  room: string | null; // ?room=，同一房间的设备共用一路 ASR（lib/roomArbiter.ts）
+  sampleRate: 8000 | 16000; // ?sr=8000 为窄带固件，接入时插值回 16 kHz（lib/resample.ts）
+}
+
+export interface AudioFrame {
+  seq: number | null;
+  deviceMs: number | null;
+  pcm: Buffer; // 指向原始数据的视图，不复制
+}
+
+/**
+ * 从升级请求 URL 中解析设备信息
+ * @param url 例如 /api/audio?id=AABBCCDDEEFF&v=2&prio=1&room=office-3f&sr=8000
+ */
+export function parseDeviceStreamInfo(url: URL): DeviceStreamInfo {
+  const id = url.searchParams.get("id");
+  const room = url.searchParams.get("room");
+  const priority = Number(url.searchParams.get("prio"));
+  return {
+    deviceId: id && /^[\w.-]{1,64}$/.test(id) ? id : null,
+    version: url.searchParams.get("v") === "2" ? 2 : 1,
+    priority: Number.isFinite(priority) ? priority : 0,
+    room: room && /^[\w.-]{1,64}$/.test(room) ? room : null,
+    sampleRate: url.searchParams.get("sr") === "8000" ? 8000 : 16000,
+  };
+}
+
+export function parseAudioFrame(data: Buffer, version: 1 | 2): AudioFrame | null {
+  if (version === 1) {
+    return { seq: null, deviceMs: null, pcm: data };
+  }
+  if (data.length < FRAME_HEADER_BYTES) return null;
+  return {
+    seq: data.readUInt32LE(0),
+    deviceMs: data.readUInt32LE(4),
+    pcm: data.subarray(FRAME_HEADER_BYTES),
+  };
+}
+
+// ==================== 设备时钟映射 ====================
+// 设备 millis() 与服务器时钟的偏移取“接收时间 - 采集时间”的窗口最小值，
+// 即单向延迟最小的那一帧；按窗口滚动更新以跟随晶振漂移。
+export class DeviceClock {
+  private offset: number | null = null;
+  private windowMin = Infinity;
+  private windowStart = 0;
+
+  constructor(private readonly windowMs: number = 10000) {}
+
+  /**
+   * 记录一帧并返回其采集时间（服务器时钟，毫秒）
+   * @param deviceMs 帧头中的设备时间
+   * @param receivedAt 服务器接收时间 Date.now()
+   */
+  observe(deviceMs: number, receivedAt: number): number {
+    const sample = receivedAt - deviceMs;
+    if (this.offset === null || sample < this.offset) {
+      this.offset = sample;
+    }
+    if (sample < this.windowMin) this.windowMin = sample;
+    if (receivedAt - this.windowStart >= this.windowMs) {
+      // 设备重启时 millis() 归零，偏移整体变大，窗口结束后即被采纳
+      if (this.windowStart > 0) this.offset = this.windowMin;
+      this.windowMin = Infinity;
+      this.windowStart = receivedAt;
+    }
+    return deviceMs + this.offset;
+  }
+
+  toServerTime(deviceMs: number): number | null {
+    return this.offset === null ? null : deviceMs + this.offset;
+  }
+}
@@ -0,0 +1,1080 @@
+import { mkdirSync } from "fs";
+import path from "path";
+import {
+  createDashscopeAsr,
+  type AsrBackend,
+  type AsrBackendFactory,
+  type AsrFinishResult,
+  type AsrResultInfo,
+} from "./asrService";
+import { metrics } from "./metrics";
+import {
+  RelayCommandTracker,
+  parseDeviceAck,
+  type CommandSink,
+} from "./relayCommand";
+import {
+  DeviceClock,
+  parseAudioFrame,
+  parseDeviceStreamInfo,
+} from "./audioFrame";
+import { tracer, type UtteranceTrace } from "./tracing";
+import {
+  loadShedder,
+  SHED_ARCHIVE,
+  SHED_ASR,
+} from "./loadShedder";
+import { DeviceRateLimiter } from "./rateLimiter";
+import { heartbeatMonitor, type HeartbeatTarget } from "./heartbeat";
+import { CommandDeduper, RoomArbiter } from "./roomArbiter";
+import { framePool, type PooledFrame } from "./framePool";
+import { archiveCompressor, type ArchiveDrainReport } from "./archiveCompressor";
+import { noteArchived } from "./retention";
+import { noteTranscript } from "./transcripts";
+import { AudioQualityTracker } from "./audioQuality";
+import { HalfbandUpsampler } from "./resample";
+import { logger } from "./logger";
+import { writeWav, writeWavSync } from "./wav";
+
+// ==================== 配置 ====================
+export const AUDIO_CONFIG = {
+  sampleRate: 16000,
+  channels: 1,
+  bitDepth: 16,
+  autoSaveIntervalMs: Number(process.env.AUTO_SAVE_INTERVAL_MS) || 60000, // ✅ 每60秒自动保存
+  maxDeferredSegments: 64, // 过载时推迟归档的段数上限，超出后照常写盘
+  drainConcurrency: Number(process.env.SHUTDOWN_FLUSH_CONCURRENCY) || 4, // 退出时同时写盘的段数
+} as const;
+
+const BYTES_PER_SAMPLE = AUDIO_CONFIG.channels * (AUDIO_CONFIG.bitDepth / 8);
+
+// ==================== 类型定义 ====================
+// 管线的输出端：单进程模式直接广播，集群模式经 IPC 总线转给主进程
+export interface PipelineOutput {
+  // 帧只在调用期间有效；异步发送需 retain，写完 release（见 lib/framePool.ts）
+  // capturedAt 为采集时间（服务器时钟），监听混音按它对齐各路
+  // clientId 是会话键：设备上报了 ID 时就是设备 ID（重连取代旧会话，不加后缀），
+  // 组成员、监听混音的输入都按它匹配；没上报 ID 的旧固件不属于任何组
+  audio(clientId: string, frame: PooledFrame, capturedAt: number): void;
+  data(message: Record<string, unknown>): void;
+  deviceUp?(clientId: string): void;
+  deviceDown?(clientId: string): void;
+  // 继电器回执，供组控制统计整组完成时间
+  ack?(clientId: string, commandId: number, relay: 0 | 1): void;
+}
+
+// 设备连接：ws 的 WebSocket，或原生网关转发的会话（lib/gatewayBridge.ts）
+export interface DeviceSocket extends CommandSink {
+  on(event: "message", listener: (data: Buffer, isBinary: boolean) => void): this;
+  on(event: "close", listener: () => void): this;
+  on(event: "error", listener: (error: Error) => void): this;
+  on(event: "ping" | "pong", listener: () => void): this;
+  close(code?: number, reason?: string): void;
+  // 服务器侧心跳；原生网关会话由网关自己探活，不提供这两个方法
+  ping?(): void;
+  terminate?(): void;
+}
+
+export interface AudioPipelineOptions {
+  audioDir: string;
+  output: PipelineOutput;
+  asrBackend?: AsrBackendFactory; // 缺省为 DashScope；回放压测传入离线后端
+}
+
+// dispatch=false：房间内重复的指令，只广播识别结果、不下发
+type AsrResultHandler = (text: string, isEnd: boolean, info: AsrResultInfo, dispatch: boolean) => void;
+
+interface DeviceSession {
+  ws: DeviceSocket;
+  commands: RelayCommandTracker;
+  onAsrResult: AsrResultHandler;
+  release: () => void; // 与连接关闭时相同的清理，退出收尾时不等关闭握手直接调用
+}
+
+// 同一房间的设备共用一路 ASR，由仲裁器择优送入
+interface Room {
+  arbiter: RoomArbiter;
+  asr: AsrBackend;
+  deduper: CommandDeduper;
+  speaker: string | null; // 当前句子归属的设备
+}
+
+// 一段待归档的音频：持有帧的引用，写盘时一次 writev，不再逐帧拼接
+interface ArchiveSegment {
+  deviceId: string; // 按设备选择归档压缩策略
+  frames: PooledFrame[];
+  bytes: number;
+  // 文件名（不含扩展名）与第一帧的采集时间，第一帧到达时确定；识别结果据此换算在文件中的偏移
+  stem: string;
+  capturedAt: number;
+}
+
+// 已交给归档的上一段：跨段的句子起点落在这里
+interface ArchivedSegment {
+  stem: string;
+  capturedAt: number;
+  durationMs: number;
+}
+
+interface PendingSegment {
+  clientId: string;
+  segment: ArchiveSegment;
+  segmentIndex: number;
+}
+
+// 退出收尾时没能写盘的段
+export interface DroppedSegment {
+  clientId: string;
+  segment: number; // 段序号（从 1 开始，与日志一致）
+  seconds: number;
+  reason: "deadline" | "unfinished" | "write_failed";
+}
+
+// 退出收尾报告，见 drain()
+export interface DrainReport {
+  devices: number;
+  segmentsFlushed: number;
+  bytesFlushed: number;
+  dropped: DroppedSegment[];
+  asr: Record<AsrFinishResult, number>;
+  archive: ArchiveDrainReport;
+  elapsedMs: number;
+}
+
+export function emptyDrainReport(): DrainReport {
+  return {
+    devices: 0,
+    segmentsFlushed: 0,
+    bytesFlushed: 0,
+    dropped: [],
+    asr: { finished: 0, idle: 0, lost: 0 },
+    archive: { completed: 0, queued: 0, interrupted: 0 },
+    elapsedMs: 0,
+  };
+}
+
+// 集群模式下汇总各 worker 的报告
+export function mergeDrainReports(reports: DrainReport[]): DrainReport {
+  const total = emptyDrainReport();
+  for (const report of reports) {
+    total.devices += report.devices;
+    total.segmentsFlushed += report.segmentsFlushed;
+    total.bytesFlushed += report.bytesFlushed;
+    total.dropped.push(...report.dropped);
+    for (const key of Object.keys(total.asr) as AsrFinishResult[]) total.asr[key] += report.asr[key];
+    for (const key of Object.keys(total.archive) as Array<keyof ArchiveDrainReport>) {
+      total.archive[key] += report.archive[key];
+    }
+    total.elapsedMs = Math.max(total.elapsedMs, report.elapsedMs);
+  }
+  return total;
+}
+
+function segmentDurationMs(segment: ArchiveSegment): number {
+  return (segment.bytes / BYTES_PER_SAMPLE / AUDIO_CONFIG.sampleRate) * 1000;
+}
+
+function releaseSegment(segment: ArchiveSegment) {
+  for (const frame of segment.frames) frame.release();
+  segment.frames.length = 0;
+  segment.bytes = 0;
+}
+
+const deviceLog = logger.get("device");
+const asrLog = logger.get("asr");
+const archiveLog = logger.get("archive");
+const shedLog = logger.get("loadshed");
+const roomLog = logger.get("room");
+
+// ==================== 指标 ====================
+const ingestBytes = metrics.counter(
+  "audio_ingest_bytes_total",
+  "Audio bytes received from devices",
+  ["device"],
+);
+const ingestFrames = metrics.counter(
+  "audio_ingest_frames_total",
+  "Audio frames received from devices",
+  ["device"],
+);
+// 按上行带宽分：bytes / audio_seconds 即每秒音频的上行字节数（含帧头），对比窄带省下的流量
+const uplinkBytes = metrics.counter(
+  "audio_uplink_bytes_total",
+  "Audio bytes received from devices, by uplink band (narrow = 8 kHz firmware)",
+  ["band"],
+);
+const uplinkSeconds = metrics.counter(
+  "audio_uplink_audio_seconds_total",
+  "Seconds of audio received from devices, by uplink band",
+  ["band"],
+);
+const frameInterarrival = metrics.histogram(
+  "audio_frame_interarrival_seconds",
+  "Time between consecutive audio frames of one device",
+  [],
+  [0.01, 0.025, 0.04, 0.05, 0.06, 0.075, 0.1, 0.15, 0.25, 0.5, 1],
+);
+const frameJitter = metrics.gauge(
+  "audio_frame_jitter_seconds",
+  "RFC 3550 style interarrival jitter estimate",
+  ["device"],
+);
+const activeDevices = metrics.gauge(
+  "audio_devices_connected",
+  "Connected audio input devices",
+);
+const sessionsSuperseded = metrics.counter(
+  "device_sessions_superseded_total",
+  "Device sessions replaced by a reconnect of the same device before they closed",
+);
+const asrFirstPartialLatency = metrics.histogram(
+  "asr_first_partial_latency_seconds",
+  "Speech start audio sent to ASR -> first partial result",
+);
+const asrFinalLatency = metrics.histogram(
+  "asr_final_latency_seconds",
+  "Speech end audio sent to ASR -> final result",
+);
+const commandAckLatency = metrics.histogram(
+  "relay_command_ack_latency_seconds",
+  "Relay command sent -> device ack",
+);
+const commandTimeouts = metrics.counter(
+  "relay_command_timeouts_total",
+  "Relay commands that were never acked",
+);
+const segmentWriteSeconds = metrics.histogram(
+  "audio_segment_write_seconds",
+  "Time spent encoding and writing one WAV segment",
+);
+const segmentBytes = metrics.counter(
+  "audio_segment_bytes_total",
+  "PCM bytes archived to WAV segments",
+);
+const segmentWriteErrors = metrics.counter(
+  "audio_segment_write_errors_total",
+  "Segments lost because the WAV write failed (disk full, missing directory)",
+);
+const deferredSegmentsGauge = metrics.gauge(
+  "audio_segments_deferred",
+  "Segments waiting to be archived because of load shedding",
+);
+const asrShedFrames = metrics.counter(
+  "asr_shed_frames_total",
+  "Frames not forwarded to ASR because of load shedding",
+);
+const dedupedCommands = metrics.counter(
+  "room_commands_deduped_total",
+  "Relay commands suppressed as duplicates within a room",
+  ["room"],
+);
+// 音频质量（lib/audioQuality.ts）：gauge 在抓取时从各连接的统计取值，每帧只更新统计本身
+const qualityRms = metrics.gauge(
+  "audio_quality_rms_dbfs",
+  "Smoothed audio level per device (dBFS)",
+  ["device"],
+);
+const qualityPeak = metrics.gauge(
+  "audio_quality_peak_dbfs",
+  "Decaying peak sample level per device (dBFS)",
+  ["device"],
+);
+const qualityClipping = metrics.gauge(
+  "audio_quality_clipping_ratio",
+  "Smoothed fraction of full-scale samples per device",
+  ["device"],
+);
+const qualityDcOffset = metrics.gauge(
+  "audio_quality_dc_offset",
+  "Smoothed DC offset per device (fraction of full scale)",
+  ["device"],
+);
+const qualityNoiseFloor = metrics.gauge(
+  "audio_quality_noise_floor_dbfs",
+  "Tracked noise floor per device (dBFS)",
+  ["device"],
+);
+const qualitySnr = metrics.gauge(
+  "audio_quality_snr_db",
+  "Estimated speech level above the noise floor per device",
+  ["device"],
+);
+const framesLost = metrics.counter(
+  "audio_frames_lost_total",
+  "Frames missing from the v2 sequence (sent by the device, never received)",
+  ["device"],
+);
+const seqResets = metrics.counter(
+  "audio_frame_seq_resets_total",
+  "Frame sequence jumps too large to be loss (device restarts)",
+);
+// 按连接登记的表，设备全部断开后应回到 0；浸泡测试（bench/soak.ts）据此判断泄漏
+const sessionEntries = metrics.gauge(
+  "audio_pipeline_entries",
+  "Entries in per-connection pipeline tables",
+  ["table"],
+);
+
+// ==================== 设备音频管线 ====================
+// 每台设备：解帧 -> 播放分发 / ASR / 分段归档；识别结果下发为继电器指令
+export function createAudioPipeline(options: AudioPipelineOptions) {
+  const { output } = options;
+  const createAsr = options.asrBackend ?? createDashscopeAsr;
+  mkdirSync(options.audioDir, { recursive: true });
+
+  // 连接管理
+  const audioSegments = new Map<string, ArchiveSegment>();
+  const asrInstances = new Map<string, AsrBackend>();
+  const saveTimers = new Map<string, NodeJS.Timeout>(); // ✅ 保存定时器
+  const segmentCounters = new Map<string, number>(); // ✅ 文件段计数器
+  const devices = new Map<string, DeviceSession>();
+  const devicePriorities = new Map<string, number>();
+  const asrShedClients = new Set<string>(); // 过载时暂停 ASR 的设备
+  const rooms = new Map<string, Room>();
+  const qualityTrackers = new Map<string, AudioQualityTracker>();
+  const deferredSegments: PendingSegment[] = [];
+  let clientCounter = 0;
+
+  // 退出收尾（见 drain()）：段与 ASR 不再按连接关闭处理，而是交给收尾统一完成
+  let draining = false;
+  let drainDeadline = 0;
+  const drainSegments: PendingSegment[] = [];
+  const drainAsr: Array<Promise<AsrFinishResult>> = [];
+
+  metrics.onCollect(() => {
+    sessionEntries.labels("segments").set(audioSegments.size);
+    sessionEntries.labels("asr").set(asrInstances.size);
+    sessionEntries.labels("save_timers").set(saveTimers.size);
+    sessionEntries.labels("segment_counters").set(segmentCounters.size);
+    sessionEntries.labels("devices").set(devices.size);
+    sessionEntries.labels("priorities").set(devicePriorities.size);
+    sessionEntries.labels("asr_shed").set(asrShedClients.size);
+    sessionEntries.labels("rooms").set(rooms.size);
+    sessionEntries.labels("quality").set(qualityTrackers.size);
+    for (const [clientId, tracker] of qualityTrackers) {
+      const quality = tracker.snapshot();
+      if (quality.frames === 0) continue;
+      qualityRms.labels(clientId).set(quality.rmsDbfs);
+      qualityPeak.labels(clientId).set(quality.peakDbfs);
+      qualityClipping.labels(clientId).set(quality.clipRatio);
+      qualityDcOffset.labels(clientId).set(quality.dcOffset);
+      qualityNoiseFloor.labels(clientId).set(quality.noiseFloorDbfs);
+      if (quality.snrDb !== null) qualitySnr.labels(clientId).set(quality.snrDb);
+    }
+  });
+
+  // 时间取段开始（第一帧到达）而不是写盘时刻，段还在录制时识别结果就能指向它
+  function segmentStem(clientId: string, segmentIndex: number, startedAt: number): string {
+    const timestamp = new Date(startedAt).toISOString().replace(/[:.]/g, "-").slice(0, 19);
+    return `audio_${clientId}_seg${segmentIndex}_${timestamp}`;
+  }
+
+  function segmentPath(segment: ArchiveSegment): string {
+    return path.join(options.audioDir, `${segment.stem}.wav`);
+  }
+
+  function segmentSaved(filePath: string, segment: ArchiveSegment, startedAt: number): void {
+    segmentWriteSeconds.observe((performance.now() - startedAt) / 1000);
+    segmentBytes.inc(segment.bytes);
+    archiveLog.info("段已保存", { file: filePath, bytes: segment.bytes });
+    noteArchived({ filePath, bytes: 44 + segment.bytes });
+    archiveCompressor.enqueue(filePath, segment.deviceId);
+  }
+
+  // 写盘后释放段内帧的引用（写盘失败也释放）
+  function saveAudioFile(clientId: string, segment: ArchiveSegment): void {
+    try {
+      if (segment.bytes % 2 !== 0) {
+        archiveLog.error("段长度不是整数个样本", { client: clientId, bytes: segment.bytes });
+        return;
+      }
+
+      // ✅ 如果没有数据就不保存
+      if (segment.bytes === 0) {
+        archiveLog.debug("缓冲区为空，跳过保存", { client: clientId });
+        return;
+      }
+
+      const filePath = segmentPath(segment);
+      const startedAt = performance.now();
+      writeWavSync(filePath, segment.frames.map((frame) => frame.pcm));
+      segmentSaved(filePath, segment, startedAt);
+    } catch (error) {
+      // 在定时器与连接关闭回调里调用，抛出会让整个进程退出；丢掉这一段，会话照常清理
+      segmentWriteErrors.inc();
+      archiveLog.error("段写盘失败", { client: clientId, file: segment.stem, error });
+    } finally {
+      releaseSegment(segment);
+    }
+  }
+
+  // 退出收尾用的异步版本：多个段同时写盘，不阻塞事件循环上的 ASR 收尾
+  // @returns 是否写了文件（空段不写）
+  async function saveAudioFileAsync(segment: ArchiveSegment): Promise<boolean> {
+    try {
+      if (segment.bytes === 0 || segment.bytes % 2 !== 0) return false;
+      const filePath = segmentPath(segment);
+      const startedAt = performance.now();
+      await writeWav(filePath, segment.frames.map((frame) => frame.pcm));
+      segmentSaved(filePath, segment, startedAt);
+      return true;
+    } finally {
+      releaseSegment(segment);
+    }
+  }
+
+  // ==================== 负载降级 ====================
+  // 第 3 级时暂停最低优先级一档设备的 ASR；只有一档时不暂停，保证仍可语音控制
+  function updateAsrShedding() {
+    const next = new Set<string>();
+    if (loadShedder.level >= SHED_ASR) {
+      const tiers = [...new Set(devicePriorities.values())].sort((a, b) => a - b);
+      if (tiers.length > 1) {
+        devicePriorities.forEach((priority, clientId) => {
+          if (priority === tiers[0]) next.add(clientId);
+        });
+      }
+    }
+    for (const clientId of next) {
+      if (!asrShedClients.has(clientId)) {
+        asrShedClients.add(clientId);
+        shedLog.warn("暂停 ASR", {
+          client: clientId,
+          reason: "LAG_SHED_ASR",
+          priority: devicePriorities.get(clientId),
+        });
+      }
+    }
+    for (const clientId of asrShedClients) {
+      if (!next.has(clientId)) {
+        asrShedClients.delete(clientId);
+        shedLog.warn("恢复 ASR", { client: clientId, reason: "LAG_SHED_ASR_LIFTED" });
+      }
+    }
+  }
+
+  // 第 2 级及以上时归档排队，回落后逐个写盘（每个 tick 一段，避免再次阻塞）
+  function archiveSegment(clientId: string, segment: ArchiveSegment, segmentIndex: number) {
+    if (draining) {
+      drainSegments.push({ clientId, segment, segmentIndex });
+      return;
+    }
+    if (
+      loadShedder.level >= SHED_ARCHIVE &&
+      deferredSegments.length < AUDIO_CONFIG.maxDeferredSegments
+    ) {
+      deferredSegments.push({ clientId, segment, segmentIndex });
+      deferredSegmentsGauge.set(deferredSegments.length);
+      shedLog.warn("推迟归档", {
+        client: clientId,
+        segment: segmentIndex + 1,
+        reason: "LAG_DEFER_ARCHIVE",
+        queued: deferredSegments.length,
+      });
+      return;
+    }
+    saveAudioFile(clientId, segment);
+  }
+
+  function drainDeferredSegments() {
+    if (loadShedder.level >= SHED_ARCHIVE) return;
+    const next = deferredSegments.shift();
+    deferredSegmentsGauge.set(deferredSegments.length);
+    if (!next) return;
+    saveAudioFile(next.clientId, next.segment);
+    setImmediate(drainDeferredSegments);
+  }
+
+  loadShedder.onChange((decision) => {
+    updateAsrShedding();
+    if (decision.to < SHED_ARCHIVE) drainDeferredSegments();
+  });
+  loadShedder.start();
+
+  // 会话结束时的 ASR：平时直接销毁；退出收尾时先 finish-task，等最后的识别结果
+  function retireAsr(asr: AsrBackend) {
+    if (draining) drainAsr.push(asr.finish(drainDeadline - Date.now()));
+    else asr.destroy();
+  }
+
+  // ==================== 房间 ====================
+  function joinRoom(name: string, clientId: string): Room {
+    let room = rooms.get(name);
+    if (!room) {
+      const created: Room = {
+        arbiter: new RoomArbiter({
+          room: name,
+          feed: (speakerId, frame, capturedAt, receivedAt) => {
+            if (asrShedClients.has(speakerId)) {
+              asrShedFrames.inc();
+              return;
+            }
+            created.asr.appendAudioChunk(frame, capturedAt, receivedAt);
+          },
+          onDecision: (decision) => {
+            roomLog.sampled("info", name, 5, "选择设备", {
+              room: name,
+              client: decision.clientId,
+              snrDb: Number(decision.snrDb.toFixed(1)),
+              candidates: decision.candidates,
+              switched: decision.switched,
+            });
+          },
+        }),
+        asr: createAsr(
+          {
+            onResult: (text, isEnd, info) => {
+              // 一句话固定归属开口时选中的设备
+              if (info.firstPartial || !created.speaker) {
+                created.speaker = created.arbiter.selected;
+              }
+              const dispatch = !isEnd || created.deduper.accept(text);
+              if (!dispatch) {
+                dedupedCommands.labels(name).inc();
+                roomLog.info("重复指令已忽略", { room: name, text });
+              }
+              const speaker = created.speaker ? devices.get(created.speaker) : undefined;
+              speaker?.onAsrResult(text, isEnd, info, dispatch);
+              if (isEnd) created.speaker = null;
+            },
+            onError: (error) => {
+              asrLog.error("识别出错", { client: `room:${name}`, error });
+            },
+          },
+          `room:${name}`,
+        ),
+        deduper: new CommandDeduper(),
+        speaker: null,
+      };
+      room = created;
+      rooms.set(name, room);
+    }
+    room.arbiter.join(clientId);
+    return room;
+  }
+
+  function leaveRoom(name: string, clientId: string) {
+    const room = rooms.get(name);
+    if (!room) return;
+    room.arbiter.leave(clientId);
+    if (room.arbiter.size > 0) return;
+    retireAsr(room.asr);
+    room.arbiter.dispose();
+    dedupedCommands.remove(name);
+    rooms.delete(name);
+  }
+
+  // 处理 ESP32 音频输入
+  function handleAudioInput(ws: DeviceSocket, url: URL) {
+    // 收尾期间（如网关转来的新会话）不再接入
+    if (draining) {
+      ws.close(1012, "server restart");
+      return;
+    }
+    // 新固件上报设备 ID（MAC），会话以设备 ID 为键：指令、组控制、监听混音都按它找设备。
+    // Wi-Fi 掉线后设备往往在心跳判死旧连接之前就重连上来，这时旧连接是半开的：
+    // 立即释放它（段照常归档）并断开，设备 ID 交给新连接
+    const stream = parseDeviceStreamInfo(url);
+    ++clientCounter;
+    const clientId = stream.deviceId ?? `client_${process.pid}_${clientCounter}`;
+    const stale = devices.get(clientId);
+    // 段号接着旧连接往下数，旧连接不到一秒就被取代时段文件名也不会撞上
+    let firstSegment = 0;
+    if (stale) {
+      firstSegment = (segmentCounters.get(clientId) ?? 0) + 1;
+      deviceLog.warn("同一设备重新连接，取代旧连接", { client: clientId });
+      sessionsSuperseded.inc();
+      stale.release();
+      if (stale.ws.terminate) stale.ws.terminate();
+      else stale.ws.close(1008, "superseded");
+    }
+    deviceLog.info("设备连接", {
+      client: clientId,
+      version: stream.version,
+      room: stream.room ?? undefined,
+      sampleRate: stream.sampleRate,
+    });
+
+    const deviceId = stream.deviceId ?? clientId;
+    const newSegment = (): ArchiveSegment => ({ deviceId, frames: [], bytes: 0, stem: "", capturedAt: 0 });
+    audioSegments.set(clientId, newSegment());
+    segmentCounters.set(clientId, firstSegment);
+    let lastArchived: ArchivedSegment | null = null;
+    devicePriorities.set(clientId, stream.priority);
+    updateAsrShedding();
+    activeDevices.inc();
+
+    let audioChunkCount = 0;
+
+    // 每帧只做数字累加，child 在连接建立时取一次
+    const deviceBytes = ingestBytes.labels(clientId);
+    const deviceFrames = ingestFrames.labels(clientId);
+    const deviceJitter = frameJitter.labels(clientId);
+    const deviceFramesLost = framesLost.labels(clientId);
+    // 窄带设备在这里插值回 16 kHz，之后的处理与宽带设备相同
+    const upsampler = stream.sampleRate === 8000 ? new HalfbandUpsampler() : null;
+    const band = upsampler ? "narrow" : "wide";
+    const bandBytes = uplinkBytes.labels(band);
+    const bandSeconds = uplinkSeconds.labels(band);
+    const quality = new AudioQualityTracker();
+    qualityTrackers.set(clientId, quality);
+    let lastFrameAt = 0;
+    let jitterMs = 0;
+
+    const clock = new DeviceClock();
+    const limiter = new DeviceRateLimiter();
+    const heartbeat =
+      ws.ping && ws.terminate
+        ? heartbeatMonitor.track(ws as HeartbeatTarget, clientId)
+        : { touch() {}, release() {} };
+    ws.on("ping", heartbeat.touch);
+    ws.on("pong", heartbeat.touch);
+    let closingForAbuse = false;
+
+    // 每句一条 trace：首个中间结果创建，回执或超时结束
+    let currentTrace: UtteranceTrace | null = null;
+    const tracesByCommand = new Map<number, UtteranceTrace>();
+
+    const commands = new RelayCommandTracker((id) => {
+      commandTimeouts.inc();
+      const trace = tracesByCommand.get(id);
+      if (trace) {
+        tracesByCommand.delete(id);
+        tracer.finish(trace, "ack_timeout");
+      }
+    });
+
+    // ✅ 启动定时保存
+    const saveTimer = setInterval(() => {
+      const segment = audioSegments.get(clientId);
+      if (segment && segment.bytes > 0) {
+        const segmentIndex = segmentCounters.get(clientId) || 0;
+        archiveLog.debug("定时保存", { client: clientId, segment: segmentIndex + 1 });
+        lastArchived = { stem: segment.stem, capturedAt: segment.capturedAt, durationMs: segmentDurationMs(segment) };
+        archiveSegment(clientId, segment, segmentIndex);
+
+        // 段交给归档（可能推迟写盘），开始新的段
+        audioSegments.set(clientId, newSegment());
+        segmentCounters.set(clientId, segmentIndex + 1);
+      }
+    }, AUDIO_CONFIG.autoSaveIntervalMs);
+
+    saveTimers.set(clientId, saveTimer);
+
+    // 识别结果：广播到浏览器，句末下发为继电器指令
+    function handleAsrResult(
+      text: string,
+      isEnd: boolean,
+      info: AsrResultInfo,
+      dispatch: boolean = true,
+    ) {
+      // 中间结果每句几十条，默认不输出；打开 debug 时也按秒限速
+      if (isEnd) asrLog.info("识别结果", { client: clientId, text });
+      else asrLog.sampled("debug", "partial", 20, "中间结果", { client: clientId, text });
+
+      const now = Date.now();
+      if (info.firstPartial) {
+        if (info.speechStart) {
+          asrFirstPartialLatency.observe((now - info.speechStart.sentAt) / 1000);
+        }
+        currentTrace = tracer.startUtterance(clientId);
+        currentTrace.speechStart = info.speechStart;
+        currentTrace.firstPartialAt = now;
+      }
+      const trace = currentTrace;
+      if (isEnd) {
+        if (info.speechEnd) {
+          asrFinalLatency.observe((now - info.speechEnd.sentAt) / 1000);
+        }
+        currentTrace = null;
+        if (trace) {
+          trace.text = text;
+          trace.speechEnd = info.speechEnd;
+          trace.finalAt = now;
+        }
+      }
+
+      if (isEnd && text) recordTranscript(text, info, now);
+
+      // 广播到浏览器
+      output.data({
+        type: "asr_result",
+        text,
+        isEnd,
+        clientId,
+        room: stream.room ?? undefined,
+      });
+
+      // 只发送给对应的 ESP32
+      if (!isEnd) return;
+      if (!dispatch) {
+        if (trace) tracer.finish(trace, "deduped");
+        return;
+      }
+      let commandId: number | null = null;
+      if (ws.readyState === 1) {
+        try {
+          commandId = commands.send(ws, text);
+        } catch (error) {
+          deviceLog.error("指令发送失败", { client: clientId, error });
+        }
+      }
+      if (trace) {
+        if (commandId === null) {
+          tracer.finish(trace, "no_command");
+        } else {
+          trace.commandId = commandId;
+          trace.commandAt = Date.now();
+          tracesByCommand.set(commandId, trace);
+        }
+      }
+    }
+
+    // 句末结果写入转写库：句子起点换算成所在归档文件内的偏移
+    // 起点早于当前段（跨过定时分段或连接已断开）时落在上一段
+    function recordTranscript(text: string, info: AsrResultInfo, now: number) {
+      const durationMs = info.endTime !== null ? info.endTime - info.beginTime : 0;
+      const startedAt = info.speechStart?.capturedAt ?? now - durationMs;
+      const current = audioSegments.get(clientId);
+      let archive = "";
+      let offsetMs = 0;
+      if (current?.stem && startedAt >= current.capturedAt) {
+        archive = current.stem;
+        offsetMs = startedAt - current.capturedAt;
+      } else if (lastArchived?.stem) {
+        archive = lastArchived.stem;
+        offsetMs = Math.min(Math.max(0, startedAt - lastArchived.capturedAt), lastArchived.durationMs);
+      } else if (current?.stem) {
+        archive = current.stem;
+      }
+      noteTranscript({
+        device: deviceId,
+        room: stream.room,
+        ts: startedAt,
+        durationMs,
+        archive,
+        offsetMs,
+        text,
+        quality: quality.summarize(startedAt, startedAt + durationMs) ?? undefined,
+      });
+    }
+
+    devices.set(clientId, { ws, commands, onAsrResult: handleAsrResult, release: releaseSession });
+    output.deviceUp?.(clientId);
+
+    // 为当前客户端创建独立的 ASR 实例；加入房间的设备共用房间的 ASR
+    const room = stream.room ? joinRoom(stream.room, clientId) : null;
+    if (!room) {
+      const asrService = createAsr(
+        {
+          onResult: handleAsrResult,
+          onComplete: () => {
+            asrLog.debug("流结束", { client: clientId });
+          },
+          onError: (error) => {
+            asrLog.error("识别出错", {
+              client: clientId,
+              error,
+              // 没有收到音频时附带已收到的块数，区分设备没推流与转发中断
+              chunks: error.includes("NO_INPUT_AUDIO_ERROR") ? audioChunkCount : undefined,
+            });
+          },
+        },
+        clientId,
+      );
+
+      asrInstances.set(clientId, asrService);
+    }
+
+    // 设备文本帧：继电器回执
+    function handleDeviceText(text: string) {
+      const ack = parseDeviceAck(text);
+      if (!ack) return;
+      const latencyMs = commands.ack(ack.id);
+      if (latencyMs !== null) {
+        commandAckLatency.observe(latencyMs / 1000);
+        output.ack?.(clientId, ack.id, ack.relay);
+      }
+      const trace = tracesByCommand.get(ack.id);
+      if (trace) {
+        tracesByCommand.delete(ack.id);
+        trace.ackAt = Date.now();
+        trace.relayState = ack.relay;
+        tracer.finish(trace);
+      }
+    }
+
+    ws.on("message", (data: Buffer, isBinary: boolean) => {
+      // 已被同一设备的新连接取代：旧连接上迟到的数据不能写进新会话
+      if (released) return;
+      heartbeat.touch();
+      // 限流在解析之前：超限的消息不进入 ASR / 播放 / 归档
+      if (limiter.check(data.length) !== null) {
+        if (limiter.abusive && !closingForAbuse) {
+          closingForAbuse = true;
+          limiter.recordDisconnect();
+          deviceLog.warn("持续超出速率限制，断开连接", { client: clientId });
+          ws.close(1008, "rate limit exceeded");
+        }
+        return;
+      }
+
+      if (!isBinary) {
+        handleDeviceText(data.toString());
+        return;
+      }
+
+      const segment = audioSegments.get(clientId);
+      if (!segment) return;
+
+      const parsed = parseAudioFrame(data, stream.version);
+      if (!parsed) return;
+      // 复制进帧池；这一份引用归本段归档所有，其余消费者按需 retain
+      let frame: PooledFrame;
+      if (upsampler) {
+        frame = framePool.acquire((parsed.pcm.length & ~1) * 2);
+        upsampler.process(parsed.pcm, frame.pcm);
+      } else {
+        frame = framePool.copyOf(parsed.pcm);
+      }
+
+      audioChunkCount++;
+      deviceFrames.inc();
+      deviceBytes.inc(data.length);
+      bandBytes.inc(data.length);
+      bandSeconds.inc(frame.length / BYTES_PER_SAMPLE / AUDIO_CONFIG.sampleRate);
+
+      // 采集时间：v2 帧头换算到服务器时钟，旧固件按帧时长回推
+      const receivedAt = Date.now();
+      const frameMs = (frame.length / BYTES_PER_SAMPLE / AUDIO_CONFIG.sampleRate) * 1000;
+      const capturedAt =
+        parsed.deviceMs !== null
+          ? clock.observe(parsed.deviceMs, receivedAt)
+          : receivedAt - frameMs;
+
+      // 到达间隔抖动：实际间隔与帧时长之差的平滑均值
+      const now = performance.now();
+      if (lastFrameAt > 0) {
+        const interval = now - lastFrameAt;
+        const expected = frameMs;
+        jitterMs += (Math.abs(interval - expected) - jitterMs) / 16;
+        frameInterarrival.observe(interval / 1000);
+        deviceJitter.set(jitterMs / 1000);
+      }
+      lastFrameAt = now;
+
+      // 质量统计与丢帧（序号空洞）
+      const resetsBefore = quality.resets;
+      const lost = quality.push(frame.pcm, parsed.seq, capturedAt);
+      if (lost > 0) deviceFramesLost.inc(lost);
+      if (quality.resets !== resetsBefore) seqResets.inc();
+
+      // 广播实时音频到播放客户端（由输出端决定是否降载丢弃）
+      output.audio(clientId, frame, capturedAt);
+
+      // 房间设备交给仲裁器对齐择优；其余发送到该客户端专属的 ASR 服务
+      if (room) {
+        room.arbiter.push(clientId, frame, capturedAt, receivedAt);
+      }
+      const asr = asrInstances.get(clientId);
+      if (asr) {
+        if (asrShedClients.has(clientId)) {
+          asrShedFrames.inc();
+        } else {
+          asr.appendAudioChunk(frame, capturedAt, receivedAt);
+        }
+      }
+
+      // ✅ 追加到当前段（只记引用，写盘时再拼）
+      if (segment.bytes === 0) {
+        segment.stem = segmentStem(clientId, segmentCounters.get(clientId) || 0, receivedAt);
+        segment.capturedAt = capturedAt;
+      }
+      segment.frames.push(frame);
+      segment.bytes += frame.length;
+    });
+
+    // close 与 error 都会走到这里（error 之后通常还有 close），只执行一次
+    let released = false;
+    function releaseSession() {
+      if (released) return;
+      released = true;
+      heartbeat.release();
+
+      // ✅ 清除定时器
+      const timer = saveTimers.get(clientId);
+      if (timer) {
+        clearInterval(timer);
+        saveTimers.delete(clientId);
+      }
+
+      // ✅ 保存最后的数据
+      const remaining = audioSegments.get(clientId);
+      if (remaining?.bytes) {
+        const segmentIndex = segmentCounters.get(clientId) || 0;
+        archiveLog.debug("连接断开，保存最后数据", { client: clientId, segment: segmentIndex + 1 });
+        lastArchived = {
+          stem: remaining.stem,
+          capturedAt: remaining.capturedAt,
+          durationMs: segmentDurationMs(remaining),
+        };
+        archiveSegment(clientId, remaining, segmentIndex);
+      }
+
+      // 清理资源
+      audioSegments.delete(clientId);
+      segmentCounters.delete(clientId);
+      const asr = asrInstances.get(clientId);
+      if (asr) {
+        retireAsr(asr);
+        asrInstances.delete(clientId);
+      }
+
+      devices.delete(clientId);
+      if (stream.room) leaveRoom(stream.room, clientId);
+      devicePriorities.delete(clientId);
+      asrShedClients.delete(clientId);
+      updateAsrShedding();
+      output.deviceDown?.(clientId);
+      commands.dispose();
+      for (const trace of tracesByCommand.values()) {
+        tracer.finish(trace, "disconnected");
+      }
+      tracesByCommand.clear();
+      activeDevices.dec();
+      ingestBytes.remove(clientId);
+      ingestFrames.remove(clientId);
+      frameJitter.remove(clientId);
+      qualityTrackers.delete(clientId);
+      for (const gauge of [qualityRms, qualityPeak, qualityClipping, qualityDcOffset, qualityNoiseFloor, qualitySnr]) {
+        gauge.remove(clientId);
+      }
+      framesLost.remove(clientId);
+      deviceLog.info("设备断开", { client: clientId, remaining: devices.size });
+    }
+
+    ws.on("close", releaseSession);
+
+    ws.on("error", (error) => {
+      deviceLog.error("WebSocket 错误", { client: clientId, error });
+      releaseSession();
+    });
+  }
+
+  /**
+   * 向设备下发继电器指令
+   * @returns 指令 id；设备不在本进程或未连接时返回 null
+   */
+  function sendCommand(clientId: string, text: string): number | null {
+    const device = devices.get(clientId);
+    if (!device) return null;
+    return device.commands.send(device.ws, text);
+  }
+
+  /**
+   * 批量下发（组 / 场景），在同一个 tick 内依次写入各设备连接
+   * @returns 与 targets 一一对应的指令 id，不在线为 null
+   */
+  function sendCommands(targets: Array<{ clientId: string; text: string }>): Array<number | null> {
+    return targets.map(({ clientId, text }) => sendCommand(clientId, text));
+  }
+
+  function hasDevice(clientId: string): boolean {
+    return devices.has(clientId);
+  }
+
+  function deviceCount(): number {
+    return devices.size;
+  }
+
+  // ==================== 退出收尾 ====================
+  /**
+   * 停机前调用，只执行一次：
+   * 1. 以 1012 (Service Restart) 关闭所有设备连接，设备按重连间隔重连到新进程。
+   *    固件把文本帧按关键字当作继电器指令解析，所以通知只能用关闭码，不能发文本
+   * 2. 不等关闭握手，直接释放会话；各设备未写盘的段（含过载推迟的段）以
+   *    AUDIO_CONFIG.drainConcurrency 的并发异步写盘
+   * 3. 所有 ASR 发送 finish-task，等待剩余结果与 task-finished
+   * 到期限时不再等待，未完成的记入报告
+   * @param deadlineAt 截止时间（Date.now() 时间戳）
+   */
+  async function drain(deadlineAt: number): Promise<DrainReport> {
+    const startedAt = Date.now();
+    const report = emptyDrainReport();
+    if (draining) return report;
+    draining = true;
+    drainDeadline = deadlineAt;
+    report.devices = devices.size;
+
+    // 转码线程先停止接收，收尾写出的段保留 WAV
+    const archive = archiveCompressor.drain(deadlineAt);
+    for (const device of [...devices.values()]) {
+      device.ws.close(1012, "server restart");
+      device.release();
+    }
+    drainSegments.push(...deferredSegments.splice(0));
+    deferredSegmentsGauge.set(0);
+
+    const [archiveReport] = await Promise.all([
+      archive,
+      flushSegments(deadlineAt, report),
+      Promise.all(drainAsr.splice(0)).then((results) => {
+        for (const result of results) report.asr[result]++;
+      }),
+    ]);
+    report.archive = archiveReport;
+    report.elapsedMs = Date.now() - startedAt;
+    return report;
+  }
+
+  async function flushSegments(deadlineAt: number, report: DrainReport): Promise<void> {
+    const queue = drainSegments.splice(0);
+    const inFlight = new Set<DroppedSegment>();
+    let settled = false; // 到期后报告已定稿，晚到的写盘结果不再计入
+    const describe = (entry: PendingSegment, reason: DroppedSegment["reason"]): DroppedSegment => ({
+      clientId: entry.clientId,
+      segment: entry.segmentIndex + 1,
+      seconds: entry.segment.bytes / BYTES_PER_SAMPLE / AUDIO_CONFIG.sampleRate,
+      reason,
+    });
+
+    async function lane() {
+      while (queue.length > 0 && Date.now() < deadlineAt) {
+        const entry = queue.shift()!;
+        const bytes = entry.segment.bytes;
+        const pending = describe(entry, "unfinished");
+        inFlight.add(pending);
+        try {
+          const written = await saveAudioFileAsync(entry.segment);
+          if (written && !settled) {
+            report.segmentsFlushed++;
+            report.bytesFlushed += bytes;
+          }
+        } catch (error) {
+          archiveLog.error("收尾写盘失败", { client: entry.clientId, error });
+          if (!settled) report.dropped.push({ ...pending, reason: "write_failed" });
+        } finally {
+          inFlight.delete(pending);
+        }
+      }
+    }
+
+    const lanes = Array.from({ length: Math.min(AUDIO_CONFIG.drainConcurrency, queue.length) }, lane);
+    await Promise.race([
+      Promise.all(lanes),
+      new Promise((resolve) => setTimeout(resolve, Math.max(0, deadlineAt - Date.now())).unref()),
+    ]);
+
+    // 写到一半的段仍持有帧，写完时由 saveAudioFileAsync 归还
+    settled = true;
+    report.dropped.push(...inFlight);
+    for (const entry of queue.splice(0)) {
+      report.dropped.push(describe(entry, "deadline"));
+      releaseSegment(entry.segment);
+    }
+  }
+
+  return { handleAudioInput, sendCommand, sendCommands, hasDevice, deviceCount, drain };
+}
+
+export type AudioPipeline = ReturnType<typeof createAudioPipeline>;
@@ -0,0 +1,259 @@
+import os from "os";
+import { DEFAULT_VAD_CONFIG, nextNoiseFloorDb } from "./vad";
+
+// ==================== 音频质量统计 ====================
+// 每个设备连接一份，逐帧增量更新，内存固定，用来区分识别差的原因：
+// - 电平 / 峰值 / 削波比例 / 直流偏移：按 windowMs 时间常数指数平滑
+// - 噪声基底与信噪比：基底跟踪规则与 lib/vad.ts 相同；信号电平只在高于基底 thresholdDb 的帧上平滑。
+//   两者都用去掉直流后的电平，直流偏移单独报告，不会把基底抬高
+// - 丢帧：v2 帧序号的空洞（固件发送失败时序号照样递增）；旧固件没有序号，不统计
+// 另按采集时间保留最近 buckets × bucketMs 的分桶累计，句末识别结果据此汇总这句话时段内的质量。
+export const AUDIO_QUALITY_CONFIG = {
+  sampleRate: 16000,
+  windowMs: Number(process.env.AUDIO_QUALITY_WINDOW_MS) || 2000,
+  clipLevel: 32767, // |样本| 达到满幅即算削波（固件取高 16 位，饱和时正好是 32767 / -32768）
+  thresholdDb: DEFAULT_VAD_CONFIG.thresholdDb, // 高于噪声基底多少 dB 的帧计入信号电平
+  bucketMs: 500,
+  buckets: 64, // 32 秒：一句话加上识别结果返回的延迟
+  maxGapFrames: 1200, // 序号一次跳过超过 1 分钟的帧数视为设备重启，不计丢帧
+} as const;
+
+const FULL_SCALE = 32768;
+const SILENT_DB = -120;
+// Int16Array 按本机字节序读；PCM 为小端，大端机器上退回逐个 readInt16LE
+const NATIVE_LE = os.endianness() === "LE";
+
+// 当前状态（指标）
+export interface AudioQualitySnapshot {
+  rmsDbfs: number;
+  peakDbfs: number;
+  clipRatio: number; // 削波样本占比
+  dcOffset: number; // 直流分量，满幅的比例（-1 ~ 1）
+  noiseFloorDbfs: number;
+  snrDb: number | null; // 还没出现过高于基底的帧时为 null
+  frames: number;
+  lostFrames: number;
+  resets: number; // 序号回退或跳变过大（设备重启）的次数
+}
+
+// 一句话时段内的汇总，写入转写库
+export interface AudioQualitySummary {
+  rmsDbfs: number;
+  peakDbfs: number;
+  clipRatio: number;
+  dcOffset: number;
+  snrDb: number | null; // 句子电平（去直流）减去句首的噪声基底
+  frames: number;
+  lostFrames: number;
+}
+
+function powerDb(meanSquare: number): number {
+  return meanSquare < 1 ? SILENT_DB : 10 * Math.log10(meanSquare / (FULL_SCALE * FULL_SCALE));
+}
+
+function amplitudeDb(amplitude: number): number {
+  return amplitude < 1 ? SILENT_DB : 20 * Math.log10(amplitude / FULL_SCALE);
+}
+
+// 分桶字段（Float64Array 里每桶连续 BUCKET_FIELDS 个数）
+const B_INDEX = 0; // 桶号 = floor(采集时间 / bucketMs)，用于判断槽位是否过期
+const B_SAMPLES = 1;
+const B_SUM = 2;
+const B_SUM_SQ = 3;
+const B_PEAK = 4;
+const B_CLIPPED = 5;
+const B_FRAMES = 6;
+const B_LOST = 7;
+const B_FLOOR = 8; // 该桶最后一帧之后的噪声基底
+const BUCKET_FIELDS = 9;
+
+export class AudioQualityTracker {
+  // ---- 平滑后的当前值 ----
+  private meanSquare = 0;
+  private mean = 0;
+  private clipRatio = 0;
+  private peak = 0;
+  private floorDb = SILENT_DB;
+  private signalDb = SILENT_DB;
+  private started = false;
+  private signalSeen = false;
+
+  // ---- 累计 ----
+  private frames = 0;
+  private lostFrames = 0;
+  private resetCount = 0;
+  private expectedSeq: number | null = null;
+
+  private readonly buckets = new Float64Array(AUDIO_QUALITY_CONFIG.buckets * BUCKET_FIELDS);
+
+  constructor() {
+    for (let i = 0; i < AUDIO_QUALITY_CONFIG.buckets; i++) this.buckets[i * BUCKET_FIELDS + B_INDEX] = -1;
+  }
+
+  /**
+   * 记录一帧
+   * @param pcm PCM16 小端
+   * @param seq v2 帧序号，旧固件为 null
+   * @param capturedAt 采集时间（服务器时钟，ms）
+   * @returns 本帧之前因序号空洞丢掉的帧数
+   */
+  push(pcm: Buffer, seq: number | null, capturedAt: number): number {
+    // ---- 丢帧 ----
+    let lost = 0;
+    if (seq !== null) {
+      if (this.expectedSeq !== null && seq !== this.expectedSeq) {
+        const gap = (seq - this.expectedSeq) >>> 0;
+        if (gap <= AUDIO_QUALITY_CONFIG.maxGapFrames) lost = gap;
+        else this.resetCount++;
+      }
+      this.lostFrames += lost;
+      this.expectedSeq = (seq + 1) >>> 0;
+    }
+
+    const samples = pcm.length >> 1;
+    if (samples === 0) return lost;
+
+    // ---- 一遍扫描：和、平方和、峰值、削波 ----
+    const clipLevel = AUDIO_QUALITY_CONFIG.clipLevel;
+    let sum = 0;
+    let sumSq = 0;
+    let peak = 0;
+    let clipped = 0;
+    if (NATIVE_LE && (pcm.byteOffset & 1) === 0) {
+      const view = new Int16Array(pcm.buffer, pcm.byteOffset, samples);
+      for (let i = 0; i < samples; i++) {
+        const s = view[i];
+        const a = s < 0 ? -s : s;
+        sum += s;
+        sumSq += s * s;
+        if (a > peak) peak = a;
+        if (a >= clipLevel) clipped++;
+      }
+    } else {
+      for (let i = 0; i < samples; i++) {
+        const s = pcm.readInt16LE(i * 2);
+        const a = s < 0 ? -s : s;
+        sum += s;
+        sumSq += s * s;
+        if (a > peak) peak = a;
+        if (a >= clipLevel) clipped++;
+      }
+    }
+
+    // ---- 平滑：时间常数按帧时长换算，帧长不固定（旧固件）也成立 ----
+    const frameMean = sum / samples;
+    const frameMeanSquare = sumSq / samples;
+    const levelDb = powerDb(frameMeanSquare - frameMean * frameMean);
+    const frameMs = (samples * 1000) / AUDIO_QUALITY_CONFIG.sampleRate;
+    const alpha = 1 - Math.exp(-frameMs / AUDIO_QUALITY_CONFIG.windowMs);
+    if (!this.started) {
+      this.started = true;
+      this.meanSquare = frameMeanSquare;
+      this.mean = frameMean;
+      this.clipRatio = clipped / samples;
+      this.peak = peak;
+      this.floorDb = levelDb;
+    } else {
+      this.meanSquare += (frameMeanSquare - this.meanSquare) * alpha;
+      this.mean += (frameMean - this.mean) * alpha;
+      this.clipRatio += (clipped / samples - this.clipRatio) * alpha;
+      this.peak = Math.max(peak, this.peak * (1 - alpha));
+      const loud = levelDb > this.floorDb + AUDIO_QUALITY_CONFIG.thresholdDb;
+      if (loud) {
+        this.signalDb = this.signalSeen ? this.signalDb + (levelDb - this.signalDb) * alpha : levelDb;
+        this.signalSeen = true;
+      }
+      this.floorDb = nextNoiseFloorDb(this.floorDb, levelDb, loud);
+    }
+    this.frames++;
+
+    // ---- 分桶 ----
+    const index = Math.floor(capturedAt / AUDIO_QUALITY_CONFIG.bucketMs);
+    const base = (index % AUDIO_QUALITY_CONFIG.buckets) * BUCKET_FIELDS;
+    const buckets = this.buckets;
+    if (buckets[base + B_INDEX] !== index) {
+      buckets.fill(0, base, base + BUCKET_FIELDS);
+      buckets[base + B_INDEX] = index;
+    }
+    buckets[base + B_SAMPLES] += samples;
+    buckets[base + B_SUM] += sum;
+    buckets[base + B_SUM_SQ] += sumSq;
+    if (peak > buckets[base + B_PEAK]) buckets[base + B_PEAK] = peak;
+    buckets[base + B_CLIPPED] += clipped;
+    buckets[base + B_FRAMES]++;
+    buckets[base + B_LOST] += lost;
+    buckets[base + B_FLOOR] = this.floorDb;
+    return lost;
+  }
+
+  // 序号重置次数（调用方按 push 前后的差值计数）
+  get resets(): number {
+    return this.resetCount;
+  }
+
+  snapshot(): AudioQualitySnapshot {
+    return {
+      rmsDbfs: powerDb(this.meanSquare),
+      peakDbfs: amplitudeDb(this.peak),
+      clipRatio: this.clipRatio,
+      dcOffset: this.mean / FULL_SCALE,
+      noiseFloorDbfs: this.floorDb,
+      snrDb: this.signalSeen ? this.signalDb - this.floorDb : null,
+      frames: this.frames,
+      lostFrames: this.lostFrames,
+      resets: this.resetCount,
+    };
+  }
+
+  /**
+   * 汇总采集时间 [from, to] 内的质量（只看得到最近 buckets × bucketMs）
+   * @returns 这段时间没有留下任何帧时为 null
+   */
+  summarize(from: number, to: number): AudioQualitySummary | null {
+    const { bucketMs, buckets: count } = AUDIO_QUALITY_CONFIG;
+    const last = Math.floor(to / bucketMs);
+    const first = Math.max(Math.floor(from / bucketMs), last - count + 1);
+    let samples = 0;
+    let sum = 0;
+    let sumSq = 0;
+    let peak = 0;
+    let clipped = 0;
+    let frames = 0;
+    let lost = 0;
+    let floorDb: number | null = null;
+    // 句首之前那一桶的基底最能代表开口前的环境噪声
+    const before = this.bucketBase(first - 1);
+    if (before >= 0) floorDb = this.buckets[before + B_FLOOR];
+    for (let index = first; index <= last; index++) {
+      const base = this.bucketBase(index);
+      if (base < 0) continue;
+      const b = this.buckets;
+      samples += b[base + B_SAMPLES];
+      sum += b[base + B_SUM];
+      sumSq += b[base + B_SUM_SQ];
+      if (b[base + B_PEAK] > peak) peak = b[base + B_PEAK];
+      clipped += b[base + B_CLIPPED];
+      frames += b[base + B_FRAMES];
+      lost += b[base + B_LOST];
+      if (floorDb === null) floorDb = b[base + B_FLOOR];
+    }
+    if (samples === 0) return null;
+    const mean = sum / samples;
+    return {
+      rmsDbfs: powerDb(sumSq / samples),
+      peakDbfs: amplitudeDb(peak),
+      clipRatio: clipped / samples,
+      dcOffset: mean / FULL_SCALE,
+      snrDb: floorDb === null ? null : powerDb(sumSq / samples - mean * mean) - floorDb,
+      frames,
+      lostFrames: lost,
+    };
+  }
+
+  // 桶号对应的槽位起点；槽位已被更新的桶覆盖（或从未写过）时返回 -1
+  private bucketBase(index: number): number {
+    if (index < 0) return -1;
+    const base = (index % AUDIO_QUALITY_CONFIG.buckets) * BUCKET_FIELDS;
+    return this.buckets[base + B_INDEX] === index ? base : -1;
+  }
+}
@@ -0,0 +1,525 @@
+import { createHash } from "crypto";
+
+// ==================== FLAC 编解码 ====================
+// 归档压缩用的最小 FLAC 实现（单声道 16 位，与固件采集格式一致）：
+// 编码：固定块长，每块在 constant / verbatim / fixed(0-4 阶) 子帧中取最小，
+//       残差用分区 Rice 编码，分区阶数逐一比较；产物是标准 FLAC，任何解码器都能读。
+// 解码：支持 constant / verbatim / fixed / LPC 子帧，用于写盘前的回读校验。
+// 不依赖外部编码器，可以直接在 worker 线程里运行。
+export const FLAC_CONFIG = {
+  blockSize: 4096,
+  maxPartitionOrder: 6,
+} as const;
+
+const BITS_PER_SAMPLE = 16;
+const MAX_RICE_PARAM = 14; // 15 为转义码，不使用
+
+// 帧头里的采样率编码；不在表里的写 0（取 STREAMINFO）
+const SAMPLE_RATE_CODES: Record<number, number> = {
+  8000: 0b0100,
+  16000: 0b0101,
+  22050: 0b0110,
+  24000: 0b0111,
+  32000: 0b1000,
+  44100: 0b1001,
+  48000: 0b1010,
+};
+
+export interface FlacStream {
+  sampleRate: number;
+  channels: number;
+  bitsPerSample: number;
+  totalSamples: number;
+  md5: Buffer; // STREAMINFO 里的原始样本 MD5
+  samples: Int16Array;
+}
+
+// ==================== CRC ====================
+const CRC8_TABLE = new Uint8Array(256);
+const CRC16_TABLE = new Uint16Array(256);
+for (let i = 0; i < 256; i++) {
+  let c8 = i;
+  let c16 = i << 8;
+  for (let bit = 0; bit < 8; bit++) {
+    c8 = c8 & 0x80 ? ((c8 << 1) ^ 0x07) & 0xff : (c8 << 1) & 0xff;
+    c16 = c16 & 0x8000 ? ((c16 << 1) ^ 0x8005) & 0xffff : (c16 << 1) & 0xffff;
+  }
+  CRC8_TABLE[i] = c8;
+  CRC16_TABLE[i] = c16;
+}
+
+function crc8(data: Uint8Array, start: number, end: number): number {
+  let crc = 0;
+  for (let i = start; i < end; i++) crc = CRC8_TABLE[crc ^ data[i]];
+  return crc;
+}
+
+function crc16(data: Uint8Array, start: number, end: number): number {
+  let crc = 0;
+  for (let i = start; i < end; i++) {
+    crc = ((crc << 8) & 0xffff) ^ CRC16_TABLE[(crc >>> 8) ^ data[i]];
+  }
+  return crc;
+}
+
+// ==================== 位读写 ====================
+class BitWriter {
+  bytes: Uint8Array;
+  pos = 0; // 已写满的字节数
+  private acc = 0;
+  private bits = 0; // acc 中未落盘的位数（< 8）
+
+  constructor(capacity: number) {
+    this.bytes = new Uint8Array(Math.max(capacity, 64));
+  }
+
+  // 一次最多 24 位，保证 acc 不超过 31 位
+  write(value: number, count: number): void {
+    if (count === 0) return;
+    this.acc = ((this.acc << count) | (value & (0xffffff >>> (24 - count)))) >>> 0;
+    this.bits += count;
+    if (this.pos + 4 > this.bytes.length) this.grow();
+    while (this.bits >= 8) {
+      this.bits -= 8;
+      this.bytes[this.pos++] = (this.acc >>> this.bits) & 0xff;
+    }
+    this.acc &= (1 << this.bits) - 1;
+  }
+
+  writeLong(value: number, count: number): void {
+    while (count > 24) {
+      count -= 24;
+      this.write(Math.floor(value / 2 ** count) & 0xffffff, 24);
+    }
+    this.write(value % 2 ** count, count);
+  }
+
+  writeUnary(zeros: number): void {
+    while (zeros >= 24) {
+      this.write(0, 24);
+      zeros -= 24;
+    }
+    this.write(1, zeros + 1);
+  }
+
+  writeRice(value: number, k: number): void {
+    const folded = value >= 0 ? value * 2 : -value * 2 - 1;
+    const q = folded >>> k;
+    if (q + 1 + k <= 24) {
+      this.write((1 << k) | (folded & ((1 << k) - 1)), q + 1 + k);
+      return;
+    }
+    this.writeUnary(q);
+    this.write(folded & ((1 << k) - 1), k);
+  }
+
+  writeBytes(data: Uint8Array): void {
+    for (const byte of data) this.write(byte, 8);
+  }
+
+  alignToByte(): void {
+    if (this.bits > 0) this.write(0, 8 - this.bits);
+  }
+
+  toBuffer(): Buffer {
+    return Buffer.from(this.bytes.buffer, this.bytes.byteOffset, this.pos);
+  }
+
+  private grow(): void {
+    const next = new Uint8Array(this.bytes.length * 2);
+    next.set(this.bytes.subarray(0, this.pos));
+    this.bytes = next;
+  }
+}
+
+class BitReader {
+  pos = 0; // 位偏移
+
+  constructor(readonly bytes: Uint8Array) {}
+
+  get bytePos(): number {
+    return this.pos >>> 3;
+  }
+
+  read(count: number): number {
+    let value = 0;
+    for (let i = 0; i < count; i++) {
+      const byte = this.bytes[this.pos >>> 3];
+      if (byte === undefined) throw new Error("FLAC 数据截断");
+      value = value * 2 + ((byte >>> (7 - (this.pos & 7))) & 1);
+      this.pos++;
+    }
+    return value;
+  }
+
+  readSigned(count: number): number {
+    const value = this.read(count);
+    return value >= 2 ** (count - 1) ? value - 2 ** count : value;
+  }
+
+  readUnary(): number {
+    let zeros = 0;
+    for (;;) {
+      // 整字节为 0 时跳过
+      if ((this.pos & 7) === 0) {
+        while (this.bytes[this.pos >>> 3] === 0) {
+          zeros += 8;
+          this.pos += 8;
+        }
+      }
+      if (this.read(1) === 1) return zeros;
+      zeros++;
+    }
+  }
+
+  readRice(k: number): number {
+    const folded = this.readUnary() * 2 ** k + this.read(k);
+    return folded % 2 === 0 ? folded / 2 : -(folded + 1) / 2;
+  }
+
+  alignToByte(): void {
+    this.pos = (this.pos + 7) & ~7;
+  }
+}
+
+// ==================== 编码 ====================
+// 固定预测器 0-4 阶的残差
+function fixedResidual(x: Int32Array, order: number, out: Int32Array): void {
+  const n = x.length;
+  switch (order) {
+    case 0:
+      for (let i = 0; i < n; i++) out[i] = x[i];
+      break;
+    case 1:
+      for (let i = 1; i < n; i++) out[i - 1] = x[i] - x[i - 1];
+      break;
+    case 2:
+      for (let i = 2; i < n; i++) out[i - 2] = x[i] - 2 * x[i - 1] + x[i - 2];
+      break;
+    case 3:
+      for (let i = 3; i < n; i++) out[i - 3] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+      break;
+    case 4:
+      for (let i = 4; i < n; i++) {
+        out[i - 4] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+      }
+      break;
+  }
+}
+
+function riceParam(sum: number, count: number): number {
+  if (count === 0 || sum <= count) return 0;
+  const k = Math.floor(Math.log2(sum / count));
+  return Math.min(MAX_RICE_PARAM, Math.max(0, k));
+}
+
+interface ResidualPlan {
+  bits: number;
+  partitionOrder: number;
+  params: number[];
+}
+
+// 选分区阶数：逐阶估算 Rice 编码位数，取最小
+function planResidual(residual: Int32Array, blockSize: number, order: number): ResidualPlan {
+  let best: ResidualPlan | null = null;
+  for (let p = 0; p <= FLAC_CONFIG.maxPartitionOrder; p++) {
+    if (blockSize % (1 << p) !== 0) break;
+    const partSize = blockSize >>> p;
+    if (partSize < order) break;
+    const params: number[] = [];
+    let bits = 6; // 编码方式 2 位 + 分区阶数 4 位
+    let offset = 0;
+    for (let part = 0; part < 1 << p; part++) {
+      const n = part === 0 ? partSize - order : partSize;
+      let sum = 0;
+      for (let i = offset; i < offset + n; i++) {
+        const r = residual[i];
+        sum += r >= 0 ? r * 2 : -r * 2 - 1;
+      }
+      offset += n;
+      const k = riceParam(sum, n);
+      params.push(k);
+      bits += 4 + n * (k + 1) + Math.floor(sum / 2 ** k);
+    }
+    if (!best || bits < best.bits) best = { bits, partitionOrder: p, params };
+  }
+  return best!;
+}
+
+function encodeSubframe(w: BitWriter, x: Int32Array, residual: Int32Array): void {
+  const n = x.length;
+  let constant = true;
+  for (let i = 1; i < n && constant; i++) constant = x[i] === x[0];
+  if (constant) {
+    w.write(0b00000000, 8);
+    w.write(x[0] & 0xffff, BITS_PER_SAMPLE);
+    return;
+  }
+
+  // 按残差绝对值和选预测阶数
+  const maxOrder = Math.min(4, n - 1);
+  let bestOrder = 0;
+  let bestSum = Infinity;
+  for (let order = 0; order <= maxOrder; order++) {
+    fixedResidual(x, order, residual);
+    let sum = 0;
+    for (let i = 0; i < n - order; i++) sum += Math.abs(residual[i]);
+    if (sum < bestSum) {
+      bestSum = sum;
+      bestOrder = order;
+    }
+  }
+  fixedResidual(x, bestOrder, residual);
+  const plan = planResidual(residual, n, bestOrder);
+
+  if (8 + bestOrder * BITS_PER_SAMPLE + plan.bits >= 8 + n * BITS_PER_SAMPLE) {
+    w.write(0b00000010, 8); // verbatim
+    for (let i = 0; i < n; i++) w.write(x[i] & 0xffff, BITS_PER_SAMPLE);
+    return;
+  }
+
+  w.write(0b00010000 | (bestOrder << 1), 8); // fixed，无 wasted bits
+  for (let i = 0; i < bestOrder; i++) w.write(x[i] & 0xffff, BITS_PER_SAMPLE);
+  w.write(0, 2); // Rice，4 位参数
+  w.write(plan.partitionOrder, 4);
+  let offset = 0;
+  const partSize = n >>> plan.partitionOrder;
+  for (let part = 0; part < plan.params.length; part++) {
+    const count = part === 0 ? partSize - bestOrder : partSize;
+    const k = plan.params[part];
+    w.write(k, 4);
+    for (let i = offset; i < offset + count; i++) w.writeRice(residual[i], k);
+    offset += count;
+  }
+}
+
+// 帧号用 UTF-8 风格变长编码
+function writeUtf8Number(w: BitWriter, value: number): void {
+  if (value < 0x80) {
+    w.write(value, 8);
+    return;
+  }
+  let extra = 1;
+  while (value >= 2 ** (6 * extra + (6 - extra))) extra++;
+  const lead = (0xff00 >>> (extra + 1)) & 0xff;
+  w.write(lead | Math.floor(value / 2 ** (6 * extra)), 8);
+  for (let i = extra - 1; i >= 0; i--) {
+    w.write(0x80 | (Math.floor(value / 2 ** (6 * i)) & 0x3f), 8);
+  }
+}
+
+function blockSizeCode(size: number): { code: number; tailBits: number } {
+  for (let code = 8; code <= 15; code++) {
+    if (size === 256 << (code - 8)) return { code, tailBits: 0 };
+  }
+  return size <= 256 ? { code: 0b0110, tailBits: 8 } : { code: 0b0111, tailBits: 16 };
+}
+
+/**
+ * 编码单声道 16 位 PCM
+ */
+export function encodeFlac(samples: Int16Array, sampleRate: number): Buffer {
+  const blockSize = FLAC_CONFIG.blockSize;
+  const frames = new BitWriter(samples.length * 2 + 1024);
+  const block = new Int32Array(blockSize);
+  const residual = new Int32Array(blockSize);
+  const rateCode = SAMPLE_RATE_CODES[sampleRate] ?? 0;
+  let minFrame = Infinity;
+  let maxFrame = 0;
+
+  for (let start = 0, index = 0; start < samples.length; start += blockSize, index++) {
+    const n = Math.min(blockSize, samples.length - start);
+    const x = n === blockSize ? block : block.subarray(0, n);
+    for (let i = 0; i < n; i++) x[i] = samples[start + i];
+
+    const frameStart = frames.pos;
+    const size = blockSizeCode(n);
+    frames.write(0xfff8, 16); // 同步码 + 固定块长
+    frames.write(size.code, 4);
+    frames.write(rateCode, 4);
+    frames.write(0b0000, 4); // 单声道
+    frames.write(0b100, 3); // 16 位
+    frames.write(0, 1);
+    writeUtf8Number(frames, index);
+    if (size.tailBits) frames.write(n - 1, size.tailBits);
+    frames.write(crc8(frames.bytes, frameStart, frames.pos), 8);
+
+    encodeSubframe(frames, x, residual);
+    frames.alignToByte();
+    frames.write(crc16(frames.bytes, frameStart, frames.pos), 16);
+
+    const frameBytes = frames.pos - frameStart;
+    minFrame = Math.min(minFrame, frameBytes);
+    maxFrame = Math.max(maxFrame, frameBytes);
+  }
+
+  const pcm = Buffer.from(samples.buffer, samples.byteOffset, samples.byteLength);
+  const header = new BitWriter(64);
+  header.writeBytes(Buffer.from("fLaC", "ascii"));
+  header.write(0x80, 8); // 最后一个元数据块，类型 0（STREAMINFO）
+  header.write(34, 24);
+  header.write(blockSize, 16);
+  header.write(blockSize, 16);
+  header.write(Number.isFinite(minFrame) ? minFrame : 0, 24);
+  header.write(maxFrame, 24);
+  header.write(sampleRate, 20);
+  header.write(0, 3); // 声道数 - 1
+  header.write(BITS_PER_SAMPLE - 1, 5);
+  header.writeLong(samples.length, 36);
+  header.writeBytes(createHash("md5").update(pcm).digest());
+
+  return Buffer.concat([header.toBuffer(), frames.toBuffer()]);
+}
+
+// ==================== 解码 ====================
+function readUtf8Number(r: BitReader): number {
+  const lead = r.read(8);
+  if (lead < 0x80) return lead;
+  let extra = 0;
+  while (lead & (0x40 >>> extra)) extra++;
+  let value = lead & (0x3f >>> extra);
+  for (let i = 0; i < extra; i++) {
+    const next = r.read(8);
+    if ((next & 0xc0) !== 0x80) throw new Error("帧号编码错误");
+    value = value * 64 + (next & 0x3f);
+  }
+  return value;
+}
+
+function decodeResidual(r: BitReader, blockSize: number, order: number, out: Int32Array): void {
+  const method = r.read(2);
+  if (method > 1) throw new Error(`未知残差编码 ${method}`);
+  const paramBits = method === 0 ? 4 : 5;
+  const escape = (1 << paramBits) - 1;
+  const partitionOrder = r.read(4);
+  const partSize = blockSize >>> partitionOrder;
+  let offset = order;
+  for (let part = 0; part < 1 << partitionOrder; part++) {
+    const count = part === 0 ? partSize - order : partSize;
+    const k = r.read(paramBits);
+    if (k === escape) {
+      const rawBits = r.read(5);
+      for (let i = 0; i < count; i++) out[offset++] = rawBits ? r.readSigned(rawBits) : 0;
+    } else {
+      for (let i = 0; i < count; i++) out[offset++] = r.readRice(k);
+    }
+  }
+}
+
+function decodeSubframe(r: BitReader, blockSize: number, bps: number, out: Int32Array): void {
+  if (r.read(1) !== 0) throw new Error("子帧填充位非 0");
+  const type = r.read(6);
+  let wasted = 0;
+  if (r.read(1)) wasted = r.readUnary() + 1;
+  const bits = bps - wasted;
+
+  if (type === 0) {
+    const value = r.readSigned(bits);
+    out.fill(value, 0, blockSize);
+  } else if (type === 1) {
+    for (let i = 0; i < blockSize; i++) out[i] = r.readSigned(bits);
+  } else if (type >= 8 && type <= 12) {
+    const order = type & 7;
+    for (let i = 0; i < order; i++) out[i] = r.readSigned(bits);
+    decodeResidual(r, blockSize, order, out);
+    for (let i = order; i < blockSize; i++) {
+      switch (order) {
+        case 1: out[i] += out[i - 1]; break;
+        case 2: out[i] += 2 * out[i - 1] - out[i - 2]; break;
+        case 3: out[i] += 3 * out[i - 1] - 3 * out[i - 2] + out[i - 3]; break;
+        case 4: out[i] += 4 * out[i - 1] - 6 * out[i - 2] + 4 * out[i - 3] - out[i - 4]; break;
+      }
+    }
+  } else if (type >= 32) {
+    const order = (type & 31) + 1;
+    for (let i = 0; i < order; i++) out[i] = r.readSigned(bits);
+    const precision = r.read(4) + 1;
+    const shift = r.readSigned(5);
+    const coefs: number[] = [];
+    for (let i = 0; i < order; i++) coefs.push(r.readSigned(precision));
+    decodeResidual(r, blockSize, order, out);
+    for (let i = order; i < blockSize; i++) {
+      let sum = 0;
+      for (let j = 0; j < order; j++) sum += coefs[j] * out[i - 1 - j];
+      out[i] += Math.floor(sum / 2 ** shift);
+    }
+  } else {
+    throw new Error(`保留的子帧类型 ${type}`);
+  }
+  if (wasted) for (let i = 0; i < blockSize; i++) out[i] *= 2 ** wasted;
+}
+
+/**
+ * 解码单声道 16 位 FLAC，校验每帧 CRC；不校验 MD5（由调用方比对）
+ */
+export function decodeFlac(data: Uint8Array): FlacStream {
+  if (Buffer.from(data.subarray(0, 4)).toString("ascii") !== "fLaC") {
+    throw new Error("不是 FLAC 文件");
+  }
+  const r = new BitReader(data);
+  r.pos = 32;
+  let info: Omit<FlacStream, "samples"> | null = null;
+  for (;;) {
+    const last = r.read(1);
+    const type = r.read(7);
+    const length = r.read(24);
+    const blockEnd = r.pos + length * 8;
+    if (type === 0) {
+      r.read(16); // 最小块长
+      r.read(16);
+      r.read(24);
+      r.read(24);
+      const sampleRate = r.read(20);
+      const channels = r.read(3) + 1;
+      const bitsPerSample = r.read(5) + 1;
+      const totalSamples = r.read(36);
+      const md5 = Buffer.from(data.subarray(r.bytePos, r.bytePos + 16));
+      info = { sampleRate, channels, bitsPerSample, totalSamples, md5 };
+    }
+    r.pos = blockEnd;
+    if (last) break;
+  }
+  if (!info) throw new Error("缺少 STREAMINFO");
+  if (info.channels !== 1 || info.bitsPerSample !== BITS_PER_SAMPLE) {
+    throw new Error(`只支持单声道 16 位，实际 ${info.channels} 声道 ${info.bitsPerSample} 位`);
+  }
+
+  const samples = new Int16Array(info.totalSamples);
+  const block = new Int32Array(65536);
+  let written = 0;
+  while (r.bytePos < data.length && written < info.totalSamples) {
+    const frameStart = r.bytePos;
+    if (r.read(15) !== 0x7ffc) throw new Error(`帧同步码错误 @${frameStart}`);
+    r.read(1); // 块长策略
+    const sizeCode = r.read(4);
+    const rateCode = r.read(4);
+    r.read(4); // 声道
+    r.read(3);
+    r.read(1);
+    readUtf8Number(r);
+    let blockSize: number;
+    if (sizeCode === 1) blockSize = 192;
+    else if (sizeCode >= 2 && sizeCode <= 5) blockSize = 576 << (sizeCode - 2);
+    else if (sizeCode === 6) blockSize = r.read(8) + 1;
+    else if (sizeCode === 7) blockSize = r.read(16) + 1;
+    else if (sizeCode >= 8) blockSize = 256 << (sizeCode - 8);
+    else throw new Error("保留的块长编码");
+    if (rateCode === 12) r.read(8);
+    else if (rateCode === 13 || rateCode === 14) r.read(16);
+    const headerCrc = crc8(data, frameStart, r.bytePos);
+    if (r.read(8) !== headerCrc) throw new Error(`帧头 CRC 错误 @${frameStart}`);
+
+    decodeSubframe(r, blockSize, info.bitsPerSample, block);
+    r.alignToByte();
+    const frameCrc = crc16(data, frameStart, r.bytePos);
+    if (r.read(16) !== frameCrc) throw new Error(`帧 CRC 错误 @${frameStart}`);
+
+    const n = Math.min(blockSize, info.totalSamples - written);
+    for (let i = 0; i < n; i++) samples[written + i] = block[i];
+    written += n;
+  }
+  if (written !== info.totalSamples) {
+    throw new Error(`样本数不符：期望 ${info.totalSamples}，解出 ${written}`);
+  }
+  return { ...info, samples };
+}
@@ -0,0 +1,147 @@
+import { metrics } from "./metrics";
+
+// ==================== 音频帧池 ====================
+// 每帧 PCM 会同时被播放分发、ASR、房间仲裁队列和分段归档持有，各自的生命周期不同。
+// 这里按固定槽大小切分大块 slab，帧带引用计数：每个异步持有者 retain 一次，
+// 用完 release，最后一个释放时槽回到空闲栈，下一帧直接复用，不再产生新的 Buffer。
+//
+// 约定：
+// - 同步用完 frame.pcm 的消费者（IPC 序列化、VAD 计算）不需要 retain
+// - 把 frame.pcm 交给异步写入（socket.send、排队、归档）的消费者必须先 retain，
+//   在写入完成回调 / 出队时 release；release 之后不得再读 frame.pcm
+// - 超过槽大小的帧或池已到上限时退化为普通 Buffer，接口不变，由 GC 回收
+export const FRAME_POOL_CONFIG = {
+  slotBytes: Number(process.env.FRAME_POOL_SLOT_BYTES) || 1600, // 固件一帧 50ms @ 16kHz PCM16
+  slotsPerSlab: 256,
+  maxBytes: (Number(process.env.FRAME_POOL_MAX_MB) || 512) * 1024 * 1024,
+} as const;
+
+const slabsGauge = metrics.gauge("frame_pool_slabs", "Slabs allocated by the audio frame pool");
+const inUseGauge = metrics.gauge("frame_pool_frames_in_use", "Pooled audio frames currently referenced");
+const fallbacks = metrics.counter(
+  "frame_pool_fallback_total",
+  "Audio frames allocated outside the pool",
+  ["reason"],
+);
+const doubleReleases = metrics.counter(
+  "frame_pool_double_release_total",
+  "release() calls on frames that were already returned to the pool",
+);
+
+export class PooledFrame {
+  private refs = 0;
+  private view: Buffer;
+
+  constructor(
+    private readonly pool: FramePool | null,
+    private readonly slot: Buffer,
+  ) {
+    this.view = slot;
+  }
+
+  // 当前帧的有效数据（槽的前 length 字节）
+  get pcm(): Buffer {
+    return this.view;
+  }
+
+  get length(): number {
+    return this.view.length;
+  }
+
+  get refCount(): number {
+    return this.refs;
+  }
+
+  retain(): this {
+    this.refs++;
+    return this;
+  }
+
+  release(): void {
+    if (this.refs <= 0) {
+      doubleReleases.inc();
+      return;
+    }
+    if (--this.refs === 0) this.pool?.recycle(this);
+  }
+
+  /** @internal 由 FramePool 在出池时调用 */
+  reset(length: number): this {
+    // 长度不变时复用上次的视图，固定帧长下每帧零分配
+    if (this.view.length !== length) this.view = this.slot.subarray(0, length);
+    this.refs = 1;
+    return this;
+  }
+}
+
+export class FramePool {
+  private readonly free: PooledFrame[] = [];
+  private slabs = 0;
+  private inUse = 0;
+  private readonly maxSlabs: number;
+
+  constructor(
+    readonly slotBytes: number = FRAME_POOL_CONFIG.slotBytes,
+    private readonly slotsPerSlab: number = FRAME_POOL_CONFIG.slotsPerSlab,
+    maxBytes: number = FRAME_POOL_CONFIG.maxBytes,
+  ) {
+    this.maxSlabs = Math.max(1, Math.floor(maxBytes / (slotBytes * slotsPerSlab)));
+  }
+
+  get stats() {
+    return {
+      slabs: this.slabs,
+      inUse: this.inUse,
+      free: this.free.length,
+      bytes: this.slabs * this.slotsPerSlab * this.slotBytes,
+    };
+  }
+
+  /**
+   * 取一个可写的帧，引用计数为 1（属于调用方）
+   */
+  acquire(length: number): PooledFrame {
+    if (length > this.slotBytes) {
+      fallbacks.labels("oversize").inc();
+      return new PooledFrame(null, Buffer.allocUnsafe(length)).reset(length);
+    }
+    if (this.free.length === 0 && !this.grow()) {
+      fallbacks.labels("exhausted").inc();
+      return new PooledFrame(null, Buffer.allocUnsafe(length)).reset(length);
+    }
+    this.inUse++;
+    inUseGauge.set(this.inUse);
+    return this.free.pop()!.reset(length);
+  }
+
+  // 把收到的数据复制进池：接收端给的 Buffer 往往是 socket 读缓冲的切片，
+  // 长时间持有（归档一段 60 秒）会把整块读缓冲钉在内存里
+  copyOf(data: Buffer): PooledFrame {
+    const frame = this.acquire(data.length);
+    data.copy(frame.pcm);
+    return frame;
+  }
+
+  /** @internal 最后一个引用释放时由 PooledFrame 调用 */
+  recycle(frame: PooledFrame): void {
+    this.inUse--;
+    inUseGauge.set(this.inUse);
+    this.free.push(frame);
+  }
+
+  // slab 只增不减：池大小停在峰值并发帧数，稳态下不再向 V8 申请内存
+  private grow(): boolean {
+    if (this.slabs >= this.maxSlabs) return false;
+    // allocUnsafeSlow 不走 Buffer 的 8KB 共享池，整块独占
+    const slab = Buffer.allocUnsafeSlow(this.slotBytes * this.slotsPerSlab);
+    for (let i = this.slotsPerSlab - 1; i >= 0; i--) {
+      const start = i * this.slotBytes;
+      this.free.push(new PooledFrame(this, slab.subarray(start, start + this.slotBytes)));
+    }
+    this.slabs++;
+    slabsGauge.set(this.slabs);
+    return true;
+  }
+}
+
+export const framePool = new FramePool();
@@ -0,0 +1,255 @@
+import { EventEmitter } from "events";
+import { existsSync, unlinkSync } from "fs";
+import net from "net";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+import { admitDevice, cpuMonitor } from "./admission";
+import { loadShedder } from "./loadShedder";
+import type { AudioPipeline, DeviceSocket } from "./audioPipeline";
+
+// ==================== 原生网关通道 ====================
+// gateway/（C++）终结设备 WebSocket 并在本地做 VAD 分段，
+// 只把语音帧与控制事件经 Unix socket 发过来；这里把每个会话包装成
+// DeviceSocket 交给同一条音频管线，ASR / 指令 / 归档逻辑不变。
+//
+// 消息格式（小端）：[u32 长度（含类型字节）][u8 类型][负载]，与 gateway/src/Bridge.h 一致
+const MSG_DEVICE_UP = 1;
+const MSG_DEVICE_DOWN = 2;
+const MSG_SEGMENT_START = 3;
+const MSG_AUDIO = 4;
+const MSG_SEGMENT_END = 5;
+const MSG_DEVICE_TEXT = 6;
+const MSG_STATS = 7;
+const MSG_SEND_TEXT = 16;
+const MSG_CLOSE = 17;
+
+const SEGMENT_END_REASONS = ["silence", "max_length", "disconnect"];
+
+// 网关每秒上报的累计统计
+interface GatewayStats {
+  connections: number;
+  framesIn: number;
+  bytesIn: number;
+  speechFrames: number;
+  speechBytes: number;
+  segments: number;
+  rejected: number;
+  bridgeDropped: number;
+  bridgeBytes: number;
+  bridgeQueuedBlocks: number;
+  poolBlocks: number;
+  poolInUse: number;
+  pings: number;
+  reaped: number;
+}
+
+const log = logger.get("gateway");
+
+// ==================== 指标 ====================
+const gatewayConnections = metrics.gauge(
+  "gateway_connections",
+  "Device WebSockets held by the native gateway",
+);
+const gatewayFrames = metrics.counter(
+  "gateway_frames_total",
+  "Audio frames received by the native gateway",
+);
+const gatewaySpeechFrames = metrics.counter(
+  "gateway_speech_frames_total",
+  "Frames forwarded to Node as speech (including pre-roll)",
+);
+const gatewayIngestBytes = metrics.counter(
+  "gateway_ingest_bytes_total",
+  "Bytes read from device sockets by the native gateway",
+);
+const gatewayBridgeBytes = metrics.counter(
+  "gateway_bridge_bytes_total",
+  "Bytes written by the gateway to the Node bridge",
+);
+const gatewayDropped = metrics.counter(
+  "gateway_bridge_dropped_total",
+  "Gateway messages dropped because the bridge was down or backlogged",
+);
+const gatewayRejected = metrics.counter(
+  "gateway_rejected_connections_total",
+  "Device connections rejected by the gateway connection cap",
+);
+const gatewayReaped = metrics.counter(
+  "gateway_reaped_connections_total",
+  "Device connections closed by the gateway after missing heartbeats",
+);
+const gatewayPoolBlocks = metrics.gauge(
+  "gateway_pool_blocks",
+  "Read buffer blocks allocated by the gateway",
+  ["state"],
+);
+const segmentSeconds = metrics.histogram(
+  "gateway_segment_seconds",
+  "Speech segment duration reported by the gateway",
+  ["reason"],
+  [0.25, 0.5, 1, 2, 3, 5, 8, 12, 15, 30],
+);
+
+// ==================== 设备会话 ====================
+class GatewayDeviceSocket extends EventEmitter implements DeviceSocket {
+  readyState = 1;
+
+  constructor(
+    private readonly link: net.Socket,
+    readonly session: number,
+  ) {
+    super();
+  }
+
+  send(data: string): void {
+    if (this.readyState !== 1) return;
+    const text = Buffer.from(data, "utf8");
+    const message = Buffer.allocUnsafe(9 + text.length);
+    message.writeUInt32LE(5 + text.length, 0);
+    message.writeUInt8(MSG_SEND_TEXT, 4);
+    message.writeUInt32LE(this.session, 5);
+    text.copy(message, 9);
+    this.link.write(message);
+  }
+
+  close(code: number = 1000): void {
+    if (this.readyState !== 1) return;
+    const message = Buffer.allocUnsafe(11);
+    message.writeUInt32LE(7, 0);
+    message.writeUInt8(MSG_CLOSE, 4);
+    message.writeUInt32LE(this.session, 5);
+    message.writeUInt16LE(code, 9);
+    this.link.write(message);
+  }
+
+  markClosed(): void {
+    if (this.readyState === 3) return;
+    this.readyState = 3;
+    this.emit("close");
+  }
+}
+
+/**
+ * 监听网关的 Unix socket
+ * @param socketPath 例如 /tmp/light-switch-gateway.sock（与网关 --socket 一致）
+ */
+export function startGatewayBridge(socketPath: string, pipeline: AudioPipeline): net.Server {
+  // 上次异常退出留下的 socket 文件会导致 EADDRINUSE
+  if (existsSync(socketPath)) unlinkSync(socketPath);
+
+  cpuMonitor.start();
+  const server = net.createServer((link) => {
+    log.info("网关已连接", { socket: socketPath });
+    const sessions = new Map<number, GatewayDeviceSocket>();
+    let lastStats: GatewayStats | null = null;
+    let pending: Buffer = Buffer.alloc(0);
+
+    // 网关重启后计数从 0 开始，按差值累加到本进程的 counter
+    const delta = (key: keyof GatewayStats, stats: GatewayStats) => {
+      const prev = lastStats?.[key] ?? 0;
+      return stats[key] >= prev ? stats[key] - prev : stats[key];
+    };
+
+    function handleStats(stats: GatewayStats) {
+      gatewayConnections.set(stats.connections);
+      gatewayFrames.inc(delta("framesIn", stats));
+      gatewaySpeechFrames.inc(delta("speechFrames", stats));
+      gatewayIngestBytes.inc(delta("bytesIn", stats));
+      gatewayBridgeBytes.inc(delta("bridgeBytes", stats));
+      gatewayDropped.inc(delta("bridgeDropped", stats));
+      gatewayRejected.inc(delta("rejected", stats));
+      gatewayReaped.inc(delta("reaped", stats));
+      gatewayPoolBlocks.labels("total").set(stats.poolBlocks);
+      gatewayPoolBlocks.labels("in_use").set(stats.poolInUse);
+      lastStats = stats;
+    }
+
+    function handleMessage(type: number, payload: Buffer) {
+      switch (type) {
+        case MSG_DEVICE_UP: {
+          const session = payload.readUInt32LE(0);
+          const target = payload.toString("utf8", 4);
+          const url = new URL(target, "http://gateway");
+          // 网关统一补齐帧头（seq + deviceMs），按 v2 解析
+          url.searchParams.set("v", "2");
+          const socket = new GatewayDeviceSocket(link, session);
+          // 与 /api/audio 升级相同的准入判断；拒绝时让网关以 1013（稍后重试）关闭
+          const sessionCount = pipeline.deviceCount();
+          const reason = admitDevice(sessionCount, {
+            sessions: sessionCount,
+            lagMs: loadShedder.lagMs,
+            cpu: cpuMonitor.usage,
+          });
+          if (reason) {
+            socket.close(1013);
+            break;
+          }
+          sessions.set(session, socket);
+          pipeline.handleAudioInput(socket, url);
+          break;
+        }
+        case MSG_DEVICE_DOWN: {
+          const session = payload.readUInt32LE(0);
+          sessions.get(session)?.markClosed();
+          sessions.delete(session);
+          break;
+        }
+        case MSG_AUDIO: {
+          // session 之后就是 v2 帧（seq + deviceMs + PCM），不复制
+          const socket = sessions.get(payload.readUInt32LE(0));
+          socket?.emit("message", payload.subarray(4), true);
+          break;
+        }
+        case MSG_DEVICE_TEXT: {
+          const socket = sessions.get(payload.readUInt32LE(0));
+          socket?.emit("message", payload.subarray(4), false);
+          break;
+        }
+        case MSG_SEGMENT_START:
+          break;
+        case MSG_SEGMENT_END: {
+          const durationMs = payload.readUInt32LE(8);
+          const reason = SEGMENT_END_REASONS[payload.readUInt8(12)] ?? "unknown";
+          segmentSeconds.labels(reason).observe(durationMs / 1000);
+          break;
+        }
+        case MSG_STATS:
+          handleStats(JSON.parse(payload.toString("utf8")));
+          break;
+      }
+    }
+
+    link.on("data", (chunk: Buffer) => {
+      pending = pending.length ? Buffer.concat([pending, chunk]) : chunk;
+      let offset = 0;
+      while (pending.length - offset >= 5) {
+        const length = pending.readUInt32LE(offset);
+        if (pending.length - offset - 4 < length) break;
+        const type = pending.readUInt8(offset + 4);
+        try {
+          handleMessage(type, pending.subarray(offset + 5, offset + 4 + length));
+        } catch (error) {
+          log.error("处理消息失败", { type, error });
+        }
+        offset += 4 + length;
+      }
+      pending = offset === pending.length ? Buffer.alloc(0) : pending.subarray(offset);
+    });
+
+    // 通道断开：网关侧的设备连接仍在，网关重连后会重新发送 DEVICE_UP
+    link.on("close", () => {
+      log.warn("网关断开，结束会话", { sessions: sessions.size });
+      for (const socket of sessions.values()) socket.markClosed();
+      sessions.clear();
+      gatewayConnections.set(0);
+    });
+    link.on("error", (error) => {
+      log.error("通道错误", { error });
+    });
+  });
+
+  server.listen(socketPath, () => {
+    log.info("网关通道已监听", { socket: socketPath });
+  });
+  return server;
+}
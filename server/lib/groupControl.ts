@@ -0,0 +1,364 @@
+import { existsSync, mkdirSync, readFileSync, writeFileSync } from "fs";
+import path from "path";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+import { summarize, type Summary } from "./stats";
+
+// ==================== 配置 ====================
+export const GROUP_CONFIG = {
+  ackTimeoutMs: 3000, // 组指令等待单台设备回执的上限（低于 relayCommand 的 5 秒）
+  historySize: 200, // 用于百分位统计的最近操作数
+} as const;
+
+// 固件按关键字匹配（"off" 先于 "on"），组指令用最短的英文关键字
+const RELAY_TEXT = ["off", "on"] as const;
+
+// ==================== 类型定义 ====================
+export interface Group {
+  id: string;
+  name: string;
+  devices: string[]; // 设备 ID（clientId）
+  gains?: Record<string, number>; // 监听混音（lib/mixer.ts）中各设备的增益，线性 0~1，缺省为 1
+}
+
+// 场景：按顺序展开，同一设备以最后一条为准
+export interface SceneAction {
+  group?: string;
+  device?: string;
+  relay: 0 | 1;
+}
+
+export interface Scene {
+  id: string;
+  name: string;
+  actions: SceneAction[];
+}
+
+export interface CommandTarget {
+  clientId: string;
+  text: string;
+}
+
+// 下发一批指令：必须在同一个事件循环 tick 内发出，返回各设备的指令 id（不在线为 null）
+export type FanoutSender = (targets: CommandTarget[]) => Promise<Array<number | null>>;
+
+export type DeviceStatus = "ack" | "timeout" | "offline";
+
+export interface DeviceResult {
+  clientId: string;
+  relay: 0 | 1;
+  status: DeviceStatus;
+  latencyMs: number | null; // 下发到回执
+  reported: 0 | 1 | null; // 设备回执中的继电器状态
+}
+
+export interface OperationResult {
+  opId: number;
+  kind: "group" | "scene";
+  target: string;
+  devices: number;
+  acked: number;
+  fanoutMs: number; // 发出全部指令耗时
+  completionMs: number | null; // 最后一台回执的时间；有设备未回执时为 null
+  ackLatency: Summary; // 本次各设备回执延迟
+  results: DeviceResult[];
+}
+
+export type ProgressListener = (opId: number, result: DeviceResult) => void;
+
+interface Operation {
+  result: OperationResult;
+  startedAt: number;
+  remaining: number;
+  pending: Map<string, DeviceResult>; // "<clientId>#<commandId>" -> 结果
+  timer: NodeJS.Timeout;
+  onProgress?: ProgressListener;
+  resolve: (result: OperationResult) => void;
+}
+
+// ==================== 指标 ====================
+const completionSeconds = metrics.histogram(
+  "group_command_completion_seconds",
+  "Group or scene command fan-out -> last device ack",
+  ["kind"],
+);
+const deviceResults = metrics.counter(
+  "group_command_devices_total",
+  "Per-device outcome of group and scene commands",
+  ["status"],
+);
+
+const log = logger.get("groups");
+
+// ==================== 存储 ====================
+// 组与场景保存在一个 JSON 文件里，修改频率低，同步写盘即可
+export class GroupStore {
+  private readonly groups = new Map<string, Group>();
+  private readonly scenes = new Map<string, Scene>();
+
+  constructor(private readonly filePath: string) {
+    if (!existsSync(filePath)) return;
+    try {
+      const data = JSON.parse(readFileSync(filePath, "utf8"));
+      for (const group of data.groups ?? []) this.groups.set(group.id, group);
+      for (const scene of data.scenes ?? []) this.scenes.set(scene.id, scene);
+    } catch (error) {
+      log.error("读取组配置失败", { file: filePath, error });
+    }
+  }
+
+  listGroups(): Group[] {
+    return [...this.groups.values()];
+  }
+
+  getGroup(id: string): Group | undefined {
+    return this.groups.get(id);
+  }
+
+  putGroup(group: Group): void {
+    this.groups.set(group.id, group);
+    this.save();
+  }
+
+  deleteGroup(id: string): boolean {
+    const deleted = this.groups.delete(id);
+    if (deleted) this.save();
+    return deleted;
+  }
+
+  listScenes(): Scene[] {
+    return [...this.scenes.values()];
+  }
+
+  getScene(id: string): Scene | undefined {
+    return this.scenes.get(id);
+  }
+
+  putScene(scene: Scene): void {
+    this.scenes.set(scene.id, scene);
+    this.save();
+  }
+
+  deleteScene(id: string): boolean {
+    const deleted = this.scenes.delete(id);
+    if (deleted) this.save();
+    return deleted;
+  }
+
+  private save(): void {
+    mkdirSync(path.dirname(this.filePath), { recursive: true });
+    writeFileSync(
+      this.filePath,
+      JSON.stringify({ groups: this.listGroups(), scenes: this.listScenes() }, null, 2),
+    );
+  }
+}
+
+// ==================== 校验 ====================
+const ID_PATTERN = /^[\w.-]{1,64}$/;
+
+/**
+ * 校验 PUT 请求体
+ * @returns 合法的组；不合法时抛出带原因的 Error
+ */
+export function parseGroup(id: string, body: unknown): Group {
+  const { name, devices, gains } = (body ?? {}) as Partial<Group>;
+  if (!ID_PATTERN.test(id)) throw new Error("无效的组 id");
+  if (!Array.isArray(devices) || !devices.every((d) => typeof d === "string" && ID_PATTERN.test(d))) {
+    throw new Error("devices 必须是设备 ID 数组");
+  }
+  const group: Group = { id, name: typeof name === "string" && name ? name : id, devices: [...new Set(devices)] };
+  if (gains !== undefined) {
+    if (typeof gains !== "object" || gains === null || Array.isArray(gains)) throw new Error("gains 必须是对象");
+    for (const [device, gain] of Object.entries(gains)) {
+      if (!group.devices.includes(device)) throw new Error(`gains 中的设备 ${device} 不在 devices 里`);
+      if (typeof gain !== "number" || !(gain >= 0 && gain <= 1)) throw new Error("gain 必须在 0~1 之间");
+    }
+    group.gains = gains;
+  }
+  return group;
+}
+
+export function parseScene(id: string, body: unknown): Scene {
+  const { name, actions } = (body ?? {}) as Partial<Scene>;
+  if (!ID_PATTERN.test(id)) throw new Error("无效的场景 id");
+  if (!Array.isArray(actions) || actions.length === 0) throw new Error("actions 不能为空");
+  for (const action of actions) {
+    if (action.relay !== 0 && action.relay !== 1) throw new Error("relay 必须为 0 或 1");
+    if (!action.group === !action.device) throw new Error("每个动作需指定 group 或 device 之一");
+  }
+  return { id, name: typeof name === "string" && name ? name : id, actions };
+}
+
+// ==================== 组控制 ====================
+// 一次操作 = 一批指令：同一 tick 内全部发出，按 "<设备>#<指令 id>" 收集回执，
+// 全部回执或超时后返回，整组完成延迟计入直方图与最近 N 次的百分位。
+export class GroupController {
+  private nextOpId = 1;
+  private readonly operations = new Map<number, Operation>();
+  private readonly pendingAcks = new Map<string, Operation>();
+  private readonly history: Array<{ completionMs: number | null; ackMs: number[] }> = [];
+
+  constructor(
+    readonly store: GroupStore,
+    private readonly send: FanoutSender,
+  ) {}
+
+  runGroup(groupId: string, relay: 0 | 1, onProgress?: ProgressListener): Promise<OperationResult> | null {
+    const group = this.store.getGroup(groupId);
+    if (!group) return null;
+    return this.run("group", groupId, new Map(group.devices.map((d) => [d, relay])), onProgress);
+  }
+
+  activateScene(sceneId: string, onProgress?: ProgressListener): Promise<OperationResult> | null {
+    const scene = this.store.getScene(sceneId);
+    if (!scene) return null;
+    const plan = new Map<string, 0 | 1>();
+    for (const action of scene.actions) {
+      const devices = action.device ? [action.device] : (this.store.getGroup(action.group!)?.devices ?? []);
+      for (const device of devices) plan.set(device, action.relay);
+    }
+    return this.run("scene", sceneId, plan, onProgress);
+  }
+
+  /**
+   * 设备回执（单进程由管线直接调用，集群模式由 worker 经 IPC 转来）
+   */
+  handleAck(clientId: string, commandId: number, relay: 0 | 1): void {
+    const key = `${clientId}#${commandId}`;
+    const op = this.pendingAcks.get(key);
+    if (!op) return;
+    this.pendingAcks.delete(key);
+    const result = op.pending.get(key)!;
+    op.pending.delete(key);
+    result.status = "ack";
+    result.latencyMs = performance.now() - op.startedAt;
+    result.reported = relay;
+    op.result.acked++;
+    op.onProgress?.(op.result.opId, result);
+    if (--op.remaining === 0) this.complete(op);
+  }
+
+  /**
+   * 设备断开（包括被同一设备的新连接取代）：它名下未回执的指令不会再有回执，立即按超时结算。
+   * 新会话的指令 id 从 1 重新编号，不结算的话会被新会话的回执误配
+   */
+  handleDeviceDown(clientId: string): void {
+    const prefix = `${clientId}#`;
+    for (const [key, op] of this.pendingAcks) {
+      if (!key.startsWith(prefix)) continue;
+      this.pendingAcks.delete(key);
+      const result = op.pending.get(key)!;
+      op.pending.delete(key);
+      op.onProgress?.(op.result.opId, result);
+      if (--op.remaining === 0) this.complete(op);
+    }
+  }
+
+  /**
+   * 最近 N 次操作的整组完成延迟与单设备回执延迟百分位
+   */
+  stats() {
+    const completed = this.history.filter((h) => h.completionMs !== null);
+    return {
+      operations: this.history.length,
+      incomplete: this.history.length - completed.length,
+      completionMs: summarize(completed.map((h) => h.completionMs!)),
+      deviceAckMs: summarize(this.history.flatMap((h) => h.ackMs)),
+      inFlight: this.operations.size,
+    };
+  }
+
+  private async run(
+    kind: "group" | "scene",
+    target: string,
+    plan: Map<string, 0 | 1>,
+    onProgress?: ProgressListener,
+  ): Promise<OperationResult> {
+    const opId = this.nextOpId++;
+    const entries = [...plan];
+    const startedAt = performance.now();
+    const ids = await this.send(
+      entries.map(([clientId, relay]) => ({ clientId, text: RELAY_TEXT[relay] })),
+    );
+    const fanoutMs = performance.now() - startedAt;
+
+    return new Promise<OperationResult>((resolve) => {
+      const op: Operation = {
+        result: {
+          opId,
+          kind,
+          target,
+          devices: entries.length,
+          acked: 0,
+          fanoutMs,
+          completionMs: null,
+          ackLatency: summarize([]),
+          results: [],
+        },
+        startedAt,
+        remaining: 0,
+        pending: new Map(),
+        timer: setTimeout(() => this.expire(op), GROUP_CONFIG.ackTimeoutMs),
+        onProgress,
+        resolve,
+      };
+      entries.forEach(([clientId, relay], i) => {
+        const commandId = ids[i];
+        const result: DeviceResult = {
+          clientId,
+          relay,
+          status: commandId === null ? "offline" : "timeout",
+          latencyMs: null,
+          reported: null,
+        };
+        op.result.results.push(result);
+        if (commandId === null) return;
+        const key = `${clientId}#${commandId}`;
+        op.pending.set(key, result);
+        this.pendingAcks.set(key, op);
+        op.remaining++;
+      });
+      this.operations.set(opId, op);
+      if (op.remaining === 0) this.complete(op);
+    });
+  }
+
+  private expire(op: Operation): void {
+    for (const [key, result] of op.pending) {
+      this.pendingAcks.delete(key);
+      op.onProgress?.(op.result.opId, result);
+    }
+    op.pending.clear();
+    this.complete(op);
+  }
+
+  private complete(op: Operation): void {
+    clearTimeout(op.timer);
+    this.operations.delete(op.result.opId);
+    const { result } = op;
+    const ackMs = result.results.flatMap((r) => (r.latencyMs === null ? [] : [r.latencyMs]));
+    // 全部在线设备都回执才算完成；离线设备不发送、不计入
+    const online = result.results.filter((r) => r.status !== "offline").length;
+    if (online > 0 && result.acked === online) {
+      result.completionMs = Math.max(...ackMs);
+      completionSeconds.labels(result.kind).observe(result.completionMs / 1000);
+    }
+    result.ackLatency = summarize(ackMs);
+    for (const r of result.results) deviceResults.labels(r.status).inc();
+
+    this.history.push({ completionMs: result.completionMs, ackMs });
+    if (this.history.length > GROUP_CONFIG.historySize) this.history.shift();
+    log.info("操作结束", {
+      kind: result.kind,
+      target: result.target,
+      op: result.opId,
+      acked: result.acked,
+      online,
+      devices: result.devices,
+      fanoutMs: Number(result.fanoutMs.toFixed(1)),
+      completionMs: result.completionMs === null ? undefined : Number(result.completionMs.toFixed(1)),
+    });
+    op.resolve(result);
+  }
+}
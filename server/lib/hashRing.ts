@@ -0,0 +1,68 @@
+// ==================== 一致性哈希 ====================
+// 设备 ID -> worker：每个节点在环上放若干虚拟节点，
+// 增减 worker 时只有约 1/N 的设备迁移，其余设备重连后仍落在原 worker。
+
+// FNV-1a 32 位
+export function fnv1a(text: string): number {
+  let hash = 0x811c9dc5;
+  for (let i = 0; i < text.length; i++) {
+    hash ^= text.charCodeAt(i);
+    hash = Math.imul(hash, 0x01000193);
+  }
+  // 末尾再做一次雪崩混合，相近的 MAC 也能均匀分布
+  hash ^= hash >>> 16;
+  hash = Math.imul(hash, 0x85ebca6b);
+  hash ^= hash >>> 13;
+  return hash >>> 0;
+}
+
+export class HashRing<T> {
+  private points = new Uint32Array(0);
+  private owners: T[] = [];
+  private readonly nodes = new Map<string, T>();
+
+  constructor(private readonly virtualNodes: number = 100) {}
+
+  get size(): number {
+    return this.nodes.size;
+  }
+
+  add(key: string, node: T): void {
+    this.nodes.set(key, node);
+    this.rebuild();
+  }
+
+  remove(key: string): void {
+    if (this.nodes.delete(key)) this.rebuild();
+  }
+
+  /**
+   * 查找负责该 ID 的节点（环上顺时针第一个虚拟节点）
+   * @returns 环为空时返回 null
+   */
+  get(id: string): T | null {
+    const points = this.points;
+    if (points.length === 0) return null;
+    const hash = fnv1a(id);
+    let lo = 0;
+    let hi = points.length;
+    while (lo < hi) {
+      const mid = (lo + hi) >>> 1;
+      if (points[mid] < hash) lo = mid + 1;
+      else hi = mid;
+    }
+    return this.owners[lo === points.length ? 0 : lo];
+  }
+
+  private rebuild(): void {
+    const entries: Array<[number, T]> = [];
+    for (const [key, node] of this.nodes) {
+      for (let v = 0; v < this.virtualNodes; v++) {
+        entries.push([fnv1a(`${key}#${v}`), node]);
+      }
+    }
+    entries.sort((a, b) => a[0] - b[0]);
+    this.points = Uint32Array.from(entries, (e) => e[0]);
+    this.owners = entries.map((e) => e[1]);
+  }
+}
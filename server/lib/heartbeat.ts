@@ -0,0 +1,124 @@
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+import { TimerWheel, type WheelTimer } from "./timerWheel";
+
+// ==================== 配置 ====================
+// 固件 enableHeartbeat(15000, 3000, 2)：设备侧每 15 秒 ping 一次。
+// 服务器只在会话空闲满 pingIntervalMs 后才主动 ping，空闲超过 deadAfterMs 判定为半开连接并回收。
+// HEARTBEAT_INTERVAL_MS=0 关闭服务器侧心跳。
+const pingIntervalMs = Number(process.env.HEARTBEAT_INTERVAL_MS ?? 20000);
+
+export const HEARTBEAT_CONFIG = {
+  pingIntervalMs,
+  deadAfterMs: Number(process.env.HEARTBEAT_DEAD_MS) || pingIntervalMs * 2.5,
+  tickMs: 1000,
+} as const;
+
+// 心跳需要的最小连接接口（ws 的 WebSocket 满足）
+export interface HeartbeatTarget {
+  ping(): void;
+  terminate(): void;
+}
+
+export interface HeartbeatHandle {
+  // 收到任何数据（音频、文本、ping/pong）时调用：只更新时间戳，不触碰时间轮
+  touch(): void;
+  release(): void;
+}
+
+interface Session {
+  target: HeartbeatTarget;
+  label: string;
+  lastSeen: number;
+  timer: WheelTimer;
+}
+
+const log = logger.get("heartbeat");
+
+// ==================== 指标 ====================
+const trackedGauge = metrics.gauge(
+  "heartbeat_sessions",
+  "WebSocket sessions (devices, playback browsers) under server-side liveness tracking",
+);
+const pingsSent = metrics.counter(
+  "heartbeat_pings_total",
+  "Server-initiated pings to idle device sessions",
+);
+const reaped = metrics.counter(
+  "heartbeat_reaped_total",
+  "Device sessions terminated after missing heartbeats",
+);
+
+// ==================== 心跳监控 ====================
+export class HeartbeatMonitor {
+  private readonly wheel: TimerWheel;
+  private readonly sessions = new Set<Session>();
+
+  constructor(
+    private readonly pingInterval: number = HEARTBEAT_CONFIG.pingIntervalMs,
+    private readonly deadAfter: number = HEARTBEAT_CONFIG.deadAfterMs,
+    tickMs: number = HEARTBEAT_CONFIG.tickMs,
+  ) {
+    this.wheel = new TimerWheel(tickMs, 64);
+  }
+
+  get enabled(): boolean {
+    return this.pingInterval > 0;
+  }
+
+  get size(): number {
+    return this.sessions.size;
+  }
+
+  track(target: HeartbeatTarget, label: string): HeartbeatHandle {
+    if (!this.enabled) return { touch() {}, release() {} };
+    this.wheel.start();
+    const session: Session = {
+      target,
+      label,
+      lastSeen: Date.now(),
+      timer: this.wheel.create(() => this.check(session)),
+    };
+    this.sessions.add(session);
+    trackedGauge.set(this.sessions.size);
+    this.wheel.schedule(session.timer, this.pingInterval);
+    return {
+      touch: () => {
+        session.lastSeen = Date.now();
+      },
+      release: () => {
+        if (!this.sessions.delete(session)) return;
+        this.wheel.cancel(session.timer);
+        trackedGauge.set(this.sessions.size);
+      },
+    };
+  }
+
+  // 到期检查：活跃的会话按最后活动时间顺延，空闲的 ping，超时的回收
+  private check(session: Session): void {
+    if (!this.sessions.has(session)) return;
+    const idle = Date.now() - session.lastSeen;
+    if (idle >= this.deadAfter) {
+      this.sessions.delete(session);
+      trackedGauge.set(this.sessions.size);
+      reaped.inc();
+      log.warn("无响应，回收连接", { session: session.label, idleMs: idle });
+      // terminate 直接销毁 socket，随后的 close 事件负责释放 ASR、定时器与缓冲区
+      session.target.terminate();
+      return;
+    }
+    if (idle >= this.pingInterval) {
+      pingsSent.inc();
+      try {
+        session.target.ping();
+      } catch {
+        // socket 已不可写，等下一次检查回收
+      }
+      this.wheel.schedule(session.timer, Math.min(this.pingInterval, this.deadAfter - idle));
+      return;
+    }
+    this.wheel.schedule(session.timer, this.pingInterval - idle);
+  }
+}
+
+export const heartbeatMonitor = new HeartbeatMonitor();
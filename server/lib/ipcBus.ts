@@ -0,0 +1,184 @@
+import type { Worker } from "cluster";
+import type { IncomingHttpHeaders } from "http";
+import type { Socket } from "net";
+import type { DrainReport } from "./audioPipeline";
+import type { TranscriptEntry } from "./transcripts";
+
+// ==================== 集群 IPC 消息 ====================
+// 主进程负责 HTTP / 播放客户端，worker 负责设备连接（解帧、ASR、归档）。
+// 使用 serialization: "advanced"，Buffer 以 Uint8Array 形式传递，无需 base64。
+
+// 主进程 -> worker
+export type PrimaryMessage =
+  // 随消息一起传递 socket 句柄，worker 在本进程内完成 WebSocket 升级
+  | { type: "upgrade"; url: string; headers: IncomingHttpHeaders; head: Uint8Array }
+  | { type: "playback"; subscribers: number }
+  // 停机：worker 在 deadlineAt 前完成收尾，回 drained 后退出
+  | { type: "shutdown"; deadlineAt: number }
+  | { type: "request"; reqId: number; method: string; params: unknown };
+
+// worker -> 主进程
+export type WorkerMessage =
+  | { type: "audio"; clientId: string; pcm: Uint8Array; capturedAt: number }
+  | { type: "data"; message: Record<string, unknown> }
+  | { type: "device"; clientId: string; up: boolean }
+  | { type: "ack"; clientId: string; commandId: number; relay: 0 | 1 }
+  // 定期上报负载，供主进程做升级时准入判断
+  | { type: "load"; sessions: number; lagMs: number; cpu: number }
+  // 新写入 / 转码替换的归档文件，由主进程统一做保留清理
+  | { type: "archive"; filePath: string; bytes: number; replaces?: string }
+  // 转码线程接手 / 放下的文件，期间保留清理跳过它
+  | { type: "archive_busy"; filePath: string; compressing: boolean }
+  // 句末识别结果，由主进程统一写入转写库
+  | { type: "transcript"; entry: TranscriptEntry }
+  // 收尾完成（主进程通知或 worker 自己收到信号），随后 worker 退出
+  | { type: "drained"; report: DrainReport }
+  | { type: "reply"; reqId: number; result?: unknown; error?: string };
+
+type RequestHandler = (params: any) => unknown | Promise<unknown>;
+
+const DEFAULT_TIMEOUT_MS = 2000;
+
+// ==================== 主进程端 ====================
+export class PrimaryBus {
+  private nextReqId = 1;
+  private readonly pending = new Map<
+    number,
+    { resolve: (v: unknown) => void; reject: (e: Error) => void; timer: NodeJS.Timeout }
+  >();
+
+  constructor(
+    readonly worker: Worker,
+    private readonly onMessage: (msg: WorkerMessage) => void,
+  ) {
+    worker.on("message", (msg: WorkerMessage) => {
+      if (msg.type === "reply") {
+        this.settle(msg);
+        return;
+      }
+      this.onMessage(msg);
+    });
+    worker.on("exit", () => {
+      for (const [reqId] of this.pending) {
+        this.settle({ type: "reply", reqId, error: "worker exited" });
+      }
+    });
+  }
+
+  get id(): number {
+    return this.worker.id;
+  }
+
+  handOff(socket: Socket, url: string, headers: IncomingHttpHeaders, head: Buffer): void {
+    if (!this.worker.isConnected()) {
+      socket.destroy();
+      return;
+    }
+    this.worker.send({ type: "upgrade", url, headers, head } satisfies PrimaryMessage, socket);
+  }
+
+  post(msg: PrimaryMessage): void {
+    if (this.worker.isConnected()) this.worker.send(msg);
+  }
+
+  /**
+   * 调用 worker 上注册的方法
+   * @param timeoutMs 超时后 reject，避免 worker 卡死时 HTTP 请求一直挂起
+   */
+  request<T = unknown>(
+    method: string,
+    params: unknown = null,
+    timeoutMs: number = DEFAULT_TIMEOUT_MS,
+  ): Promise<T> {
+    const reqId = this.nextReqId++;
+    return new Promise<T>((resolve, reject) => {
+      const timer = setTimeout(() => {
+        this.settle({ type: "reply", reqId, error: `${method} 超时 (${timeoutMs}ms)` });
+      }, timeoutMs);
+      this.pending.set(reqId, { resolve: resolve as (v: unknown) => void, reject, timer });
+      this.post({ type: "request", reqId, method, params });
+    });
+  }
+
+  private settle(msg: Extract<WorkerMessage, { type: "reply" }>): void {
+    const entry = this.pending.get(msg.reqId);
+    if (!entry) return;
+    this.pending.delete(msg.reqId);
+    clearTimeout(entry.timer);
+    if (msg.error !== undefined) entry.reject(new Error(msg.error));
+    else entry.resolve(msg.result);
+  }
+}
+
+// ==================== worker 端 ====================
+export class WorkerBus {
+  private readonly handlers = new Map<string, RequestHandler>();
+  private upgradeHandler:
+    | ((socket: Socket, url: string, headers: IncomingHttpHeaders, head: Buffer) => void)
+    | null = null;
+  private shutdownHandler: ((deadlineAt: number) => void) | null = null;
+  playbackSubscribers = 0;
+
+  constructor() {
+    process.on("message", (msg: PrimaryMessage, socket?: Socket) => {
+      switch (msg.type) {
+        case "upgrade":
+          if (socket && this.upgradeHandler) {
+            this.upgradeHandler(socket, msg.url, msg.headers, toBuffer(msg.head));
+          } else {
+            socket?.destroy();
+          }
+          break;
+        case "playback":
+          this.playbackSubscribers = msg.subscribers;
+          break;
+        case "request":
+          void this.dispatch(msg.reqId, msg.method, msg.params);
+          break;
+        case "shutdown":
+          this.shutdownHandler?.(msg.deadlineAt);
+          break;
+      }
+    });
+  }
+
+  onUpgrade(
+    fn: (socket: Socket, url: string, headers: IncomingHttpHeaders, head: Buffer) => void,
+  ): void {
+    this.upgradeHandler = fn;
+  }
+
+  onShutdown(fn: (deadlineAt: number) => void): void {
+    this.shutdownHandler = fn;
+  }
+
+  handle(method: string, fn: RequestHandler): void {
+    this.handlers.set(method, fn);
+  }
+
+  /**
+   * @param done 消息写入通道（或通道已关闭）后调用，退出前用来确认消息已发出
+   */
+  send(msg: WorkerMessage, done?: () => void): void {
+    // 主进程退出时通道可能已关闭；错误交给回调，避免 EPIPE 变成未处理的 error 事件
+    if (process.connected) process.send!(msg, undefined, undefined, () => done?.());
+    else done?.();
+  }
+
+  private async dispatch(reqId: number, method: string, params: unknown) {
+    const fn = this.handlers.get(method);
+    try {
+      if (!fn) throw new Error(`未知方法: ${method}`);
+      this.send({ type: "reply", reqId, result: await fn(params) });
+    } catch (error) {
+      this.send({ type: "reply", reqId, error: String(error) });
+    }
+  }
+}
+
+// advanced 序列化把 Buffer 还原成 Uint8Array，这里零拷贝包装回 Buffer
+export function toBuffer(data: Uint8Array): Buffer {
+  return Buffer.isBuffer(data)
+    ? data
+    : Buffer.from(data.buffer, data.byteOffset, data.byteLength);
+}
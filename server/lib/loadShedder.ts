@@ -0,0 +1,145 @@
+import { monitorEventLoopDelay } from "perf_hooks";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+
+// ==================== 配置 ====================
+function parseThresholds(value: string | undefined): [number, number, number] {
+  const parts = (value || "").split(",").map(Number);
+  if (parts.length === 3 && parts.every((n) => n > 0)) {
+    return [parts[0], parts[1], parts[2]];
+  }
+  return [50, 100, 200];
+}
+
+const CONFIG = {
+  sampleIntervalMs: 500,
+  // 事件循环延迟 p99（毫秒）达到第 N 个阈值时进入第 N 级，例如 LOAD_SHED_LAG_MS=50,100,200
+  thresholdsMs: parseThresholds(process.env.LOAD_SHED_LAG_MS),
+  recoverRatio: 0.5, // 延迟降到阈值的一半以下才回落，避免抖动
+  recoverHoldMs: 3000, // 且需持续这么久
+} as const;
+
+// ==================== 类型定义 ====================
+// 逐级降载：1 暂停播放分发 -> 2 推迟归档 -> 3 停止低优先级设备的 ASR
+export const SHED_NONE = 0;
+export const SHED_PLAYBACK = 1;
+export const SHED_ARCHIVE = 2;
+export const SHED_ASR = 3;
+
+export type ShedLevel = 0 | 1 | 2 | 3;
+
+const REASONS: Record<ShedLevel, string> = {
+  0: "LAG_RECOVERED",
+  1: "LAG_PAUSE_PLAYBACK",
+  2: "LAG_DEFER_ARCHIVE",
+  3: "LAG_SHED_ASR",
+};
+
+export interface ShedDecision {
+  from: ShedLevel;
+  to: ShedLevel;
+  reason: string;
+  lagMs: number;
+}
+
+const log = logger.get("loadshed");
+
+const levelGauge = metrics.gauge(
+  "load_shed_level",
+  "Current load shedding level (0 none, 1 playback, 2 archive, 3 asr)",
+);
+const lagGauge = metrics.gauge(
+  "load_shed_lag_seconds",
+  "Event loop delay p99 of the last shedding sample window",
+);
+const decisions = metrics.counter(
+  "load_shed_decisions_total",
+  "Load shedding level changes",
+  ["reason"],
+);
+
+// ==================== 负载降级 ====================
+export class LoadShedder {
+  level: ShedLevel = SHED_NONE;
+  lagMs = 0; // 最近一个采样窗口的 p99
+  private readonly histogram = monitorEventLoopDelay({ resolution: 10 });
+  private readonly listeners: Array<(decision: ShedDecision) => void> = [];
+  private belowSince: number | null = null;
+  private timer: NodeJS.Timeout | null = null;
+
+  start(): void {
+    if (this.timer) return;
+    this.histogram.enable();
+    this.timer = setInterval(() => this.sample(), CONFIG.sampleIntervalMs);
+    this.timer.unref();
+  }
+
+  stop(): void {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+    this.histogram.disable();
+  }
+
+  onChange(fn: (decision: ShedDecision) => void): void {
+    this.listeners.push(fn);
+  }
+
+  /**
+   * 根据一个窗口的延迟调整级别：升级立即生效，降级需持续低于回落线
+   * @param lagMs 窗口内事件循环延迟 p99（毫秒）
+   */
+  update(lagMs: number, now: number = Date.now()): void {
+    this.lagMs = lagMs;
+    lagGauge.set(lagMs / 1000);
+
+    let target: ShedLevel = SHED_NONE;
+    for (let i = 0; i < CONFIG.thresholdsMs.length; i++) {
+      if (lagMs >= CONFIG.thresholdsMs[i]) target = (i + 1) as ShedLevel;
+    }
+
+    if (target > this.level) {
+      this.belowSince = null;
+      this.transition(target, REASONS[target], lagMs);
+      return;
+    }
+
+    if (this.level === SHED_NONE) return;
+    const recoverLine = CONFIG.thresholdsMs[this.level - 1] * CONFIG.recoverRatio;
+    if (lagMs >= recoverLine) {
+      this.belowSince = null;
+      return;
+    }
+    if (this.belowSince === null) {
+      this.belowSince = now;
+      return;
+    }
+    if (now - this.belowSince >= CONFIG.recoverHoldMs) {
+      this.belowSince = now;
+      // 每次只回落一级，依次恢复 ASR、归档、播放
+      this.transition((this.level - 1) as ShedLevel, `${REASONS[this.level]}_LIFTED`, lagMs);
+    }
+  }
+
+  private sample(): void {
+    const lagMs = this.histogram.percentile(99) / 1e6;
+    this.histogram.reset();
+    this.update(lagMs);
+  }
+
+  private transition(to: ShedLevel, reason: string, lagMs: number): void {
+    const decision: ShedDecision = { from: this.level, to, reason, lagMs };
+    this.level = to;
+    levelGauge.set(to);
+    decisions.labels(reason).inc();
+    log.warn("降级级别变化", {
+      from: decision.from,
+      to,
+      reason,
+      lagP99Ms: Number(lagMs.toFixed(1)),
+      thresholdsMs: CONFIG.thresholdsMs,
+    });
+    for (const fn of this.listeners) fn(decision);
+  }
+}
+
+export const loadShedder = new LoadShedder();
@@ -0,0 +1,297 @@
+import { openSync, write, writeSync } from "fs";
+import { metrics } from "./metrics";
+
+// ==================== 配置 ====================
+// 结构化日志：每条一行 JSON（或终端下的可读格式），先进内存缓冲，定时 / 攒够一批后
+// 一次异步 write。console.log 写终端和管道在 Linux 上是同步的，高频调用直接体现为事件循环延迟。
+//   LOG_LEVEL=info                    默认级别
+//   LOG_LEVELS=asr=debug,http=warn    按类别覆盖
+//   LOG_FORMAT=json|pretty            缺省时终端用 pretty，否则 json
+//   LOG_FILE=/var/log/light.jsonl     追加写文件，缺省写 stdout
+export const LOG_CONFIG = {
+  level: (process.env.LOG_LEVEL || "info") as LogLevel,
+  categoryLevels: process.env.LOG_LEVELS || "",
+  format: (process.env.LOG_FORMAT || (process.stdout.isTTY ? "pretty" : "json")) as "json" | "pretty",
+  file: process.env.LOG_FILE || "",
+  flushIntervalMs: 50,
+  maxBatchBytes: 64 * 1024, // 攒够这么多立即写
+  maxPendingBytes: 4 * 1024 * 1024, // 写不动时缓冲上限，超出丢弃并计数
+  ringSize: 1000, // 内存中保留最近的记录，/logs 查看
+} as const;
+
+export type LogLevel = "debug" | "info" | "warn" | "error" | "silent";
+export type LogFields = Record<string, unknown>;
+
+const LEVELS: Record<LogLevel, number> = { debug: 10, info: 20, warn: 30, error: 40, silent: 100 };
+const LEVEL_NAMES = ["debug", "info", "warn", "error"] as const;
+
+// ==================== 指标 ====================
+const recordsTotal = metrics.counter("log_records_total", "Log records emitted", ["level"]);
+const droppedTotal = metrics.counter(
+  "log_dropped_total",
+  "Log records not written (sampled out or buffer full)",
+  ["reason"],
+);
+const pendingGauge = metrics.gauge("log_pending_bytes", "Log bytes waiting for the async writer");
+const droppedSampled = droppedTotal.labels("sampled");
+const droppedBufferFull = droppedTotal.labels("buffer_full");
+const droppedWriteError = droppedTotal.labels("write_error");
+
+function parseLevel(value: string, fallback: LogLevel): LogLevel {
+  return value in LEVELS ? (value as LogLevel) : fallback;
+}
+
+// "asr=debug,http=warn" -> Map
+function parseCategoryLevels(spec: string, fallback: LogLevel): Map<string, LogLevel> {
+  const levels = new Map<string, LogLevel>();
+  for (const part of spec.split(",")) {
+    const [category, level] = part.split("=").map((s) => s.trim());
+    if (category && level) levels.set(category, parseLevel(level, fallback));
+  }
+  return levels;
+}
+
+// Error 默认序列化成 {}，取 message / stack
+function replacer(_key: string, value: unknown) {
+  if (value instanceof Error) return { message: value.message, stack: value.stack };
+  if (typeof value === "bigint") return value.toString();
+  return value;
+}
+
+function pad(n: number, width: number = 2): string {
+  return String(n).padStart(width, "0");
+}
+
+// ==================== 异步批量写出 ====================
+class LogSink {
+  private pending: string[] = [];
+  private pendingBytes = 0;
+  private writing = false;
+  private timer: NodeJS.Timeout | null = null;
+  private fd: number;
+  private readonly ring: string[] = [];
+  private ringHead = 0;
+
+  constructor(private readonly config: typeof LOG_CONFIG) {
+    this.fd = config.file ? openSync(config.file, "a") : 1;
+    // 退出前把缓冲同步写完；正在进行的那一批由内核 / 线程池完成
+    process.on("exit", () => this.flushSync());
+  }
+
+  push(line: string): void {
+    if (this.ring.length < this.config.ringSize) this.ring.push(line);
+    else this.ring[this.ringHead] = line;
+    this.ringHead = (this.ringHead + 1) % this.config.ringSize;
+
+    if (this.pendingBytes + line.length > this.config.maxPendingBytes) {
+      droppedBufferFull.inc();
+      return;
+    }
+    this.pending.push(line);
+    this.pendingBytes += line.length;
+    if (this.pendingBytes >= this.config.maxBatchBytes) this.flush();
+    else if (!this.timer) {
+      this.timer = setTimeout(() => this.flush(), this.config.flushIntervalMs);
+      this.timer.unref();
+    }
+  }
+
+  // 最近 n 条，从旧到新
+  recent(n: number): string[] {
+    const ordered =
+      this.ring.length < this.config.ringSize
+        ? this.ring
+        : [...this.ring.slice(this.ringHead), ...this.ring.slice(0, this.ringHead)];
+    return ordered.slice(-n);
+  }
+
+  // 同一时刻只有一个写请求在线程池里，保证顺序；写的过程中新记录继续攒下一批
+  flush(): void {
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+    if (this.writing || this.pending.length === 0) return;
+    const batch = Buffer.from(this.pending.join(""), "utf8");
+    this.pending = [];
+    this.pendingBytes = 0;
+    this.writing = true;
+    this.writeAll(batch, 0);
+  }
+
+  private writeAll(batch: Buffer, offset: number): void {
+    write(this.fd, batch, offset, batch.length - offset, null, (error, written) => {
+      if (error?.code === "EAGAIN") {
+        // 非阻塞管道写满：稍后重试
+        setTimeout(() => this.writeAll(batch, offset), 10);
+        return;
+      }
+      if (error) {
+        // 输出端关闭（管道另一头退出）：丢弃这一批，不再抛出
+        droppedWriteError.inc();
+      } else if (offset + written < batch.length) {
+        this.writeAll(batch, offset + written);
+        return;
+      }
+      this.writing = false;
+      pendingGauge.set(this.pendingBytes);
+      if (this.pending.length > 0) this.flush();
+    });
+    pendingGauge.set(this.pendingBytes + batch.length - offset);
+  }
+
+  flushSync(): void {
+    if (this.pending.length === 0) return;
+    const batch = this.pending.join("");
+    this.pending = [];
+    this.pendingBytes = 0;
+    try {
+      writeSync(this.fd, batch);
+    } catch {
+      // 退出阶段输出端可能已关闭
+    }
+  }
+}
+
+// ==================== 日志器 ====================
+// 每个限速 key 的当前窗口
+interface SampleWindow {
+  startedAt: number;
+  count: number;
+  suppressed: number;
+}
+
+export class Logger {
+  // 当前阈值；热路径上只比较这个数，关闭时不做任何分配
+  threshold: number;
+  private readonly windows = new Map<string, SampleWindow>();
+
+  constructor(
+    readonly category: string,
+    private readonly root: LoggerRoot,
+  ) {
+    this.threshold = root.thresholdFor(category);
+  }
+
+  enabled(level: Exclude<LogLevel, "silent">): boolean {
+    return LEVELS[level] >= this.threshold;
+  }
+
+  debug(msg: string, fields?: LogFields): void {
+    if (LEVELS.debug >= this.threshold) this.root.emit(LEVELS.debug, this.category, msg, fields);
+  }
+
+  info(msg: string, fields?: LogFields): void {
+    if (LEVELS.info >= this.threshold) this.root.emit(LEVELS.info, this.category, msg, fields);
+  }
+
+  warn(msg: string, fields?: LogFields): void {
+    if (LEVELS.warn >= this.threshold) this.root.emit(LEVELS.warn, this.category, msg, fields);
+  }
+
+  error(msg: string, fields?: LogFields): void {
+    if (LEVELS.error >= this.threshold) this.root.emit(LEVELS.error, this.category, msg, fields);
+  }
+
+  /**
+   * 高频事件限速：同一 key 每秒最多输出 perSec 条，其余计数，
+   * 下一条输出时附带 suppressed 字段
+   * 字段构造本身有开销时，先用 enabled() 判断
+   */
+  sampled(
+    level: Exclude<LogLevel, "silent">,
+    key: string,
+    perSec: number,
+    msg: string,
+    fields?: LogFields,
+  ): void {
+    if (LEVELS[level] < this.threshold) return;
+    const now = Date.now();
+    let window = this.windows.get(key);
+    if (!window) {
+      window = { startedAt: now, count: 0, suppressed: 0 };
+      this.windows.set(key, window);
+    }
+    if (now - window.startedAt >= 1000) {
+      window.startedAt = now;
+      window.count = 0;
+    }
+    if (window.count >= perSec) {
+      window.suppressed++;
+      droppedSampled.inc();
+      return;
+    }
+    window.count++;
+    const suppressed = window.suppressed;
+    window.suppressed = 0;
+    this.root.emit(LEVELS[level], this.category, msg, suppressed > 0 ? { ...fields, suppressed } : fields);
+  }
+}
+
+export class LoggerRoot {
+  private defaultLevel: LogLevel;
+  private categoryLevels: Map<string, LogLevel>;
+  private readonly loggers = new Map<string, Logger>();
+  private readonly sink: LogSink;
+  private readonly recordCounters = LEVEL_NAMES.map((name) => recordsTotal.labels(name));
+
+  constructor(private readonly config: typeof LOG_CONFIG = LOG_CONFIG) {
+    this.defaultLevel = parseLevel(config.level, "info");
+    this.categoryLevels = parseCategoryLevels(config.categoryLevels, this.defaultLevel);
+    this.sink = new LogSink(config);
+  }
+
+  // 同一类别共用一个实例，模块加载时取一次
+  get(category: string): Logger {
+    let logger = this.loggers.get(category);
+    if (!logger) {
+      logger = new Logger(category, this);
+      this.loggers.set(category, logger);
+    }
+    return logger;
+  }
+
+  thresholdFor(category: string): number {
+    return LEVELS[this.categoryLevels.get(category) ?? this.defaultLevel];
+  }
+
+  /**
+   * 运行时调整级别，已创建的日志器立即生效
+   * @param category 省略时修改默认级别
+   */
+  setLevel(level: LogLevel, category?: string): void {
+    if (category) this.categoryLevels.set(category, level);
+    else this.defaultLevel = level;
+    for (const logger of this.loggers.values()) {
+      logger.threshold = this.thresholdFor(logger.category);
+    }
+  }
+
+  emit(level: number, category: string, msg: string, fields?: LogFields): void {
+    const name = LEVEL_NAMES[level / 10 - 1];
+    this.recordCounters[level / 10 - 1].inc();
+    const ts = Date.now();
+    let line: string;
+    if (this.config.format === "json") {
+      line = JSON.stringify({ ts, level: name, cat: category, msg, ...fields }, replacer) + "\n";
+    } else {
+      const d = new Date(ts);
+      const time = `${pad(d.getHours())}:${pad(d.getMinutes())}:${pad(d.getSeconds())}.${pad(d.getMilliseconds(), 3)}`;
+      let extra = "";
+      if (fields) {
+        for (const key in fields) {
+          const value = fields[key];
+          extra += ` ${key}=${typeof value === "string" ? value : JSON.stringify(value, replacer)}`;
+        }
+      }
+      line = `${time} ${name.toUpperCase().padEnd(5)} [${category}] ${msg}${extra}\n`;
+    }
+    this.sink.push(line);
+  }
+
+  recent(n: number): string[] {
+    return this.sink.recent(n);
+  }
+}
+
+export const logger = new LoggerRoot();
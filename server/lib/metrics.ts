@@ -0,0 +1,471 @@
+import { constants as perfConstants, monitorEventLoopDelay, PerformanceObserver } from "perf_hooks";
+
+// ==================== 类型定义 ====================
+type MetricType = "counter" | "gauge" | "histogram";
+
+export interface MetricSample {
+  name: string;
+  labels: Record<string, string>;
+  value: number;
+}
+
+export interface MetricFamily {
+  name: string;
+  help: string;
+  type: MetricType | "untyped";
+  samples: MetricSample[];
+}
+
+// 默认延迟桶（秒），覆盖 1ms ~ 10s
+export const LATENCY_BUCKETS = [
+  0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+];
+
+// ==================== 指标子项 ====================
+// 热路径只做数字累加：调用方在连接建立时取一次 child 并缓存，
+// 之后每帧只是一次属性写入，没有 Map 查找和字符串拼接。
+export class CounterChild {
+  value = 0;
+  inc(n: number = 1): void {
+    this.value += n;
+  }
+}
+
+export class GaugeChild {
+  value = 0;
+  set(v: number): void {
+    this.value = v;
+  }
+  inc(n: number = 1): void {
+    this.value += n;
+  }
+  dec(n: number = 1): void {
+    this.value -= n;
+  }
+}
+
+export class HistogramChild {
+  readonly counts: Float64Array;
+  sum = 0;
+  count = 0;
+
+  constructor(private readonly buckets: readonly number[]) {
+    this.counts = new Float64Array(buckets.length);
+  }
+
+  observe(v: number): void {
+    this.sum += v;
+    this.count++;
+    const buckets = this.buckets;
+    for (let i = 0; i < buckets.length; i++) {
+      if (v <= buckets[i]) {
+        this.counts[i]++;
+        return;
+      }
+    }
+  }
+}
+
+type Child = CounterChild | GaugeChild | HistogramChild;
+
+// ==================== 指标族 ====================
+abstract class Metric<C extends Child> {
+  protected readonly children = new Map<string, { values: string[]; child: C }>();
+
+  constructor(
+    readonly name: string,
+    readonly help: string,
+    readonly type: MetricType,
+    readonly labelNames: readonly string[],
+  ) {}
+
+  protected abstract create(): C;
+
+  labels(...values: string[]): C {
+    const key = values.join("\u0000");
+    let entry = this.children.get(key);
+    if (!entry) {
+      entry = { values, child: this.create() };
+      this.children.set(key, entry);
+    }
+    return entry.child;
+  }
+
+  // 设备断开时移除，避免 clientId 无限增长导致标签基数泄漏
+  remove(...values: string[]): void {
+    this.children.delete(values.join("\u0000"));
+  }
+
+  reset(): void {
+    this.children.clear();
+  }
+
+  protected labelObject(values: string[]): Record<string, string> {
+    const labels: Record<string, string> = {};
+    this.labelNames.forEach((name, i) => {
+      labels[name] = values[i] ?? "";
+    });
+    return labels;
+  }
+
+  abstract samples(): MetricSample[];
+}
+
+export class Counter extends Metric<CounterChild> {
+  protected create(): CounterChild {
+    return new CounterChild();
+  }
+
+  inc(n: number = 1): void {
+    this.labels().inc(n);
+  }
+
+  samples(): MetricSample[] {
+    return [...this.children.values()].map(({ values, child }) => ({
+      name: this.name,
+      labels: this.labelObject(values),
+      value: child.value,
+    }));
+  }
+}
+
+export class Gauge extends Metric<GaugeChild> {
+  protected create(): GaugeChild {
+    return new GaugeChild();
+  }
+
+  set(v: number): void {
+    this.labels().set(v);
+  }
+
+  inc(n: number = 1): void {
+    this.labels().inc(n);
+  }
+
+  dec(n: number = 1): void {
+    this.labels().dec(n);
+  }
+
+  samples(): MetricSample[] {
+    return [...this.children.values()].map(({ values, child }) => ({
+      name: this.name,
+      labels: this.labelObject(values),
+      value: child.value,
+    }));
+  }
+}
+
+export class Histogram extends Metric<HistogramChild> {
+  constructor(
+    name: string,
+    help: string,
+    labelNames: readonly string[],
+    readonly buckets: readonly number[],
+  ) {
+    super(name, help, "histogram", labelNames);
+  }
+
+  protected create(): HistogramChild {
+    return new HistogramChild(this.buckets);
+  }
+
+  observe(v: number): void {
+    this.labels().observe(v);
+  }
+
+  samples(): MetricSample[] {
+    const out: MetricSample[] = [];
+    for (const { values, child } of this.children.values()) {
+      const labels = this.labelObject(values);
+      let cumulative = 0;
+      this.buckets.forEach((le, i) => {
+        cumulative += child.counts[i];
+        out.push({
+          name: `${this.name}_bucket`,
+          labels: { ...labels, le: formatValue(le) },
+          value: cumulative,
+        });
+      });
+      out.push({
+        name: `${this.name}_bucket`,
+        labels: { ...labels, le: "+Inf" },
+        value: child.count,
+      });
+      out.push({ name: `${this.name}_sum`, labels, value: child.sum });
+      out.push({ name: `${this.name}_count`, labels, value: child.count });
+    }
+    return out;
+  }
+}
+
+// ==================== 注册表 ====================
+export class Registry {
+  private readonly metrics = new Map<string, Metric<Child>>();
+  private readonly collectors: Array<() => void> = [];
+
+  counter(name: string, help: string, labelNames: readonly string[] = []): Counter {
+    return this.register(new Counter(name, help, "counter", labelNames));
+  }
+
+  gauge(name: string, help: string, labelNames: readonly string[] = []): Gauge {
+    return this.register(new Gauge(name, help, "gauge", labelNames));
+  }
+
+  histogram(
+    name: string,
+    help: string,
+    labelNames: readonly string[] = [],
+    buckets: readonly number[] = LATENCY_BUCKETS,
+  ): Histogram {
+    return this.register(new Histogram(name, help, labelNames, buckets));
+  }
+
+  // 抓取时才计算的指标（堆、事件循环延迟等）
+  onCollect(fn: () => void): void {
+    this.collectors.push(fn);
+  }
+
+  families(): MetricFamily[] {
+    for (const fn of this.collectors) {
+      try {
+        fn();
+      } catch (error) {
+        console.error("[Metrics] collector 出错:", error);
+      }
+    }
+    return [...this.metrics.values()].map((metric) => ({
+      name: metric.name,
+      help: metric.help,
+      type: metric.type,
+      samples: metric.samples(),
+    }));
+  }
+
+  render(): string {
+    return renderFamilies(this.families());
+  }
+
+  private register<M extends Metric<Child>>(metric: M): M {
+    if (this.metrics.has(metric.name)) {
+      throw new Error(`指标重复注册: ${metric.name}`);
+    }
+    this.metrics.set(metric.name, metric);
+    return metric;
+  }
+}
+
+// ==================== 文本格式 ====================
+function formatValue(v: number): string {
+  if (Number.isNaN(v)) return "NaN";
+  if (v === Infinity) return "+Inf";
+  if (v === -Infinity) return "-Inf";
+  return String(v);
+}
+
+function escapeLabel(v: string): string {
+  return v.replace(/\\/g, "\\\\").replace(/\n/g, "\\n").replace(/"/g, '\\"');
+}
+
+function escapeHelp(v: string): string {
+  return v.replace(/\\/g, "\\\\").replace(/\n/g, "\\n");
+}
+
+export function renderFamilies(families: MetricFamily[]): string {
+  const lines: string[] = [];
+  for (const family of families) {
+    lines.push(`# HELP ${family.name} ${escapeHelp(family.help)}`);
+    lines.push(`# TYPE ${family.name} ${family.type}`);
+    for (const sample of family.samples) {
+      const labels = Object.entries(sample.labels)
+        .map(([k, v]) => `${k}="${escapeLabel(v)}"`)
+        .join(",");
+      lines.push(
+        `${sample.name}${labels ? `{${labels}}` : ""} ${formatValue(sample.value)}`,
+      );
+    }
+  }
+  return lines.join("\n") + "\n";
+}
+
+/**
+ * 解析 Prometheus 文本格式（0.0.4）
+ * 用于校验 /metrics 输出；格式错误时抛出异常并指明行号
+ * @param text 抓取得到的文本
+ * @returns 按 HELP/TYPE 分组的指标族
+ */
+export function parsePrometheusText(text: string): MetricFamily[] {
+  const families = new Map<string, MetricFamily>();
+  const ensure = (name: string): MetricFamily => {
+    let family = families.get(name);
+    if (!family) {
+      family = { name, help: "", type: "untyped", samples: [] };
+      families.set(name, family);
+    }
+    return family;
+  };
+  // histogram 的 _bucket/_sum/_count 样本归入同名族
+  const familyOf = (sampleName: string): MetricFamily => {
+    const exact = families.get(sampleName);
+    if (exact) return exact;
+    const parent = families.get(sampleName.replace(/_(bucket|sum|count)$/, ""));
+    if (parent && (parent.type === "histogram" || parent.type === "summary")) {
+      return parent;
+    }
+    return ensure(sampleName);
+  };
+
+  const nameRe = /^[a-zA-Z_:][a-zA-Z0-9_:]*$/;
+  const lines = text.split("\n");
+  lines.forEach((raw, index) => {
+    const line = raw.trim();
+    const fail = (reason: string): never => {
+      throw new Error(`第 ${index + 1} 行格式错误 (${reason}): ${raw}`);
+    };
+    if (!line) return;
+
+    if (line.startsWith("#")) {
+      const m = /^#\s+(HELP|TYPE)\s+(\S+)\s*(.*)$/.exec(line);
+      if (!m) return; // 普通注释
+      const [, kind, name, rest] = m;
+      if (!nameRe.test(name)) fail("非法指标名");
+      const family = ensure(name);
+      if (kind === "HELP") {
+        family.help = rest.replace(/\\n/g, "\n").replace(/\\\\/g, "\\");
+      } else {
+        if (!["counter", "gauge", "histogram", "summary", "untyped"].includes(rest)) {
+          fail("未知类型");
+        }
+        family.type = rest as MetricFamily["type"];
+      }
+      return;
+    }
+
+    const m = /^([a-zA-Z_:][a-zA-Z0-9_:]*)(\{(.*)\})?\s+(\S+)(\s+-?\d+)?$/.exec(line);
+    if (!m) fail("无法识别的样本行");
+    const [, name, , labelBody, valueStr] = m!;
+    const labels: Record<string, string> = {};
+    if (labelBody) {
+      const labelRe = /\s*([a-zA-Z_][a-zA-Z0-9_]*)="((?:[^"\\]|\\.)*)"\s*(,|$)/y;
+      let pos = 0;
+      while (pos < labelBody.length) {
+        labelRe.lastIndex = pos;
+        const lm = labelRe.exec(labelBody);
+        if (!lm) fail("标签格式错误");
+        labels[lm![1]] = lm![2]
+          .replace(/\\n/g, "\n")
+          .replace(/\\"/g, '"')
+          .replace(/\\\\/g, "\\");
+        pos = labelRe.lastIndex;
+      }
+    }
+    let value: number;
+    if (valueStr === "+Inf") value = Infinity;
+    else if (valueStr === "-Inf") value = -Infinity;
+    else if (valueStr === "NaN") value = NaN;
+    else {
+      value = Number(valueStr);
+      if (Number.isNaN(value)) fail("数值非法");
+    }
+    familyOf(name).samples.push({ name, labels, value });
+  });
+
+  return [...families.values()];
+}
+
+// ==================== 默认注册表与进程指标 ====================
+export const metrics = new Registry();
+
+const loopDelay = monitorEventLoopDelay({ resolution: 10 });
+loopDelay.enable();
+
+const eventLoopLag = metrics.gauge(
+  "nodejs_eventloop_lag_seconds",
+  "Event loop delay since last scrape",
+  ["stat"],
+);
+const heapUsed = metrics.gauge("nodejs_heap_used_bytes", "V8 heap used");
+const heapTotal = metrics.gauge("nodejs_heap_total_bytes", "V8 heap total");
+const externalMem = metrics.gauge(
+  "nodejs_external_memory_bytes",
+  "Memory held by Buffers and other C++ objects",
+);
+const rss = metrics.gauge("process_resident_memory_bytes", "Resident set size");
+const activeResources = metrics.gauge(
+  "nodejs_active_resources",
+  "Resources keeping the event loop alive (sockets, timers, fs requests)",
+  ["type"],
+);
+const seenResourceTypes = new Set<string>();
+const gcDuration = metrics.histogram(
+  "nodejs_gc_duration_seconds",
+  "Garbage collection pause time",
+  ["kind"],
+  [0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25],
+);
+
+const GC_KINDS: Record<number, string> = {
+  [perfConstants.NODE_PERFORMANCE_GC_MINOR]: "minor",
+  [perfConstants.NODE_PERFORMANCE_GC_MAJOR]: "major",
+  [perfConstants.NODE_PERFORMANCE_GC_INCREMENTAL]: "incremental",
+  [perfConstants.NODE_PERFORMANCE_GC_WEAKCB]: "weakcb",
+};
+new PerformanceObserver((list) => {
+  for (const entry of list.getEntries()) {
+    const kind = (entry.detail as { kind?: number } | null)?.kind ?? 0;
+    gcDuration.labels(GC_KINDS[kind] ?? "other").observe(entry.duration / 1000);
+  }
+}).observe({ entryTypes: ["gc"] });
+
+metrics.onCollect(() => {
+  // histogram 的单位是纳秒
+  eventLoopLag.labels("p50").set(loopDelay.percentile(50) / 1e9);
+  eventLoopLag.labels("p99").set(loopDelay.percentile(99) / 1e9);
+  eventLoopLag.labels("max").set(loopDelay.max / 1e9);
+  loopDelay.reset();
+
+  const mem = process.memoryUsage();
+  heapUsed.set(mem.heapUsed);
+  heapTotal.set(mem.heapTotal);
+  externalMem.set(mem.external);
+  rss.set(mem.rss);
+
+  // 按类型计数；上次出现、这次没有的类型置 0，曲线不会停在旧值
+  const counts = new Map<string, number>();
+  for (const type of process.getActiveResourcesInfo()) {
+    counts.set(type, (counts.get(type) ?? 0) + 1);
+  }
+  for (const type of seenResourceTypes) {
+    if (!counts.has(type)) activeResources.labels(type).set(0);
+  }
+  for (const [type, count] of counts) {
+    seenResourceTypes.add(type);
+    activeResources.labels(type).set(count);
+  }
+});
+
+/**
+ * 合并多个进程的指标：同名族合并，样本追加来源标签（如 worker="1"）
+ * @param sources 每个来源的附加标签与指标族
+ */
+export function mergeFamilies(
+  sources: Array<{ labels: Record<string, string>; families: MetricFamily[] }>,
+): MetricFamily[] {
+  const merged = new Map<string, MetricFamily>();
+  for (const { labels, families } of sources) {
+    for (const family of families) {
+      let target = merged.get(family.name);
+      if (!target) {
+        target = { ...family, samples: [] };
+        merged.set(family.name, target);
+      }
+      for (const sample of family.samples) {
+        target.samples.push({
+          name: sample.name,
+          labels: { ...labels, ...sample.labels },
+          value: sample.value,
+        });
+      }
+    }
+  }
+  return [...merged.values()];
+}
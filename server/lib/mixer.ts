@@ -0,0 +1,400 @@
+import { framePool, type PooledFrame } from "./framePool";
+import { loadShedder, SHED_PLAYBACK } from "./loadShedder";
+import { logger } from "./logger";
+import { metrics, type CounterChild } from "./metrics";
+import { DEFAULT_VAD_CONFIG, EnergyVad } from "./vad";
+
+// ==================== 监听混音 ====================
+// 保安值班要听一整层楼而不是开 N 个标签页：一个组（lib/groupControl.ts）的各台设备按采集时间
+// 对齐到同一条时间线，每 blockMs 混成一块，作为 "monitor:<组 id>" 这一路走普通的播放分发（PCM / Opus）。
+//
+//   采集时间 ──[环形缓冲 ringSamples]──│混音点 = now - delayMs│── 晚于混音点到达的帧丢弃
+//
+// - 增益：组里按设备配置（线性 0~1，默认 1），与闪避系数相乘后量化为 Q15
+// - 自动闪避：有设备在说话（能量 VAD）时其余各路压低 duckDb，按 attack / release 平滑
+// - 混音：WebAssembly SIMD 的 i16x8.q15mulr_sat_s + i16x8.add_sat_s，每次 8 个样本饱和相乘累加；
+//   运行时不支持 SIMD 时退回逐样本的同等 JS 实现，结果逐位一致
+// 每块的耗时很短（几十路也在微秒级），放在主线程里做，不值得为此跨线程复制 PCM。
+export const MIXER_CONFIG = {
+  sampleRate: 16000,
+  blockMs: 50,
+  delayMs: Number(process.env.MIXER_DELAY_MS) || 300, // 采集到混音输出的固定延迟，也是各路到达时间差的容忍上限
+  ringSamples: 32000, // 每路环形缓冲（2 秒），须为块长的整数倍，否则跨越缓冲末尾的块会读到下一路
+  maxInputs: Number(process.env.MIXER_MAX_INPUTS) || 32, // 每个监听流最多混几路，超出的设备不参与
+  duckDb: 12,
+  duckAttackMs: 50, // 压低到位的时间常数
+  duckReleaseMs: 600, // 恢复的时间常数
+  simd: process.env.MIXER_SIMD !== "0",
+} as const;
+
+export const MONITOR_PREFIX = "monitor:";
+
+/**
+ * 播放订阅者是否要这一路音频
+ * @param filter 订阅时指定的流（?stream=）；null 表示全部设备，但不含监听混音流
+ */
+export function wantsStream(filter: string | null, stream: string): boolean {
+  return filter === null ? !stream.startsWith(MONITOR_PREFIX) : filter === stream;
+}
+
+const log = logger.get("mixer");
+
+// ==================== 指标 ====================
+const mixerInputs = metrics.gauge("mixer_inputs", "Device streams mixed into a monitor feed", ["monitor"]);
+const mixerLatency = metrics.histogram(
+  "mixer_latency_seconds",
+  "Capture time of the end of a mixed block -> block emitted",
+  [],
+  [0.1, 0.2, 0.25, 0.3, 0.35, 0.4, 0.5, 0.75, 1],
+);
+const mixerBlockPerInput = metrics.histogram(
+  "mixer_block_seconds_per_input",
+  "CPU time to mix one block divided by the number of inputs",
+  [],
+  [0.000001, 0.0000025, 0.000005, 0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.001],
+);
+const mixerCpuSeconds = metrics.counter(
+  "mixer_cpu_seconds_total",
+  "CPU time spent mixing monitor feeds",
+  ["monitor"],
+);
+const mixerDropped = metrics.counter(
+  "mixer_frames_dropped_total",
+  "Device frames not mixed (late: behind the mix point; ahead: beyond the ring buffer)",
+  ["reason"],
+);
+const droppedLate = mixerDropped.labels("late");
+const droppedAhead = mixerDropped.labels("ahead");
+
+// ==================== 混音内核 ====================
+// mix(dst, src, n, gainQ15)：dst[i] = sat(dst[i] + sat((src[i] * gain + 0x4000) >> 15))，然后 src[i] = 0
+// （读过的环形缓冲块清零，下一圈没有数据的位置就是静音）。地址为字节偏移，n 为 8 的倍数。
+function leb128(value: number): number[] {
+  const out: number[] = [];
+  do {
+    let byte = value & 0x7f;
+    value >>>= 7;
+    if (value !== 0) byte |= 0x80;
+    out.push(byte);
+  } while (value !== 0);
+  return out;
+}
+
+function section(id: number, body: number[]): number[] {
+  return [id, ...leb128(body.length), ...body];
+}
+
+function mixModuleBytes(): Uint8Array {
+  const name = (s: string) => [s.length, ...Buffer.from(s)];
+  const V128_LOAD = [0xfd, 0x00, 0x04, 0x00];
+  const V128_STORE = [0xfd, 0x0b, 0x04, 0x00];
+  // 参数 0 dst、1 src、2 n、3 gain；局部 4 gain×8（v128）、5 src 终点
+  const body = [
+    0x02, 0x01, 0x7b, 0x01, 0x7f, // locals: 1 × v128, 1 × i32
+    0x20, 0x03, 0xfd, 0x10, 0x21, 0x04, // g = i16x8.splat(gain)
+    0x20, 0x01, 0x20, 0x02, 0x41, 0x01, 0x74, 0x6a, 0x21, 0x05, // end = src + (n << 1)
+    0x02, 0x40, 0x03, 0x40, // block loop
+    0x20, 0x01, 0x20, 0x05, 0x4f, 0x0d, 0x01, // br_if (src >= end) 出循环
+    0x20, 0x00, // 存储地址 dst
+    0x20, 0x00, ...V128_LOAD,
+    0x20, 0x01, ...V128_LOAD,
+    0x20, 0x04, 0xfd, 0x82, 0x01, // i16x8.q15mulr_sat_s
+    0xfd, 0x8f, 0x01, // i16x8.add_sat_s
+    ...V128_STORE,
+    0x20, 0x01, 0xfd, 0x0c, ...new Array(16).fill(0), ...V128_STORE, // src 清零
+    0x20, 0x01, 0x41, 0x10, 0x6a, 0x21, 0x01, // src += 16
+    0x20, 0x00, 0x41, 0x10, 0x6a, 0x21, 0x00, // dst += 16
+    0x0c, 0x00, 0x0b, 0x0b, // br 0; end loop; end block
+    0x0b,
+  ];
+  return new Uint8Array([
+    0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,
+    ...section(1, [0x01, 0x60, 0x04, 0x7f, 0x7f, 0x7f, 0x7f, 0x00]), // (i32 i32 i32 i32) -> ()
+    ...section(2, [0x01, ...name("env"), ...name("memory"), 0x02, 0x00, 0x01]), // 导入内存
+    ...section(3, [0x01, 0x00]),
+    ...section(7, [0x01, ...name("mix"), 0x00, 0x00]),
+    ...section(10, [0x01, ...leb128(body.length), ...body]),
+  ]);
+}
+
+const MIX_MODULE_BYTES = mixModuleBytes();
+// 运行时不支持 SIMD 时 validate 返回 false
+const mixModule = WebAssembly.validate(MIX_MODULE_BYTES) ? new WebAssembly.Module(MIX_MODULE_BYTES) : null;
+
+export type MixKernel = (dst: number, src: number, n: number, gainQ15: number) => void;
+
+// 与 SIMD 版逐位一致的标量实现
+function scalarKernel(memory: WebAssembly.Memory): MixKernel {
+  const heap = new Int16Array(memory.buffer);
+  return (dst, src, n, gainQ15) => {
+    let d = dst >> 1;
+    let s = src >> 1;
+    for (const end = s + n; s < end; s++, d++) {
+      const sum = heap[d] + ((heap[s] * gainQ15 + 0x4000) >> 15);
+      heap[d] = sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum;
+      heap[s] = 0;
+    }
+  };
+}
+
+/**
+ * 在 memory 上创建混音内核
+ * @param simd false 时强制用标量实现（基准对比用）
+ */
+export function createMixKernel(memory: WebAssembly.Memory, simd: boolean = MIXER_CONFIG.simd): {
+  mix: MixKernel;
+  simd: boolean;
+} {
+  if (simd && mixModule) {
+    const instance = new WebAssembly.Instance(mixModule, { env: { memory } });
+    return { mix: instance.exports.mix as MixKernel, simd: true };
+  }
+  return { mix: scalarKernel(memory), simd: false };
+}
+
+// ==================== 单个监听流 ====================
+interface MixerInput {
+  offset: number; // 环形缓冲在 memory 中的字节偏移
+  gain: number;
+  duck: number; // 当前闪避系数（1 = 不压低）
+  vad: EnergyVad;
+}
+
+export interface MonitorMixerOptions {
+  monitor: string; // 组 id
+  devices: string[];
+  gains?: Record<string, number>;
+  // 每块混音结果；帧只在回调期间有效，需要异步持有的消费者自行 retain
+  output: (frame: PooledFrame, capturedAt: number) => void;
+  simd?: boolean;
+}
+
+export class MonitorMixer {
+  readonly monitor: string;
+  readonly simd: boolean;
+  private readonly inputs = new Map<string, MixerInput>();
+  private readonly memory: WebAssembly.Memory;
+  private readonly bytes: Buffer; // memory 的字节视图，写入各路 PCM
+  private readonly mix: MixKernel;
+  private readonly blockSamples: number;
+  private readonly dstOffset: number;
+  private readonly dst: Buffer;
+  private readonly duckTarget: number;
+  private readonly attack: number;
+  private readonly release: number;
+  private mixedUntil: number | null = null; // 已混音到的采集位置（样本号，块对齐）
+  private readonly cpu: CounterChild;
+
+  constructor(private readonly options: MonitorMixerOptions) {
+    const { sampleRate, blockMs, ringSamples, maxInputs } = MIXER_CONFIG;
+    this.monitor = options.monitor;
+    this.blockSamples = (sampleRate * blockMs) / 1000;
+    const devices = options.devices.slice(0, maxInputs);
+    if (options.devices.length > maxInputs) {
+      log.warn("设备数超过上限，多出的不参与混音", {
+        monitor: this.monitor,
+        devices: options.devices.length,
+        maxInputs,
+      });
+    }
+    // 布局：各路环形缓冲依次排列，最后一块是输出
+    const ringBytes = ringSamples * 2;
+    this.dstOffset = devices.length * ringBytes;
+    const pages = Math.ceil((this.dstOffset + this.blockSamples * 2) / 65536);
+    this.memory = new WebAssembly.Memory({ initial: pages, maximum: pages });
+    this.bytes = Buffer.from(this.memory.buffer);
+    this.dst = this.bytes.subarray(this.dstOffset, this.dstOffset + this.blockSamples * 2);
+    const kernel = createMixKernel(this.memory, options.simd);
+    this.mix = kernel.mix;
+    this.simd = kernel.simd;
+    devices.forEach((device, i) => {
+      const gain = options.gains?.[device] ?? 1;
+      this.inputs.set(device, {
+        offset: i * ringBytes,
+        gain: Math.max(0, Math.min(1, gain)),
+        duck: 1,
+        vad: new EnergyVad(DEFAULT_VAD_CONFIG),
+      });
+    });
+
+    this.duckTarget = Math.pow(10, -MIXER_CONFIG.duckDb / 20);
+    this.attack = 1 - Math.exp(-blockMs / MIXER_CONFIG.duckAttackMs);
+    this.release = 1 - Math.exp(-blockMs / MIXER_CONFIG.duckReleaseMs);
+    this.cpu = mixerCpuSeconds.labels(this.monitor);
+    mixerInputs.labels(this.monitor).set(this.inputs.size);
+  }
+
+  get size(): number {
+    return this.inputs.size;
+  }
+
+  has(device: string): boolean {
+    return this.inputs.has(device);
+  }
+
+  // 不再使用时调用，移除本监听流的指标
+  dispose(): void {
+    mixerInputs.remove(this.monitor);
+    mixerCpuSeconds.remove(this.monitor);
+  }
+
+  /**
+   * 送入一路设备的一帧（PCM16 小端）；同时推进混音点，输出到期的块
+   * @param capturedAt 采集时间（服务器时钟）
+   */
+  push(device: string, pcm: Buffer, capturedAt: number, now = Date.now()): void {
+    const input = this.inputs.get(device);
+    if (!input) return;
+    const { sampleRate, ringSamples } = MIXER_CONFIG;
+    const samples = pcm.length >> 1;
+    const pos = Math.round((capturedAt * sampleRate) / 1000);
+    // 时间线从第一帧开始
+    if (this.mixedUntil === null) this.mixedUntil = Math.floor(pos / this.blockSamples) * this.blockSamples;
+
+    input.vad.push(pcm);
+    const skip = Math.max(0, this.mixedUntil - pos);
+    if (skip >= samples) {
+      droppedLate.inc();
+    } else if (pos + samples > this.mixedUntil + ringSamples) {
+      droppedAhead.inc();
+    } else {
+      // 按字节复制：WebAssembly 内存固定小端，与 PCM 一致
+      let at = (pos + skip) % ringSamples;
+      let from = skip * 2;
+      while (from < pcm.length) {
+        const count = Math.min(pcm.length - from, (ringSamples - at) * 2);
+        pcm.copy(this.bytes, input.offset + at * 2, from, from + count);
+        from += count;
+        at = 0;
+      }
+    }
+    this.pump(now);
+  }
+
+  /**
+   * 推进混音点到 now - delayMs，输出其间的各块
+   * 各路都没有新帧时不会被调用；设备断开后剩下的路继续推进
+   */
+  pump(now = Date.now()): void {
+    if (this.mixedUntil === null) return;
+    const { sampleRate, delayMs, ringSamples } = MIXER_CONFIG;
+    const horizon = Math.floor(((now - delayMs) * sampleRate) / 1000);
+    // 落后超过一圈缓冲（进程卡顿、时钟跳变）：缓冲里的数据已被覆盖，清空后跳到当前位置
+    if (horizon - this.mixedUntil > ringSamples) {
+      this.bytes.fill(0, 0, this.dstOffset);
+      this.mixedUntil = Math.floor(horizon / this.blockSamples) * this.blockSamples - this.blockSamples;
+    }
+    while (this.mixedUntil + this.blockSamples <= horizon) {
+      this.mixBlock(this.mixedUntil, now);
+      this.mixedUntil += this.blockSamples;
+    }
+  }
+
+  private mixBlock(start: number, now: number): void {
+    const { sampleRate, ringSamples } = MIXER_CONFIG;
+    const t0 = process.hrtime.bigint();
+    // VAD 状态取自到达时刻，比混音点早 delayMs：闪避在对方开口之前就开始压低
+    let anySpeaking = false;
+    for (const input of this.inputs.values()) {
+      if (input.vad.isSpeaking) {
+        anySpeaking = true;
+        break;
+      }
+    }
+    this.dst.fill(0);
+    const ringByte = (start % ringSamples) * 2;
+    for (const input of this.inputs.values()) {
+      const target = anySpeaking && !input.vad.isSpeaking ? this.duckTarget : 1;
+      input.duck += (target - input.duck) * (target < input.duck ? this.attack : this.release);
+      const gainQ15 = Math.round(input.gain * input.duck * 32767);
+      this.mix(this.dstOffset, input.offset + ringByte, this.blockSamples, gainQ15);
+    }
+    const frame = framePool.copyOf(this.dst);
+    const elapsed = Number(process.hrtime.bigint() - t0) / 1e9;
+    this.cpu.inc(elapsed);
+    mixerBlockPerInput.observe(elapsed / Math.max(1, this.inputs.size));
+
+    const capturedAt = (start * 1000) / sampleRate;
+    mixerLatency.observe((now - (capturedAt + MIXER_CONFIG.blockMs)) / 1000);
+    try {
+      this.options.output(frame, capturedAt);
+    } finally {
+      frame.release();
+    }
+  }
+}
+
+// ==================== 监听流集合 ====================
+// 有人收听 monitor:<组 id> 时才创建该组的混音器，最后一个听众离开即销毁
+export interface MonitorGroup {
+  devices: string[];
+  gains?: Record<string, number>;
+}
+
+export class MonitorSet {
+  private readonly mixers = new Map<string, { mixer: MonitorMixer; listeners: number }>();
+
+  constructor(
+    private readonly resolve: (groupId: string) => MonitorGroup | undefined,
+    // 混音结果；stream 为 "monitor:<组 id>"
+    private readonly output: (stream: string, frame: PooledFrame, capturedAt: number) => void,
+  ) {}
+
+  get size(): number {
+    return this.mixers.size;
+  }
+
+  /**
+   * 增加一个听众
+   * @returns 组不存在时返回 false
+   */
+  acquire(groupId: string): boolean {
+    const entry = this.mixers.get(groupId);
+    if (entry) {
+      entry.listeners++;
+      return true;
+    }
+    const mixer = this.create(groupId);
+    if (!mixer) return false;
+    this.mixers.set(groupId, { mixer, listeners: 1 });
+    log.info("开始监听混音", { monitor: groupId, inputs: mixer.size, simd: mixer.simd });
+    return true;
+  }
+
+  release(groupId: string): void {
+    const entry = this.mixers.get(groupId);
+    if (!entry || --entry.listeners > 0) return;
+    entry.mixer.dispose();
+    this.mixers.delete(groupId);
+    log.info("停止监听混音", { monitor: groupId });
+  }
+
+  // 组被修改或删除：正在混音的按新配置重建（删除后输出静音，直到听众离开）
+  reload(groupId: string): void {
+    const entry = this.mixers.get(groupId);
+    if (!entry) return;
+    entry.mixer.dispose();
+    entry.mixer = this.create(groupId) ?? new MonitorMixer({ monitor: groupId, devices: [], output: () => {} });
+  }
+
+  // device 为设备 ID（管线输出的 clientId，见 PipelineOutput.audio），与组配置里的成员一致
+  push(device: string, pcm: Buffer, capturedAt: number, now = Date.now()): void {
+    // 过载时与实时音频分发一起暂停；恢复后落后的部分由 pump 跳过
+    if (loadShedder.level >= SHED_PLAYBACK) return;
+    for (const { mixer } of this.mixers.values()) {
+      if (mixer.has(device)) mixer.push(device, pcm, capturedAt, now);
+    }
+  }
+
+  private create(groupId: string): MonitorMixer | null {
+    const group = this.resolve(groupId);
+    if (!group) return null;
+    const stream = MONITOR_PREFIX + groupId;
+    return new MonitorMixer({
+      monitor: groupId,
+      devices: group.devices,
+      gains: group.gains,
+      output: (frame, capturedAt) => this.output(stream, frame, capturedAt),
+    });
+  }
+}
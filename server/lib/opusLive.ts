@@ -0,0 +1,361 @@
+import { execFile, spawn, type ChildProcessWithoutNullStreams } from "child_process";
+import { readFileSync } from "fs";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+import { wantsStream } from "./mixer";
+import type { PlaybackClient } from "./playback";
+
+// ==================== 配置 ====================
+// 手机流量下收听实时音频：每台设备的 PCM 在主进程里由一个 ffmpeg（libopus）编码一次，
+// 所有 Opus 订阅者共用同一份包。没有 Opus 订阅者时不启动编码器，最后一个订阅者离开即全部停止。
+// 需要带 libopus 的 ffmpeg（与归档转码同一个，FFMPEG_PATH）；不可用时订阅者退回 PCM。
+export const OPUS_LIVE_CONFIG = {
+  ffmpeg: process.env.FFMPEG_PATH || "ffmpeg",
+  bitrate: Number(process.env.PLAYBACK_OPUS_BITRATE) || 24000,
+  frameMs: 20, // Opus 帧长；每页一个包，延迟约一帧
+  maxStdinBytes: 64 * 1024, // 编码器跟不上时积压超过该值丢帧
+  maxBufferedBytes: 64 * 1024, // 单个订阅者积压超过该值时丢包
+  restartDelayMs: 5000, // 编码器异常退出后，该设备过这么久才重新启动
+} as const;
+
+// 浏览器侧解码参数：Opus 固定按 48 kHz 计时
+export const OPUS_OUTPUT_SAMPLE_RATE = 48000;
+
+// 二进制消息：u16 流编号（小端）| 一个 Opus 包
+// 流编号与设备的对应关系由 JSON 消息 opus_stream / opus_stream_end 通知
+export const OPUS_PACKET_HEADER_BYTES = 2;
+
+const log = logger.get("playback");
+
+// ==================== 指标 ====================
+const opusStreams = metrics.gauge("playback_opus_streams", "Device streams currently encoded to Opus");
+const opusSubscribers = metrics.gauge("playback_opus_subscribers", "Playback clients receiving Opus");
+const opusCpuSeconds = metrics.counter(
+  "playback_opus_encoder_cpu_seconds_total",
+  "CPU time of the live Opus encoder process per device stream",
+  ["device"],
+);
+const opusAudioSeconds = metrics.counter(
+  "playback_opus_audio_seconds_total",
+  "Audio fed to the live Opus encoder per device stream",
+  ["device"],
+);
+const opusBytes = metrics.counter("playback_opus_bytes_total", "Opus packet bytes produced for live playback");
+const opusDrops = metrics.counter(
+  "playback_opus_dropped_total",
+  "Live Opus input frames or packets not delivered",
+  ["reason"],
+);
+const droppedEncoderBacklog = opusDrops.labels("encoder_backlog");
+const droppedBackpressure = opusDrops.labels("backpressure");
+const droppedError = opusDrops.labels("error");
+
+// ==================== Ogg 解包 ====================
+// ffmpeg 输出 Ogg/Opus，按 RFC 3533 的分段表拼出包；跨页的包（续页标志）接着拼
+export class OggPacketReader {
+  private buf: Buffer = Buffer.alloc(0);
+  private partial: Buffer[] = [];
+
+  push(chunk: Buffer, onPacket: (packet: Buffer) => void): void {
+    this.buf = this.buf.length === 0 ? chunk : Buffer.concat([this.buf, chunk]);
+    let pos = 0;
+    while (this.buf.length - pos >= 27) {
+      if (this.buf.readUInt32BE(pos) !== 0x4f676753) throw new Error(`Ogg 页头错误 @${pos}`); // "OggS"
+      const segments = this.buf[pos + 26];
+      const headerBytes = 27 + segments;
+      if (this.buf.length - pos < headerBytes) break;
+      let bodyBytes = 0;
+      for (let i = 0; i < segments; i++) bodyBytes += this.buf[pos + 27 + i];
+      if (this.buf.length - pos < headerBytes + bodyBytes) break;
+
+      // 续页标志而手上没有未完成的包：从中途接入的流，丢掉这一段
+      const continued = (this.buf[pos + 5] & 0x01) !== 0;
+      let skip = continued && this.partial.length === 0;
+      if (!continued) this.partial = [];
+      let at = pos + headerBytes;
+      let start = at;
+      for (let i = 0; i < segments; i++) {
+        const lacing = this.buf[pos + 27 + i];
+        at += lacing;
+        if (lacing === 255) continue;
+        if (!skip) {
+          this.partial.push(this.buf.subarray(start, at));
+          onPacket(this.partial.length === 1 ? Buffer.from(this.partial[0]) : Buffer.concat(this.partial));
+        }
+        this.partial = [];
+        skip = false;
+        start = at;
+      }
+      if (start < at && !skip) this.partial.push(Buffer.from(this.buf.subarray(start, at)));
+      pos += headerBytes + bodyBytes;
+    }
+    this.buf = pos === this.buf.length ? Buffer.alloc(0) : this.buf.subarray(pos);
+  }
+}
+
+// 子进程累计 CPU 时间（/proc/<pid>/stat，Linux）；读不到时返回 null
+function processCpuSeconds(pid: number | undefined): number | null {
+  if (pid === undefined) return null;
+  try {
+    const stat = readFileSync(`/proc/${pid}/stat`, "utf8");
+    const fields = stat.slice(stat.lastIndexOf(")") + 2).split(" ");
+    return (Number(fields[11]) + Number(fields[12])) / 100;
+  } catch {
+    return null;
+  }
+}
+
+// ==================== 单路编码器 ====================
+interface OpusStream {
+  id: number;
+  device: string;
+  child: ChildProcessWithoutNullStreams;
+  reader: OggPacketReader;
+  headers: number; // 已跳过的头包（OpusHead、OpusTags）
+  inputBytes: number;
+  cpuSeconds: number; // 上次采样的累计值
+  cpu: ReturnType<typeof opusCpuSeconds.labels>;
+  audio: ReturnType<typeof opusAudioSeconds.labels>;
+}
+
+// ==================== Opus 实时分发 ====================
+export class OpusLiveFeed<T extends PlaybackClient = PlaybackClient> {
+  readonly subscribers = new Map<T, string | null>(); // 订阅者 -> 只收的流（见 wantsStream）
+  private readonly streams = new Map<string, OpusStream>(); // 设备 clientId -> 编码器
+  private readonly retryAt = new Map<string, number>(); // 异常退出的设备 -> 允许重启的时间
+  private nextStreamId = 1;
+  private availability: Promise<boolean> | null = null;
+
+  constructor(
+    private readonly sampleRate: number,
+    private readonly config: typeof OPUS_LIVE_CONFIG = OPUS_LIVE_CONFIG,
+  ) {
+    metrics.onCollect(() => {
+      opusStreams.set(this.streams.size);
+      opusSubscribers.set(this.subscribers.size);
+      for (const stream of this.streams.values()) this.sampleCpu(stream);
+    });
+  }
+
+  get size(): number {
+    return this.subscribers.size;
+  }
+
+  // ffmpeg 是否带 libopus；第一个 Opus 订阅者到来时探测一次
+  // 异步探测：同步等 ffmpeg 启动会卡住事件循环几十毫秒，足以触发过载降级
+  available(): Promise<boolean> {
+    this.availability ??= new Promise((resolve) => {
+      execFile(this.config.ffmpeg, ["-hide_banner", "-encoders"], (error, stdout) => {
+        const ok = !error && /\blibopus\b/.test(stdout);
+        if (!ok) log.warn("ffmpeg 不可用或不支持 libopus，Opus 订阅者退回 PCM", { ffmpeg: this.config.ffmpeg });
+        resolve(ok);
+      });
+    });
+    return this.availability;
+  }
+
+  add(client: T, filter: string | null = null): void {
+    this.subscribers.set(client, filter);
+    // 已在编码的流先告知新订阅者；Opus 包可从任意位置开始解码
+    for (const stream of this.streams.values()) {
+      if (wantsStream(filter, stream.device)) this.sendJson(client, streamInfo(stream));
+    }
+  }
+
+  delete(client: T): void {
+    if (!this.subscribers.delete(client)) return;
+    if (this.subscribers.size === 0) {
+      this.stopAll();
+      this.retryAt.clear();
+      return;
+    }
+    // 剩下的订阅者都不要的流不再编码
+    for (const clientId of [...this.streams.keys()]) {
+      if (!this.wanted(clientId)) this.end(clientId);
+    }
+  }
+
+  /**
+   * 送入一帧设备 PCM；没有 Opus 订阅者时直接返回
+   * 管道写不完时 stdin 会持有传入的 Buffer，帧池里的数据先复制一份
+   */
+  push(clientId: string, pcm: Buffer): void {
+    if (this.subscribers.size === 0) return;
+    if (!this.streams.has(clientId) && !this.wanted(clientId)) return;
+    let stream = this.streams.get(clientId);
+    if (!stream) {
+      const retryAt = this.retryAt.get(clientId);
+      if (retryAt !== undefined && Date.now() < retryAt) return;
+      this.retryAt.delete(clientId);
+      stream = this.start(clientId);
+    }
+    if (stream.child.stdin.writableLength > this.config.maxStdinBytes) {
+      droppedEncoderBacklog.inc();
+      return;
+    }
+    stream.child.stdin.write(Buffer.from(pcm));
+    stream.inputBytes += pcm.length;
+    stream.audio.inc(pcm.length / 2 / this.sampleRate);
+  }
+
+  // 设备断开（或不再有订阅者）：关闭 stdin，ffmpeg 输出剩余的包后退出
+  end(clientId: string): void {
+    const stream = this.streams.get(clientId);
+    if (!stream) return;
+    this.streams.delete(clientId);
+    this.finish(stream);
+    stream.child.stdin.end();
+  }
+
+  stopAll(): void {
+    for (const clientId of [...this.streams.keys()]) this.end(clientId);
+  }
+
+  private wanted(clientId: string): boolean {
+    for (const filter of this.subscribers.values()) {
+      if (wantsStream(filter, clientId)) return true;
+    }
+    return false;
+  }
+
+  private start(clientId: string): OpusStream {
+    const { ffmpeg, bitrate, frameMs } = this.config;
+    // 每页只放一个包并立即输出，否则 ogg 默认攒 1 秒一页
+    const child = spawn(
+      ffmpeg,
+      [
+        "-v", "error",
+        "-f", "s16le", "-ar", String(this.sampleRate), "-ac", "1", "-i", "pipe:0",
+        "-c:a", "libopus", "-b:a", String(bitrate), "-application", "lowdelay",
+        "-frame_duration", String(frameMs),
+        "-page_duration", String(frameMs * 1000), "-flush_packets", "1",
+        "-f", "ogg", "pipe:1",
+      ],
+      { stdio: ["pipe", "pipe", "pipe"] },
+    );
+    const stream: OpusStream = {
+      id: this.nextStreamId,
+      device: clientId,
+      child,
+      reader: new OggPacketReader(),
+      headers: 0,
+      inputBytes: 0,
+      cpuSeconds: 0,
+      cpu: opusCpuSeconds.labels(clientId),
+      audio: opusAudioSeconds.labels(clientId),
+    };
+    this.nextStreamId = this.nextStreamId === 0xffff ? 1 : this.nextStreamId + 1;
+    this.streams.set(clientId, stream);
+
+    let stderr = "";
+    child.stderr.on("data", (chunk: Buffer) => {
+      if (stderr.length < 2000) stderr += chunk.toString();
+    });
+    child.stdout.on("data", (chunk: Buffer) => {
+      try {
+        stream.reader.push(chunk, (packet) => this.onPacket(stream, packet));
+      } catch (error) {
+        log.sampled("error", "opus_ogg", 5, "Opus 输出解析失败", { client: clientId, error });
+        child.kill();
+      }
+    });
+    // 进程退出后写入会 EPIPE，由 exit 处理
+    child.stdin.on("error", () => {});
+    child.on("error", (error) => {
+      log.sampled("error", "opus_spawn", 5, "启动 Opus 编码器失败", { client: clientId, error });
+    });
+    child.on("exit", (code, signal) => {
+      if (this.streams.get(clientId) !== stream) return; // end() 主动结束
+      this.streams.delete(clientId);
+      this.finish(stream);
+      this.retryAt.set(clientId, Date.now() + this.config.restartDelayMs);
+      log.sampled("error", "opus_exit", 5, "Opus 编码器异常退出", {
+        client: clientId,
+        code,
+        signal,
+        stderr: stderr.trim() || undefined,
+      });
+    });
+
+    this.broadcastJson(clientId, streamInfo(stream));
+    log.info("开始 Opus 编码", { client: clientId, stream: stream.id, bitrate });
+    return stream;
+  }
+
+  private onPacket(stream: OpusStream, packet: Buffer): void {
+    // end() 之后 ffmpeg 冲出的尾包：订阅者已收到 opus_stream_end，不再发送
+    if (this.streams.get(stream.device) !== stream) return;
+    // 前两个包是 OpusHead / OpusTags，WebCodecs 不需要
+    if (stream.headers < 2) {
+      stream.headers++;
+      return;
+    }
+    opusBytes.inc(packet.length);
+    const message = Buffer.allocUnsafe(OPUS_PACKET_HEADER_BYTES + packet.length);
+    message.writeUInt16LE(stream.id, 0);
+    packet.copy(message, OPUS_PACKET_HEADER_BYTES);
+    for (const [client, filter] of this.subscribers) {
+      if (client.readyState !== 1 || !wantsStream(filter, stream.device)) continue;
+      if (client.bufferedAmount > this.config.maxBufferedBytes) {
+        droppedBackpressure.inc();
+        continue;
+      }
+      try {
+        client.send(message);
+      } catch (error) {
+        droppedError.inc();
+        log.sampled("error", "opus_send", 5, "Opus 包发送失败", { error });
+      }
+    }
+  }
+
+  private sampleCpu(stream: OpusStream): void {
+    const cpuSeconds = processCpuSeconds(stream.child.pid);
+    if (cpuSeconds === null || cpuSeconds <= stream.cpuSeconds) return;
+    stream.cpu.inc(cpuSeconds - stream.cpuSeconds);
+    stream.cpuSeconds = cpuSeconds;
+  }
+
+  // 停止前最后采样一次 CPU，记下这一路的编码开销
+  private finish(stream: OpusStream): void {
+    this.sampleCpu(stream);
+    const audioSeconds = stream.inputBytes / 2 / this.sampleRate;
+    log.info("停止 Opus 编码", {
+      client: stream.device,
+      stream: stream.id,
+      audioSec: Number(audioSeconds.toFixed(1)),
+      cpuMs: Math.round(stream.cpuSeconds * 1000),
+      // 编码 1 秒音频花的 CPU 秒数
+      cpuPerAudioSec: audioSeconds > 0 ? Number((stream.cpuSeconds / audioSeconds).toFixed(4)) : undefined,
+    });
+    opusCpuSeconds.remove(stream.device);
+    opusAudioSeconds.remove(stream.device);
+    this.broadcastJson(stream.device, { type: "opus_stream_end", stream: stream.id });
+  }
+
+  private broadcastJson(clientId: string, message: unknown): void {
+    const text = JSON.stringify(message);
+    for (const [client, filter] of this.subscribers) {
+      if (wantsStream(filter, clientId)) this.sendJson(client, text);
+    }
+  }
+
+  private sendJson(client: T, message: unknown): void {
+    if (client.readyState !== 1) return;
+    try {
+      client.send(typeof message === "string" ? message : JSON.stringify(message));
+    } catch (error) {
+      log.sampled("error", "opus_send", 5, "Opus 流通知发送失败", { error });
+    }
+  }
+}
+
+function streamInfo(stream: OpusStream) {
+  return {
+    type: "opus_stream",
+    stream: stream.id,
+    device: stream.device,
+    sampleRate: OPUS_OUTPUT_SAMPLE_RATE,
+    channels: 1,
+  };
+}
@@ -0,0 +1,118 @@
+import type { PooledFrame } from "./framePool";
+import { loadShedder, SHED_PLAYBACK } from "./loadShedder";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+import { wantsStream } from "./mixer";
+import { OpusLiveFeed } from "./opusLive";
+
+// ==================== 配置 ====================
+export const PLAYBACK_CONFIG = {
+  maxBufferedBytes: 256 * 1024, // 浏览器积压超过该值时丢帧，避免拖慢其他订阅者
+  sampleRate: 16000, // 设备 PCM 采样率（与 AUDIO_CONFIG 一致），Opus 编码器输入用
+} as const;
+
+// 订阅者选择的音频格式：pcm 为原始 PCM16 帧，opus 见 lib/opusLive.ts
+export type PlaybackCodec = "pcm" | "opus";
+
+// 播放订阅者需要的最小接口（ws 的 WebSocket 满足）
+export interface PlaybackClient {
+  readonly readyState: number;
+  readonly bufferedAmount: number;
+  send(data: Buffer | string, cb?: (err?: Error) => void): void;
+}
+
+const log = logger.get("playback");
+
+// ==================== 指标 ====================
+export const playbackDrops = metrics.counter(
+  "playback_frames_dropped_total",
+  "Frames not delivered to a playback client",
+  ["reason"],
+);
+const droppedBackpressure = playbackDrops.labels("backpressure");
+const droppedError = playbackDrops.labels("error");
+const droppedShed = playbackDrops.labels("load_shed");
+
+// ==================== 播放分发 ====================
+// 主进程持有所有浏览器连接：设备音频与识别结果从这里扇出
+export class PlaybackHub<T extends PlaybackClient = PlaybackClient> {
+  readonly clients = new Set<T>(); // 全部订阅者，JSON 消息发给所有人
+  private readonly pcmClients = new Map<T, string | null>(); // 订阅者 -> 只收的流（见 wantsStream）
+  readonly opus: OpusLiveFeed<T>;
+
+  constructor(
+    private readonly maxBufferedBytes: number = PLAYBACK_CONFIG.maxBufferedBytes,
+    sampleRate: number = PLAYBACK_CONFIG.sampleRate,
+  ) {
+    this.opus = new OpusLiveFeed<T>(sampleRate);
+  }
+
+  get size(): number {
+    return this.clients.size;
+  }
+
+  /**
+   * 登记订阅者；opus 需先确认 opus.available()
+   * @param stream 只收这一路（设备 clientId 或 "monitor:<组 id>"）；null 为全部设备
+   */
+  add(client: T, codec: PlaybackCodec = "pcm", stream: string | null = null): void {
+    this.clients.add(client);
+    if (codec === "opus") this.opus.add(client, stream);
+    else this.pcmClients.set(client, stream);
+  }
+
+  delete(client: T): void {
+    this.clients.delete(client);
+    this.pcmClients.delete(client);
+    this.opus.delete(client);
+  }
+
+  // 设备断开：结束该设备的 Opus 流
+  endStream(clientId: string): void {
+    this.opus.end(clientId);
+  }
+
+  /**
+   * 广播一台设备的音频到所有播放客户端
+   * @param frame 数据来自帧池时传入，每个 PCM 客户端的 send 写完才归还
+   */
+  broadcastAudio(clientId: string, data: Buffer, frame?: PooledFrame): void {
+    // 过载第 1 级起暂停实时音频分发（ASR 文本仍照常广播），Opus 编码一并暂停
+    if (loadShedder.level >= SHED_PLAYBACK) {
+      droppedShed.inc(this.clients.size);
+      return;
+    }
+    this.opus.push(clientId, data);
+    const release = frame ? () => frame.release() : undefined;
+    for (const [client, stream] of this.pcmClients) {
+      if (client.readyState !== 1 || !wantsStream(stream, clientId)) continue;
+      // 慢客户端积压过多时丢帧，而不是无限占用内存
+      if (client.bufferedAmount > this.maxBufferedBytes) {
+        droppedBackpressure.inc();
+        continue;
+      }
+      frame?.retain();
+      try {
+        client.send(data, release);
+      } catch (error) {
+        frame?.release();
+        droppedError.inc();
+        log.sampled("error", "broadcast_audio", 5, "音频广播失败", { error });
+      }
+    }
+  }
+
+  // 广播 JSON 数据到所有播放客户端：只序列化一次
+  broadcastData(data: unknown): void {
+    if (this.clients.size === 0) return;
+    const message = JSON.stringify(data);
+    for (const client of this.clients) {
+      if (client.readyState !== 1) continue;
+      try {
+        client.send(message);
+      } catch (error) {
+        log.sampled("error", "broadcast_data", 5, "数据广播失败", { error });
+      }
+    }
+  }
+}
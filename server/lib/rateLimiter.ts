@@ -0,0 +1,101 @@
+import { metrics } from "./metrics";
+
+// ==================== 配置 ====================
+// 固件每秒 20 帧、约 32 KB；留出重连补发的余量，超出部分丢弃
+export const RATE_CONFIG = {
+  frameRate: Number(process.env.DEVICE_FRAME_RATE) || 50, // 帧/秒
+  frameBurst: Number(process.env.DEVICE_FRAME_BURST) || 100,
+  byteRate: Number(process.env.DEVICE_BYTE_RATE) || 80 * 1024, // 字节/秒
+  byteBurst: Number(process.env.DEVICE_BYTE_BURST) || 160 * 1024,
+  maxFrameBytes: 64 * 1024, // 单帧上限，作为 WebSocketServer 的 maxPayload
+  abuseWindowMs: 10000,
+  abuseThrottledFrames: 500, // 一个窗口内被限流这么多帧即断开（1008）
+} as const;
+
+export type ThrottleReason = "frames" | "bytes";
+
+// ==================== 令牌桶 ====================
+// 取令牌时按流逝时间补充，不需要定时器；每次检查 O(1)
+export class TokenBucket {
+  private tokens: number;
+  private updatedAt: number;
+
+  constructor(
+    private readonly ratePerSec: number,
+    private readonly burst: number,
+    now: number = Date.now(),
+  ) {
+    this.tokens = burst;
+    this.updatedAt = now;
+  }
+
+  take(n: number, now: number = Date.now()): boolean {
+    const elapsed = now - this.updatedAt;
+    if (elapsed > 0) {
+      this.tokens = Math.min(this.burst, this.tokens + (elapsed * this.ratePerSec) / 1000);
+      this.updatedAt = now;
+    }
+    if (this.tokens < n) return false;
+    this.tokens -= n;
+    return true;
+  }
+}
+
+// ==================== 指标 ====================
+const throttledFrames = metrics.counter(
+  "audio_throttled_frames_total",
+  "Device messages dropped by the per-device rate limit",
+  ["reason"],
+);
+const throttledBytes = metrics.counter(
+  "audio_throttled_bytes_total",
+  "Device bytes dropped by the per-device rate limit",
+  ["reason"],
+);
+const abuseDisconnects = metrics.counter(
+  "audio_rate_limit_disconnects_total",
+  "Devices disconnected for exceeding the rate limit persistently",
+);
+
+// ==================== 单设备限流 ====================
+export class DeviceRateLimiter {
+  private readonly frames: TokenBucket;
+  private readonly bytes: TokenBucket;
+  private windowStart: number;
+  private windowThrottled = 0;
+
+  constructor(now: number = Date.now()) {
+    this.frames = new TokenBucket(RATE_CONFIG.frameRate, RATE_CONFIG.frameBurst, now);
+    this.bytes = new TokenBucket(RATE_CONFIG.byteRate, RATE_CONFIG.byteBurst, now);
+    this.windowStart = now;
+  }
+
+  /**
+   * 检查一条消息
+   * @returns null 表示放行，否则为限流原因
+   */
+  check(byteLength: number, now: number = Date.now()): ThrottleReason | null {
+    let reason: ThrottleReason | null = null;
+    if (!this.frames.take(1, now)) reason = "frames";
+    else if (!this.bytes.take(byteLength, now)) reason = "bytes";
+    if (reason === null) return null;
+
+    throttledFrames.labels(reason).inc();
+    throttledBytes.labels(reason).inc(byteLength);
+    if (now - this.windowStart >= RATE_CONFIG.abuseWindowMs) {
+      this.windowStart = now;
+      this.windowThrottled = 0;
+    }
+    this.windowThrottled++;
+    return reason;
+  }
+
+  // 一个窗口内持续超限：判定为故障或恶意设备，由调用方断开
+  get abusive(): boolean {
+    return this.windowThrottled >= RATE_CONFIG.abuseThrottledFrames;
+  }
+
+  recordDisconnect(): void {
+    abuseDisconnects.inc();
+  }
+}
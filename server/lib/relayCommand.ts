@@ -0,0 +1,123 @@
+// ==================== 配置 ====================
+const CONFIG = {
+  ackTimeoutMs: 5000,
+} as const;
+
+// ==================== 类型定义 ====================
+// 设备回执：{"type":"ack","id":12,"relay":1}
+export interface RelayAck {
+  type: "ack";
+  id: number;
+  relay: 0 | 1;
+}
+
+/**
+ * 解析设备发来的文本消息
+ * @param text 设备文本帧
+ * @returns 是回执则返回回执对象，否则返回 null
+ */
+export function parseDeviceAck(text: string): RelayAck | null {
+  if (!text.startsWith("{")) return null;
+  try {
+    const msg = JSON.parse(text);
+    if (msg?.type === "ack" && Number.isInteger(msg.id)) {
+      return { type: "ack", id: msg.id, relay: msg.relay ? 1 : 0 };
+    }
+  } catch {
+    // 非 JSON 文本，忽略
+  }
+  return null;
+}
+
+/**
+ * 固件对指令文本的判定（firmware/ 的 handleRelayCommand）：小写后含“关”/“off”为关，
+ * 否则含“开”/“on”为开，两者都不含时不动作
+ * @returns 1 开、0 关、null 不动作
+ */
+export function relayIntent(text: string): 0 | 1 | null {
+  const message = text.toLowerCase();
+  if (message.includes("关") || message.includes("off")) return 0;
+  if (message.includes("开") || message.includes("on")) return 1;
+  return null;
+}
+
+// 下发指令所需的最小接口：ws 连接与网关会话都满足
+export interface CommandSink {
+  readonly readyState: number;
+  send(data: string): void;
+}
+
+// ==================== 指令跟踪 ====================
+// 下发格式 "#<id> <text>"：旧固件只做关键字匹配，前缀不影响开/关判断；
+// 新固件剥离前缀并以相同 id 回执，用于统计指令到回执的延迟。
+// 超时由定时器按最早一条未回执指令的发送时间触发：开关灯指令可能隔几个小时才有下一条，
+// 不能等下一次 send() 才清理，否则超时计数与 trace 的 ack_timeout 都会滞后。
+export class RelayCommandTracker {
+  private nextId = 1;
+  private readonly pending = new Map<number, number>(); // id -> 发送时间
+  private timer: NodeJS.Timeout | null = null;
+
+  constructor(private readonly onTimeout: (id: number) => void = () => {}) {}
+
+  send(ws: CommandSink, text: string): number | null {
+    if (ws.readyState !== 1) return null;
+    this.expire(Date.now());
+    const id = this.nextId++;
+    ws.send(`#${id} ${text}`);
+    this.pending.set(id, Date.now());
+    this.schedule();
+    return id;
+  }
+
+  /**
+   * 处理回执
+   * @returns 指令到回执的延迟（毫秒），未知或已超时的 id 返回 null
+   */
+  ack(id: number): number | null {
+    const sentAt = this.pending.get(id);
+    if (sentAt === undefined) return null;
+    this.pending.delete(id);
+    if (this.pending.size === 0) this.cancel();
+    return Date.now() - sentAt;
+  }
+
+  get pendingCount(): number {
+    return this.pending.size;
+  }
+
+  /**
+   * 设备断开时调用：停掉定时器，未回执的指令不再计为超时（由调用方按断开处理）
+   */
+  dispose(): void {
+    this.cancel();
+    this.pending.clear();
+  }
+
+  // 定时器对准最早一条未回执指令的到期时刻；到期后清理并对准下一条
+  private schedule(): void {
+    if (this.timer || this.pending.size === 0) return;
+    const oldest: number = this.pending.values().next().value!;
+    const delay = Math.max(0, oldest + CONFIG.ackTimeoutMs - Date.now());
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      this.expire(Date.now());
+      this.schedule();
+    }, delay);
+    this.timer.unref();
+  }
+
+  private cancel(): void {
+    if (!this.timer) return;
+    clearTimeout(this.timer);
+    this.timer = null;
+  }
+
+  private expire(now: number): void {
+    for (const [id, sentAt] of this.pending) {
+      // Map 按插入顺序迭代，遇到未超时的即可停止
+      if (now - sentAt < CONFIG.ackTimeoutMs) break;
+      this.pending.delete(id);
+      this.onTimeout(id);
+    }
+  }
+}
@@ -0,0 +1,115 @@
+import os from "os";
+
+// ==================== 窄带上行 8 kHz <-> 16 kHz ====================
+// 弱网设备的固件（firmware/sketch_sep23a/Decimator.h，?sr=8000）先用半带 FIR 低通再 2:1 抽取，上行码率减半。
+// 服务器在接入时插值回 16 kHz，之后的 VAD、质量统计、归档、播放、ASR（sample_rate 16000）都不用区分。
+//
+// 两边用同一组 47 阶半带系数（Kaiser β=5.65）：3.4 kHz 以内平坦，4.6 kHz 处衰减约 49.9 dB、往上更深。
+// 半带插值的偶数位置系数只有中心一个（0.5 × 2 = 1），所以输出的偶数样本就是原始 8 kHz 样本，
+// 只算奇数位置：每个输出样本 12 次乘法。插值要看后面 12 个输入，输出整体延后 12 个样本（1.5 ms）。
+export const NARROWBAND_SAMPLE_RATE = 8000;
+export const WIDEBAND_SAMPLE_RATE = 16000;
+
+export const HALFBAND_TAPS = 47;
+const HALFBAND_CENTER = 16384; // 0.5，Q15
+// h[±1], h[±3], ..., h[±23]，Q15；改动时与 Decimator.h 同步
+export const HALFBAND_SIDE = [10381, -3328, 1846, -1169, 772, -511, 331, -206, 120, -64, 29, -9] as const;
+const SIDE = Int32Array.from(HALFBAND_SIDE);
+const SIDE_COUNT = SIDE.length;
+const HISTORY = 2 * SIDE_COUNT - 1; // 插值窗口跨 24 个输入，上一块留 23 个
+
+const NATIVE_LE = os.endianness() === "LE";
+
+function saturate(value: number): number {
+  return value > 32767 ? 32767 : value < -32768 ? -32768 : value;
+}
+
+// PCM16 小端 Buffer 读成 Int16Array：对齐时直接建视图，否则逐个读
+function samplesOf(pcm: Buffer): Int16Array {
+  const count = pcm.length >> 1;
+  if (NATIVE_LE && (pcm.byteOffset & 1) === 0) return new Int16Array(pcm.buffer, pcm.byteOffset, count);
+  const out = new Int16Array(count);
+  for (let i = 0; i < count; i++) out[i] = pcm.readInt16LE(i * 2);
+  return out;
+}
+
+/**
+ * 8 kHz -> 16 kHz 插值，每个设备连接一个实例（跨帧保留历史样本）
+ */
+export class HalfbandUpsampler {
+  // [0, HISTORY) 为上一块末尾的样本，之后是本块
+  private work = new Int16Array(HISTORY + 512);
+  private primed = false;
+
+  /**
+   * @param pcm 8 kHz PCM16 小端
+   * @param out 16 kHz 输出，长度须为 pcm.length * 2
+   */
+  process(pcm: Buffer, out: Buffer): void {
+    const input = samplesOf(pcm);
+    const n = input.length;
+    if (this.work.length < HISTORY + n) {
+      const grown = new Int16Array(HISTORY + n);
+      grown.set(this.work.subarray(0, HISTORY));
+      this.work = grown;
+    }
+    const work = this.work;
+    // 第一块之前当作与首样本相同的平直信号，避免从 0 起跳的冲击
+    if (!this.primed && n > 0) {
+      work.fill(input[0], 0, HISTORY);
+      this.primed = true;
+    }
+    work.set(input, HISTORY);
+
+    // 输出第 2i 个为 work[i + SIDE_COUNT - 1]（延后 12 个输入样本），第 2i+1 个插在它与下一个之间
+    const direct = NATIVE_LE && (out.byteOffset & 1) === 0;
+    const view = direct ? new Int16Array(out.buffer, out.byteOffset, n * 2) : null;
+    for (let i = 0; i < n; i++) {
+      const left = i + SIDE_COUNT - 1;
+      let acc = 0;
+      for (let k = 0; k < SIDE_COUNT; k++) acc += SIDE[k] * (work[left - k] + work[left + 1 + k]);
+      // 插值增益为 2：Q15 右移 14 位
+      const odd = saturate((acc + 8192) >> 14);
+      if (view) {
+        view[2 * i] = work[left];
+        view[2 * i + 1] = odd;
+      } else {
+        out.writeInt16LE(work[left], i * 4);
+        out.writeInt16LE(odd, i * 4 + 2);
+      }
+    }
+    work.copyWithin(0, n, n + HISTORY);
+  }
+}
+
+/**
+ * 16 kHz -> 8 kHz 抽取：与固件 Decimator.h 逐位一致，回放压测（bench/replay.ts --narrowband）模拟窄带固件用
+ */
+export class HalfbandDecimator {
+  private readonly line = new Int16Array(2 * HALFBAND_TAPS);
+  private pos = 0;
+  private pending = false;
+
+  /**
+   * @returns 输出样本数（奇数长度的输入留一个样本到下一块配对）
+   */
+  process(input: Int16Array, out: Int16Array): number {
+    const line = this.line;
+    const c = HALFBAND_TAPS >> 1;
+    let produced = 0;
+    for (let i = 0; i < input.length; i++) {
+      line[this.pos] = input[i];
+      line[this.pos + HALFBAND_TAPS] = input[i];
+      this.pos = this.pos + 1 === HALFBAND_TAPS ? 0 : this.pos + 1;
+      this.pending = !this.pending;
+      if (this.pending) continue;
+      const base = this.pos;
+      let acc = HALFBAND_CENTER * line[base + c];
+      for (let k = 0; k < SIDE_COUNT; k++) {
+        acc += SIDE[k] * (line[base + c - 1 - 2 * k] + line[base + c + 1 + 2 * k]);
+      }
+      out[produced++] = saturate((acc + 16384) >> 15);
+    }
+    return produced;
+  }
+}
@@ -0,0 +1,358 @@
+import { promises as fsp } from "fs";
+import path from "path";
+import { logger } from "./logger";
+import { metrics } from "./metrics";
+
+// ==================== 配置 ====================
+// 归档目录（public/audio）只增不减，树莓派的 SD 卡写满后写盘失败或阻塞。
+// 按以下顺序淘汰最旧的文件：过期 -> 单设备超额 -> 总量超额或剩余空间不足。
+// 0 表示不启用对应的限制。
+export const RETENTION_CONFIG = {
+  maxAgeDays: Number(process.env.RETENTION_MAX_AGE_DAYS ?? 30),
+  deviceQuotaBytes: Number(process.env.RETENTION_DEVICE_MAX_MB ?? 1024) * 1024 * 1024,
+  globalQuotaBytes: Number(process.env.RETENTION_MAX_MB ?? 8192) * 1024 * 1024,
+  minFreeBytes: Number(process.env.RETENTION_MIN_FREE_MB ?? 512) * 1024 * 1024,
+  sweepIntervalMs: 30000,
+  statConcurrency: 64, // 启动建索引时并发 stat 的文件数
+  yieldEvery: 32, // 连续删除这么多个文件后让出一次事件循环
+  busyTtlMs: 10 * 60_000, // 转码中的标记最长保留这么久（集群 worker 崩溃时标记不会被撤销）
+} as const;
+
+// audio_<clientId>[_seg<N>]_<YYYY-MM-DDTHH-mm-ss>.<ext>
+const ARCHIVE_NAME = /^audio_(.+?)(?:_seg\d+)?_(\d{4}-\d{2}-\d{2})T(\d{2})-(\d{2})-(\d{2})\.(wav|flac|opus)$/;
+
+type DeleteReason = "expired" | "device_quota" | "global_quota" | "disk_free";
+
+interface ArchiveFile {
+  name: string;
+  device: string;
+  bytes: number;
+  createdAt: number;
+}
+
+interface DeviceFiles {
+  files: ArchiveFile[]; // 按 createdAt 从旧到新
+  bytes: number;
+}
+
+export interface ArchivedEvent {
+  filePath: string;
+  bytes: number;
+  replaces?: string; // 转码后替换掉的原文件
+}
+
+// 转码线程接手（排队）/ 放下一个文件：期间保留策略不删它
+export interface CompressingEvent {
+  filePath: string;
+  compressing: boolean;
+}
+
+export type RetentionEvent = ArchivedEvent | CompressingEvent;
+
+const log = logger.get("retention");
+
+// ==================== 指标 ====================
+const diskBytes = metrics.gauge("archive_disk_bytes", "Bytes of archived audio under retention");
+const diskFiles = metrics.gauge("archive_disk_files", "Archived audio files under retention");
+const diskFree = metrics.gauge("archive_disk_free_bytes", "Free bytes on the archive filesystem");
+const devicesGauge = metrics.gauge("archive_devices", "Devices with archived audio on disk");
+const deletedFiles = metrics.counter(
+  "archive_deleted_files_total",
+  "Archived audio files deleted by retention",
+  ["reason"],
+);
+const deletedBytes = metrics.counter(
+  "archive_deleted_bytes_total",
+  "Archived audio bytes deleted by retention",
+  ["reason"],
+);
+const deleteErrors = metrics.counter("archive_delete_errors_total", "Retention deletions that failed");
+const indexSeconds = metrics.gauge("archive_index_build_seconds", "Time to build the retention index at startup");
+
+/**
+ * 从文件名解析设备与时间；不是归档文件返回 null
+ * 重连时的 "<id>_<序号>" 归到同一设备
+ */
+export function parseArchiveName(name: string): { device: string; createdAt: number } | null {
+  const m = ARCHIVE_NAME.exec(name);
+  if (!m) return null;
+  const [, clientId, date, hh, mm, ss] = m;
+  const createdAt = Date.parse(`${date}T${hh}:${mm}:${ss}Z`);
+  if (Number.isNaN(createdAt)) return null;
+  return { device: clientId.replace(/_\d+$/, ""), createdAt };
+}
+
+// ==================== 保留管理 ====================
+export class RetentionManager {
+  private readonly devices = new Map<string, DeviceFiles>();
+  private readonly byName = new Map<string, ArchiveFile>();
+  private readonly busy = new Map<string, number>(); // 转码中的文件名 -> 标记时间
+  private totalBytes = 0;
+  private dir: string | null = null;
+  private ready = false;
+  private sweeping = false;
+  private sweepQueued = false;
+  private freeBytes = Infinity;
+  private timer: NodeJS.Timeout | null = null;
+
+  constructor(private readonly config: typeof RETENTION_CONFIG = RETENTION_CONFIG) {}
+
+  get stats() {
+    return {
+      files: this.byName.size,
+      bytes: this.totalBytes,
+      devices: this.devices.size,
+      freeBytes: this.freeBytes,
+    };
+  }
+
+  /**
+   * 异步扫描目录建立索引，之后定期清理
+   */
+  async start(dir: string): Promise<void> {
+    if (this.dir) return;
+    this.dir = dir;
+    const startedAt = performance.now();
+    let names: string[] = [];
+    try {
+      names = await fsp.readdir(dir);
+    } catch {
+      // 目录尚未创建：第一次写盘后再开始计数
+    }
+    const candidates = names.filter((name) => ARCHIVE_NAME.test(name));
+    for (let i = 0; i < candidates.length; i += this.config.statConcurrency) {
+      const chunk = candidates.slice(i, i + this.config.statConcurrency);
+      const stats = await Promise.all(
+        chunk.map((name) => fsp.stat(path.join(dir, name)).catch(() => null)),
+      );
+      chunk.forEach((name, j) => {
+        const stat = stats[j];
+        if (stat?.isFile()) this.insert(name, stat.size, false);
+      });
+    }
+    for (const device of this.devices.values()) {
+      device.files.sort((a, b) => a.createdAt - b.createdAt);
+    }
+    const seconds = (performance.now() - startedAt) / 1000;
+    indexSeconds.set(seconds);
+    this.updateGauges();
+    this.ready = true;
+    log.info("索引已建立", {
+      files: this.byName.size,
+      bytes: this.totalBytes,
+      devices: this.devices.size,
+      ms: Math.round(seconds * 1000),
+    });
+
+    this.timer = setInterval(() => this.requestSweep(), this.config.sweepIntervalMs);
+    this.timer.unref();
+    this.requestSweep();
+  }
+
+  stop(): void {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  /**
+   * 按不含扩展名的文件名找当前的归档文件（转码后扩展名会变）
+   * @returns 已被清理或尚未写盘时返回 null
+   */
+  resolve(stem: string): string | null {
+    for (const ext of [".opus", ".flac", ".wav"]) {
+      if (this.byName.has(stem + ext)) return stem + ext;
+    }
+    return null;
+  }
+
+  // 新写入（或转码替换）的归档文件
+  track(event: ArchivedEvent): void {
+    if (!this.dir || path.resolve(path.dirname(event.filePath)) !== path.resolve(this.dir)) return;
+    if (event.replaces) this.remove(path.basename(event.replaces));
+    const file = this.insert(path.basename(event.filePath), event.bytes, true);
+    this.updateGauges();
+    if (file && this.overQuota(file.device)) this.requestSweep();
+  }
+
+  // 转码中的文件不删：压缩线程删 WAV 时会遇到 ENOENT，转出的文件也会落在索引之外
+  setCompressing(event: CompressingEvent): void {
+    const name = path.basename(event.filePath);
+    if (event.compressing) this.busy.set(name, Date.now());
+    else this.busy.delete(name);
+  }
+
+  private isBusy(name: string, now: number): boolean {
+    const since = this.busy.get(name);
+    if (since === undefined) return false;
+    if (now - since < this.config.busyTtlMs) return true;
+    this.busy.delete(name);
+    return false;
+  }
+
+  // 时间取文件名（段开始时的服务器时钟），转码、复制都不会改变
+  private insert(name: string, bytes: number, append: boolean): ArchiveFile | null {
+    const parsed = parseArchiveName(name);
+    if (!parsed) return null;
+    this.remove(name);
+    const file: ArchiveFile = { name, device: parsed.device, bytes, createdAt: parsed.createdAt };
+    let device = this.devices.get(file.device);
+    if (!device) {
+      device = { files: [], bytes: 0 };
+      this.devices.set(file.device, device);
+    }
+    // 运行中新文件几乎总是最新的，从尾部找插入点；启动扫描结束后统一排序
+    if (append) {
+      let i = device.files.length;
+      while (i > 0 && device.files[i - 1].createdAt > file.createdAt) i--;
+      device.files.splice(i, 0, file);
+    } else {
+      device.files.push(file);
+    }
+    device.bytes += bytes;
+    this.totalBytes += bytes;
+    this.byName.set(name, file);
+    return file;
+  }
+
+  private remove(name: string): ArchiveFile | null {
+    const file = this.byName.get(name);
+    if (!file) return null;
+    this.byName.delete(name);
+    const device = this.devices.get(file.device)!;
+    const index = device.files.indexOf(file);
+    if (index >= 0) device.files.splice(index, 1);
+    device.bytes -= file.bytes;
+    this.totalBytes -= file.bytes;
+    if (device.files.length === 0) this.devices.delete(file.device);
+    return file;
+  }
+
+  private overQuota(device: string): boolean {
+    const { deviceQuotaBytes, globalQuotaBytes, minFreeBytes } = this.config;
+    return (
+      (deviceQuotaBytes > 0 && (this.devices.get(device)?.bytes ?? 0) > deviceQuotaBytes) ||
+      (globalQuotaBytes > 0 && this.totalBytes > globalQuotaBytes) ||
+      (minFreeBytes > 0 && this.freeBytes < minFreeBytes)
+    );
+  }
+
+  // 同一时刻只跑一轮；运行中再次请求则结束后补一轮
+  private requestSweep(): void {
+    if (!this.ready) return;
+    if (this.sweeping) {
+      this.sweepQueued = true;
+      return;
+    }
+    this.sweeping = true;
+    this.sweep()
+      .catch((error) => log.error("清理出错", { error }))
+      .finally(() => {
+        this.sweeping = false;
+        if (this.sweepQueued) {
+          this.sweepQueued = false;
+          this.requestSweep();
+        }
+      });
+  }
+
+  private async refreshFreeBytes(): Promise<void> {
+    try {
+      const fs = await fsp.statfs(this.dir!);
+      this.freeBytes = fs.bavail * fs.bsize;
+      diskFree.set(this.freeBytes);
+    } catch {
+      this.freeBytes = Infinity;
+    }
+  }
+
+  // 选下一个要删的文件：只看每台设备最旧的一个（跳过转码中的），O(设备数)
+  private nextVictim(now: number): { file: ArchiveFile; reason: DeleteReason } | null {
+    const { maxAgeDays, deviceQuotaBytes, globalQuotaBytes, minFreeBytes } = this.config;
+    const cutoff = maxAgeDays > 0 ? now - maxAgeDays * 86400_000 : -Infinity;
+    let oldest: ArchiveFile | null = null;
+    let overDevice: ArchiveFile | null = null;
+    for (const device of this.devices.values()) {
+      const head = device.files.find((file) => !this.isBusy(file.name, now));
+      if (!head) continue;
+      if (!oldest || head.createdAt < oldest.createdAt) oldest = head;
+      if (!overDevice && deviceQuotaBytes > 0 && device.bytes > deviceQuotaBytes) overDevice = head;
+    }
+    if (!oldest) return null;
+    if (oldest.createdAt < cutoff) return { file: oldest, reason: "expired" };
+    if (overDevice) return { file: overDevice, reason: "device_quota" };
+    if (globalQuotaBytes > 0 && this.totalBytes > globalQuotaBytes) {
+      return { file: oldest, reason: "global_quota" };
+    }
+    if (minFreeBytes > 0 && this.freeBytes < minFreeBytes) return { file: oldest, reason: "disk_free" };
+    return null;
+  }
+
+  // 逐个异步 unlink：同一时刻只占一个 libuv 线程，不与归档写盘争抢；
+  // 每删一批让出一次事件循环，大批量过期时也不会卡住音频处理
+  private async sweep(): Promise<void> {
+    await this.refreshFreeBytes();
+    const startedAt = performance.now();
+    let deleted = 0;
+    let freed = 0;
+    for (;;) {
+      const victim = this.nextVictim(Date.now());
+      if (!victim) break;
+      const { file, reason } = victim;
+      this.remove(file.name);
+      try {
+        await fsp.unlink(path.join(this.dir!, file.name));
+        deletedFiles.labels(reason).inc();
+        deletedBytes.labels(reason).inc(file.bytes);
+        freed += file.bytes;
+        if (Number.isFinite(this.freeBytes)) this.freeBytes += file.bytes;
+      } catch (error) {
+        if ((error as NodeJS.ErrnoException).code !== "ENOENT") {
+          deleteErrors.inc();
+          log.error("删除失败", { file: file.name, error });
+        }
+      }
+      if (++deleted % this.config.yieldEvery === 0) {
+        this.updateGauges();
+        await new Promise((resolve) => setImmediate(resolve));
+      }
+    }
+    if (deleted > 0) {
+      log.info("清理完成", {
+        deleted,
+        freedBytes: freed,
+        ms: Math.round(performance.now() - startedAt),
+        files: this.byName.size,
+        bytes: this.totalBytes,
+      });
+      await this.refreshFreeBytes();
+    }
+    this.updateGauges();
+  }
+
+  private updateGauges(): void {
+    diskBytes.set(this.totalBytes);
+    diskFiles.set(this.byName.size);
+    devicesGauge.set(this.devices.size);
+  }
+}
+
+export const retentionManager = new RetentionManager();
+
+// ==================== 写盘通知 ====================
+// 单进程 / 主进程直接记入索引；集群 worker 由 server.ts 设置转发，经 IPC 交给主进程
+let forward: ((event: RetentionEvent) => void) | null = null;
+
+export function setArchiveForwarder(fn: (event: RetentionEvent) => void): void {
+  forward = fn;
+}
+
+export function noteArchived(event: ArchivedEvent): void {
+  if (forward) forward(event);
+  else retentionManager.track(event);
+}
+
+export function noteCompressing(filePath: string, compressing: boolean): void {
+  const event: CompressingEvent = { filePath, compressing };
+  if (forward) forward(event);
+  else retentionManager.setCompressing(event);
+}
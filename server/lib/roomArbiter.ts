@@ -0,0 +1,247 @@
+import type { PooledFrame } from "./framePool";
+import { metrics, type CounterChild } from "./metrics";
+import { DEFAULT_VAD_CONFIG, EnergyVad, type VadConfig } from "./vad";
+
+// ==================== 同房间多麦克风仲裁 ====================
+// 开放空间里一句“关灯”会被多台设备同时听到。同一房间（?room=）的设备共用一个 ASR：
+// 各路音频按采集时间对齐后延迟 delayMs 再送识别；任一路检测到开口后观察 decisionWindowMs，
+// 选出信噪比最高的一路，从开口前的位置切换过去，其余各路不送 ASR。
+//
+//   采集时间  ──[preroll][attack]│开口检测│[决策窗口]│
+//   送 ASR    ───────────────────────────────────────── 落后 delayMs，切换点在开口之前
+
+export const ROOM_CONFIG = {
+  decisionWindowMs: 200, // 开口后观察多久再选路
+  prerollMs: 100, // 切换点再往前留一点，避免吞掉首字
+  maxQueuedFrames: 64, // 每路对齐队列上限（约 3.2 秒），时钟异常时丢最旧的
+  commandDedupeMs: 2000, // 同一房间相同指令的去重窗口
+} as const;
+
+interface QueuedFrame {
+  frame: PooledFrame; // 入队时 retain，送出或丢弃时 release
+  capturedAt: number;
+  receivedAt: number;
+  durationMs: number;
+  snrDb: number;
+}
+
+interface Member {
+  vad: EnergyVad;
+  queue: QueuedFrame[];
+}
+
+export interface RoomDecision {
+  room: string;
+  clientId: string;
+  snrDb: number;
+  candidates: number; // 参与比较的路数
+  switched: boolean;
+}
+
+export interface RoomArbiterOptions {
+  room: string;
+  // 送给房间 ASR 的音频（已对齐、只有被选中的一路）
+  // 帧只在回调期间有效，需要异步持有的消费者自行 retain
+  feed: (clientId: string, frame: PooledFrame, capturedAt: number, receivedAt: number) => void;
+  onDecision?: (decision: RoomDecision) => void;
+  vad?: VadConfig;
+}
+
+// ==================== 指标 ====================
+const savedSeconds = metrics.counter(
+  "asr_audio_saved_seconds_total",
+  "Device audio not sent to ASR because another microphone in the room was selected",
+  ["room"],
+);
+const roomUtterances = metrics.counter(
+  "room_utterances_total",
+  "Utterances arbitrated between microphones of one room",
+  ["room"],
+);
+const roomSwitches = metrics.counter(
+  "room_microphone_switches_total",
+  "Times the selected microphone of a room changed",
+  ["room"],
+);
+
+export class RoomArbiter {
+  readonly room: string;
+  readonly delayMs: number;
+  private readonly members = new Map<string, Member>();
+  private readonly vadConfig: VadConfig;
+  private selectedId: string | null = null;
+  private fedUntil = 0; // 已送 ASR 的采集时间终点
+  private utterance: { startedAt: number; decided: boolean } | null = null;
+  private readonly saved: CounterChild;
+  private readonly utterances: CounterChild;
+  private readonly switches: CounterChild;
+
+  constructor(private readonly options: RoomArbiterOptions) {
+    this.room = options.room;
+    this.vadConfig = options.vad ?? DEFAULT_VAD_CONFIG;
+    this.delayMs =
+      ROOM_CONFIG.decisionWindowMs + this.vadConfig.attackMs + ROOM_CONFIG.prerollMs;
+    this.saved = savedSeconds.labels(this.room);
+    this.utterances = roomUtterances.labels(this.room);
+    this.switches = roomSwitches.labels(this.room);
+  }
+
+  get size(): number {
+    return this.members.size;
+  }
+
+  get selected(): string | null {
+    return this.selectedId;
+  }
+
+  join(clientId: string) {
+    this.members.set(clientId, { vad: new EnergyVad(this.vadConfig), queue: [] });
+    if (this.selectedId === null) this.selectedId = clientId;
+  }
+
+  leave(clientId: string) {
+    const member = this.members.get(clientId);
+    if (!member) return;
+    for (const queued of member.queue) queued.frame.release();
+    this.members.delete(clientId);
+    if (this.selectedId !== clientId) return;
+    // 被选中的一路断开：改用任意一路，fedUntil 保留以免重复送入
+    this.selectedId = this.members.keys().next().value ?? null;
+  }
+
+  // 房间最后一台设备离开时调用，移除本房间的指标
+  dispose() {
+    savedSeconds.remove(this.room);
+    roomUtterances.remove(this.room);
+    roomSwitches.remove(this.room);
+  }
+
+  /**
+   * 送入一路设备的一帧
+   * @param capturedAt 采集时间（服务器时钟）
+   */
+  push(clientId: string, frame: PooledFrame, capturedAt: number, receivedAt: number, now = Date.now()) {
+    const member = this.members.get(clientId);
+    if (!member) return;
+
+    const vad = member.vad.push(frame.pcm);
+    const durationMs = (frame.length / 2 / this.vadConfig.sampleRate) * 1000;
+    member.queue.push({ frame: frame.retain(), capturedAt, receivedAt, durationMs, snrDb: vad.snrDb });
+    if (member.queue.length > ROOM_CONFIG.maxQueuedFrames) {
+      this.drop(member.queue.shift()!, clientId);
+    }
+
+    if (!this.utterance && vad.onset) {
+      this.utterance = { startedAt: capturedAt, decided: false };
+    }
+    if (this.utterance) {
+      if (!this.utterance.decided && now >= this.utterance.startedAt + ROOM_CONFIG.decisionWindowMs) {
+        this.decide();
+      } else if (this.utterance.decided && !this.anySpeaking()) {
+        this.utterance = null;
+      }
+    }
+    this.pump(now);
+  }
+
+  // 比较开口前后（attack + 决策窗口）各路的平均信噪比
+  private decide() {
+    const utterance = this.utterance!;
+    utterance.decided = true;
+    const from = utterance.startedAt - this.vadConfig.attackMs;
+    const to = utterance.startedAt + ROOM_CONFIG.decisionWindowMs;
+    let bestId: string | null = null;
+    let bestSnr = -Infinity;
+    let candidates = 0;
+    for (const [clientId, member] of this.members) {
+      let sum = 0;
+      let count = 0;
+      for (const frame of member.queue) {
+        if (frame.capturedAt < from || frame.capturedAt > to) continue;
+        sum += frame.snrDb;
+        count++;
+      }
+      if (count === 0) continue;
+      candidates++;
+      const snr = sum / count;
+      // 相同时保持当前路，避免来回切换
+      if (snr > bestSnr || (snr === bestSnr && clientId === this.selectedId)) {
+        bestSnr = snr;
+        bestId = clientId;
+      }
+    }
+    if (bestId === null) return;
+
+    this.utterances.inc();
+    const switched = bestId !== this.selectedId;
+    if (switched) {
+      this.selectedId = bestId;
+      this.switches.inc();
+    }
+    this.options.onDecision?.({
+      room: this.room,
+      clientId: bestId,
+      snrDb: bestSnr,
+      candidates,
+      switched,
+    });
+  }
+
+  // 把采集时间早于 now - delayMs 的帧移出队列：选中的一路送 ASR，其余丢弃
+  private pump(now: number) {
+    const horizon = now - this.delayMs;
+    for (const [clientId, member] of this.members) {
+      const queue = member.queue;
+      let consumed = 0;
+      while (consumed < queue.length && queue[consumed].capturedAt <= horizon) {
+        const frame = queue[consumed++];
+        // 切换后新一路与已送出的部分重叠时跳过，时间线保持连续
+        if (clientId === this.selectedId && frame.capturedAt + frame.durationMs / 2 >= this.fedUntil) {
+          this.fedUntil = frame.capturedAt + frame.durationMs;
+          this.options.feed(clientId, frame.frame, frame.capturedAt, frame.receivedAt);
+          frame.frame.release();
+        } else {
+          this.drop(frame, clientId);
+        }
+      }
+      if (consumed > 0) queue.splice(0, consumed);
+    }
+  }
+
+  private drop(frame: QueuedFrame, clientId: string) {
+    frame.frame.release();
+    if (clientId !== this.selectedId || frame.capturedAt + frame.durationMs <= this.fedUntil) {
+      this.saved.inc(frame.durationMs / 1000);
+    }
+  }
+
+  private anySpeaking(): boolean {
+    for (const member of this.members.values()) {
+      if (member.vad.isSpeaking) return true;
+    }
+    return false;
+  }
+}
+
+// ==================== 指令去重 ====================
+// 同一房间在窗口内识别出相同指令（拆句、重复识别）时只下发一次
+export class CommandDeduper {
+  private readonly recent = new Map<string, number>();
+
+  constructor(private readonly windowMs: number = ROOM_CONFIG.commandDedupeMs) {}
+
+  /**
+   * @returns true 表示应下发；窗口内重复则返回 false
+   */
+  accept(text: string, now = Date.now()): boolean {
+    for (const [key, at] of this.recent) {
+      if (now - at >= this.windowMs) this.recent.delete(key);
+    }
+    // 忽略标点与空白：“关灯。”与“关灯”视为同一指令
+    const key = text.replace(/[\s\p{P}]/gu, "");
+    if (!key) return true;
+    if (this.recent.has(key)) return false;
+    this.recent.set(key, now);
+    return true;
+  }
+}
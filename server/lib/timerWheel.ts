@@ -0,0 +1,95 @@
+import { logger } from "./logger";
+
+// ==================== 时间轮 ====================
+// 上万个会话各自 setTimeout 会让定时器堆随连接数增长，且每次重排都是 O(log n)。
+// 这里用一个 setInterval 驱动的哈希时间轮：调度 / 取消 O(1)，每个 tick 只处理到期的槽。
+// 精度为一个 tick，适合心跳这类秒级、允许少量延后的定时任务。
+
+const log = logger.get("timer");
+
+export interface WheelTimer {
+  readonly callback: () => void;
+  slot: number; // 所在槽，-1 表示未调度
+  rounds: number; // 还需转过的整圈数（延迟超过一圈时）
+}
+
+export class TimerWheel {
+  private readonly slots: Array<Set<WheelTimer>>;
+  private cursor = 0;
+  private timer: NodeJS.Timeout | null = null;
+  private scheduled = 0;
+
+  constructor(
+    readonly tickMs: number = 1000,
+    slotCount: number = 64,
+  ) {
+    this.slots = Array.from({ length: slotCount }, () => new Set<WheelTimer>());
+  }
+
+  get size(): number {
+    return this.scheduled;
+  }
+
+  start(): void {
+    if (this.timer) return;
+    this.timer = setInterval(() => this.tick(), this.tickMs);
+    this.timer.unref();
+  }
+
+  stop(): void {
+    if (this.timer) clearInterval(this.timer);
+    this.timer = null;
+  }
+
+  create(callback: () => void): WheelTimer {
+    return { callback, slot: -1, rounds: 0 };
+  }
+
+  /**
+   * 在 delayMs 之后（向上取整到 tick）触发；已调度的先取消
+   */
+  schedule(timer: WheelTimer, delayMs: number): void {
+    this.cancel(timer);
+    const ticks = Math.max(1, Math.ceil(delayMs / this.tickMs));
+    const slotCount = this.slots.length;
+    timer.slot = (this.cursor + ticks) % slotCount;
+    timer.rounds = Math.floor((ticks - 1) / slotCount);
+    this.slots[timer.slot].add(timer);
+    this.scheduled++;
+  }
+
+  cancel(timer: WheelTimer): void {
+    if (timer.slot < 0) return;
+    this.slots[timer.slot].delete(timer);
+    timer.slot = -1;
+    this.scheduled--;
+  }
+
+  // 推进一格，触发该槽内本圈到期的定时器
+  tick(): void {
+    this.cursor = (this.cursor + 1) % this.slots.length;
+    const slot = this.slots[this.cursor];
+    if (slot.size === 0) return;
+    const due: WheelTimer[] = [];
+    for (const timer of slot) {
+      if (timer.rounds > 0) {
+        timer.rounds--;
+        continue;
+      }
+      due.push(timer);
+    }
+    for (const timer of due) {
+      slot.delete(timer);
+      timer.slot = -1;
+      this.scheduled--;
+    }
+    // 先全部摘除再回调，回调里重新调度不会落回正在遍历的槽
+    for (const timer of due) {
+      try {
+        timer.callback();
+      } catch (error) {
+        log.error("回调出错", { error });
+      }
+    }
+  }
+}
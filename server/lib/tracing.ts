@@ -0,0 +1,289 @@
+import { randomBytes } from "crypto";
+import { appendFile, mkdir } from "fs/promises";
+import path from "path";
+import { logger } from "./logger";
+import { summarize, type Summary } from "./stats";
+import type { AudioTiming } from "./types";
+
+// ==================== 配置 ====================
+const CONFIG = {
+  serviceName: "light-switch-server",
+  // 设置 OTEL_EXPORTER_OTLP_ENDPOINT 时发送到 collector，否则写入本地文件
+  collectorUrl: process.env.OTEL_EXPORTER_OTLP_ENDPOINT || "",
+  filePath:
+    process.env.TRACE_FILE || path.join(process.cwd(), "traces", "spans.jsonl"),
+  flushIntervalMs: 2000,
+  maxBatch: 256,
+  recentSize: 200, // 汇总视图保留最近的句子数
+} as const;
+
+const log = logger.get("tracing");
+
+// ==================== 类型定义 ====================
+type AttrValue = string | number | boolean;
+
+interface SpanRecord {
+  traceId: string;
+  spanId: string;
+  parentSpanId?: string;
+  name: string;
+  startMs: number;
+  endMs: number;
+  attributes: Record<string, AttrValue>;
+  error?: string;
+}
+
+// 各阶段耗时（毫秒），缺失的环节为 null
+export interface StageBreakdown {
+  uplink: number | null; // 句尾音频：设备采集 -> 服务器接收
+  ingest: number | null; // 服务器接收 -> 转发给 ASR
+  asr_first_partial: number | null; // 句首音频转发 -> 第一个中间结果
+  asr_final: number | null; // 句尾音频转发 -> 最终结果
+  command_emit: number | null; // 最终结果 -> 指令下发
+  device_ack: number | null; // 指令下发 -> 设备回执
+  total: number | null; // 句尾采集 -> 回执（或最后一个已知环节）
+}
+
+export interface TraceSummaryEntry {
+  traceId: string;
+  deviceId: string;
+  text: string;
+  finishedAt: number;
+  status: string;
+  stages: StageBreakdown;
+}
+
+// ==================== 导出器 ====================
+function randomHex(bytes: number): string {
+  return randomBytes(bytes).toString("hex");
+}
+
+function toNano(ms: number): string {
+  return (BigInt(Math.round(ms * 1000)) * 1000n).toString();
+}
+
+function toOtlpAttributes(attrs: Record<string, AttrValue>) {
+  return Object.entries(attrs).map(([key, v]) => ({
+    key,
+    value:
+      typeof v === "string"
+        ? { stringValue: v }
+        : typeof v === "boolean"
+          ? { boolValue: v }
+          : Number.isInteger(v)
+            ? { intValue: String(v) }
+            : { doubleValue: v },
+  }));
+}
+
+// 批量输出 OTLP/JSON（ExportTraceServiceRequest），每批一行
+class SpanExporter {
+  private queue: SpanRecord[] = [];
+  private flushing: Promise<void> | null = null;
+  private dirReady = false;
+
+  constructor() {
+    setInterval(() => void this.flush(), CONFIG.flushIntervalMs).unref();
+  }
+
+  push(span: SpanRecord): void {
+    this.queue.push(span);
+    if (this.queue.length >= CONFIG.maxBatch) void this.flush();
+  }
+
+  async flush(): Promise<void> {
+    if (this.flushing) await this.flushing;
+    if (this.queue.length === 0) return;
+    const batch = this.queue;
+    this.queue = [];
+    this.flushing = this.write(batch).finally(() => {
+      this.flushing = null;
+    });
+    await this.flushing;
+  }
+
+  private async write(batch: SpanRecord[]): Promise<void> {
+    const body = JSON.stringify({
+      resourceSpans: [
+        {
+          resource: {
+            attributes: toOtlpAttributes({ "service.name": CONFIG.serviceName }),
+          },
+          scopeSpans: [
+            {
+              scope: { name: "voice-to-relay" },
+              spans: batch.map((s) => ({
+                traceId: s.traceId,
+                spanId: s.spanId,
+                ...(s.parentSpanId ? { parentSpanId: s.parentSpanId } : {}),
+                name: s.name,
+                kind: 1, // SPAN_KIND_INTERNAL
+                startTimeUnixNano: toNano(s.startMs),
+                endTimeUnixNano: toNano(s.endMs),
+                attributes: toOtlpAttributes(s.attributes),
+                status: s.error ? { code: 2, message: s.error } : { code: 1 },
+              })),
+            },
+          ],
+        },
+      ],
+    });
+
+    try {
+      if (CONFIG.collectorUrl) {
+        const res = await fetch(`${CONFIG.collectorUrl.replace(/\/$/, "")}/v1/traces`, {
+          method: "POST",
+          headers: { "Content-Type": "application/json" },
+          body,
+        });
+        if (!res.ok) throw new Error(`HTTP ${res.status}`);
+      } else {
+        if (!this.dirReady) {
+          await mkdir(path.dirname(CONFIG.filePath), { recursive: true });
+          this.dirReady = true;
+        }
+        await appendFile(CONFIG.filePath, body + "\n");
+      }
+    } catch (error) {
+      log.error("导出 span 失败", { spans: batch.length, error });
+    }
+  }
+}
+
+// ==================== 单句追踪 ====================
+// 一个句子（一次 ASR sentence）对应一条 trace：
+// 首个中间结果时创建，最终结果、指令下发、设备回执依次补充时间点。
+export class UtteranceTrace {
+  readonly traceId = randomHex(16);
+  readonly rootSpanId = randomHex(8);
+  text = "";
+  speechStart: AudioTiming | null = null;
+  speechEnd: AudioTiming | null = null;
+  firstPartialAt: number | null = null;
+  finalAt: number | null = null;
+  commandId: number | null = null;
+  commandAt: number | null = null;
+  ackAt: number | null = null;
+  relayState: 0 | 1 | null = null;
+
+  constructor(readonly deviceId: string) {}
+
+  stages(): StageBreakdown {
+    const diff = (a: number | null | undefined, b: number | null | undefined) =>
+      a == null || b == null ? null : b - a;
+    const end = this.ackAt ?? this.commandAt ?? this.finalAt;
+    return {
+      uplink: diff(this.speechEnd?.capturedAt, this.speechEnd?.receivedAt),
+      ingest: diff(this.speechEnd?.receivedAt, this.speechEnd?.sentAt),
+      asr_first_partial: diff(this.speechStart?.sentAt, this.firstPartialAt),
+      asr_final: diff(this.speechEnd?.sentAt, this.finalAt),
+      command_emit: diff(this.finalAt, this.commandAt),
+      device_ack: diff(this.commandAt, this.ackAt),
+      total: diff(this.speechEnd?.capturedAt, end),
+    };
+  }
+}
+
+// ==================== Tracer ====================
+export class Tracer {
+  private readonly exporter = new SpanExporter();
+  private readonly recent: TraceSummaryEntry[] = [];
+
+  startUtterance(deviceId: string): UtteranceTrace {
+    return new UtteranceTrace(deviceId);
+  }
+
+  /**
+   * 结束一条 trace：生成根 span 与各阶段子 span 并导出
+   * @param status ok / no_command / ack_timeout / disconnected
+   */
+  finish(trace: UtteranceTrace, status: string = "ok"): void {
+    const now = Date.now();
+    const start =
+      trace.speechStart?.capturedAt ?? trace.firstPartialAt ?? trace.finalAt ?? now;
+    const end = trace.ackAt ?? trace.commandAt ?? trace.finalAt ?? now;
+    const error = status === "ok" || status === "no_command" ? undefined : status;
+
+    const child = (
+      name: string,
+      from: number | null | undefined,
+      to: number | null | undefined,
+      attributes: Record<string, AttrValue> = {},
+    ) => {
+      if (from == null || to == null) return;
+      this.exporter.push({
+        traceId: trace.traceId,
+        spanId: randomHex(8),
+        parentSpanId: trace.rootSpanId,
+        name,
+        startMs: from,
+        endMs: Math.max(from, to),
+        attributes: { "device.id": trace.deviceId, ...attributes },
+      });
+    };
+
+    this.exporter.push({
+      traceId: trace.traceId,
+      spanId: trace.rootSpanId,
+      name: "utterance",
+      startMs: start,
+      endMs: Math.max(start, end),
+      attributes: {
+        "device.id": trace.deviceId,
+        "asr.text": trace.text,
+        ...(trace.relayState !== null ? { "relay.state": trace.relayState } : {}),
+      },
+      error,
+    });
+    child("device.capture", trace.speechStart?.capturedAt, trace.speechEnd?.capturedAt);
+    child("network.uplink", trace.speechEnd?.capturedAt, trace.speechEnd?.receivedAt);
+    child("server.ingest", trace.speechEnd?.receivedAt, trace.speechEnd?.sentAt);
+    child("asr.first_partial", trace.speechStart?.sentAt, trace.firstPartialAt);
+    child("asr.final", trace.speechEnd?.sentAt, trace.finalAt);
+    child("command.emit", trace.finalAt, trace.commandAt, {
+      ...(trace.commandId !== null ? { "command.id": trace.commandId } : {}),
+    });
+    child("device.ack", trace.commandAt, trace.ackAt);
+
+    this.recent.push({
+      traceId: trace.traceId,
+      deviceId: trace.deviceId,
+      text: trace.text,
+      finishedAt: now,
+      status,
+      stages: trace.stages(),
+    });
+    if (this.recent.length > CONFIG.recentSize) this.recent.shift();
+  }
+
+  /**
+   * 最近 N 条指令的分阶段延迟汇总
+   * @param n 条数（默认 20）
+   */
+  summary(n: number = 20) {
+    return summarizeTraces(this.recent.slice(-n));
+  }
+
+  flush(): Promise<void> {
+    return this.exporter.flush();
+  }
+}
+
+/**
+ * 按阶段汇总一组 trace；集群模式下主进程用它合并各 worker 的结果
+ */
+export function summarizeTraces(traces: TraceSummaryEntry[]) {
+  const stages: Partial<Record<keyof StageBreakdown, Summary>> = {};
+  const keys = Object.keys(
+    traces[0]?.stages ?? {},
+  ) as (keyof StageBreakdown)[];
+  for (const key of keys) {
+    const values = traces
+      .map((t) => t.stages[key])
+      .filter((v): v is number => v !== null);
+    stages[key] = summarize(values);
+  }
+  return { count: traces.length, stages, traces };
+}
+
+export const tracer = new Tracer();
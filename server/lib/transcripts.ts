@@ -0,0 +1,691 @@
+import { promises as fsp } from "fs";
+import path from "path";
+import { metrics } from "./metrics";
+import { logger } from "./logger";
+import type { AudioQualitySummary } from "./audioQuality";
+
+// ==================== 配置 ====================
+// 识别结果（句末）按设备追加到 <dir>/<device>.tlog，内存中维护倒排索引：
+// 按文字查到设备、时间和归档文件内的偏移，不必逐个去听 WAV。
+// 中文按相邻两字（bigram）切词，查询时再回读原句确认是连续出现的子串。
+export const TRANSCRIPT_CONFIG = {
+  flushIntervalMs: 500, // 攒一批再追加写盘
+  readChunkBytes: 256 * 1024, // 启动时逐块读取日志
+  yieldEvery: 20000, // 启动建索引时每处理这么多句让出一次事件循环
+  defaultLimit: 50,
+  maxLimit: 500,
+  maxScan: 5000, // 一次查询最多回读校验的候选句数，超出时结果标记 truncated
+  readBatch: 64, // 回读校验时并发读取的句数
+  maxBacklog: 10000, // 索引加载完成前（或目录不可用时）暂存的句数
+} as const;
+
+const EXTENSION = ".tlog";
+
+// 记录格式（小端）：
+//   u32 长度（不含自身）| f64 ts | u32 durationMs | u32 offsetMs
+//   u8 房间名字节数 | u8 归档名字节数 | u16 文本字节数 | 房间名 | 归档名 | 文本（UTF-8）
+//   [可选] 音频质量：f32 rmsDbfs | f32 peakDbfs | f32 clipRatio | f32 dcOffset | f32 snrDb（NaN 表示无）
+//          | u32 frames | u32 lostFrames
+// 有没有质量块由长度字段区分，加入质量块之前写的日志照常读取
+const HEADER_BYTES = 24;
+const QUALITY_BYTES = 28;
+const MAX_RECORD_BYTES = HEADER_BYTES + 255 + 255 + 0xffff + QUALITY_BYTES;
+
+const log = logger.get("transcript");
+
+// ==================== 类型定义 ====================
+export interface TranscriptEntry {
+  device: string; // 设备 ID（重连序号已去掉；写入时非 [A-Za-z0-9_-] 的字符替换为 _）
+  room: string | null;
+  ts: number; // 句子起点的采集时间（服务器时钟，ms）
+  durationMs: number;
+  archive: string; // 句子起点所在的归档文件名（不含扩展名，转码后扩展名会变）；没有音频时为空
+  offsetMs: number; // 句子起点在该归档文件中的偏移
+  text: string;
+  quality?: AudioQualitySummary; // 句子时段内的音频质量（lib/audioQuality.ts）；旧记录没有
+}
+
+export interface TranscriptQuery {
+  text: string; // 空白分隔的多个词需同时出现
+  device?: string;
+  room?: string;
+  since?: number;
+  until?: number;
+  limit?: number;
+}
+
+export interface TranscriptSearchResult {
+  candidates: number; // 索引命中的句数（校验前）
+  scanned: number; // 回读校验的句数
+  truncated: boolean; // 达到 maxScan 仍未凑满 limit
+  hits: TranscriptEntry[]; // 从新到旧
+}
+
+// ==================== 指标 ====================
+const sentencesTotal = metrics.counter("transcript_sentences_total", "Final ASR sentences stored");
+const droppedBacklog = metrics.counter(
+  "transcript_dropped_total",
+  "Sentences dropped because the store was not ready",
+);
+const writeErrors = metrics.counter("transcript_write_errors_total", "Failed appends to transcript logs");
+const indexDocs = metrics.gauge("transcript_index_sentences", "Sentences in the transcript index");
+const indexTerms = metrics.gauge("transcript_index_terms", "Distinct terms in the transcript index");
+const indexSeconds = metrics.gauge(
+  "transcript_index_build_seconds",
+  "Time to load transcript logs and build the index at startup",
+);
+const searchSeconds = metrics.histogram("transcript_search_seconds", "Transcript search latency");
+
+// ==================== 切词 ====================
+// 中日韩文字按字切 bigram；其余字母数字连续的一段作为一个词
+const CJK = "\\p{Script=Han}\\p{Script=Hiragana}\\p{Script=Katakana}\\p{Script=Hangul}";
+const TOKEN_RE = new RegExp(`[${CJK}]+|(?:(?![${CJK}])[\\p{L}\\p{N}])+`, "gu");
+const CJK_START = new RegExp(`^[${CJK}]`, "u");
+
+export function normalizeText(text: string): string {
+  return text.normalize("NFKC").toLowerCase();
+}
+
+/**
+ * 切词（输入需先 normalizeText）
+ * 单独一个汉字的片段记为单字词；查询里的单字在 search() 中展开为包含它的所有 bigram
+ */
+export function tokenize(normalized: string, out: Set<string> = new Set()): Set<string> {
+  for (const match of normalized.matchAll(TOKEN_RE)) {
+    const run = match[0];
+    if (!CJK_START.test(run)) {
+      out.add(run);
+      continue;
+    }
+    const chars = Array.from(run);
+    if (chars.length === 1) out.add(chars[0]);
+    for (let i = 0; i + 1 < chars.length; i++) out.add(chars[i] + chars[i + 1]);
+  }
+  return out;
+}
+
+function isSingleCjk(token: string): boolean {
+  return token.length <= 2 && Array.from(token).length === 1 && CJK_START.test(token);
+}
+
+// ==================== 记录编解码 ====================
+// 超长字段按字节截断；截断处可能落在多字节字符中间，解码时替换为 U+FFFD
+function utf8(text: string, maxBytes: number): Buffer {
+  const bytes = Buffer.from(text, "utf8");
+  return bytes.length > maxBytes ? bytes.subarray(0, maxBytes) : bytes;
+}
+
+export function encodeRecord(entry: TranscriptEntry): Buffer {
+  const room = utf8(entry.room ?? "", 255);
+  const archive = utf8(entry.archive, 255);
+  const text = utf8(entry.text, 0xffff);
+  const quality = entry.quality;
+  const record = Buffer.allocUnsafe(
+    HEADER_BYTES + room.length + archive.length + text.length + (quality ? QUALITY_BYTES : 0),
+  );
+  record.writeUInt32LE(record.length - 4, 0);
+  record.writeDoubleLE(entry.ts, 4);
+  record.writeUInt32LE(Math.max(0, Math.min(0xffffffff, Math.round(entry.durationMs))), 12);
+  record.writeUInt32LE(Math.max(0, Math.min(0xffffffff, Math.round(entry.offsetMs))), 16);
+  record.writeUInt8(room.length, 20);
+  record.writeUInt8(archive.length, 21);
+  record.writeUInt16LE(text.length, 22);
+  let pos = HEADER_BYTES;
+  pos += room.copy(record, pos);
+  pos += archive.copy(record, pos);
+  pos += text.copy(record, pos);
+  if (quality) {
+    record.writeFloatLE(quality.rmsDbfs, pos);
+    record.writeFloatLE(quality.peakDbfs, pos + 4);
+    record.writeFloatLE(quality.clipRatio, pos + 8);
+    record.writeFloatLE(quality.dcOffset, pos + 12);
+    record.writeFloatLE(quality.snrDb ?? NaN, pos + 16);
+    record.writeUInt32LE(Math.min(0xffffffff, quality.frames), pos + 20);
+    record.writeUInt32LE(Math.min(0xffffffff, quality.lostFrames), pos + 24);
+  }
+  return record;
+}
+
+/**
+ * 从 buf[pos] 解一条记录
+ * @returns 数据不足一条时返回 null；长度字段与各字段不符（文件损坏）时抛出
+ */
+export function decodeRecord(
+  buf: Buffer,
+  pos: number,
+  device: string,
+): { entry: TranscriptEntry; bytes: number } | null {
+  if (buf.length - pos < HEADER_BYTES) return null;
+  const bytes = buf.readUInt32LE(pos) + 4;
+  const roomBytes = buf.readUInt8(pos + 20);
+  const archiveBytes = buf.readUInt8(pos + 21);
+  const textBytes = buf.readUInt16LE(pos + 22);
+  const baseBytes = HEADER_BYTES + roomBytes + archiveBytes + textBytes;
+  if (bytes !== baseBytes && bytes !== baseBytes + QUALITY_BYTES) {
+    throw new Error(`记录长度不符 @${pos}`);
+  }
+  if (buf.length - pos < bytes) return null;
+  let at = pos + HEADER_BYTES;
+  const room = buf.toString("utf8", at, (at += roomBytes));
+  const archive = buf.toString("utf8", at, (at += archiveBytes));
+  const text = buf.toString("utf8", at, (at += textBytes));
+  const entry: TranscriptEntry = {
+    device,
+    room: room || null,
+    ts: buf.readDoubleLE(pos + 4),
+    durationMs: buf.readUInt32LE(pos + 12),
+    offsetMs: buf.readUInt32LE(pos + 16),
+    archive,
+    text,
+  };
+  if (bytes !== baseBytes) {
+    const snrDb = buf.readFloatLE(at + 16);
+    entry.quality = {
+      rmsDbfs: buf.readFloatLE(at),
+      peakDbfs: buf.readFloatLE(at + 4),
+      clipRatio: buf.readFloatLE(at + 8),
+      dcOffset: buf.readFloatLE(at + 12),
+      snrDb: Number.isNaN(snrDb) ? null : snrDb,
+      frames: buf.readUInt32LE(at + 20),
+      lostFrames: buf.readUInt32LE(at + 24),
+    };
+  }
+  return { entry, bytes };
+}
+
+// 设备 ID 用作文件名：只保留安全字符（固件上报的 MAC 不受影响）
+function safeDeviceName(device: string): string {
+  return device.replace(/[^A-Za-z0-9_-]/g, "_");
+}
+
+// ==================== 索引结构 ====================
+// 句子编号按写入顺序递增；倒排表只存编号，文本留在磁盘上，百万句级别内存也只有几十 MB
+interface Posting {
+  ids: Uint32Array;
+  length: number;
+}
+
+class DocTable {
+  count = 0;
+  ts = new Float64Array(1024);
+  offset = new Float64Array(1024); // 在设备日志中的字节偏移
+  device = new Uint32Array(1024);
+  room = new Uint32Array(1024); // 0 = 不属于房间
+
+  add(ts: number, device: number, room: number, offset: number): number {
+    if (this.count === this.ts.length) {
+      const size = this.count * 2;
+      this.ts = grow(this.ts, new Float64Array(size));
+      this.offset = grow(this.offset, new Float64Array(size));
+      this.device = grow(this.device, new Uint32Array(size));
+      this.room = grow(this.room, new Uint32Array(size));
+    }
+    const id = this.count++;
+    this.ts[id] = ts;
+    this.offset[id] = offset;
+    this.device[id] = device;
+    this.room[id] = room;
+    return id;
+  }
+}
+
+function grow<T extends Float64Array | Uint32Array>(from: T, to: T): T {
+  to.set(from);
+  return to;
+}
+
+// 有序编号列表求交：从最短的开始，在其余列表里二分前进
+function intersect(lists: Uint32Array[]): Uint32Array {
+  if (lists.length === 0) return new Uint32Array(0);
+  lists.sort((a, b) => a.length - b.length);
+  let result = lists[0];
+  for (let k = 1; k < lists.length && result.length > 0; k++) {
+    const other = lists[k];
+    const out = new Uint32Array(result.length);
+    let n = 0;
+    let lo = 0;
+    for (let i = 0; i < result.length; i++) {
+      const id = result[i];
+      let hi = other.length;
+      while (lo < hi) {
+        const mid = (lo + hi) >>> 1;
+        if (other[mid] < id) lo = mid + 1;
+        else hi = mid;
+      }
+      if (lo === other.length) break;
+      if (other[lo] === id) out[n++] = id;
+    }
+    result = out.subarray(0, n);
+  }
+  return result;
+}
+
+// 多个有序列表求并（单字查询展开后使用）
+function union(lists: Uint32Array[]): Uint32Array {
+  if (lists.length === 1) return lists[0];
+  let total = 0;
+  for (const list of lists) total += list.length;
+  const all = new Uint32Array(total);
+  let pos = 0;
+  for (const list of lists) {
+    all.set(list, pos);
+    pos += list.length;
+  }
+  all.sort();
+  let n = 0;
+  for (let i = 0; i < all.length; i++) {
+    if (i === 0 || all[i] !== all[i - 1]) all[n++] = all[i];
+  }
+  return all.subarray(0, n);
+}
+
+// ==================== 启动时顺序读取 ====================
+class LogReader {
+  private buf = Buffer.alloc(0);
+  private pos = 0;
+  private fileOffset = 0; // buf[0] 在文件中的偏移
+  private eof = false;
+  head: { entry: TranscriptEntry; offset: number; bytes: number } | null = null;
+
+  constructor(
+    readonly device: string,
+    readonly filePath: string,
+    private readonly handle: fsp.FileHandle,
+    private readonly chunkBytes: number,
+  ) {}
+
+  // 读下一条到 head；返回 false 表示到末尾（末尾不完整的记录留给调用方截断）
+  async advance(): Promise<boolean> {
+    for (;;) {
+      const decoded = decodeRecord(this.buf, this.pos, this.device);
+      if (decoded) {
+        this.head = { entry: decoded.entry, offset: this.fileOffset + this.pos, bytes: decoded.bytes };
+        this.pos += decoded.bytes;
+        return true;
+      }
+      if (this.eof) {
+        this.head = null;
+        return false;
+      }
+      const rest = this.buf.subarray(this.pos);
+      const chunk = Buffer.allocUnsafe(Math.max(this.chunkBytes, MAX_RECORD_BYTES));
+      const { bytesRead } = await this.handle.read(chunk, 0, chunk.length, this.fileOffset + this.buf.length);
+      if (bytesRead === 0) this.eof = true;
+      this.fileOffset += this.pos;
+      this.buf = Buffer.concat([rest, chunk.subarray(0, bytesRead)]);
+      this.pos = 0;
+    }
+  }
+
+  // 最后一条完整记录之后的位置
+  get validBytes(): number {
+    return this.fileOffset + this.pos;
+  }
+
+  close(): Promise<void> {
+    return this.handle.close();
+  }
+}
+
+// ==================== 存储 ====================
+export class TranscriptStore {
+  private dir: string | null = null;
+  private ready = false;
+  private readonly docs = new DocTable();
+  private readonly postings = new Map<string, Posting>();
+  private readonly charPostings = new Map<string, Posting[]>(); // 汉字 -> 含该字的 bigram 与单字词
+  private readonly deviceNames: string[] = [];
+  private readonly deviceNos = new Map<string, number>();
+  private readonly deviceBytes: number[] = []; // 含未写出的记录，新记录的偏移
+  private readonly flushedBytes: number[] = []; // 已确认写入的长度，写失败时截回这里
+  private readonly roomNames: string[] = [""];
+  private readonly roomNos = new Map<string, number>();
+  private readonly pending = new Map<number, Array<{ id: number; record: Buffer }>>(); // 设备 -> 待写
+  private readonly unflushed = new Map<number, Buffer>(); // 未写出的记录，查询时直接用
+  private readonly backlog: TranscriptEntry[] = []; // 启动加载完成前收到的句子
+  private timer: NodeJS.Timeout | null = null;
+  private flushing: Promise<void> | null = null;
+
+  constructor(private readonly config: typeof TRANSCRIPT_CONFIG = TRANSCRIPT_CONFIG) {}
+
+  get stats() {
+    return {
+      sentences: this.docs.count,
+      terms: this.postings.size,
+      devices: this.deviceNames.length,
+      unflushed: this.unflushed.size,
+    };
+  }
+
+  /**
+   * 读取已有日志建立索引；各设备日志按时间归并，句子编号与时间顺序一致
+   * 末尾不完整的记录（写到一半断电）截掉
+   */
+  async start(dir: string): Promise<void> {
+    if (this.dir) return;
+    this.dir = dir;
+    const startedAt = performance.now();
+    try {
+      await this.load(dir);
+    } catch (error) {
+      // 目录不可用：只暂存到 maxBacklog，不写盘
+      log.error("索引加载失败", { dir, error });
+      return;
+    }
+    const seconds = (performance.now() - startedAt) / 1000;
+    indexSeconds.set(seconds);
+    this.updateGauges();
+    this.ready = true;
+    log.info("索引已加载", {
+      sentences: this.docs.count,
+      terms: this.postings.size,
+      devices: this.deviceNames.length,
+      ms: Math.round(seconds * 1000),
+    });
+    for (const entry of this.backlog.splice(0)) this.add(entry);
+  }
+
+  private async load(dir: string): Promise<void> {
+    await fsp.mkdir(dir, { recursive: true });
+    const names = (await fsp.readdir(dir)).filter((name) => name.endsWith(EXTENSION));
+    const readers: LogReader[] = [];
+    for (const name of names) {
+      const filePath = path.join(dir, name);
+      const handle = await fsp.open(filePath, "r");
+      readers.push(new LogReader(name.slice(0, -EXTENSION.length), filePath, handle, this.config.readChunkBytes));
+    }
+
+    // 按 ts 归并；设备数不多，线性选最小即可
+    const live: LogReader[] = [];
+    for (const reader of readers) {
+      if (await this.advanceOrClose(reader)) live.push(reader);
+    }
+    let loaded = 0;
+    while (live.length > 0) {
+      let min = 0;
+      for (let i = 1; i < live.length; i++) {
+        if (live[i].head!.entry.ts < live[min].head!.entry.ts) min = i;
+      }
+      const reader = live[min];
+      const { entry, offset } = reader.head!;
+      this.index(this.docs.add(entry.ts, this.deviceNo(entry.device), this.roomNo(entry.room), offset), entry.text);
+      if (!(await this.advanceOrClose(reader))) live.splice(min, 1);
+      if (++loaded % this.config.yieldEvery === 0) {
+        await new Promise((resolve) => setImmediate(resolve));
+      }
+    }
+  }
+
+  // 读下一条；读完时截掉不完整的尾部并关闭文件
+  private async advanceOrClose(reader: LogReader): Promise<boolean> {
+    try {
+      if (await reader.advance()) return true;
+    } catch (error) {
+      log.error("日志损坏，之后的记录忽略", { file: reader.filePath, at: reader.validBytes, error });
+    }
+    const { size } = await fsp.stat(reader.filePath);
+    if (size > reader.validBytes) {
+      log.warn("截掉不完整的记录", { file: reader.filePath, bytes: size - reader.validBytes });
+      await fsp.truncate(reader.filePath, reader.validBytes);
+    }
+    const deviceNo = this.deviceNo(reader.device);
+    this.deviceBytes[deviceNo] = this.flushedBytes[deviceNo] = reader.validBytes;
+    await reader.close();
+    return false;
+  }
+
+  /**
+   * 记录一句最终识别结果：立即可查，稍后批量追加到设备日志
+   */
+  add(entry: TranscriptEntry): void {
+    if (!this.ready) {
+      if (this.backlog.length < this.config.maxBacklog) this.backlog.push(entry);
+      else droppedBacklog.inc();
+      return;
+    }
+    const record = encodeRecord(entry);
+    const deviceNo = this.deviceNo(safeDeviceName(entry.device));
+    const offset = this.deviceBytes[deviceNo];
+    this.deviceBytes[deviceNo] += record.length;
+    const id = this.docs.add(entry.ts, deviceNo, this.roomNo(entry.room), offset);
+    this.index(id, entry.text);
+    this.unflushed.set(id, record);
+    let queue = this.pending.get(deviceNo);
+    if (!queue) {
+      queue = [];
+      this.pending.set(deviceNo, queue);
+    }
+    queue.push({ id, record });
+    sentencesTotal.inc();
+    this.updateGauges();
+    if (!this.timer) {
+      this.timer = setTimeout(() => void this.flush(), this.config.flushIntervalMs);
+      this.timer.unref();
+    }
+  }
+
+  /**
+   * 写出所有待写记录；同一时刻只有一轮在进行
+   */
+  async flush(): Promise<void> {
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+    while (this.flushing) await this.flushing;
+    if (this.pending.size === 0) return;
+    this.flushing = this.writePending().finally(() => {
+      this.flushing = null;
+    });
+    await this.flushing;
+  }
+
+  private async writePending(): Promise<void> {
+    const batches = [...this.pending];
+    this.pending.clear();
+    for (const [deviceNo, queue] of batches) {
+      const filePath = path.join(this.dir!, this.deviceNames[deviceNo] + EXTENSION);
+      const data = Buffer.concat(queue.map((item) => item.record));
+      try {
+        await fsp.appendFile(filePath, data);
+        this.flushedBytes[deviceNo] += data.length;
+        for (const item of queue) this.unflushed.delete(item.id);
+      } catch (error) {
+        // 可能写了一部分：截回已确认的长度，放回队首下次重试，保证索引里的偏移仍然有效
+        writeErrors.inc();
+        log.error("写入失败，稍后重试", { file: filePath, error });
+        await fsp.truncate(filePath, this.flushedBytes[deviceNo]).catch(() => {});
+        const later = this.pending.get(deviceNo) ?? [];
+        this.pending.set(deviceNo, [...queue, ...later]);
+      }
+    }
+    if (this.pending.size > 0 && !this.timer) {
+      this.timer = setTimeout(() => void this.flush(), this.config.flushIntervalMs);
+      this.timer.unref();
+    }
+  }
+
+  // 退出前写完
+  async close(): Promise<void> {
+    if (this.dir && this.ready) await this.flush();
+  }
+
+  /**
+   * 全文检索，结果从新到旧
+   * 索引给出包含全部 bigram 的候选，再回读原句确认每个词是连续出现的子串
+   */
+  async search(query: TranscriptQuery): Promise<TranscriptSearchResult> {
+    const startedAt = performance.now();
+    const limit = Math.min(query.limit || this.config.defaultLimit, this.config.maxLimit);
+    const terms = normalizeText(query.text).split(/\s+/).filter(Boolean);
+    const result: TranscriptSearchResult = { candidates: 0, scanned: 0, truncated: false, hits: [] };
+    const candidates = this.candidates(terms);
+    if (!candidates) return result;
+    result.candidates = candidates.length;
+
+    const deviceNo = query.device !== undefined ? this.deviceNos.get(query.device) : undefined;
+    const roomNo = query.room !== undefined ? this.roomNos.get(query.room) : undefined;
+    if ((query.device !== undefined && deviceNo === undefined) || (query.room !== undefined && roomNo === undefined)) {
+      return result;
+    }
+    const since = query.since ?? -Infinity;
+    const until = query.until ?? Infinity;
+    const { docs } = this;
+
+    const handles = new Map<number, Promise<fsp.FileHandle>>();
+    try {
+      let i = candidates.length - 1;
+      while (i >= 0 && result.hits.length < limit) {
+        // 先用内存中的列过滤，再成批回读
+        const batch: number[] = [];
+        for (; i >= 0 && batch.length < this.config.readBatch; i--) {
+          const id = candidates[i];
+          if (deviceNo !== undefined && docs.device[id] !== deviceNo) continue;
+          if (roomNo !== undefined && docs.room[id] !== roomNo) continue;
+          if (docs.ts[id] < since || docs.ts[id] > until) continue;
+          batch.push(id);
+        }
+        if (batch.length === 0) continue;
+        if (result.scanned >= this.config.maxScan) {
+          result.truncated = true;
+          break;
+        }
+        result.scanned += batch.length;
+        const entries = await Promise.all(batch.map((id) => this.readEntry(id, handles)));
+        for (const entry of entries) {
+          if (!entry) continue;
+          const text = normalizeText(entry.text);
+          if (terms.every((term) => text.includes(term))) {
+            result.hits.push(entry);
+            if (result.hits.length === limit) break;
+          }
+        }
+      }
+    } finally {
+      await Promise.all(
+        [...handles.values()].map((handle) => handle.then((h) => h.close()).catch(() => {})),
+      );
+    }
+    // 编号按写入顺序；设备时钟略有偏差，返回前按时间再排一次
+    result.hits.sort((a, b) => b.ts - a.ts);
+    searchSeconds.observe((performance.now() - startedAt) / 1000);
+    return result;
+  }
+
+  // 各词的候选求交；有词完全不在索引里时返回 null
+  private candidates(terms: string[]): Uint32Array | null {
+    const lists: Uint32Array[] = [];
+    for (const term of terms) {
+      const tokens = tokenize(term);
+      if (tokens.size === 0) return null;
+      for (const token of tokens) {
+        if (isSingleCjk(token)) {
+          // 单字：包含该字的所有 bigram 与单字词求并
+          const postings = this.charPostings.get(token);
+          if (!postings) return null;
+          lists.push(union(postings.map((posting) => posting.ids.subarray(0, posting.length))));
+        } else {
+          const posting = this.postings.get(token);
+          if (!posting) return null;
+          lists.push(posting.ids.subarray(0, posting.length));
+        }
+      }
+    }
+    return lists.length > 0 ? intersect(lists) : null;
+  }
+
+  private async readEntry(
+    id: number,
+    handles: Map<number, Promise<fsp.FileHandle>>,
+  ): Promise<TranscriptEntry | null> {
+    const deviceNo = this.docs.device[id];
+    const device = this.deviceNames[deviceNo];
+    const record = this.unflushed.get(id);
+    if (record) return decodeRecord(record, 0, device)?.entry ?? null;
+    let handle = handles.get(deviceNo);
+    if (!handle) {
+      handle = fsp.open(path.join(this.dir!, device + EXTENSION), "r");
+      handles.set(deviceNo, handle);
+    }
+    try {
+      const fh = await handle;
+      const head = Buffer.allocUnsafe(HEADER_BYTES);
+      await fh.read(head, 0, HEADER_BYTES, this.docs.offset[id]);
+      const buf = Buffer.allocUnsafe(head.readUInt32LE(0) + 4);
+      const { bytesRead } = await fh.read(buf, 0, buf.length, this.docs.offset[id]);
+      return decodeRecord(buf.subarray(0, bytesRead), 0, device)?.entry ?? null;
+    } catch (error) {
+      log.sampled("error", "read", 5, "读取记录失败", { device, error });
+      return null;
+    }
+  }
+
+  private index(id: number, text: string): void {
+    for (const token of tokenize(normalizeText(text))) {
+      let posting = this.postings.get(token);
+      if (!posting) {
+        posting = { ids: new Uint32Array(4), length: 0 };
+        this.postings.set(token, posting);
+        if (CJK_START.test(token)) this.indexChars(token, posting);
+      }
+      if (posting.length === posting.ids.length) {
+        posting.ids = grow(posting.ids, new Uint32Array(posting.length * 2));
+      }
+      posting.ids[posting.length++] = id;
+    }
+  }
+
+  // 新的中文词登记到它的每个字下，单字查询直接取，不用扫整个词表
+  private indexChars(token: string, posting: Posting): void {
+    const chars = Array.from(token);
+    for (let i = 0; i < chars.length; i++) {
+      if (i > 0 && chars[i] === chars[0]) continue; // “哈哈”只登记一次
+      const list = this.charPostings.get(chars[i]);
+      if (list) list.push(posting);
+      else this.charPostings.set(chars[i], [posting]);
+    }
+  }
+
+    private deviceNo(device: string): number {
+    let no = this.deviceNos.get(device);
+    if (no === undefined) {
+      no = this.deviceNames.length;
+      this.deviceNames.push(device);
+      this.deviceNos.set(device, no);
+      this.deviceBytes.push(0);
+      this.flushedBytes.push(0);
+    }
+    return no;
+  }
+
+  private roomNo(room: string | null): number {
+    if (!room) return 0;
+    let no = this.roomNos.get(room);
+    if (no === undefined) {
+      no = this.roomNames.length;
+      this.roomNames.push(room);
+      this.roomNos.set(room, no);
+    }
+    return no;
+  }
+
+  private updateGauges(): void {
+    indexDocs.set(this.docs.count);
+    indexTerms.set(this.postings.size);
+  }
+}
+
+export const transcriptStore = new TranscriptStore();
+
+// ==================== 写入通知 ====================
+// 单进程 / 主进程直接写入；集群 worker 由 server.ts 设置转发，经 IPC 交给主进程
+let forward: ((entry: TranscriptEntry) => void) | null = null;
+
+export function setTranscriptForwarder(fn: (entry: TranscriptEntry) => void): void {
+  forward = fn;
+}
+
+export function noteTranscript(entry: TranscriptEntry): void {
+  if (forward) forward(entry);
+  else transcriptStore.add(entry);
+}
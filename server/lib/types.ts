@@ -28,7 +28,7 @@ export interface AsrMessage {
         text: string;
         sentence_end: boolean;
         begin_time: number;
-        end_time: number;
+        end_time: number | null;
       };
     };
     usage?: {
@@ -36,3 +36,10 @@ export interface AsrMessage {
     };
   };
 }
+
+// 某段音频在各环节的时间点（服务器时钟，Date.now()）
+export interface AudioTiming {
+  capturedAt: number; // 设备采集（由帧头换算，旧固件为估计值）
+  receivedAt: number; // 服务器收到
+  sentAt: number; // 转发给 ASR
+}
@@ -0,0 +1,102 @@
+// ==================== 能量 VAD ====================
+// 与原生网关 gateway/src/Segmenter.h 同一套判定：噪声基底跟踪 + 起音 / 拖尾。
+// 除了是否在说话，还给出每帧相对噪声基底的信噪比，供同房间多麦克风择优。
+
+export interface VadConfig {
+  sampleRate: number;
+  thresholdDb: number; // 高于噪声基底多少 dB 判为语音
+  minLevelDb: number; // 绝对下限（dBFS），极安静环境下避免把底噪当语音
+  attackMs: number; // 连续超过阈值多久才算开口
+  hangoverMs: number; // 连续静音多久算说完
+}
+
+export const DEFAULT_VAD_CONFIG: VadConfig = {
+  sampleRate: 16000,
+  thresholdDb: 9,
+  minLevelDb: -50,
+  attackMs: 100,
+  hangoverMs: 500,
+};
+
+export interface VadFrame {
+  levelDb: number;
+  snrDb: number; // 相对噪声基底
+  speaking: boolean;
+  onset: boolean; // 本帧开始一段语音
+}
+
+/**
+ * PCM16 小端电平（dBFS）
+ */
+export function pcmLevelDb(pcm: Buffer): number {
+  const samples = pcm.length >> 1;
+  if (samples === 0) return -120;
+  let sum = 0;
+  for (let i = 0; i < samples; i++) {
+    const s = pcm.readInt16LE(i * 2);
+    sum += s * s;
+  }
+  const rms = Math.sqrt(sum / samples);
+  return rms < 1 ? -120 : 20 * Math.log10(rms / 32768);
+}
+
+/**
+ * 噪声基底跟踪一步：静音时快速下降、缓慢上升，跟随环境噪声变化
+ * @param loud 本帧是否高于判定阈值（高于时上升更慢，避免把语音计入基底）
+ */
+export function nextNoiseFloorDb(floorDb: number, levelDb: number, loud: boolean): number {
+  const rate = levelDb < floorDb ? 0.3 : loud ? 0.005 : 0.05;
+  return floorDb + (levelDb - floorDb) * rate;
+}
+
+export class EnergyVad {
+  private noiseFloorDb = 0;
+  private floorReady = false;
+  private speaking = false;
+  private loudSamples = 0;
+  private silenceSamples = 0;
+  private readonly attackSamples: number;
+  private readonly hangoverSamples: number;
+
+  constructor(private readonly config: VadConfig = DEFAULT_VAD_CONFIG) {
+    this.attackSamples = (config.attackMs * config.sampleRate) / 1000;
+    this.hangoverSamples = (config.hangoverMs * config.sampleRate) / 1000;
+  }
+
+  push(pcm: Buffer): VadFrame {
+    const samples = pcm.length >> 1;
+    const levelDb = pcmLevelDb(pcm);
+    const threshold = Math.max(this.noiseFloorDb + this.config.thresholdDb, this.config.minLevelDb);
+    const loud = this.floorReady && levelDb > threshold;
+    const snrDb = this.floorReady ? levelDb - this.noiseFloorDb : 0;
+    let onset = false;
+
+    if (!this.speaking) {
+      this.updateFloor(levelDb, loud);
+      this.loudSamples = loud ? this.loudSamples + samples : 0;
+      if (this.loudSamples >= this.attackSamples) {
+        this.speaking = true;
+        this.silenceSamples = 0;
+        this.loudSamples = 0;
+        onset = true;
+      }
+    } else {
+      this.silenceSamples = loud ? 0 : this.silenceSamples + samples;
+      if (this.silenceSamples >= this.hangoverSamples) this.speaking = false;
+    }
+    return { levelDb, snrDb, speaking: this.speaking, onset };
+  }
+
+  get isSpeaking(): boolean {
+    return this.speaking;
+  }
+
+  private updateFloor(levelDb: number, loud: boolean) {
+    if (!this.floorReady) {
+      this.noiseFloorDb = levelDb;
+      this.floorReady = true;
+      return;
+    }
+    this.noiseFloorDb = nextNoiseFloorDb(this.noiseFloorDb, levelDb, loud);
+  }
+}
@@ -0,0 +1,90 @@
+import { closeSync, openSync, promises as fsp, writevSync } from "fs";
+
+// ==================== WAV 解析 ====================
+// 归档压缩（lib/archiveWorker.ts）与回放压测（bench/replay.ts）共用；只支持 PCM
+
+export interface WavData {
+  sampleRate: number;
+  channels: number;
+  bitsPerSample: number;
+  samples: Int16Array;
+}
+
+export function parseWav(buffer: Buffer): WavData {
+  if (buffer.toString("ascii", 0, 4) !== "RIFF" || buffer.toString("ascii", 8, 12) !== "WAVE") {
+    throw new Error("不是 WAV 文件");
+  }
+  let offset = 12;
+  let format: Omit<WavData, "samples"> | null = null;
+  while (offset + 8 <= buffer.length) {
+    const id = buffer.toString("ascii", offset, offset + 4);
+    const size = buffer.readUInt32LE(offset + 4);
+    const body = offset + 8;
+    if (id === "fmt ") {
+      if (buffer.readUInt16LE(body) !== 1) throw new Error("只支持 PCM WAV");
+      format = {
+        channels: buffer.readUInt16LE(body + 2),
+        sampleRate: buffer.readUInt32LE(body + 4),
+        bitsPerSample: buffer.readUInt16LE(body + 14),
+      };
+    } else if (id === "data") {
+      if (!format) throw new Error("data 在 fmt 之前");
+      const end = Math.min(body + size, buffer.length);
+      // 复制到对齐的内存，Int16Array 要求偶数偏移
+      const pcm = Buffer.from(buffer.subarray(body, end - ((end - body) % 2)));
+      return {
+        ...format,
+        samples: new Int16Array(pcm.buffer, pcm.byteOffset, pcm.length / 2),
+      };
+    }
+    offset = body + size + (size % 2);
+  }
+  throw new Error("缺少 data 块");
+}
+
+// ==================== WAV 写入 ====================
+// 分段归档：头与各帧一次 writev 写出，不拼接成整块
+
+// 标准 44 字节 PCM WAV 头
+export function wavHeader(dataBytes: number, sampleRate = 16000, channels = 1, bitDepth = 16): Buffer {
+  const blockAlign = channels * (bitDepth / 8);
+  const header = Buffer.allocUnsafe(44);
+  header.write("RIFF", 0, "ascii");
+  header.writeUInt32LE(36 + dataBytes, 4);
+  header.write("WAVE", 8, "ascii");
+  header.write("fmt ", 12, "ascii");
+  header.writeUInt32LE(16, 16);
+  header.writeUInt16LE(1, 20); // PCM
+  header.writeUInt16LE(channels, 22);
+  header.writeUInt32LE(sampleRate, 24);
+  header.writeUInt32LE(sampleRate * blockAlign, 28);
+  header.writeUInt16LE(blockAlign, 32);
+  header.writeUInt16LE(bitDepth, 34);
+  header.write("data", 36, "ascii");
+  header.writeUInt32LE(dataBytes, 40);
+  return header;
+}
+
+/**
+ * 同步写出 16kHz 单声道 PCM WAV
+ * @param chunks PCM 数据块，总长即 data 块长度
+ */
+export function writeWavSync(filePath: string, chunks: Buffer[]): void {
+  const dataBytes = chunks.reduce((sum, chunk) => sum + chunk.length, 0);
+  const fd = openSync(filePath, "w");
+  try {
+    writevSync(fd, [wavHeader(dataBytes), ...chunks]);
+  } finally {
+    closeSync(fd);
+  }
+}
+
+export async function writeWav(filePath: string, chunks: Buffer[]): Promise<void> {
+  const dataBytes = chunks.reduce((sum, chunk) => sum + chunk.length, 0);
+  const handle = await fsp.open(filePath, "w");
+  try {
+    await handle.writev([wavHeader(dataBytes), ...chunks]);
+  } finally {
+    await handle.close();
+  }
+}
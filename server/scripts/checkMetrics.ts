@@ -0,0 +1,57 @@
+import { parsePrometheusText } from "../lib/metrics";
+
+// 抓取 /metrics 并用本地解析器校验格式
+// 用法: npm run metrics:check -- [url]
+const url = process.argv[2] || "http://localhost:3000/metrics";
+
+const REQUIRED = [
+  "audio_ingest_bytes_total",
+  "audio_ingest_frames_total",
+  "audio_frame_interarrival_seconds",
+  "asr_first_partial_latency_seconds",
+  "asr_final_latency_seconds",
+  "relay_command_ack_latency_seconds",
+  "playback_frames_dropped_total",
+  "audio_segment_write_seconds",
+  "nodejs_eventloop_lag_seconds",
+  "nodejs_heap_used_bytes",
+];
+
+async function main() {
+  const res = await fetch(url);
+  if (!res.ok) {
+    throw new Error(`抓取失败: HTTP ${res.status}`);
+  }
+  const contentType = res.headers.get("content-type") || "";
+  if (!contentType.startsWith("text/plain")) {
+    throw new Error(`Content-Type 错误: ${contentType}`);
+  }
+
+  const families = parsePrometheusText(await res.text());
+  const byName = new Map(families.map((f) => [f.name, f]));
+
+  const missing = REQUIRED.filter((name) => !byName.has(name));
+  for (const family of families) {
+    if (family.type === "histogram" && family.samples.length > 0) {
+      const inf = family.samples.filter((s) => s.labels.le === "+Inf");
+      const counts = family.samples.filter((s) => s.name.endsWith("_count"));
+      if (inf.length !== counts.length) {
+        throw new Error(`${family.name}: +Inf 桶与 _count 数量不一致`);
+      }
+    }
+  }
+
+  console.log(`✅ 解析 ${families.length} 个指标族`);
+  for (const family of families) {
+    console.log(`  ${family.type.padEnd(9)} ${family.name} (${family.samples.length})`);
+  }
+  if (missing.length > 0) {
+    console.error(`❌ 缺少指标: ${missing.join(", ")}`);
+    process.exit(1);
+  }
+}
+
+main().catch((error) => {
+  console.error("❌", error.message);
+  process.exit(1);
+});
@@ -0,0 +1,62 @@
+import { createServer } from "http";
+import { appendFileSync } from "fs";
+
+// 本地 OTLP/HTTP JSON collector 替身
+// 用法: npm run traces:collector -- [port] [outFile]
+// 服务器端设置 OTEL_EXPORTER_OTLP_ENDPOINT=http://localhost:4318
+const port = Number(process.argv[2]) || 4318;
+const outFile = process.argv[3] || "traces/collector.jsonl";
+
+interface OtlpSpan {
+  traceId: string;
+  name: string;
+  startTimeUnixNano: string;
+  endTimeUnixNano: string;
+  attributes?: { key: string; value: Record<string, unknown> }[];
+}
+
+const server = createServer((req, res) => {
+  if (req.method !== "POST" || req.url !== "/v1/traces") {
+    res.statusCode = 404;
+    res.end();
+    return;
+  }
+
+  const chunks: Buffer[] = [];
+  req.on("data", (chunk: Buffer) => chunks.push(chunk));
+  req.on("end", () => {
+    const body = Buffer.concat(chunks).toString();
+    try {
+      const payload = JSON.parse(body);
+      appendFileSync(outFile, body + "\n");
+
+      const spans: OtlpSpan[] = payload.resourceSpans.flatMap(
+        (rs: { scopeSpans: { spans: OtlpSpan[] }[] }) =>
+          rs.scopeSpans.flatMap((ss) => ss.spans),
+      );
+      for (const span of spans.filter((s) => s.name === "utterance")) {
+        const text = span.attributes?.find((a) => a.key === "asr.text")?.value
+          .stringValue;
+        const stages = spans
+          .filter((s) => s.traceId === span.traceId && s.name !== "utterance")
+          .map((s) => {
+            const ms =
+              Number(BigInt(s.endTimeUnixNano) - BigInt(s.startTimeUnixNano)) / 1e6;
+            return `${s.name}=${ms.toFixed(0)}ms`;
+          });
+        console.log(`[${span.traceId.slice(0, 8)}] "${text}" ${stages.join(" ")}`);
+      }
+
+      res.setHeader("Content-Type", "application/json");
+      res.end("{}");
+    } catch (error) {
+      console.error("[Collector] 无法解析请求:", error);
+      res.statusCode = 400;
+      res.end();
+    }
+  });
+});
+
+server.listen(port, () => {
+  console.log(`📥 OTLP collector 替身: http://localhost:${port}/v1/traces -> ${outFile}`);
+});
@@ -1,332 +1,856 @@
-import { createRequire } from "module";
-import { createServer } from "http";
+import cluster from "cluster";
+import { createServer, IncomingMessage } from "http";
+import type { ServerResponse } from "http";
+import type { Socket } from "net";
 import { parse } from "url";
-import { writeFileSync } from "fs";
 import path from "path";
 import { fileURLToPath } from "url";
 import next from "next";
 import { WebSocketServer } from "ws";
 import type { WebSocket as WsWebSocket } from "ws";
-import { AsrService } from "./lib/asrService";
+import { metrics, mergeFamilies, renderFamilies } from "./lib/metrics";
+import { parseDeviceStreamInfo } from "./lib/audioFrame";
+import {
+  summarizeTraces,
+  tracer,
+  type TraceSummaryEntry,
+} from "./lib/tracing";
+import { loadShedder, SHED_PLAYBACK } from "./lib/loadShedder";
+import {
+  AUDIO_CONFIG,
+  createAudioPipeline,
+  emptyDrainReport,
+  mergeDrainReports,
+  type DrainReport,
+  type PipelineOutput,
+} from "./lib/audioPipeline";
+import { HashRing } from "./lib/hashRing";
+import { PrimaryBus, WorkerBus, toBuffer, type WorkerMessage } from "./lib/ipcBus";
+import { startGatewayBridge } from "./lib/gatewayBridge";
+import { admitDevice, cpuMonitor, rejectUpgrade, type ProcessLoad } from "./lib/admission";
+import { RATE_CONFIG } from "./lib/rateLimiter";
+import { retentionManager, setArchiveForwarder } from "./lib/retention";
+import { setTranscriptForwarder, transcriptStore } from "./lib/transcripts";
+import { logger } from "./lib/logger";
+import { heartbeatMonitor } from "./lib/heartbeat";
+import { MonitorSet, MONITOR_PREFIX } from "./lib/mixer";
+import { PlaybackHub, playbackDrops } from "./lib/playback";
+import {
+  GroupController,
+  GroupStore,
+  parseGroup,
+  parseScene,
+  type CommandTarget,
+  type OperationResult,
+} from "./lib/groupControl";
 
-const require = createRequire(import.meta.url);
 const __filename = fileURLToPath(import.meta.url);
 const __dirname = path.dirname(__filename);
 
 const CONFIG = {
   dev: process.env.NODE_ENV !== "production",
   hostname: "localhost",
-  port: 3000,
-  audio: {
-    sampleRate: 16000,
-    channels: 1,
-    bitDepth: 16,
-    bufferDurationMs: 10000,
-    autoSaveIntervalMs: 60000, // ✅ 每60秒自动保存
+  port: Number(process.env.PORT) || 3000,
+  // CLUSTER_WORKERS=N 时设备连接按设备 ID 一致性哈希分给 N 个 worker 进程
+  clusterWorkers: Number(process.env.CLUSTER_WORKERS) || 0,
+  // AUDIO_ONLY=1 时不加载 Next.js（压测、纯网关部署）
+  audioOnly: process.env.AUDIO_ONLY === "1",
+  audioDir: process.env.AUDIO_DIR || path.join(__dirname, "public", "audio"),
+  // 设置后监听原生网关（gateway/）的 Unix socket；集群模式下每个 worker 监听 <path>.<slot>
+  gatewaySocket: process.env.GATEWAY_SOCKET || "",
+  groupsFile: process.env.GROUPS_FILE || path.join(__dirname, "data", "groups.json"),
+  transcriptDir: process.env.TRANSCRIPT_DIR || path.join(__dirname, "data", "transcripts"),
+  cluster: {
+    requestTimeoutMs: 2000,
+    respawnDelayMs: 1000,
+    loadReportIntervalMs: 1000,
+  },
+  shutdown: {
+    // SIGTERM / SIGINT 后最迟在这个时间内退出，到期仍未完成的段与 ASR 记为丢弃
+    timeoutMs: Number(process.env.SHUTDOWN_TIMEOUT_MS) || 10000,
+    marginMs: 500, // 留给汇总报告、worker 回报与退出
   },
 } as const;
 
-const BYTES_PER_SAMPLE = CONFIG.audio.channels * (CONFIG.audio.bitDepth / 8);
-const BUFFER_SIZE =
-  (CONFIG.audio.bufferDurationMs / 1000) *
-  CONFIG.audio.sampleRate *
-  BYTES_PER_SAMPLE;
-
-function saveAudioFile(
-  clientId: string,
-  buffer: Buffer,
-  segmentIndex?: number,
-): void {
-  const { WaveFile } = require("wavefile");
-  if (buffer.length % 2 !== 0) {
-    console.error(`Invalid buffer length: ${buffer.length}`);
-    return;
-  }
+// 收尾截止时间：总期限减去余量
+function shutdownDeadline(): number {
+  return Date.now() + CONFIG.shutdown.timeoutMs - CONFIG.shutdown.marginMs;
+}
+
+const httpLog = logger.get("http");
+const playbackLog = logger.get("playback");
+const clusterLog = logger.get("cluster");
+const shutdownLog = logger.get("shutdown");
+
+// ==================== 指标 ====================
+const playbackSubscribers = metrics.gauge(
+  "playback_subscribers",
+  "Connected playback clients",
+);
+
+// ==================== Worker 进程 ====================
+// 只处理设备连接：主进程把升级请求连同 socket 句柄转过来，在这里完成握手
+function runWorker() {
+  const bus = new WorkerBus();
+  const wss = new WebSocketServer({ noServer: true, maxPayload: RATE_CONFIG.maxFrameBytes });
+  const droppedShed = playbackDrops.labels("load_shed");
+
+  const pipeline = createAudioPipeline({
+    audioDir: CONFIG.audioDir,
+    output: {
+      // 没有播放订阅者时不经 IPC 发送音频
+      // IPC 序列化是同步复制，不需要持有帧
+      audio: (clientId, frame, capturedAt) => {
+        if (bus.playbackSubscribers === 0) return;
+        if (loadShedder.level >= SHED_PLAYBACK) {
+          droppedShed.inc(bus.playbackSubscribers);
+          return;
+        }
+        bus.send({ type: "audio", clientId, pcm: frame.pcm, capturedAt });
+      },
+      data: (message) => bus.send({ type: "data", message }),
+      deviceUp: (clientId) => bus.send({ type: "device", clientId, up: true }),
+      deviceDown: (clientId) => bus.send({ type: "device", clientId, up: false }),
+      ack: (clientId, commandId, relay) => bus.send({ type: "ack", clientId, commandId, relay }),
+    },
+  });
+
+  bus.onUpgrade((socket, url, headers, head) => {
+    if (draining) {
+      rejectUpgrade(socket, "draining");
+      return;
+    }
+    const request = new IncomingMessage(socket);
+    request.method = "GET";
+    request.url = url;
+    request.headers = headers;
+    wss.handleUpgrade(request, socket, head, (ws) => {
+      pipeline.handleAudioInput(ws, new URL(url, `http://${headers.host}`));
+    });
+  });
 
-  // ✅ 如果没有数据就不保存
-  if (buffer.length === 0) {
-    console.log(`[${clientId}] 缓冲区为空，跳过保存`);
-    return;
+  if (CONFIG.gatewaySocket) {
+    startGatewayBridge(`${CONFIG.gatewaySocket}.${process.env.CLUSTER_SLOT}`, pipeline);
   }
 
-  const timestamp = new Date().toISOString().replace(/[:.]/g, "-").slice(0, 19);
-  const segmentStr = segmentIndex !== undefined ? `_seg${segmentIndex}` : "";
-  const filePath = path.join(
-    __dirname,
-    "public",
-    "audio",
-    `audio_${clientId}${segmentStr}_${timestamp}.wav`,
+  // 归档目录由主进程统一做保留清理
+  setArchiveForwarder((event) =>
+    bus.send("compressing" in event ? { type: "archive_busy", ...event } : { type: "archive", ...event }),
   );
-
-  const samples = new Int16Array(
-    buffer.buffer,
-    buffer.byteOffset,
-    buffer.byteLength / 2,
+  setTranscriptForwarder((entry) => bus.send({ type: "transcript", entry }));
+
+  // ==================== 停机 ====================
+  // 主进程通知，或本进程直接收到信号（Ctrl+C 时整个进程组都会收到）；只执行一次
+  let draining = false;
+  function shutdown(deadlineAt: number) {
+    if (draining) return;
+    draining = true;
+    const slot = process.env.CLUSTER_SLOT;
+    setTimeout(() => {
+      shutdownLog.error("收尾超时，强制退出", { worker: slot });
+      process.exit(1);
+    }, deadlineAt - Date.now() + CONFIG.shutdown.marginMs).unref();
+    void pipeline.drain(deadlineAt).then((report) => {
+      shutdownLog.info("收尾完成", { worker: slot, ...report });
+      bus.send({ type: "drained", report }, () => process.exit(0));
+    });
+  }
+  bus.onShutdown(shutdown);
+  process.on("SIGTERM", () => shutdown(shutdownDeadline()));
+  process.on("SIGINT", () => shutdown(shutdownDeadline()));
+  // 主进程异常退出，IPC 断开：同样收尾，不留下孤儿进程
+  process.on("disconnect", () => shutdown(shutdownDeadline()));
+
+  bus.handle("metrics", () => metrics.families());
+  bus.handle("traces", (params: { n: number }) => tracer.summary(params.n).traces);
+  bus.handle("logs", (params: { n: number }) => logger.recent(params.n));
+  bus.handle("command", (params: { clientId: string; text: string }) =>
+    pipeline.sendCommand(params.clientId, params.text),
   );
-
-  const wav = new WaveFile();
-  wav.fromScratch(
-    CONFIG.audio.channels,
-    CONFIG.audio.sampleRate,
-    "16",
-    samples,
+  bus.handle("commandBatch", (params: { targets: CommandTarget[] }) =>
+    pipeline.sendCommands(params.targets),
   );
-  writeFileSync(filePath, wav.toBuffer());
-  console.log(`✅ 保存: ${filePath} (${(buffer.length / 1024).toFixed(2)} KB)`);
-}
 
-const app = next({
-  dev: CONFIG.dev,
-  hostname: CONFIG.hostname,
-  port: CONFIG.port,
-});
+  cpuMonitor.start();
+  setInterval(() => {
+    bus.send({
+      type: "load",
+      sessions: pipeline.deviceCount(),
+      lagMs: loadShedder.lagMs,
+      cpu: cpuMonitor.usage,
+    });
+  }, CONFIG.cluster.loadReportIntervalMs).unref();
 
-app.prepare().then(() => {
-  const httpServer = createServer(async (req, res) => {
-    console.log(`${req.method} ${req.url} from ${req.socket.remoteAddress}`);
-    try {
-      await app.getRequestHandler()(req, res, parse(req.url!, true));
-    } catch (err) {
-      console.error("Error handling request:", req.url, err);
-      res.statusCode = 500;
-      res.end("Internal server error");
-    }
-  });
+  clusterLog.info("worker 就绪", { worker: process.env.CLUSTER_SLOT, pid: process.pid });
+}
+
+// ==================== 主进程 ====================
+async function runPrimary() {
+  const app = CONFIG.audioOnly
+    ? null
+    : next({
+        dev: CONFIG.dev,
+        hostname: CONFIG.hostname,
+        port: CONFIG.port,
+      });
+  await app?.prepare();
 
   const wss = new WebSocketServer({
     noServer: true,
+    maxPayload: RATE_CONFIG.maxFrameBytes,
   });
 
-  // 连接管理
-  const audioBuffers = new Map<string, Buffer>();
-  const playbackClients = new Set<WsWebSocket>();
-  const asrInstances = new Map<string, AsrService>();
-  const saveTimers = new Map<string, NodeJS.Timeout>(); // ✅ 保存定时器
-  const segmentCounters = new Map<string, number>(); // ✅ 文件段计数器
-  let clientCounter = 0;
-
-  // 广播音频数据到所有播放客户端
-  function broadcastAudio(data: Buffer) {
-    playbackClients.forEach((client) => {
-      if (client.readyState === 1) {
-        try {
-          client.send(data);
-        } catch (error) {
-          console.error("[Broadcast Audio] 失败:", error);
+  const playback = new PlaybackHub<WsWebSocket>();
+  const playbackClients = playback.clients;
+  // 监听混音：有人订阅 monitor:<组 id> 时把组内设备混成一路（见 lib/mixer.ts）
+  const monitors = new MonitorSet(
+    (groupId) => groups.store.getGroup(groupId),
+    (stream, frame) => playback.broadcastAudio(stream, frame.pcm, frame),
+  );
+
+  loadShedder.start();
+  cpuMonitor.start();
+  void retentionManager.start(CONFIG.audioDir);
+  void transcriptStore.start(CONFIG.transcriptDir);
+
+  const output: PipelineOutput = {
+    audio: (clientId, frame, capturedAt) => {
+      playback.broadcastAudio(clientId, frame.pcm, frame);
+      monitors.push(clientId, frame.pcm, capturedAt);
+    },
+    data: (message) => playback.broadcastData(message),
+    deviceDown: (clientId) => {
+      playback.endStream(clientId);
+      groups.handleDeviceDown(clientId);
+    },
+    ack: (clientId, commandId, relay) => groups.handleAck(clientId, commandId, relay),
+  };
+
+  // ==================== 设备连接分发 ====================
+  // 单进程：本进程直接处理；集群：按设备 ID 一致性哈希转交 worker
+  const ring = new HashRing<PrimaryBus>();
+  const workers = new Map<string, PrimaryBus>(); // slot -> bus
+  const deviceOwners = new Map<string, PrimaryBus>(); // clientId -> bus
+  const workerLoads = new Map<PrimaryBus, ProcessLoad>(); // 各 worker 最近一次上报
+  const drainReports = new Map<PrimaryBus, DrainReport>(); // 停机时各 worker 的收尾报告
+  let shuttingDown = false;
+  let roundRobin = 0;
+
+  const pipeline =
+    CONFIG.clusterWorkers > 0
+      ? null
+      : createAudioPipeline({ audioDir: CONFIG.audioDir, output });
+  if (pipeline && CONFIG.gatewaySocket) {
+    startGatewayBridge(CONFIG.gatewaySocket, pipeline);
+  }
+
+  function handleWorkerMessage(bus: PrimaryBus, msg: WorkerMessage) {
+    switch (msg.type) {
+      case "audio": {
+        const pcm = toBuffer(msg.pcm);
+        playback.broadcastAudio(msg.clientId, pcm);
+        monitors.push(msg.clientId, pcm, msg.capturedAt);
+        break;
+      }
+      case "data":
+        playback.broadcastData(msg.message);
+        break;
+      case "device":
+        if (msg.up) deviceOwners.set(msg.clientId, bus);
+        else if (deviceOwners.get(msg.clientId) === bus) {
+          deviceOwners.delete(msg.clientId);
+          playback.endStream(msg.clientId);
+          groups.handleDeviceDown(msg.clientId);
         }
+        break;
+      case "ack":
+        groups.handleAck(msg.clientId, msg.commandId, msg.relay);
+        break;
+      case "load":
+        workerLoads.set(bus, { sessions: msg.sessions, lagMs: msg.lagMs, cpu: msg.cpu });
+        break;
+      case "archive":
+        retentionManager.track({ filePath: msg.filePath, bytes: msg.bytes, replaces: msg.replaces });
+        break;
+      case "archive_busy":
+        retentionManager.setCompressing({ filePath: msg.filePath, compressing: msg.compressing });
+        break;
+      case "transcript":
+        transcriptStore.add(msg.entry);
+        break;
+      case "drained":
+        drainReports.set(bus, msg.report);
+        break;
+    }
+  }
+
+  function forkWorker(slot: string) {
+    const worker = cluster.fork({ CLUSTER_SLOT: slot });
+    const bus = new PrimaryBus(worker, (msg) => handleWorkerMessage(bus, msg));
+    workers.set(slot, bus);
+    ring.add(slot, bus);
+    worker.on("online", () => {
+      bus.post({ type: "playback", subscribers: playbackClients.size });
+    });
+    worker.on("exit", (code, signal) => {
+      if (shuttingDown) {
+        clusterLog.info("worker 已退出", { worker: slot, code, signal });
+      } else {
+        clusterLog.error("worker 退出，稍后重启", {
+          worker: slot,
+          code,
+          signal,
+          respawnDelayMs: CONFIG.cluster.respawnDelayMs,
+        });
+      }
+      // 同一 slot 重启后环上位置不变，设备重连仍落在该 slot
+      ring.remove(slot);
+      workers.delete(slot);
+      workerLoads.delete(bus);
+      for (const [clientId, owner] of deviceOwners) {
+        if (owner !== bus) continue;
+        deviceOwners.delete(clientId);
+        groups.handleDeviceDown(clientId);
       }
+      if (shuttingDown) return;
+      // 单独停掉的 worker 已自行收尾，报告只记日志
+      const report = drainReports.get(bus);
+      if (report) {
+        drainReports.delete(bus);
+        shutdownLog.info("收尾报告", { worker: slot, ...report });
+      }
+      setTimeout(() => forkWorker(slot), CONFIG.cluster.respawnDelayMs);
     });
   }
 
-  // 广播 JSON 数据到所有播放客户端
-  function broadcastData(data: any) {
-    const message = JSON.stringify(data);
-    playbackClients.forEach((client) => {
-      if (client.readyState === 1) {
+  if (CONFIG.clusterWorkers > 0) {
+    // advanced 序列化：音频帧以二进制传递
+    cluster.setupPrimary({ serialization: "advanced" });
+    for (let i = 1; i <= CONFIG.clusterWorkers; i++) {
+      forkWorker(`worker-${i}`);
+    }
+  }
+
+  function notifyPlaybackSubscribers() {
+    playbackSubscribers.set(playbackClients.size);
+    for (const bus of workers.values()) {
+      bus.post({ type: "playback", subscribers: playbackClients.size });
+    }
+  }
+
+  /**
+   * 向设备下发继电器指令，集群模式下转给持有该设备的 worker
+   * @returns 指令 id；设备不在线时返回 null
+   */
+  async function sendCommand(clientId: string, text: string): Promise<number | null> {
+    if (pipeline) return pipeline.sendCommand(clientId, text);
+    const owner = deviceOwners.get(clientId);
+    if (!owner) return null;
+    return owner.request<number | null>(
+      "command",
+      { clientId, text },
+      CONFIG.cluster.requestTimeoutMs,
+    );
+  }
+
+  /**
+   * 组 / 场景批量下发：单进程同步写入；集群模式按 worker 分批，所有 IPC 请求在同一 tick 发出
+   * @returns 与 targets 一一对应的指令 id，不在线为 null
+   */
+  async function sendCommandBatch(targets: CommandTarget[]): Promise<Array<number | null>> {
+    if (pipeline) return pipeline.sendCommands(targets);
+    const ids: Array<number | null> = targets.map(() => null);
+    const batches = new Map<PrimaryBus, number[]>(); // bus -> targets 下标
+    targets.forEach((target, i) => {
+      const owner = deviceOwners.get(target.clientId);
+      if (!owner) return;
+      const batch = batches.get(owner);
+      if (batch) batch.push(i);
+      else batches.set(owner, [i]);
+    });
+    await Promise.all(
+      [...batches].map(async ([bus, indexes]) => {
         try {
-          client.send(message);
+          const result = await bus.request<Array<number | null>>(
+            "commandBatch",
+            { targets: indexes.map((i) => targets[i]) },
+            CONFIG.cluster.requestTimeoutMs,
+          );
+          indexes.forEach((i, k) => (ids[i] = result[k]));
         } catch (error) {
-          console.error("[Broadcast Data] 失败:", error);
+          clusterLog.error("worker 批量下发失败", { error });
         }
-      }
-    });
+      }),
+    );
+    return ids;
   }
 
-  // 手动处理 WebSocket 升级请求
-  httpServer.on("upgrade", (request, socket, head) => {
-    const pathname = new URL(request.url!, `http://${request.headers.host}`)
-      .pathname;
+  const groups = new GroupController(new GroupStore(CONFIG.groupsFile), sendCommandBatch);
 
-    if (pathname === "/api/audio") {
-      wss.handleUpgrade(request, socket, head, (ws) => {
-        handleAudioInput(ws);
-      });
-    } else if (pathname === "/api/playback") {
-      wss.handleUpgrade(request, socket, head, (ws) => {
-        handlePlaybackClient(ws);
-      });
-    } else {
-      socket.destroy();
+  // 集群模式下从每个 worker 收集结果；超时的 worker 跳过，不拖住整个请求
+  async function collectFromWorkers<T>(method: string, params: unknown = null) {
+    const entries = [...workers.entries()];
+    const results = await Promise.allSettled(
+      entries.map(([, bus]) =>
+        bus.request<T>(method, params, CONFIG.cluster.requestTimeoutMs),
+      ),
+    );
+    const collected: Array<{ slot: string; result: T }> = [];
+    results.forEach((r, i) => {
+      if (r.status === "fulfilled") collected.push({ slot: entries[i][0], result: r.value });
+      else clusterLog.error("worker 请求失败", { worker: entries[i][0], method, error: r.reason });
+    });
+    return collected;
+  }
+
+  async function renderMetrics(): Promise<string> {
+    if (pipeline) return metrics.render();
+    const sources = [{ labels: { worker: "primary" }, families: metrics.families() }];
+    for (const { slot, result } of await collectFromWorkers<ReturnType<typeof metrics.families>>(
+      "metrics",
+    )) {
+      sources.push({ labels: { worker: slot }, families: result });
     }
-  });
+    return renderFamilies(mergeFamilies(sources));
+  }
 
-  // 处理 ESP32 音频输入
-  function handleAudioInput(ws: WsWebSocket) {
-    const clientId = `client_${++clientCounter}`;
-    console.log(`[Audio Input] ESP32 连接: ${clientId}`);
+  async function summarizeRecentTraces(n: number) {
+    if (pipeline) return tracer.summary(n);
+    const traces: TraceSummaryEntry[] = [];
+    for (const { result } of await collectFromWorkers<TraceSummaryEntry[]>("traces", { n })) {
+      traces.push(...result);
+    }
+    traces.sort((a, b) => a.finishedAt - b.finishedAt);
+    return summarizeTraces(traces.slice(-n));
+  }
 
-    audioBuffers.set(clientId, Buffer.alloc(0));
-    segmentCounters.set(clientId, 0);
+  // 各进程内存中最近的日志；两种格式的行都以时间开头，按字符串排序即按时间合并
+  async function recentLogs(n: number): Promise<string[]> {
+    const lines = logger.recent(n);
+    if (pipeline) return lines;
+    for (const { result } of await collectFromWorkers<string[]>("logs", { n })) {
+      lines.push(...result);
+    }
+    return lines.sort().slice(-n);
+  }
 
-    let audioChunkCount = 0;
+  function readBody(req: IncomingMessage, limit: number = 4096): Promise<string> {
+    return new Promise((resolve, reject) => {
+      let body = "";
+      req.setEncoding("utf8");
+      req.on("data", (chunk: string) => {
+        body += chunk;
+        if (body.length > limit) {
+          reject(new Error("请求体过大"));
+          req.destroy();
+        }
+      });
+      req.on("end", () => resolve(body));
+      req.on("error", reject);
+    });
+  }
 
-    // ✅ 启动定时保存
-    const saveTimer = setInterval(() => {
-      const buffer = audioBuffers.get(clientId);
-      if (buffer && buffer.length > 0) {
-        const segmentIndex = segmentCounters.get(clientId) || 0;
-        console.log(`[${clientId}] ⏰ 定时保存 (段 ${segmentIndex + 1})`);
-        saveAudioFile(clientId, buffer, segmentIndex);
+  function sendJson(res: ServerResponse, status: number, body: unknown) {
+    res.statusCode = status;
+    res.setHeader("Content-Type", "application/json; charset=utf-8");
+    res.end(JSON.stringify(body, null, 2));
+  }
 
-        // 保存后清空缓冲区，开始新的段
-        audioBuffers.set(clientId, Buffer.alloc(0));
-        segmentCounters.set(clientId, segmentIndex + 1);
+  // ==================== 组 / 场景 REST ====================
+  //   GET    /api/groups                  PUT|DELETE /api/groups/<id>   {"name","devices":[...],"gains":{<设备>:0~1}}
+  //   POST   /api/groups/<id>/relay       {"relay":1}
+  //   GET    /api/scenes                  PUT|DELETE /api/scenes/<id>   {"name","actions":[{"group"|"device","relay"}]}
+  //   POST   /api/scenes/<id>/activate
+  //   GET    /api/control/stats           最近操作的整组完成延迟百分位
+  async function handleControlApi(req: IncomingMessage, res: ServerResponse): Promise<boolean> {
+    const url = req.url ?? "";
+    const match = /^\/api\/(groups|scenes)(?:\/([^/?]+))?(?:\/(relay|activate))?$/.exec(url);
+    if (url === "/api/control/stats" && req.method === "GET") {
+      sendJson(res, 200, groups.stats());
+      return true;
+    }
+    if (!match) return false;
+    const [, collection, rawId, action] = match;
+    const id = rawId ? decodeURIComponent(rawId) : null;
+    const store = groups.store;
+    try {
+      if (!id) {
+        if (req.method !== "GET") return false;
+        sendJson(res, 200, collection === "groups" ? store.listGroups() : store.listScenes());
+        return true;
       }
-    }, CONFIG.audio.autoSaveIntervalMs);
-
-    saveTimers.set(clientId, saveTimer);
+      if (action) {
+        if (req.method !== "POST") return false;
+        let operation: Promise<OperationResult> | null;
+        if (collection === "groups" && action === "relay") {
+          const { relay } = JSON.parse(await readBody(req));
+          if (relay !== 0 && relay !== 1) {
+            sendJson(res, 400, { error: "relay 必须为 0 或 1" });
+            return true;
+          }
+          operation = groups.runGroup(id, relay);
+        } else if (collection === "scenes" && action === "activate") {
+          operation = groups.activateScene(id);
+        } else {
+          return false;
+        }
+        if (!operation) sendJson(res, 404, { error: "不存在" });
+        else sendJson(res, 200, await operation);
+        return true;
+      }
+      if (req.method === "PUT") {
+        const body = JSON.parse(await readBody(req, 64 * 1024));
+        if (collection === "groups") {
+          const group = parseGroup(id, body);
+          store.putGroup(group);
+          monitors.reload(id);
+          sendJson(res, 200, group);
+        } else {
+          const scene = parseScene(id, body);
+          store.putScene(scene);
+          sendJson(res, 200, scene);
+        }
+        return true;
+      }
+      if (req.method === "DELETE") {
+        const deleted = collection === "groups" ? store.deleteGroup(id) : store.deleteScene(id);
+        if (collection === "groups") monitors.reload(id);
+        res.statusCode = deleted ? 204 : 404;
+        res.end();
+        return true;
+      }
+      if (req.method === "GET") {
+        const item = collection === "groups" ? store.getGroup(id) : store.getScene(id);
+        sendJson(res, item ? 200 : 404, item ?? { error: "不存在" });
+        return true;
+      }
+      return false;
+    } catch (error) {
+      sendJson(res, 400, { error: error instanceof Error ? error.message : String(error) });
+      return true;
+    }
+  }
 
-    // 为当前客户端创建独立的 ASR 实例
-    const asrService = new AsrService(
+  // ==================== 转写检索 ====================
+  //   GET /api/transcripts?q=开灯&room=3&device=<id>&since=<ms|ISO>&until=<ms|ISO>&limit=50
+  // 每条结果附带当前的归档文件名（已被保留策略清理时为 null）与句子在文件中的偏移
+  async function searchTranscripts(params: URLSearchParams): Promise<[number, unknown]> {
+    const text = params.get("q")?.trim();
+    if (!text) return [400, { error: "缺少 q" }];
+    const time = (name: string) => {
+      const value = params.get(name);
+      if (!value) return undefined;
+      return /^\d+$/.test(value) ? Number(value) : Date.parse(value);
+    };
+    const since = time("since");
+    const until = time("until");
+    if (Number.isNaN(since) || Number.isNaN(until)) return [400, { error: "since / until 无法解析" }];
+    const result = await transcriptStore.search({
+      text,
+      device: params.get("device") ?? undefined,
+      room: params.get("room") ?? undefined,
+      since,
+      until,
+      limit: Number(params.get("limit")) || undefined,
+    });
+    return [
+      200,
       {
-        onResult: (text, isEnd) => {
-          console.log(`[识别 ${clientId}] ${isEnd ? "✅" : "📝"} "${text}"`);
-
-          // 广播到浏览器
-          broadcastData({
-            type: "asr_result",
-            text,
-            isEnd,
-            clientId,
-          });
-
-          // 只发送给对应的 ESP32
-          if (ws.readyState === 1 && isEnd) {
-            try {
-              ws.send(text);
-            } catch (error) {
-              console.error(`[ESP32 ${clientId}] 发送失败:`, error);
-            }
-          }
-        },
-        onComplete: () => {
-          console.log(`[ASR ${clientId}] 流结束`);
-        },
-        onError: (error) => {
-          console.error(`[ASR ${clientId}] 错误:`, error);
-
-          if (error.includes("NO_INPUT_AUDIO_ERROR")) {
-            console.warn(`[${clientId}] 已收到 ${audioChunkCount} 个音频块`);
-          }
-        },
+        ...result,
+        hits: result.hits.map((hit) => ({
+          ...hit,
+          time: new Date(hit.ts).toISOString(),
+          file: hit.archive ? retentionManager.resolve(hit.archive) : null,
+        })),
       },
-      clientId,
-    );
-
-    asrInstances.set(clientId, asrService);
-
-    ws.on("message", (data: Buffer) => {
-      const currentBuffer = audioBuffers.get(clientId);
-      if (!currentBuffer) return;
-
-      audioChunkCount++;
+    ];
+  }
 
-      // 广播实时音频到播放客户端
-      broadcastAudio(data);
+  const httpServer = createServer(async (req, res) => {
+    if (req.url === "/metrics") {
+      res.setHeader("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+      res.end(await renderMetrics());
+      return;
+    }
+    if (req.url?.startsWith("/traces")) {
+      // 最近 N 条指令的分阶段延迟：/traces?n=20
+      const n = Number(new URL(req.url, "http://localhost").searchParams.get("n")) || 20;
+      sendJson(res, 200, await summarizeRecentTraces(n));
+      return;
+    }
+    if (req.url?.startsWith("/logs")) {
+      // 最近 N 条日志（含未写出的）：/logs?n=200
+      const n = Number(new URL(req.url, "http://localhost").searchParams.get("n")) || 200;
+      res.setHeader("Content-Type", "text/plain; charset=utf-8");
+      res.end((await recentLogs(n)).join(""));
+      return;
+    }
+    if (await handleControlApi(req, res)) return;
+    if (req.url?.startsWith("/api/transcripts") && req.method === "GET") {
+      sendJson(res, ...(await searchTranscripts(new URL(req.url, "http://localhost").searchParams)));
+      return;
+    }
 
-      // 发送到该客户端专属的 ASR 服务
-      const asr = asrInstances.get(clientId);
-      if (asr) {
-        asr.appendAudioChunk(data);
+    // 手动下发指令：POST /api/devices/<clientId>/command  {"text":"开灯"}
+    const commandMatch = /^\/api\/devices\/([^/?]+)\/command$/.exec(req.url ?? "");
+    if (commandMatch && req.method === "POST") {
+      try {
+        const { text } = JSON.parse(await readBody(req));
+        if (typeof text !== "string" || !text) {
+          sendJson(res, 400, { error: "缺少 text" });
+          return;
+        }
+        const id = await sendCommand(decodeURIComponent(commandMatch[1]), text);
+        sendJson(res, id === null ? 404 : 200, id === null ? { error: "设备不在线" } : { id });
+      } catch (error) {
+        sendJson(res, 400, { error: String(error) });
       }
+      return;
+    }
 
-      // ✅ 追加到缓冲区（不再检查 BUFFER_SIZE）
-      const newBuffer = Buffer.concat([currentBuffer, data]);
-      audioBuffers.set(clientId, newBuffer);
-    });
+    if (!app) {
+      res.statusCode = 404;
+      res.end("Not found");
+      return;
+    }
+    httpLog.debug("request", { method: req.method, url: req.url, remote: req.socket.remoteAddress });
+    try {
+      await app.getRequestHandler()(req, res, parse(req.url!, true));
+    } catch (err) {
+      httpLog.error("请求处理失败", { url: req.url, error: err });
+      res.statusCode = 500;
+      res.end("Internal server error");
+    }
+  });
 
-    ws.on("close", () => {
-      // ✅ 清除定时器
-      const timer = saveTimers.get(clientId);
-      if (timer) {
-        clearInterval(timer);
-        saveTimers.delete(clientId);
-      }
+  // 手动处理 WebSocket 升级请求
+  httpServer.on("upgrade", (request, socket, head) => {
+    if (shuttingDown) {
+      rejectUpgrade(socket, "draining");
+      return;
+    }
+    const url = new URL(request.url!, `http://${request.headers.host}`);
+    const pathname = url.pathname;
 
-      // ✅ 保存最后的数据
-      const remainingBuffer = audioBuffers.get(clientId);
-      if (remainingBuffer?.length) {
-        const segmentIndex = segmentCounters.get(clientId) || 0;
-        console.log(
-          `[${clientId}] 连接断开，保存最后数据 (段 ${segmentIndex + 1})...`,
-        );
-        saveAudioFile(clientId, remainingBuffer, segmentIndex);
+    if (pathname === "/api/audio") {
+      if (pipeline) {
+        const sessions = pipeline.deviceCount();
+        const reason = admitDevice(sessions, {
+          sessions,
+          lagMs: loadShedder.lagMs,
+          cpu: cpuMonitor.usage,
+        });
+        if (reason) {
+          rejectUpgrade(socket, reason);
+          return;
+        }
+        wss.handleUpgrade(request, socket, head, (ws) => {
+          pipeline.handleAudioInput(ws, url);
+        });
+        return;
       }
-
-      // 清理资源
-      audioBuffers.delete(clientId);
-      segmentCounters.delete(clientId);
-      const asr = asrInstances.get(clientId);
-      if (asr) {
-        asr.destroy();
-        asrInstances.delete(clientId);
+      // 同一设备总是落在同一 worker；同一房间的设备按房间哈希，仲裁需要它们在一起；
+      // 旧固件没有 ID，轮询分配
+      const { deviceId, room } = parseDeviceStreamInfo(url);
+      const routeKey = room ? `room:${room}` : deviceId;
+      const bus = routeKey
+        ? ring.get(routeKey)
+        : [...workers.values()][roundRobin++ % Math.max(workers.size, 1)];
+      if (!bus) {
+        socket.destroy();
+        return;
       }
-
-      console.log(
-        `[Audio Input] ESP32 断开: ${clientId} (剩余: ${asrInstances.size})`,
+      const reason = admitDevice(
+        deviceOwners.size,
+        workerLoads.get(bus) ?? { sessions: 0, lagMs: 0, cpu: 0 },
       );
-    });
-
-    ws.on("error", (error) => {
-      console.error(`[${clientId}] WebSocket 错误:`, error);
-
-      // ✅ 清除定时器
-      const timer = saveTimers.get(clientId);
-      if (timer) {
-        clearInterval(timer);
-        saveTimers.delete(clientId);
+      if (reason) {
+        rejectUpgrade(socket, reason);
+        return;
       }
+      bus.handOff(socket as Socket, request.url!, request.headers, head);
+    } else if (pathname === "/api/playback") {
+      wss.handleUpgrade(request, socket, head, (ws) => {
+        void handlePlaybackClient(ws, url);
+      });
+    } else if (pathname === "/api/control") {
+      wss.handleUpgrade(request, socket, head, (ws) => {
+        handleControlClient(ws);
+      });
+    } else {
+      socket.destroy();
+    }
+  });
 
-      // 错误时也要清理
-      audioBuffers.delete(clientId);
-      segmentCounters.delete(clientId);
-      const asr = asrInstances.get(clientId);
-      if (asr) {
-        asr.destroy();
-        asrInstances.delete(clientId);
-      }
-    });
-  }
-
-  // 处理浏览器播放客户端
-  function handlePlaybackClient(ws: WsWebSocket) {
-    console.log(`[Playback] 浏览器连接 (总数: ${playbackClients.size + 1})`);
-    playbackClients.add(ws);
-
-    // 发送音频配置
+  // 处理浏览器播放客户端；?codec=opus 订阅 Opus（见 lib/opusLive.ts），默认 PCM
+  // ?stream=<设备 id> 只收一台设备，?stream=monitor:<组 id> 收该组的混音；缺省为全部设备
+  async function handlePlaybackClient(ws: WsWebSocket, url: URL) {
+    const stream = url.searchParams.get("stream") || null;
+    const monitor = stream?.startsWith(MONITOR_PREFIX) ? stream.slice(MONITOR_PREFIX.length) : null;
+    // ffmpeg 不支持 Opus 时退回 PCM，由 config 里的 codec 告知浏览器
+    const codec =
+      url.searchParams.get("codec") === "opus" && (await playback.opus.available()) ? "opus" : "pcm";
+    if (ws.readyState !== 1) return; // 探测期间已断开
+    if (monitor !== null && !monitors.acquire(monitor)) {
+      ws.close(1008, "组不存在");
+      return;
+    }
+    // 先发配置再登记：Opus 订阅者登记时会收到已在编码的流，须排在配置之后
     ws.send(
       JSON.stringify({
         type: "config",
-        sampleRate: CONFIG.audio.sampleRate,
-        channels: CONFIG.audio.channels,
-        bitDepth: CONFIG.audio.bitDepth,
+        codec,
+        stream,
+        sampleRate: AUDIO_CONFIG.sampleRate,
+        channels: AUDIO_CONFIG.channels,
+        bitDepth: AUDIO_CONFIG.bitDepth,
       }),
     );
+    playback.add(ws, codec, stream);
+    playbackLog.info("浏览器连接", { total: playbackClients.size, codec, stream: stream ?? undefined });
+    notifyPlaybackSubscribers();
+
+    // 浏览器自动回 pong；休眠的笔记本、断网的手机留下的半开连接由心跳回收
+    const heartbeat = heartbeatMonitor.track(ws, "playback");
+    ws.on("pong", heartbeat.touch);
+
+    // close 与 error 都会走到这里，只执行一次
+    let released = false;
+    const release = () => {
+      if (released) return;
+      released = true;
+      heartbeat.release();
+      playback.delete(ws);
+      if (monitor !== null) monitors.release(monitor);
+      notifyPlaybackSubscribers();
+      playbackLog.info("浏览器断开", { remaining: playbackClients.size });
+    };
+    ws.on("close", release);
 
-    ws.on("close", () => {
-      playbackClients.delete(ws);
-      console.log(`[Playback] 浏览器断开 (剩余: ${playbackClients.size})`);
+    ws.on("error", (error) => {
+      playbackLog.error("WebSocket 错误", { error });
+      release();
+      ws.terminate();
     });
+  }
 
+  // 控制通道：{"type":"group","id":"floor3","relay":1,"reqId":1}
+  //          {"type":"scene","id":"night","reqId":2} / {"type":"stats","reqId":3}
+  // 每台设备回执或超时推送一条 progress，全部结束后推送 result
+  function handleControlClient(ws: WsWebSocket) {
+    const reply = (message: Record<string, unknown>) => {
+      if (ws.readyState === 1) ws.send(JSON.stringify(message));
+    };
+    ws.on("message", async (data: Buffer, isBinary: boolean) => {
+      if (isBinary) return;
+      let request: { type?: string; id?: string; relay?: number; reqId?: unknown };
+      try {
+        request = JSON.parse(data.toString());
+      } catch {
+        reply({ type: "error", error: "无效的 JSON" });
+        return;
+      }
+      const { reqId } = request;
+      if (request.type === "stats") {
+        reply({ type: "stats", reqId, ...groups.stats() });
+        return;
+      }
+      const onProgress = (opId: number, result: unknown) =>
+        reply({ type: "progress", reqId, opId, result });
+      let operation: Promise<OperationResult> | null = null;
+      if (request.type === "group" && (request.relay === 0 || request.relay === 1)) {
+        operation = groups.runGroup(String(request.id), request.relay, onProgress);
+      } else if (request.type === "scene") {
+        operation = groups.activateScene(String(request.id), onProgress);
+      } else {
+        reply({ type: "error", reqId, error: "未知请求" });
+        return;
+      }
+      if (!operation) {
+        reply({ type: "error", reqId, error: "不存在" });
+        return;
+      }
+      reply({ type: "result", reqId, ...(await operation) });
+    });
     ws.on("error", (error) => {
-      console.error("[Playback] 错误:", error);
-      playbackClients.delete(ws);
+      httpLog.error("控制通道错误", { error });
     });
   }
 
+  // ==================== 停机 ====================
+  // 1. 不再接受新连接与升级；2-4. 设备收尾（关闭通知、并发写盘、ASR finish-task），
+  //    单进程在本进程执行，集群模式通知各 worker 执行并汇总报告；5. 期限内退出
+  async function drainWorkers(deadlineAt: number): Promise<DrainReport> {
+    const buses = [...workers.entries()];
+    for (const [, bus] of buses) bus.post({ type: "shutdown", deadlineAt });
+    await Promise.race([
+      Promise.all(
+        buses.map(([, bus]) =>
+          bus.worker.isDead() ? null : new Promise((resolve) => bus.worker.once("exit", resolve)),
+        ),
+      ),
+      new Promise((resolve) => setTimeout(resolve, deadlineAt - Date.now() + CONFIG.shutdown.marginMs / 2)),
+    ]);
+    const reports: DrainReport[] = [];
+    for (const [slot, bus] of buses) {
+      const report = drainReports.get(bus);
+      if (report) reports.push(report);
+      else shutdownLog.error("worker 未在期限内回报，其设备的缓冲音频可能丢失", { worker: slot });
+    }
+    return reports.length > 0 ? mergeDrainReports(reports) : emptyDrainReport();
+  }
+
+  async function shutdown(signal: NodeJS.Signals) {
+    if (shuttingDown) {
+      shutdownLog.warn("再次收到信号，立即退出", { signal });
+      process.exit(1);
+    }
+    shuttingDown = true;
+    const deadlineAt = shutdownDeadline();
+    shutdownLog.info("收到信号，停止接入", { signal, timeoutMs: CONFIG.shutdown.timeoutMs });
+    setTimeout(() => {
+      shutdownLog.error("超过期限，强制退出");
+      process.exit(1);
+    }, CONFIG.shutdown.timeoutMs).unref();
+
+    httpServer.close();
+    retentionManager.stop();
+    const report = pipeline ? await pipeline.drain(deadlineAt) : await drainWorkers(deadlineAt);
+    // 收尾期间的最终识别结果已推送，最后断开浏览器
+    playback.opus.stopAll();
+    for (const client of playbackClients) client.close(1001, "server shutting down");
+    await transcriptStore.close();
+    shutdownLog.info("收尾完成", { ...report });
+    process.exit(0);
+  }
+
+  process.on("SIGTERM", () => void shutdown("SIGTERM"));
+  process.on("SIGINT", () => void shutdown("SIGINT"));
+
   httpServer.listen(CONFIG.port, (err?: Error) => {
     if (err) throw err;
-    console.log(
-      `\n🚀 Server ready on http://${CONFIG.hostname}:${CONFIG.port}`,
-    );
-    console.log(
-      `📡 Audio Input: ws://${CONFIG.hostname}:${CONFIG.port}/api/audio`,
-    );
-    console.log(
-      `🔊 Audio Playback: ws://${CONFIG.hostname}:${CONFIG.port}/api/playback`,
-    );
-    console.log(
-      `⏰ Auto-save: Every ${CONFIG.audio.autoSaveIntervalMs / 1000}s\n`,
-    );
+    // 与其他日志走同一个 sink，console 的同步写不会插进异步写了一半的记录里
+    const host = `${CONFIG.hostname}:${CONFIG.port}`;
+    httpLog.info("服务已就绪", {
+      url: `http://${host}`,
+      audioInput: `ws://${host}/api/audio`,
+      playback: `ws://${host}/api/playback`,
+      metrics: `http://${host}/metrics`,
+      traces: `http://${host}/traces`,
+      logs: `http://${host}/logs`,
+      transcripts: `http://${host}/api/transcripts?q=`,
+      control: `ws://${host}/api/control`,
+      workers: CONFIG.clusterWorkers > 0 ? CONFIG.clusterWorkers : undefined,
+      autoSaveS: AUDIO_CONFIG.autoSaveIntervalMs / 1000,
+    });
   });
-});
+}
+
+if (cluster.isPrimary) {
+  runPrimary().catch((err) => {
+    clusterLog.error("启动失败", { error: err });
+    process.exit(1);
+  });
+} else {
+  runWorker();
+}